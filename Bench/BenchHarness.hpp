@@ -0,0 +1,232 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <chrono>
+#include <vector>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+///
+/// Minimal timing helper for micro benchmarks - warm up, then measure `repeats` runs of `func`.
+/// Each run is timed separately, result keeps min/median/mean/max/stddev in milliseconds.
+///
+namespace Bench
+{
+
+struct Result {
+    uint32_t repeats = 0;
+    double minMs = 0.0;
+    double medianMs = 0.0;
+    double meanMs = 0.0;
+    double maxMs = 0.0;
+    double stddevMs = 0.0;
+};
+
+template <typename Func>
+Result run(uint32_t repeats, Func func, uint32_t warmUp = 3)
+{
+    for (uint32_t i = 0; i < warmUp; ++i) {
+        func();
+    }
+
+    std::vector<double> times;
+    times.reserve(repeats);
+    for (uint32_t i = 0; i < repeats; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        func();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    Result result;
+    if (times.empty()) {
+        return result;
+    }
+    std::sort(times.begin(), times.end());
+    result.repeats = static_cast<uint32_t>(times.size());
+    result.minMs = times.front();
+    result.maxMs = times.back();
+    result.medianMs = times[times.size() / 2];
+    for (double t : times) {
+        result.meanMs += t;
+    }
+    result.meanMs /= times.size();
+    for (double t : times) {
+        result.stddevMs += (t - result.meanMs) * (t - result.meanMs);
+    }
+    result.stddevMs = std::sqrt(result.stddevMs / times.size());
+    return result;
+}
+
+///
+/// Distribution of samples measured elsewhere e.g. frame times - nearest rank percentiles.
+///
+struct Distribution {
+    size_t count = 0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+    double meanMs = 0.0;
+    double p50Ms = 0.0;
+    double p95Ms = 0.0;
+    double p99Ms = 0.0;
+};
+
+inline Distribution distribution(std::vector<double> samples)
+{
+    Distribution result;
+    if (samples.empty()) {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    auto percentile = [&samples](double p) {
+        size_t rank = static_cast<size_t>(p * (samples.size() - 1) + 0.5);
+        return samples[std::min(rank, samples.size() - 1)];
+    };
+    result.count = samples.size();
+    result.minMs = samples.front();
+    result.maxMs = samples.back();
+    for (double t : samples) {
+        result.meanMs += t;
+    }
+    result.meanMs /= samples.size();
+    result.p50Ms = percentile(0.50);
+    result.p95Ms = percentile(0.95);
+    result.p99Ms = percentile(0.99);
+    return result;
+}
+
+inline void print(const char* name, const Result& result, double itemsPerRun = 0.0)
+{
+    if (itemsPerRun > 0.0) {
+        printf("%-40s min %9.4f ms  median %9.4f ms  mean %9.4f ms  %8.3f ns/item\n",
+               name, result.minMs, result.medianMs, result.meanMs, result.medianMs * 1.0e6 / itemsPerRun);
+    }
+    else {
+        printf("%-40s min %9.4f ms  median %9.4f ms  mean %9.4f ms\n",
+               name, result.minMs, result.medianMs, result.meanMs);
+    }
+}
+
+///
+/// Machine readable results for regression tracking:
+///     { "info": { "key": "value", ... }, "results": [ { "name": ..., "repeats": ..., "minMs": ..., ... }, ... ] }
+///
+class JsonReport
+{
+public:
+    void setInfo(const std::string& key, const std::string& value) { mInfo.emplace_back(key, value); }
+
+    void add(const std::string& name, const Result& result, double itemsPerRun = 0.0)
+    {
+        mResults.push_back(Entry{name, result, itemsPerRun});
+    }
+
+    bool write(const char* path) const
+    {
+        FILE* file = fopen(path, "w");
+        if (!file) {
+            printf("Can't open %s\n", path);
+            return false;
+        }
+        fprintf(file, "{\n  \"info\": {");
+        for (size_t i = 0; i < mInfo.size(); ++i) {
+            fprintf(file, "%s\n    \"%s\": \"%s\"", i ? "," : "", escape(mInfo[i].first).c_str(), escape(mInfo[i].second).c_str());
+        }
+        fprintf(file, "\n  },\n  \"results\": [");
+        for (size_t i = 0; i < mResults.size(); ++i) {
+            const Entry& e = mResults[i];
+            fprintf(file, "%s\n    { \"name\": \"%s\", \"repeats\": %u, \"minMs\": %.6f, \"medianMs\": %.6f, \"meanMs\": %.6f, \"maxMs\": %.6f, \"stddevMs\": %.6f, \"itemsPerRun\": %.0f }",
+                    i ? "," : "", escape(e.name).c_str(), e.result.repeats, e.result.minMs, e.result.medianMs,
+                    e.result.meanMs, e.result.maxMs, e.result.stddevMs, e.itemsPerRun);
+        }
+        fprintf(file, "\n  ]\n}\n");
+        fclose(file);
+        return true;
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        Result result;
+        double itemsPerRun;
+    };
+
+    static std::string escape(const std::string& text)
+    {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                result += '\\';
+            }
+            result += c;
+        }
+        return result;
+    }
+
+    std::vector<std::pair<std::string, std::string>> mInfo;
+    std::vector<Entry> mResults;
+};
+
+// keeps compiler from removing computation which result is not used
+template <typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+///
+/// Command line option `name` followed by value at argv[i] - on match the value is parsed (at least minValue)
+/// and i is moved to it. Chain calls with && ! to parse options of a benchmark.
+///
+inline bool option(int argc, char* argv[], int& i, const char* name, uint32_t& value, uint32_t minValue = 0)
+{
+    if (strcmp(argv[i], name) != 0 || i + 1 >= argc) {
+        return false;
+    }
+    value = std::max(minValue, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+    return true;
+}
+
+inline bool option(int argc, char* argv[], int& i, const char* name, std::string& value)
+{
+    if (strcmp(argv[i], name) != 0 || i + 1 >= argc) {
+        return false;
+    }
+    value = argv[++i];
+    return true;
+}
+
+}
@@ -0,0 +1,192 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include <Scan/DepthBackProjector.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace {
+
+struct Options {
+    uint32_t repeats = 50;
+    std::string output = "depth_back_project_bench.json";
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--repeats") == 0 && value) {
+            options.repeats = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--output") == 0 && value) {
+            options.output = argv[++i];
+        }
+        else {
+            printf("Usage: depth_back_project_bench [--repeats N] [--output FILE]\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// Synthetic depth frame - wavy wall 1.5 .. 2.5 m away with ~5% holes (0) and far pixels out of range
+//
+struct Frame {
+    CameraIntrinsics intrinsics;
+    std::vector<uint16_t> depthMm;
+    std::vector<float> depthM;
+    std::vector<uint32_t> colors;
+};
+
+Frame syntheticFrame(uint32_t width, uint32_t height)
+{
+    Frame frame;
+    frame.intrinsics.width = width;
+    frame.intrinsics.height = height;
+    frame.intrinsics.fx = frame.intrinsics.fy = 0.8f * width; // ~64 deg horizontal field of view
+    frame.intrinsics.cx = 0.5f * width - 0.5f;
+    frame.intrinsics.cy = 0.5f * height - 0.5f;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    size_t pixels = size_t(width) * height;
+    frame.depthMm.resize(pixels);
+    frame.depthM.resize(pixels);
+    frame.colors.resize(pixels);
+    for (uint32_t v = 0; v < height; ++v) {
+        for (uint32_t u = 0; u < width; ++u) {
+            size_t i = size_t(v) * width + u;
+            float depth = 2.f + 0.5f * std::sin(u * 0.02f) * std::cos(v * 0.03f);
+            float r = unit(rng);
+            if (r < 0.05f) {
+                depth = 0.f;
+            }
+            else if (r < 0.06f) {
+                depth = 20.f;
+            }
+            frame.depthMm[i] = static_cast<uint16_t>(depth * 1000.f + 0.5f);
+            frame.depthM[i] = frame.depthMm[i] * 0.001f;
+            frame.colors[i] = 0xff000000u | (uint32_t(v & 0xff) << 8) | uint32_t(u & 0xff);
+        }
+    }
+    return frame;
+}
+
+bool samePoints(const PointCloudData& a, const PointCloudData& b)
+{
+    if (a.size() != b.size() || a.colors != b.colors) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        glm::vec3 d = a.positions[i] - b.positions[i];
+        if (std::fabs(d.x) > 1e-5f || std::fabs(d.y) > 1e-5f || std::fabs(d.z) > 1e-5f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+}
+
+///
+/// Depth back projection (DepthBackProjector) of 640x480 and 1280x720 frames - 16-bit millimeters with colors
+/// and float meters - for every supported SIMD path with one and all threads.
+/// Reports Mpixels/s and the share of a 30 Hz frame (33.3 ms) one frame costs; results are checked against scalar path.
+///
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    const double FrameBudgetMs = 1000.0 / 30.0;
+    const Simd::Path paths[] = {Simd::Scalar, Simd::Avx2, Simd::Neon};
+    const uint32_t threadCounts[] = {1, 0};
+    const uint32_t resolutions[][2] = {{640, 480}, {1280, 720}};
+
+    Bench::JsonReport report;
+    report.setInfo("hardwareThreads", std::to_string(std::thread::hardware_concurrency()));
+    report.setInfo("repeats", std::to_string(options.repeats));
+    bool ok = true;
+    for (const uint32_t* resolution : resolutions) {
+        Frame frame = syntheticFrame(resolution[0], resolution[1]);
+        ColorImage color;
+        color.pixels = frame.colors.data();
+        color.width = resolution[0];
+        color.height = resolution[1];
+
+        for (int floatDepth = 0; floatDepth < 2; ++floatDepth) {
+            PointCloudData reference;
+            for (Simd::Path path : paths) {
+                if (!Simd::isSupported(path)) {
+                    continue;
+                }
+                for (uint32_t threads : threadCounts) {
+                    DepthBackProjector projector;
+                    projector.setIntrinsics(frame.intrinsics);
+                    projector.setDepthRange(0.1f, 10.f);
+                    projector.setSimdPath(path);
+                    projector.setMaxThreads(threads);
+                    PointCloudData points;
+                    Bench::Result result = Bench::run(options.repeats, [&]() {
+                        if (floatDepth) {
+                            projector.project(frame.depthM.data(), points);
+                        }
+                        else {
+                            projector.project(frame.depthMm.data(), 0.001f, points, color);
+                        }
+                        Bench::doNotOptimize(points.positions.data());
+                    });
+
+                    const DepthBackProjector::Stats& stats = projector.stats();
+                    std::string name = std::to_string(resolution[0]) + "x" + std::to_string(resolution[1])
+                                     + (floatDepth ? " float" : " uint16+color") + ", " + Simd::name(path)
+                                     + ", threads: " + std::to_string(stats.threads);
+                    Bench::print(name.c_str(), result, static_cast<double>(stats.pixels));
+                    printf("%-40s %9.1f Mpixels/s  %5.1f%% of 30 Hz frame\n", "",
+                           stats.pixels / result.medianMs / 1000.0, 100.0 * result.medianMs / FrameBudgetMs);
+                    report.add(name, result, static_cast<double>(stats.pixels));
+
+                    if (reference.size() == 0) {
+                        reference = std::move(points);
+                    }
+                    else if (!samePoints(reference, points)) {
+                        printf("    ERROR: points differ from scalar single thread\n");
+                        ok = false;
+                    }
+                }
+            }
+        }
+    }
+    return report.write(options.output.c_str()) && ok ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include <Graphic/BoundsCuller.hpp>
+#include <Graphic/Frustum.hpp>
+#include <glm/ext.hpp>
+#include <random>
+#include <string>
+#include <cstdlib>
+
+///
+/// Frustum culling of random spheres - every available SIMD path, single thread and all threads.
+/// Usage: frustum_cull_bench [sphereCount] [repeats]
+///
+int main(int argc, char* argv[])
+{
+    size_t sphereCount = argc > 1 ? static_cast<size_t>(std::strtoul(argv[1], nullptr, 10)) : 1000000;
+    uint32_t repeats = argc > 2 ? static_cast<uint32_t>(std::strtoul(argv[2], nullptr, 10)) : 50;
+
+    // Camera in the middle of the cloud - roughly 1/6 of spheres is visible
+    glm::mat4 proj = glm::perspective(glm::radians(60.f), 16.f / 9.f, 0.1f, 500.f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.f), glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, 1.f, 0.f));
+    Frustum frustum = Frustum::fromMatrix(proj * view);
+
+    BoundsCuller culler;
+    culler.resize(sphereCount);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-400.f, 400.f);
+    std::uniform_real_distribution<float> radius(0.1f, 5.f);
+    for (size_t i = 0; i < sphereCount; ++i) {
+        culler.set(i, glm::vec3(position(rng), position(rng), position(rng)), radius(rng));
+    }
+
+    printf("Spheres: %zu, repeats: %u\n", sphereCount, repeats);
+    uint32_t expectedVisible = 0;
+    const BoundsCuller::SimdPath paths[] = {BoundsCuller::SimdScalar, BoundsCuller::SimdSse, BoundsCuller::SimdAvx, BoundsCuller::SimdNeon};
+    for (BoundsCuller::SimdPath path : paths) {
+        if (!BoundsCuller::isSupported(path)) {
+            continue;
+        }
+        culler.setSimdPath(path);
+        const uint32_t threadCounts[] = {1, 0};
+        for (uint32_t threads : threadCounts) {
+            culler.setMaxThreads(threads);
+            Bench::Result result = Bench::run(repeats, [&]() {
+                Bench::doNotOptimize(culler.cull(frustum));
+            });
+            std::string name = std::string(BoundsCuller::simdPathName(path)) + ", threads: " + std::to_string(culler.stats().threads);
+            Bench::print(name.c_str(), result, static_cast<double>(sphereCount));
+
+            if (!expectedVisible) {
+                expectedVisible = culler.stats().visible;
+            }
+            else if (expectedVisible != culler.stats().visible) {
+                printf("    ERROR: visible %u, scalar reference %u\n", culler.stats().visible, expectedVisible);
+                return 1;
+            }
+        }
+    }
+    printf("Visible: %u of %zu\n", expectedVisible, sphereCount);
+    return 0;
+}
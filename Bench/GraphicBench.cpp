@@ -0,0 +1,300 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include <Graphic/HeadlessContext.hpp>
+#include <Graphic/ResourceManager.hpp>
+#include <Graphic/PipelineManager.hpp>
+#include <Graphic/GraphicObject.hpp>
+#include <Graphic/BufferDescr.hpp>
+#include <Graphic/ImageDescr.hpp>
+#include <Graphic/FrameArena.hpp>
+#include <QVariant>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+Q_DECLARE_METATYPE(VkDescriptorBufferInfo);
+
+namespace {
+
+///
+/// Shader reflection is protected - only pipelines are public API
+///
+class BenchPipelineManager : public PipelineManager
+{
+public:
+    using PipelineManager::PipelineManager;
+    using PipelineManager::getShader;
+};
+
+struct ShaderCase {
+    const char* path;
+    VkShaderStageFlagBits stage;
+};
+
+const ShaderCase sShaders[] = {
+    { "../shaders/calc_position.vert.bin",    VK_SHADER_STAGE_VERTEX_BIT },
+    { "../shaders/calc_position_uv.vert.bin", VK_SHADER_STAGE_VERTEX_BIT },
+    { "../shaders/cube_instanced.vert.bin",   VK_SHADER_STAGE_VERTEX_BIT },
+    { "../shaders/gradient.frag.bin",         VK_SHADER_STAGE_FRAGMENT_BIT },
+    { "../shaders/texture.frag.bin",          VK_SHADER_STAGE_FRAGMENT_BIT },
+    { "../shaders/cull_chunks.comp.bin",      VK_SHADER_STAGE_COMPUTE_BIT },
+};
+
+const char* sVertexShader = "../shaders/calc_position.vert.bin";
+const char* sFragmentShader = "../shaders/gradient.frag.bin";
+
+struct Options {
+    uint32_t repeats = 50;
+    bool software = true;
+    std::string filter;                     // substring of benchmark name, empty - all
+    std::string output = "graphic_bench.json";
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--hardware") == 0) {
+            options.software = false;
+        }
+        else if (strcmp(arg, "--repeats") == 0 && value) {
+            options.repeats = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--filter") == 0 && value) {
+            options.filter = argv[++i];
+        }
+        else if (strcmp(arg, "--output") == 0 && value) {
+            options.output = argv[++i];
+        }
+        else {
+            printf("Usage: graphic_bench [--repeats N] [--filter NAME] [--output FILE] [--hardware]\n"
+                   "  By default runs on CPU Vulkan device (lavapipe) if available.\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+///
+/// Uniform/storage buffer for every binding of pipeline - other descriptor types are not supported here.
+///
+bool fillUniformMapping(ResourceManager* resourceMgr, GraphicObject& go, std::vector<std::unique_ptr<BufferDescr>>& buffers)
+{
+    const PipelineManager::PipelineInfo* pipelineInfo = go.pipelineInfo;
+    go.uniformMapping.resize(pipelineInfo->descriptorSetInfo.size());
+    for (size_t setIdx = 0; setIdx < pipelineInfo->descriptorSetInfo.size(); ++setIdx) {
+        const PipelineManager::DescriptorSetInfo& dsi = pipelineInfo->descriptorSetInfo[setIdx];
+        if (dsi.external) {
+            continue;
+        }
+        for (const PipelineManager::BindingInfo& binding : dsi.bindingInfo) {
+            VkDescriptorType type = binding.vdslbInfo.descriptorType;
+            if (type != VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER && type != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
+                return false;
+            }
+            VkBufferUsageFlags usage = type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ? VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT : VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+            buffers.emplace_back(new BufferDescr(resourceMgr));
+            if (!buffers.back()->createBuffer(nullptr, std::max<size_t>(binding.byteSize, 16), usage)) {
+                return false;
+            }
+            VkDescriptorBufferInfo bufferInfo = { buffers.back()->getBuffer(), 0, binding.byteSize };
+            go.uniformMapping[setIdx].push_back(QVariant::fromValue(bufferInfo));
+        }
+    }
+    return true;
+}
+
+}
+
+///
+/// Hot paths of Graphic library measured on a real (by default software) Vulkan device.
+/// Run from bin/<build type> directory (shaders are loaded by relative paths).
+/// Results are printed and written as JSON (see Bench::JsonReport).
+///
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    HeadlessContext context;
+    HeadlessContext::Settings settings;
+    settings.width = 256;
+    settings.height = 256;
+    settings.framesInFlight = 1;
+    settings.preferSoftwareDevice = options.software;
+    if (!context.create(settings)) {
+        return 1;
+    }
+    ResourceManager resourceMgr(context.instanceFunctions(), context.deviceFunctions(), context.device(), context.physicalDevice());
+    VulkanDeviceFunctions* devFuncs = context.deviceFunctions();
+    const uint32_t repeats = options.repeats;
+
+    Bench::JsonReport report;
+    report.setInfo("device", context.physicalDeviceProperties().deviceName);
+    report.setInfo("repeats", std::to_string(repeats));
+
+    auto enabled = [&options](const std::string& name) {
+        return options.filter.empty() || name.find(options.filter) != std::string::npos;
+    };
+    auto record = [&report](const std::string& name, const Bench::Result& result, double itemsPerRun) {
+        Bench::print(name.c_str(), result, itemsPerRun);
+        report.add(name, result, itemsPerRun);
+    };
+    auto newPipelineManager = [&context, devFuncs]() {
+        return std::unique_ptr<BenchPipelineManager>(new BenchPipelineManager(devFuncs, context.device(), context.frameSize(),
+                                                                              VK_SAMPLE_COUNT_1_BIT, context.defaultRenderPass()));
+    };
+
+    //
+    // PipelineManager::getShader - module creation and SPIR-V reflection (cache miss) and cached lookup
+    //
+    {
+        std::unique_ptr<BenchPipelineManager> pipelineMgr = newPipelineManager();
+        const std::map<PipelineManager::AdditionalParameters, QVariant> noParameters;
+        for (const ShaderCase& shader : sShaders) {
+            std::string name = std::string("getShader/reflect/") + (strrchr(shader.path, '/') + 1);
+            if (enabled(name)) {
+                record(name, Bench::run(repeats, [&]() {
+                    pipelineMgr->cleanUpShaders();
+                    Bench::doNotOptimize(pipelineMgr->getShader(shader.path, shader.stage, noParameters));
+                }), 0.0);
+            }
+        }
+        std::string name = "getShader/cached";
+        if (enabled(name)) {
+            pipelineMgr->getShader(sVertexShader, VK_SHADER_STAGE_VERTEX_BIT, noParameters);
+            const uint32_t lookups = 1000;
+            record(name, Bench::run(repeats, [&]() {
+                for (uint32_t i = 0; i < lookups; ++i) {
+                    Bench::doNotOptimize(pipelineMgr->getShader(sVertexShader, VK_SHADER_STAGE_VERTEX_BIT, noParameters));
+                }
+            }), lookups);
+        }
+    }
+
+    //
+    // PipelineManager::getPipeline - creation with empty caches and cached lookup
+    //
+    {
+        std::string name = "getPipeline/create";
+        if (enabled(name)) {
+            record(name, Bench::run(repeats, [&]() {
+                std::unique_ptr<BenchPipelineManager> pipelineMgr = newPipelineManager();
+                Bench::doNotOptimize(pipelineMgr->getPipeline(sVertexShader, "", "", "", sFragmentShader));
+            }), 0.0);
+        }
+        name = "getPipeline/cached";
+        if (enabled(name)) {
+            std::unique_ptr<BenchPipelineManager> pipelineMgr = newPipelineManager();
+            pipelineMgr->getPipeline(sVertexShader, "", "", "", sFragmentShader);
+            const uint32_t lookups = 1000;
+            record(name, Bench::run(repeats, [&]() {
+                for (uint32_t i = 0; i < lookups; ++i) {
+                    Bench::doNotOptimize(pipelineMgr->getPipeline(sVertexShader, "", "", "", sFragmentShader));
+                }
+            }), lookups);
+        }
+    }
+
+    //
+    // GraphicObject::connectResourceWithUniformSets - heap and frame arena scratch memory
+    //
+    {
+        std::unique_ptr<BenchPipelineManager> pipelineMgr = newPipelineManager();
+        GraphicObject go;
+        go.pipelineInfo = pipelineMgr->getPipeline(sVertexShader, "", "", "", sFragmentShader);
+        std::vector<std::unique_ptr<BufferDescr>> buffers;
+        if (go.pipelineInfo
+         && pipelineMgr->allocateDescriptorSets(go.pipelineInfo, go.descriptorSets)
+         && fillUniformMapping(&resourceMgr, go, buffers)) {
+            const uint32_t connections = 100;
+            std::string name = "connectResourceWithUniformSets/heap";
+            if (enabled(name)) {
+                record(name, Bench::run(repeats, [&]() {
+                    for (uint32_t i = 0; i < connections; ++i) {
+                        go.connectResourceWithUniformSets(*devFuncs, context.device());
+                    }
+                }), connections);
+            }
+            name = "connectResourceWithUniformSets/arena";
+            if (enabled(name)) {
+                FrameArena arena;
+                record(name, Bench::run(repeats, [&]() {
+                    arena.reset();
+                    for (uint32_t i = 0; i < connections; ++i) {
+                        go.connectResourceWithUniformSets(*devFuncs, context.device(), &arena);
+                    }
+                }), connections);
+            }
+        }
+        else {
+            printf("connectResourceWithUniformSets skipped - can't prepare graphic object\n");
+        }
+    }
+
+    //
+    // BufferDescr::createBuffer - create, allocate, map and copy data
+    //
+    {
+        const size_t sizes[] = { 64 * 1024, 1024 * 1024, 16 * 1024 * 1024 };
+        for (size_t size : sizes) {
+            std::string name = "createBuffer/" + std::to_string(size / 1024) + "KiB";
+            if (!enabled(name)) {
+                continue;
+            }
+            std::vector<uint8_t> data(size, 0x5a);
+            record(name, Bench::run(repeats, [&]() {
+                BufferDescr buffer(&resourceMgr);
+                Bench::doNotOptimize(buffer.createBuffer(data.data(), data.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT));
+            }), static_cast<double>(size));
+        }
+    }
+
+    //
+    // ImageDescr::createImage - linear image filled row by row
+    //
+    {
+        const uint32_t sides[] = { 256, 1024, 2048 };
+        for (uint32_t side : sides) {
+            std::string name = "createImage/" + std::to_string(side) + "x" + std::to_string(side) + "_rgba8";
+            if (!enabled(name)) {
+                continue;
+            }
+            std::vector<uint8_t> pixels(side * side * 4, 0x7f);
+            VkExtent3D extent = { side, side, 1 };
+            record(name, Bench::run(repeats, [&]() {
+                ImageDescr image(&resourceMgr);
+                Bench::doNotOptimize(image.createImage(VK_FORMAT_R8G8B8A8_UNORM, extent, 1, pixels.data(), false, VK_IMAGE_USAGE_SAMPLED_BIT));
+            }), static_cast<double>(side) * side);
+        }
+    }
+
+    return report.write(options.output.c_str()) ? 0 : 1;
+}
@@ -0,0 +1,169 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include "SyntheticSurface.hpp"
+#include <Scan/IcpRegistration.hpp>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+struct Options {
+    uint32_t side = 1000;   // grid of side x side points
+    uint32_t repeats = 3;
+    std::string output = "icp_bench.json";
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (!Bench::option(argc, argv, i, "--side", options.side, 16)
+            && !Bench::option(argc, argv, i, "--repeats", options.repeats, 1)
+            && !Bench::option(argc, argv, i, "--output", options.output)) {
+            printf("Usage: icp_bench [--side N] [--repeats N] [--output FILE]\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+///
+/// side x side samples of synthetic surface, offset - fraction of spacing (other sampling of the same surface), noise - meters
+///
+PointCloudData sampleCloud(uint32_t side, float offset, float noise)
+{
+    Bench::SurfaceSampling sampling;
+    sampling.side = side;
+    sampling.offset = offset;
+    sampling.noise = noise;
+    PointCloudData cloud;
+    Bench::sampleSurface(sampling, cloud.positions, cloud.normals);
+    return cloud;
+}
+
+///
+/// Rotation by angle (radians) around unit axis and translation
+///
+glm::mat4 rigidTransform(const glm::vec3& axis, float angle, const glm::vec3& translation)
+{
+    float c = std::cos(angle);
+    float s = std::sin(angle);
+    float t = 1.f - c;
+    glm::mat4 transform(1.f);
+    transform[0] = glm::vec4(t * axis.x * axis.x + c, t * axis.x * axis.y + s * axis.z, t * axis.x * axis.z - s * axis.y, 0.f);
+    transform[1] = glm::vec4(t * axis.x * axis.y - s * axis.z, t * axis.y * axis.y + c, t * axis.y * axis.z + s * axis.x, 0.f);
+    transform[2] = glm::vec4(t * axis.x * axis.z + s * axis.y, t * axis.y * axis.z - s * axis.x, t * axis.z * axis.z + c, 0.f);
+    transform[3] = glm::vec4(translation, 1.f);
+    return transform;
+}
+
+///
+/// Rotation (degrees) and translation (millimeters) left in result * inverse(groundTruth)
+///
+void transformError(const glm::mat4& result, const glm::mat4& groundTruth, float& degrees, float& millimeters)
+{
+    glm::mat4 error = result * glm::inverse(groundTruth);
+    float trace = error[0][0] + error[1][1] + error[2][2];
+    degrees = std::acos(std::max(-1.f, std::min(1.f, 0.5f * (trace - 1.f)))) * 57.2957795f;
+    millimeters = glm::length(glm::vec3(error[3])) * 1000.f;
+}
+
+}
+
+///
+/// ICP (IcpRegistration) of two samplings of synthetic surface (1M points each by default), source is moved away
+/// by known rigid transform. Point to point and point to plane with one and all threads - iterations,
+/// ms per iteration, target indexing time and error of the found transform.
+///
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    printf("Sampling %u points...\n", options.side * options.side);
+    PointCloudData target = sampleCloud(options.side, 0.f, 0.f);
+    PointCloudData source = sampleCloud(options.side, 0.5f, 0.0005f);
+    glm::mat4 groundTruth = rigidTransform(glm::normalize(glm::vec3(0.3f, 1.f, 0.2f)), 0.035f, glm::vec3(0.02f, -0.01f, 0.015f));
+    glm::mat4 targetToSource = glm::inverse(groundTruth);
+    for (size_t i = 0; i < source.size(); ++i) {
+        source.positions[i] = glm::vec3(targetToSource * glm::vec4(source.positions[i], 1.f));
+    }
+    source.normals.clear();
+
+    Bench::JsonReport report;
+    report.setInfo("hardwareThreads", std::to_string(std::thread::hardware_concurrency()));
+    report.setInfo("points", std::to_string(source.size()));
+    bool ok = true;
+    const IcpRegistration::Metric metrics[] = {IcpRegistration::PointToPoint, IcpRegistration::PointToPlane};
+    const uint32_t threadCounts[] = {1, 0};
+    for (IcpRegistration::Metric metric : metrics) {
+        for (uint32_t threads : threadCounts) {
+            IcpRegistration::Settings settings;
+            settings.metric = metric;
+            settings.maxDistance = 0.1f;
+            settings.maxIterations = metric == IcpRegistration::PointToPoint ? 100 : 30;
+            settings.threads = threads;
+            IcpRegistration icp;
+            icp.setSettings(settings);
+            ok = icp.setTarget(target) && ok;
+
+            glm::mat4 result(1.f);
+            bool aligned = true;
+            Bench::Result timing = Bench::run(options.repeats, [&]() {
+                result = glm::mat4(1.f);
+                aligned = icp.align(source, result);
+            }, 0);
+
+            const IcpRegistration::Stats& stats = icp.stats();
+            std::string name = std::string(metric == IcpRegistration::PointToPlane ? "point to plane" : "point to point")
+                             + ", threads: " + std::to_string(stats.threads);
+            Bench::print(name.c_str(), timing, static_cast<double>(source.size()) * stats.iterations);
+            float degrees;
+            float millimeters;
+            transformError(result, groundTruth, degrees, millimeters);
+            printf("%-40s %u iterations%s  %.2f ms/iteration  index %.1f ms  rmse %.3f mm\n", "",
+                   stats.iterations, stats.converged ? "" : " (not converged)", timing.medianMs / std::max(1u, stats.iterations),
+                   stats.indexMs, stats.rmse * 1000.f);
+            printf("%-40s %u correspondences  error %.4f deg  %.3f mm\n", "", stats.correspondences, degrees, millimeters);
+            report.add(name, timing, static_cast<double>(source.size()) * stats.iterations);
+            report.setInfo(name + " iterations", std::to_string(stats.iterations));
+            report.setInfo(name + " ms per iteration", std::to_string(timing.medianMs / std::max(1u, stats.iterations)));
+            report.setInfo(name + " index ms", std::to_string(stats.indexMs));
+
+            // point to point settles within sampling distance - the two samplings have no exactly matching points
+            bool pointToPlane = metric == IcpRegistration::PointToPlane;
+            float maxDegrees = pointToPlane ? 0.05f : 1.f;
+            float maxMillimeters = pointToPlane ? 1.f : 3.f * 2000.f / options.side;
+            if (!aligned || degrees > maxDegrees || millimeters > maxMillimeters) {
+                printf("    ERROR: registration failed\n");
+                ok = false;
+            }
+        }
+    }
+    return report.write(options.output.c_str()) && ok ? 0 : 1;
+}
@@ -0,0 +1,243 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include <Scan/KdTree.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+
+struct Options {
+    uint32_t points = 1000000;
+    uint32_t queries = 100000;
+    uint32_t bruteForceQueries = 1000;
+    uint32_t buildPoints = 10000000;
+    uint32_t k = 8;
+    uint32_t repeats = 3;
+    std::string output = "kd_tree_bench.json";
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--points") == 0 && value) {
+            options.points = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--queries") == 0 && value) {
+            options.queries = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--brute-force-queries") == 0 && value) {
+            options.bruteForceQueries = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--build-points") == 0 && value) {
+            options.buildPoints = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--k") == 0 && value) {
+            options.k = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--repeats") == 0 && value) {
+            options.repeats = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--output") == 0 && value) {
+            options.output = argv[++i];
+        }
+        else {
+            printf("Usage: kd_tree_bench [--points N] [--queries N] [--brute-force-queries N] [--build-points N] [--k N]\n"
+                   "                     [--repeats N] [--output FILE]\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+///
+/// Scan like points - noisy samples of sphere shells in 10 m cube, deterministic
+///
+std::vector<glm::vec3> scanPoints(uint32_t count, uint32_t seed)
+{
+    std::vector<glm::vec3> points(count);
+    uint32_t random = seed;
+    auto next = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return (random >> 8) * (1.f / 16777216.f);
+    };
+    for (uint32_t i = 0; i < count; ++i) {
+        uint32_t shell = i % 16;
+        glm::vec3 center(-4.f + (shell % 4) * 2.67f, -4.f + (shell / 4) * 2.67f, 0.f);
+        float z = 2.f * next() - 1.f;
+        float phi = 6.2831853f * next();
+        float r = std::sqrt(std::max(0.f, 1.f - z * z));
+        float radius = 1.f + 0.005f * next();
+        points[i] = center + glm::vec3(r * std::cos(phi), r * std::sin(phi), z) * radius;
+    }
+    return points;
+}
+
+void bruteForceKnn(const std::vector<glm::vec3>& points, const glm::vec3& query, uint32_t k, std::vector<float>& distances)
+{
+    distances.assign(k, std::numeric_limits<float>::infinity());
+    for (const glm::vec3& point : points) {
+        glm::vec3 diff = point - query;
+        float distance = glm::dot(diff, diff);
+        if (distance < distances[k - 1]) {
+            size_t slot = k - 1;
+            for (; slot > 0 && distances[slot - 1] > distance; --slot) {
+                distances[slot] = distances[slot - 1];
+            }
+            distances[slot] = distance;
+        }
+    }
+}
+
+uint32_t bruteForceRadius(const std::vector<glm::vec3>& points, const glm::vec3& query, float radius)
+{
+    uint32_t count = 0;
+    for (const glm::vec3& point : points) {
+        glm::vec3 diff = point - query;
+        count += glm::dot(diff, diff) < radius * radius ? 1 : 0;
+    }
+    return count;
+}
+
+}
+
+///
+/// KdTree - build time of 1M and 10M points with one and all threads, batched kNN and radius queries
+/// per SIMD path against brute force search (on fewer queries, which are checked against the tree results).
+///
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    Bench::JsonReport report;
+    report.setInfo("hardwareThreads", std::to_string(std::thread::hardware_concurrency()));
+    report.setInfo("points", std::to_string(options.points));
+    report.setInfo("k", std::to_string(options.k));
+    bool ok = true;
+    const uint32_t threadCounts[] = {1, 0};
+
+    // Build
+    const uint32_t buildSizes[] = {options.points, options.buildPoints};
+    for (uint32_t size : buildSizes) {
+        std::vector<glm::vec3> points = scanPoints(size, 7);
+        for (uint32_t threads : threadCounts) {
+            KdTree tree;
+            tree.setMaxThreads(threads);
+            Bench::Result result = Bench::run(options.repeats, [&]() {
+                ok = tree.build(points) && ok;
+            }, 0);
+            std::string name = "build " + std::to_string(size) + " points, threads: " + std::to_string(tree.stats().threads);
+            Bench::print(name.c_str(), result, size);
+            printf("%-40s %u leaves  depth %u\n", "", tree.stats().leaves, tree.stats().depth);
+            report.add(name, result, size);
+        }
+    }
+
+    // Queries
+    std::vector<glm::vec3> points = scanPoints(options.points, 7);
+    std::vector<glm::vec3> queries = scanPoints(options.queries, 11);
+    const float radius = 4.f * std::sqrt(16.f * 4.f * 3.1415926f / options.points); // a few tens of neighbours
+    KdTree tree;
+    tree.build(points);
+
+    std::vector<float> bruteDistances;
+    std::vector<uint32_t> bruteCounts(options.bruteForceQueries);
+    std::vector<std::vector<float>> bruteKnn(options.bruteForceQueries);
+    uint32_t bruteQueries = std::min(options.bruteForceQueries, options.queries);
+    Bench::Result bruteKnnResult = Bench::run(1, [&]() {
+        for (uint32_t i = 0; i < bruteQueries; ++i) {
+            bruteForceKnn(points, queries[i], options.k, bruteKnn[i]);
+        }
+    }, 0);
+    Bench::Result bruteRadiusResult = Bench::run(1, [&]() {
+        for (uint32_t i = 0; i < bruteQueries; ++i) {
+            bruteCounts[i] = bruteForceRadius(points, queries[i], radius);
+        }
+    }, 0);
+    std::string bruteKnnName = "brute force kNN " + std::to_string(bruteQueries) + " queries";
+    std::string bruteRadiusName = "brute force radius " + std::to_string(bruteQueries) + " queries";
+    Bench::print(bruteKnnName.c_str(), bruteKnnResult, bruteQueries);
+    Bench::print(bruteRadiusName.c_str(), bruteRadiusResult, bruteQueries);
+    report.add(bruteKnnName, bruteKnnResult, bruteQueries);
+    report.add(bruteRadiusName, bruteRadiusResult, bruteQueries);
+
+    std::vector<uint32_t> indices(size_t(options.queries) * options.k);
+    std::vector<float> distances(size_t(options.queries) * options.k);
+    std::vector<uint32_t> offsets;
+    std::vector<uint32_t> neighbours;
+    const Simd::Path paths[] = {Simd::Scalar, Simd::Avx2, Simd::Neon};
+    for (Simd::Path path : paths) {
+        if (!Simd::isSupported(path)) {
+            continue;
+        }
+        tree.setSimdPath(path);
+        for (uint32_t threads : threadCounts) {
+            tree.setMaxThreads(threads);
+            uint32_t usedThreads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+            std::string suffix = std::string(", ") + Simd::name(path) + ", threads: " + std::to_string(usedThreads);
+
+            Bench::Result knnResult = Bench::run(options.repeats, [&]() {
+                tree.knnBatch(queries.data(), queries.size(), options.k, indices.data(), distances.data());
+            });
+            std::string name = "kNN " + std::to_string(options.k) + suffix;
+            Bench::print(name.c_str(), knnResult, options.queries);
+            printf("%-40s %.0fx faster than brute force per query\n", "",
+                   (bruteKnnResult.medianMs / bruteQueries) / (knnResult.medianMs / options.queries));
+            report.add(name, knnResult, options.queries);
+
+            Bench::Result radiusResult = Bench::run(options.repeats, [&]() {
+                tree.radiusBatch(queries.data(), queries.size(), radius, offsets, neighbours);
+            });
+            name = "radius" + suffix;
+            Bench::print(name.c_str(), radiusResult, options.queries);
+            printf("%-40s %.1f neighbours per query  %.0fx faster than brute force per query\n", "",
+                   double(neighbours.size()) / options.queries,
+                   (bruteRadiusResult.medianMs / bruteQueries) / (radiusResult.medianMs / options.queries));
+            report.add(name, radiusResult, options.queries);
+
+            for (uint32_t i = 0; i < bruteQueries; ++i) {
+                bool same = offsets[i + 1] - offsets[i] == bruteCounts[i];
+                for (uint32_t n = 0; n < options.k; ++n) {
+                    float expected = bruteKnn[i][n];
+                    same = same && std::fabs(distances[size_t(i) * options.k + n] - expected) <= 1e-5f * expected;
+                }
+                if (!same) {
+                    printf("    ERROR: query %u differs from brute force\n", i);
+                    ok = false;
+                    break;
+                }
+            }
+        }
+    }
+    return report.write(options.output.c_str()) && ok ? 0 : 1;
+}
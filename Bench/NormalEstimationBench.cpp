@@ -0,0 +1,157 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include "SyntheticSurface.hpp"
+#include <Scan/NormalEstimator.hpp>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+namespace {
+
+struct Options {
+    uint32_t side = 1000;   // grid of side x side points
+    uint32_t neighbours = 16;
+    uint32_t repeats = 3;
+    std::string output = "normal_estimation_bench.json";
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        if (!Bench::option(argc, argv, i, "--side", options.side, 16)
+            && !Bench::option(argc, argv, i, "--k", options.neighbours, 3)
+            && !Bench::option(argc, argv, i, "--repeats", options.repeats, 1)
+            && !Bench::option(argc, argv, i, "--output", options.output)) {
+            printf("Usage: normal_estimation_bench [--side N] [--k N] [--repeats N] [--output FILE]\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+const glm::vec3 SensorPosition(0.f, 3.f, 0.f); // synthetic surface is seen from above
+
+inline float angleDegrees(const glm::vec3& a, const glm::vec3& b)
+{
+    return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)) * 57.2957795f; // precise also for small angles
+}
+
+}
+
+///
+/// NormalEstimator on noisy samples of synthetic surface (1M points by default) - ms with one and all threads for
+/// orientation toward sensor and by spanning tree propagation, split into KD-tree build, PCA and orientation.
+/// Angle to exact normals, wrongly oriented normals and error of octahedral packing are checked.
+///
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    printf("Sampling %u points...\n", options.side * options.side);
+    PointCloudData cloud;
+    std::vector<glm::vec3> truth;
+    Bench::SurfaceSampling sampling;
+    sampling.side = options.side;
+    sampling.jitter = true;
+    sampling.noise = 0.1f / options.side; // 5% of spacing
+    sampling.seed = 4321;
+    Bench::sampleSurface(sampling, cloud.positions, truth);
+
+    Bench::JsonReport report;
+    report.setInfo("hardwareThreads", std::to_string(std::thread::hardware_concurrency()));
+    report.setInfo("points", std::to_string(cloud.size()));
+    report.setInfo("k", std::to_string(options.neighbours));
+    bool ok = true;
+    const NormalEstimator::Orientation orientations[] = {NormalEstimator::OrientToSensor, NormalEstimator::OrientPropagate};
+    const uint32_t threadCounts[] = {1, 0};
+    for (NormalEstimator::Orientation orientation : orientations) {
+        for (uint32_t threads : threadCounts) {
+            NormalEstimator::Settings settings;
+            settings.neighbours = options.neighbours;
+            settings.orientation = orientation;
+            settings.sensorPosition = SensorPosition;
+            settings.threads = threads;
+            NormalEstimator estimator;
+            estimator.setSettings(settings);
+            Bench::Result result = Bench::run(options.repeats, [&]() {
+                ok = estimator.estimate(cloud) && ok;
+            }, 0);
+
+            const NormalEstimator::Stats& stats = estimator.stats();
+            std::string name = std::string(orientation == NormalEstimator::OrientPropagate ? "propagated" : "toward sensor")
+                             + ", threads: " + std::to_string(stats.threads);
+            Bench::print(name.c_str(), result, static_cast<double>(cloud.size()));
+            printf("%-40s index %.1f ms  PCA %.1f ms  orientation %.1f ms  %u trees\n", "",
+                   stats.indexMs, stats.pcaMs, stats.orientMs, stats.trees);
+            report.add(name, result, static_cast<double>(cloud.size()));
+
+            double angleSum = 0.0;
+            size_t wrong = 0;
+            for (size_t i = 0; i < cloud.size(); ++i) {
+                float angle = angleDegrees(cloud.normals[i], truth[i]);
+                wrong += angle > 90.f ? 1 : 0;
+                angleSum += std::min(angle, 180.f - angle);
+            }
+            double meanAngle = angleSum / cloud.size();
+            printf("%-40s mean error %.3f deg  %zu wrongly oriented  %llu fallbacks\n", "",
+                   meanAngle, wrong, static_cast<unsigned long long>(stats.fallbacks));
+            report.setInfo(name + " mean error deg", std::to_string(meanAngle));
+            report.setInfo(name + " wrongly oriented", std::to_string(wrong));
+            if (meanAngle > 2.0 || wrong > cloud.size() / 1000) {
+                printf("    ERROR: normals differ from the surface\n");
+                ok = false;
+            }
+        }
+    }
+
+    // Packed stream for vertex buffer - compared with vec3 normals of the same settings
+    std::vector<uint32_t> packed;
+    NormalEstimator::Settings settings;
+    settings.neighbours = options.neighbours;
+    settings.orientation = NormalEstimator::OrientToSensor;
+    settings.sensorPosition = SensorPosition;
+    NormalEstimator estimator;
+    estimator.setSettings(settings);
+    ok = estimator.estimate(cloud) && ok;
+    Bench::Result result = Bench::run(options.repeats, [&]() {
+        ok = estimator.estimate(cloud.positions, packed) && ok;
+    }, 0);
+    Bench::print("packed octahedral", result, static_cast<double>(cloud.size()));
+    report.add("packed octahedral", result, static_cast<double>(cloud.size()));
+    float maxError = 0.f;
+    for (size_t i = 0; i < packed.size(); ++i) {
+        maxError = std::max(maxError, angleDegrees(NormalEstimator::unpackOctahedral(packed[i]), cloud.normals[i]));
+    }
+    printf("%-40s %.1f MiB  max packing error %.4f deg\n", "", packed.size() * sizeof(uint32_t) / (1024.0 * 1024.0), maxError);
+    if (maxError > 0.01f) {
+        printf("    ERROR: octahedral packing error %f deg\n", maxError);
+        ok = false;
+    }
+    return report.write(options.output.c_str()) && ok ? 0 : 1;
+}
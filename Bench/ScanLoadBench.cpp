@@ -0,0 +1,251 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include <Scan/OctreeConverter.hpp>
+#include <Scan/OctreeReader.hpp>
+#include <Scan/PointCloudLoader.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+
+namespace {
+
+struct Options {
+    uint64_t points = 2000000;
+    uint32_t repeats = 5;
+    std::string file;                        // empty - generated XYZ, ASCII PLY and binary PLY files
+    std::string output = "scan_load_bench.json";
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--points") == 0 && value) {
+            options.points = std::max<uint64_t>(1, std::strtoull(argv[++i], nullptr, 10));
+        }
+        else if (strcmp(arg, "--repeats") == 0 && value) {
+            options.repeats = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--file") == 0 && value) {
+            options.file = argv[++i];
+        }
+        else if (strcmp(arg, "--output") == 0 && value) {
+            options.output = argv[++i];
+        }
+        else {
+            printf("Usage: scan_load_bench [--file CLOUD] [--points N] [--repeats N] [--output FILE]\n"
+                   "  Without --file XYZ, ASCII PLY and binary PLY files with N points are generated in current directory.\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// Synthetic scan - wavy surface with colors and normals, the same points in every format
+//
+struct SyntheticPoint {
+    float position[3];
+    float normal[3];
+    uint8_t color[3];
+};
+
+SyntheticPoint syntheticPoint(std::mt19937& rng)
+{
+    std::uniform_real_distribution<float> coord(-50.f, 50.f);
+    SyntheticPoint point;
+    float x = coord(rng);
+    float z = coord(rng);
+    point.position[0] = x;
+    point.position[1] = std::sin(x * 0.2f) * std::cos(z * 0.2f) * 3.f;
+    point.position[2] = z;
+    point.normal[0] = 0.f;
+    point.normal[1] = 1.f;
+    point.normal[2] = 0.f;
+    point.color[0] = static_cast<uint8_t>(x + 50.f);
+    point.color[1] = static_cast<uint8_t>(z + 50.f);
+    point.color[2] = 128;
+    return point;
+}
+
+bool writeXyz(const std::string& path, uint64_t points)
+{
+    FILE* file = fopen(path.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+    std::mt19937 rng(1234);
+    for (uint64_t i = 0; i < points; ++i) {
+        SyntheticPoint p = syntheticPoint(rng);
+        fprintf(file, "%.4f %.4f %.4f %u %u %u\n", p.position[0], p.position[1], p.position[2], p.color[0], p.color[1], p.color[2]);
+    }
+    fclose(file);
+    return true;
+}
+
+bool writePly(const std::string& path, uint64_t points, bool binary)
+{
+    FILE* file = fopen(path.c_str(), binary ? "wb" : "w");
+    if (!file) {
+        return false;
+    }
+    fprintf(file, "ply\nformat %s 1.0\ncomment scan_load_bench\nelement vertex %llu\n"
+                  "property float x\nproperty float y\nproperty float z\n"
+                  "property float nx\nproperty float ny\nproperty float nz\n"
+                  "property uchar red\nproperty uchar green\nproperty uchar blue\nend_header\n",
+            binary ? "binary_little_endian" : "ascii", static_cast<unsigned long long>(points));
+    std::mt19937 rng(1234);
+    for (uint64_t i = 0; i < points; ++i) {
+        SyntheticPoint p = syntheticPoint(rng);
+        if (binary) {
+            fwrite(p.position, sizeof(p.position), 1, file);
+            fwrite(p.normal, sizeof(p.normal), 1, file);
+            fwrite(p.color, sizeof(p.color), 1, file);
+        }
+        else {
+            fprintf(file, "%.4f %.4f %.4f %.3f %.3f %.3f %u %u %u\n", p.position[0], p.position[1], p.position[2],
+                    p.normal[0], p.normal[1], p.normal[2], p.color[0], p.color[1], p.color[2]);
+        }
+    }
+    fclose(file);
+    return true;
+}
+
+bool samePoints(const PointCloudData& a, const PointCloudData& b)
+{
+    return a.size() == b.size() && a.colors == b.colors
+        && memcmp(a.positions.data(), b.positions.data(), a.positions.size() * sizeof(glm::vec3)) == 0
+        && a.normals.size() == b.normals.size()
+        && memcmp(a.normals.data(), b.normals.data(), a.normals.size() * sizeof(glm::vec3)) == 0;
+}
+
+}
+
+///
+/// Point cloud loading (PointCloudLoader) with one thread and all threads - MB/s and points/s,
+/// then conversion of the last cloud to native octree file and its open/read time.
+/// Results are printed and written as JSON (see Bench::JsonReport).
+///
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    std::vector<std::string> files;
+    bool generated = options.file.empty();
+    if (generated) {
+        files = { "scan_load_bench.xyz", "scan_load_bench_ascii.ply", "scan_load_bench_binary.ply" };
+        printf("Generating %llu points...\n", static_cast<unsigned long long>(options.points));
+        if (!writeXyz(files[0], options.points) || !writePly(files[1], options.points, false) || !writePly(files[2], options.points, true)) {
+            printf("Can't write generated files\n");
+            return 1;
+        }
+    }
+    else {
+        files.push_back(options.file);
+    }
+
+    Bench::JsonReport report;
+    report.setInfo("hardwareThreads", std::to_string(std::thread::hardware_concurrency()));
+    report.setInfo("repeats", std::to_string(options.repeats));
+    bool ok = true;
+    PointCloudData reference;
+    for (const std::string& path : files) {
+        reference.clear();
+        const uint32_t threadCounts[] = {1, 0};
+        for (uint32_t threads : threadCounts) {
+            PointCloudLoader loader;
+            loader.setThreadCount(threads);
+            PointCloudData data;
+            Bench::Result result = Bench::run(options.repeats, [&]() {
+                ok = loader.load(path, data) && ok;
+            }, 1);
+            if (!ok) {
+                printf("Can't load %s\n", path.c_str());
+                return 1;
+            }
+
+            const PointCloudLoader::Stats& stats = loader.stats();
+            std::string name = path + ", threads: " + std::to_string(stats.threads);
+            Bench::print(name.c_str(), result, static_cast<double>(stats.points));
+            double seconds = result.medianMs / 1000.0;
+            printf("%-40s %9.1f MB/s  %8.2f Mpoints/s\n", "", stats.bytes / (1024.0 * 1024.0) / seconds, stats.points / seconds / 1e6);
+            report.add(name, result, static_cast<double>(stats.points));
+
+            if (reference.size() == 0) {
+                report.setInfo(path + " bytes", std::to_string(stats.bytes));
+                reference = std::move(data);
+            }
+            else if (!samePoints(reference, data)) {
+                printf("    ERROR: points differ from single thread load\n");
+                ok = false;
+            }
+        }
+    }
+
+    // Native octree file of the last cloud - conversion, open (only header and nodes) and read of all points
+    const std::string octreePath = "scan_load_bench.pco";
+    OctreeConverter converter;
+    Bench::Result convertResult = Bench::run(std::max(1u, options.repeats / 2), [&]() {
+        ok = converter.convert(reference, octreePath) && ok;
+    }, 0);
+    Bench::print("octree convert", convertResult, static_cast<double>(reference.size()));
+    report.add("octree convert", convertResult, static_cast<double>(reference.size()));
+    report.setInfo("octree nodes", std::to_string(converter.stats().nodes));
+    report.setInfo("octree bytes", std::to_string(converter.stats().bytes));
+
+    OctreeReader octree;
+    Bench::Result openResult = Bench::run(options.repeats, [&]() {
+        ok = octree.open(octreePath) && ok;
+    });
+    Bench::print("octree open", openResult);
+    report.add("octree open", openResult);
+
+    PointCloudData octreePoints;
+    Bench::Result readResult = Bench::run(options.repeats, [&]() {
+        octree.readLevels(~0u, octreePoints);
+    }, 1);
+    Bench::print("octree read all", readResult, static_cast<double>(octreePoints.size()));
+    report.add("octree read all", readResult, static_cast<double>(octreePoints.size()));
+    if (octreePoints.size() != reference.size()) {
+        printf("    ERROR: octree has %zu of %zu points\n", octreePoints.size(), reference.size());
+        ok = false;
+    }
+    octree.close();
+    std::remove(octreePath.c_str());
+
+    if (generated) {
+        for (const std::string& path : files) {
+            std::remove(path.c_str());
+        }
+    }
+    return report.write(options.output.c_str()) && ok ? 0 : 1;
+}
@@ -0,0 +1,476 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include <MainWindow/PointCloud.hpp>
+#include <MainWindow/SceneSetup.hpp>
+#include <MainWindow/StreamedPointCloud.hpp>
+#include <Graphic/HeadlessContext.hpp>
+#include <Graphic/ResourceManager.hpp>
+#include <Graphic/PipelineManager.hpp>
+#include <Graphic/DrawManager.hpp>
+#include <Graphic/Scene.hpp>
+#include <Graphic/ParallelRecorder.hpp>
+#include <Graphic/RenderGraph.hpp>
+#include <Graphic/GpuProfiler.hpp>
+#include <Graphic/NullDriver.hpp>
+#include <Graphic/VulkanFunctions.hpp>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/ext.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+
+namespace {
+
+struct Options {
+    uint32_t frames = 500;
+    uint32_t warmUpFrames = 30;
+    uint32_t width = 1280;
+    uint32_t height = 720;
+    uint32_t framesInFlight = 2;
+    int gridHalfSize = 5;        // instanced cubes (2*N+1)^2 - 1
+    uint32_t chunksPerSide = 64; // GPU culled chunk field, 0 - disabled
+    uint32_t points = 0;         // synthetic scanned terrain, 0 - disabled
+    float pointSize = 0.05f;     // world units, attenuated with distance
+    std::string stream;          // octree file (*.pco) streamed by StreamedPointCloud, empty - disabled
+    uint32_t gpuBudgetMiB = 512; // device memory of streamed nodes
+    bool texturedCube = true;
+    bool bindlessTextures = false; // textured cube sampled from bindless table if descriptor indexing is supported
+    uint32_t recordingThreads = 0;
+    bool software = false;
+    bool validation = false;
+    bool nullDriver = false;     // count API calls, nothing is rendered
+    int32_t deviceIndex = -1;
+    std::string output;          // empty - stdout
+};
+
+void printUsage()
+{
+    printf("Usage: 3DModelScanerBench [options]\n"
+           "  --frames N          measured frames (500)\n"
+           "  --warmup N          frames rendered before measuring (30)\n"
+           "  --size WxH          offscreen target size (1280x720)\n"
+           "  --frames-in-flight N  (2)\n"
+           "  --grid N            half size of instanced cube grid, 0 - none (5)\n"
+           "  --chunks N          chunks per side of GPU culled field, 0 - none (64)\n"
+           "  --points N          synthetic point cloud with N points, 0 - none (0)\n"
+           "  --point-size S      point size in world units (0.05)\n"
+           "  --stream FILE       stream octree file (*.pco, see scan_convert)\n"
+           "  --gpu-budget MB     device memory for streamed nodes (512)\n"
+           "  --no-texture        no textured cube in the center\n"
+           "  --bindless          bindless texture table (VK_EXT_descriptor_indexing) if supported\n"
+           "  --threads N         render queue recording threads (0)\n"
+           "  --software          prefer CPU Vulkan device e.g. lavapipe\n"
+           "  --device N          physical device index\n"
+           "  --validation        enable validation layer\n"
+           "  --null-driver       run against NullDriver and report API calls per frame\n"
+           "  --output FILE       JSON result file (stdout)\n");
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        auto number = [&i, value]() { ++i; return static_cast<uint32_t>(std::strtoul(value, nullptr, 10)); };
+
+        if (strcmp(arg, "--no-texture") == 0) {
+            options.texturedCube = false;
+        }
+        else if (strcmp(arg, "--bindless") == 0) {
+            options.bindlessTextures = true;
+        }
+        else if (strcmp(arg, "--software") == 0) {
+            options.software = true;
+        }
+        else if (strcmp(arg, "--validation") == 0) {
+            options.validation = true;
+        }
+        else if (strcmp(arg, "--null-driver") == 0) {
+            options.nullDriver = true;
+        }
+        else if (!value) {
+            printUsage();
+            return false;
+        }
+        else if (strcmp(arg, "--frames") == 0) {
+            options.frames = number();
+        }
+        else if (strcmp(arg, "--warmup") == 0) {
+            options.warmUpFrames = number();
+        }
+        else if (strcmp(arg, "--frames-in-flight") == 0) {
+            options.framesInFlight = std::max(1u, number());
+        }
+        else if (strcmp(arg, "--grid") == 0) {
+            options.gridHalfSize = static_cast<int>(number());
+        }
+        else if (strcmp(arg, "--chunks") == 0) {
+            options.chunksPerSide = number();
+        }
+        else if (strcmp(arg, "--points") == 0) {
+            options.points = number();
+        }
+        else if (strcmp(arg, "--point-size") == 0) {
+            ++i;
+            options.pointSize = std::strtof(value, nullptr);
+        }
+        else if (strcmp(arg, "--stream") == 0) {
+            ++i;
+            options.stream = value;
+        }
+        else if (strcmp(arg, "--gpu-budget") == 0) {
+            options.gpuBudgetMiB = number();
+        }
+        else if (strcmp(arg, "--threads") == 0) {
+            options.recordingThreads = number();
+        }
+        else if (strcmp(arg, "--device") == 0) {
+            options.deviceIndex = static_cast<int32_t>(number());
+        }
+        else if (strcmp(arg, "--size") == 0) {
+            ++i;
+            if (sscanf(value, "%ux%u", &options.width, &options.height) != 2 || !options.width || !options.height) {
+                printUsage();
+                return false;
+            }
+        }
+        else if (strcmp(arg, "--output") == 0) {
+            ++i;
+            options.output = value;
+        }
+        else {
+            printUsage();
+            return false;
+        }
+    }
+    return true;
+}
+
+// Terrain sampled on a jittered grid below the cubes - stand-in for a scan with colors and normals
+PointCloud* createPointCloud(uint32_t pointCount)
+{
+    const float halfSize = 50.f;
+    const float height = -4.f;
+    uint32_t side = std::max(1u, static_cast<uint32_t>(std::sqrt(static_cast<double>(pointCount))));
+    std::vector<glm::vec3> positions(pointCount);
+    std::vector<uint32_t> colors(pointCount);
+    std::vector<glm::vec3> normals(pointCount);
+    uint32_t seed = 12345;
+    auto random = [&seed]() { seed = seed * 1664525u + 1013904223u; return static_cast<float>(seed >> 8) / 16777216.f; };
+    for (uint32_t i = 0; i < pointCount; ++i) {
+        float x = ((i % side) + random()) / side * 2.f * halfSize - halfSize;
+        float z = ((i / side) + random()) / side * 2.f * halfSize - halfSize;
+        float y = height + std::sin(0.2f * x) * std::cos(0.15f * z);
+        positions[i] = glm::vec3(x, y, z);
+        normals[i] = glm::normalize(glm::vec3(-0.2f * std::cos(0.2f * x) * std::cos(0.15f * z), 1.f,
+                                              0.15f * std::sin(0.2f * x) * std::sin(0.15f * z)));
+        uint32_t shade = static_cast<uint32_t>(255.f * (0.5f + 0.5f * (y - height)));
+        colors[i] = 0xff000000u | (shade << 8) | (255 - shade); // red to green with height
+    }
+    return new PointCloud(std::move(positions), std::move(colors), std::move(normals));
+}
+
+// Scene of the window (SceneSetup) plus optional point clouds
+uint32_t fillScene(Scene& scene, const Options& options, uint32_t framesInFlight, bool bindlessTextures,
+                   PointCloud** pointCloud, StreamedPointCloud** streamedCloud)
+{
+    SceneSetup::Settings settings;
+    settings.texturedCube = options.texturedCube;
+    settings.bindlessTextures = bindlessTextures;
+    settings.gridHalfSize = options.gridHalfSize;
+    settings.chunksPerSide = options.chunksPerSide;
+    settings.framesInFlight = framesInFlight;
+    SceneSetup::fill(scene, settings);
+
+    *pointCloud = nullptr;
+    if (options.points) {
+        *pointCloud = createPointCloud(options.points);
+        (*pointCloud)->setFramesInFlight(framesInFlight);
+        (*pointCloud)->setPointSize(options.pointSize, true);
+        scene.add(std::unique_ptr<IRenderable>(*pointCloud));
+    }
+
+    *streamedCloud = nullptr;
+    if (!options.stream.empty()) {
+        *streamedCloud = new StreamedPointCloud(options.stream);
+        (*streamedCloud)->setFramesInFlight(framesInFlight);
+        (*streamedCloud)->setPointSize(options.pointSize, true);
+        (*streamedCloud)->setGpuBudget(static_cast<uint64_t>(options.gpuBudgetMiB) * 1024 * 1024);
+        scene.add(std::unique_ptr<IRenderable>(*streamedCloud));
+    }
+    return static_cast<uint32_t>(scene.size());
+}
+
+void writeDistribution(FILE* file, const char* name, const std::vector<double>& samples, bool last = false)
+{
+    if (samples.empty()) {
+        fprintf(file, "  \"%s\": null%s\n", name, last ? "" : ",");
+        return;
+    }
+    Bench::Distribution d = Bench::distribution(samples);
+    fprintf(file, "  \"%s\": { \"count\": %zu, \"mean\": %.4f, \"p50\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"min\": %.4f, \"max\": %.4f }%s\n",
+            name, d.count, d.meanMs, d.p50Ms, d.p95Ms, d.p99Ms, d.minMs, d.maxMs, last ? "" : ",");
+}
+
+void writeApiCalls(FILE* file, const NullDriver::Counters& counters, uint32_t frames)
+{
+    double divider = frames ? static_cast<double>(frames) : 1.0;
+    fprintf(file, "  \"apiCallsPerFrame\": { \"total\": %.2f, \"binds\": %.2f, \"draws\": %.2f, \"dispatches\": %.2f, "
+                  "\"descriptorWrites\": %.2f, \"maps\": %.2f, \"unmaps\": %.2f, \"allocations\": %.2f },\n",
+            counters.total() / divider, counters.binds() / divider, counters.draws() / divider, counters.dispatches() / divider,
+            counters.descriptorWrites / divider, counters.maps() / divider, counters.unmaps() / divider, counters.allocations() / divider);
+}
+
+std::string jsonString(const char* text)
+{
+    std::string result;
+    for (const char* c = text; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            result += '\\';
+        }
+        result += *c;
+    }
+    return result;
+}
+
+}
+
+///
+/// Renders N frames of the window scene into offscreen targets and reports CPU and GPU frame times as JSON.
+/// With --null-driver nothing reaches GPU - reported are CPU times and Vulkan calls per frame.
+/// Run from bin/<build type> directory (shaders and textures are loaded by relative paths).
+///
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    HeadlessContext context;
+    HeadlessContext::Settings settings;
+    settings.width = options.width;
+    settings.height = options.height;
+    settings.framesInFlight = options.framesInFlight;
+    settings.preferSoftwareDevice = options.software;
+    settings.physicalDeviceIndex = options.deviceIndex;
+    settings.enableValidation = options.validation;
+    settings.deviceExtensions = { VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME };
+    settings.enableDescriptorIndexing = options.bindlessTextures;
+    if (options.nullDriver) {
+        settings.getInstanceProcAddr = NullDriver::getInstanceProcAddr;
+    }
+    if (!context.create(settings)) {
+        return 1;
+    }
+
+    //
+    // Renderer - the same objects as VulkanRenderer uses with the window
+    //
+    const uint32_t framesInFlight = context.framesInFlight();
+    std::unique_ptr<ResourceManager> resourceMgr(new ResourceManager(context.instanceFunctions(), context.deviceFunctions(),
+                                                                     context.device(), context.physicalDevice()));
+    bool bindlessTextures = false;
+    if (context.isDescriptorIndexingEnabled()) {
+        const uint32_t maxBindlessTextures = 4096; // as VulkanRenderer
+        bindlessTextures = resourceMgr->enableBindlessTextures(maxBindlessTextures) != nullptr;
+    }
+    std::unique_ptr<DrawManager> drawMgr(new DrawManager());
+    std::shared_ptr<glm::mat4x4> viewMtx(new glm::mat4x4(glm::lookAt(SceneSetup::EyePosition, SceneSetup::LookAtPosition, glm::vec3(0.f, 1.f, 0.f))));
+    std::shared_ptr<glm::mat4x4> projMtx(new glm::mat4x4(SceneSetup::perspective(glm::radians(SceneSetup::FovDegrees), static_cast<float>(options.width),
+                                                                                 static_cast<float>(options.height), SceneSetup::MinDepth, SceneSetup::MaxDepth)));
+    drawMgr->setViewMatrix(viewMtx);
+    drawMgr->setProjMatrix(projMtx);
+    drawMgr->setViewportSize(options.width, options.height);
+
+    std::unique_ptr<Scene> scene(new Scene());
+    PointCloud* pointCloud = nullptr; // owned by scene
+    StreamedPointCloud* streamedCloud = nullptr;
+    uint32_t renderables = fillScene(*scene, options, framesInFlight, bindlessTextures, &pointCloud, &streamedCloud);
+    scene->initResource(resourceMgr.get(), framesInFlight);
+
+    std::unique_ptr<PipelineManager> pipelineMgr(new PipelineManager(context.deviceFunctions(), context.device(), context.frameSize(),
+                                                                     VK_SAMPLE_COUNT_1_BIT, context.defaultRenderPass()));
+    scene->initPipeline(pipelineMgr.get());
+
+    std::unique_ptr<ParallelRecorder> recorder(new ParallelRecorder(context.deviceFunctions(), context.device(),
+                                                                    context.graphicsQueueFamilyIndex(), framesInFlight));
+    recorder->setWorkerCount(options.recordingThreads);
+
+    std::unique_ptr<GpuProfiler> gpuProfiler(new GpuProfiler(resourceMgr.get()));
+    if (!gpuProfiler->create(context.graphicsQueueFamilyIndex(), framesInFlight)) {
+        gpuProfiler.reset();
+    }
+    drawMgr->setGpuProfiler(gpuProfiler.get());
+
+    RenderGraph renderGraph(resourceMgr.get());
+    SceneSetup::buildRenderGraph(renderGraph, *scene, [&](DrawManager* drawMgr) {
+        SceneSetup::RenderTarget target; // offscreen target of the context
+        target.renderPass = context.defaultRenderPass();
+        target.framebuffer = context.framebuffer();
+        target.width = options.width;
+        target.height = options.height;
+        SceneSetup::recordMainPass(*context.deviceFunctions(), drawMgr, *scene, recorder.get(), target);
+    });
+    if (!renderGraph.compile(context.frameSize())) {
+        return 1;
+    }
+
+    //
+    // Frames
+    //
+    std::vector<double> cpuMs;        // record and submit
+    std::vector<double> frameIntervalMs; // between starts of frames - includes waiting for frame in flight
+    std::vector<double> gpuMs;
+    cpuMs.reserve(options.frames);
+    frameIntervalMs.reserve(options.frames);
+    gpuMs.reserve(options.frames);
+    NullDriver::Counters apiCalls; // sum of measured frames
+    uint64_t lastGpuFrame = 0;
+    uint64_t firstMeasuredGpuFrame = options.warmUpFrames + 1; // GpuProfiler counts frames from 1
+    auto previousStart = std::chrono::steady_clock::now();
+
+    const uint32_t totalFrames = options.warmUpFrames + options.frames;
+    for (uint32_t frameIdx = 0; frameIdx < totalFrames; ++frameIdx) {
+        NullDriver::beginFrame();
+        VkCommandBuffer cmdBuf = context.beginFrame();
+        if (!cmdBuf) {
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+
+        drawMgr->beginFrame();
+        drawMgr->setCmdBuffer(cmdBuf);
+        drawMgr->setRenderPass(context.defaultRenderPass(), context.framebuffer());
+        drawMgr->setCurrentFrame(context.currentFrame());
+        if (gpuProfiler) {
+            gpuProfiler->beginFrame(cmdBuf, context.currentFrame());
+        }
+        {
+            GpuScope frameScope(drawMgr.get(), "Frame");
+            renderGraph.execute(drawMgr.get());
+        }
+        if (!context.endFrame()) {
+            return 1;
+        }
+        drawMgr->setCmdBuffer(nullptr);
+
+        auto end = std::chrono::steady_clock::now();
+        if (frameIdx >= options.warmUpFrames) {
+            cpuMs.push_back(std::chrono::duration<double, std::milli>(end - start).count());
+            if (frameIdx > options.warmUpFrames) {
+                frameIntervalMs.push_back(std::chrono::duration<double, std::milli>(start - previousStart).count());
+            }
+            if (options.nullDriver) {
+                NullDriver::Counters frameCalls = NullDriver::frameCounters();
+                for (size_t i = 0; i < NullDriver::CallCount; ++i) {
+                    apiCalls.calls[i] += frameCalls.calls[i];
+                }
+                apiCalls.descriptorWrites += frameCalls.descriptorWrites;
+                apiCalls.allocatedBytes += frameCalls.allocatedBytes;
+            }
+        }
+        previousStart = start;
+
+        // Result of a frame is read when its slot is used again - framesInFlight frames later
+        if (gpuProfiler && !options.nullDriver && gpuProfiler->lastFrame().frameNumber != lastGpuFrame) {
+            lastGpuFrame = gpuProfiler->lastFrame().frameNumber;
+            if (lastGpuFrame >= firstMeasuredGpuFrame) {
+                gpuMs.push_back(gpuProfiler->lastFrame().frameMs);
+            }
+        }
+    }
+    context.waitIdle();
+
+    //
+    // Report
+    //
+    FILE* file = options.output.empty() ? stdout : fopen(options.output.c_str(), "w");
+    if (!file) {
+        printf("Can't open %s\n", options.output.c_str());
+        return 1;
+    }
+    const VkPhysicalDeviceProperties& props = context.physicalDeviceProperties();
+    fprintf(file, "{\n");
+    fprintf(file, "  \"device\": \"%s\",\n", jsonString(props.deviceName).c_str());
+    fprintf(file, "  \"deviceType\": %d,\n", props.deviceType);
+    fprintf(file, "  \"driverVersion\": %u,\n", props.driverVersion);
+    fprintf(file, "  \"width\": %u,\n", options.width);
+    fprintf(file, "  \"height\": %u,\n", options.height);
+    fprintf(file, "  \"framesInFlight\": %u,\n", framesInFlight);
+    fprintf(file, "  \"warmUpFrames\": %u,\n", options.warmUpFrames);
+    fprintf(file, "  \"frames\": %u,\n", options.frames);
+    fprintf(file, "  \"renderables\": %u,\n", renderables);
+    fprintf(file, "  \"chunksPerSide\": %u,\n", options.chunksPerSide);
+    fprintf(file, "  \"recordingThreads\": %u,\n", recorder->workerCount());
+    fprintf(file, "  \"bindlessTextures\": %s,\n", bindlessTextures ? "true" : "false");
+    fprintf(file, "  \"drawIndirectCount\": %s,\n", context.isDeviceExtensionEnabled(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME) ? "true" : "false");
+    if (pointCloud) {
+        PointCloud::MemoryFootprint footprint = pointCloud->memoryFootprint();
+        fprintf(file, "  \"pointCloud\": { \"points\": %llu, \"chunks\": %u, \"uploadedChunks\": %u, \"deviceBytes\": %llu, \"hostBytes\": %llu },\n",
+                static_cast<unsigned long long>(footprint.points), footprint.chunks, footprint.uploadedChunks,
+                static_cast<unsigned long long>(footprint.deviceBytes), static_cast<unsigned long long>(footprint.hostBytes));
+    }
+    if (streamedCloud) {
+        const StreamedPointCloud::Stats& stats = streamedCloud->stats();
+        fprintf(file, "  \"streaming\": { \"hits\": %llu, \"misses\": %llu, \"evictions\": %llu, \"residentNodes\": %u, \"residentBytes\": %llu,"
+                      " \"uploadedBytes\": %llu, \"uploadMBps\": %.1f, \"diskMBps\": %.1f, \"drawnPoints\": %llu },\n",
+                static_cast<unsigned long long>(stats.hits), static_cast<unsigned long long>(stats.misses),
+                static_cast<unsigned long long>(stats.evictions), stats.residentNodes,
+                static_cast<unsigned long long>(stats.residentBytes), static_cast<unsigned long long>(stats.uploadedBytes),
+                stats.uploadMegabytesPerSecond, stats.diskMegabytesPerSecond, static_cast<unsigned long long>(stats.drawnPoints));
+    }
+    if (options.nullDriver) {
+        writeApiCalls(file, apiCalls, options.frames);
+    }
+    writeDistribution(file, "cpuFrameMs", cpuMs);
+    writeDistribution(file, "frameIntervalMs", frameIntervalMs);
+    writeDistribution(file, "gpuFrameMs", gpuMs, true);
+    fprintf(file, "}\n");
+    if (file != stdout) {
+        fclose(file);
+    }
+
+    //
+    // Release in the same order as VulkanRenderer
+    //
+    renderGraph.release();
+    scene->releasePipeline();
+    pipelineMgr.reset();
+    recorder.reset();
+    drawMgr->setGpuProfiler(nullptr);
+    gpuProfiler.reset();
+    scene->releaseResource();
+    resourceMgr.reset();
+    context.release();
+    if (options.nullDriver && NullDriver::liveMemoryAllocations()) {
+        printf("Leaked memory allocations: %llu\n", static_cast<unsigned long long>(NullDriver::liveMemoryAllocations()));
+    }
+    return 0;
+}
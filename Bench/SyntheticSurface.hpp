@@ -0,0 +1,85 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+///
+/// Synthetic scan for Scan library benchmarks - wavy height field y(x, z) over 2 x 2 m,
+/// waves constrain all 6 DoF of registration and give curvature to normal estimation.
+///
+namespace Bench
+{
+
+inline float surfaceHeight(float x, float z)
+{
+    return 0.1f * std::sin(3.f * x) * std::cos(2.f * z) + 0.05f * std::sin(7.f * z + 1.f);
+}
+
+inline glm::vec3 surfaceNormal(float x, float z)
+{
+    float dx = 0.3f * std::cos(3.f * x) * std::cos(2.f * z);
+    float dz = -0.2f * std::sin(3.f * x) * std::sin(2.f * z) + 0.35f * std::cos(7.f * z + 1.f);
+    return glm::normalize(glm::vec3(-dx, 1.f, -dz));
+}
+
+struct SurfaceSampling {
+    uint32_t side = 1000;   // grid of side x side samples
+    float offset = 0.f;     // fraction of grid spacing - other sampling of the same surface
+    bool jitter = false;    // random position inside grid cell instead of fixed offset
+    float noise = 0.f;      // meters along normal, uniform
+    uint32_t seed = 12345;
+};
+
+///
+/// Samples of the surface, normals - exact normals at sample positions
+///
+inline void sampleSurface(const SurfaceSampling& sampling, std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals)
+{
+    positions.clear();
+    normals.clear();
+    positions.reserve(size_t(sampling.side) * sampling.side);
+    normals.reserve(size_t(sampling.side) * sampling.side);
+    float spacing = 2.f / sampling.side;
+    uint32_t random = sampling.seed;
+    auto next = [&random]() {
+        random = random * 1664525u + 1013904223u;
+        return (random >> 8) * (1.f / 16777216.f);
+    };
+    for (uint32_t row = 0; row < sampling.side; ++row) {
+        for (uint32_t col = 0; col < sampling.side; ++col) {
+            float x = -1.f + (col + (sampling.jitter ? next() : sampling.offset)) * spacing;
+            float z = -1.f + (row + (sampling.jitter ? next() : sampling.offset)) * spacing;
+            glm::vec3 normal = surfaceNormal(x, z);
+            positions.push_back(glm::vec3(x, surfaceHeight(x, z), z) + normal * (sampling.noise * (2.f * next() - 1.f)));
+            normals.push_back(normal);
+        }
+    }
+}
+
+}
@@ -0,0 +1,265 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BenchHarness.hpp"
+#include <Scan/TsdfMesher.hpp>
+#include <Scan/TsdfVolume.hpp>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <thread>
+
+namespace {
+
+struct Options {
+    uint32_t frames = 60;
+    float voxelSize = 0.01f;
+    std::string output = "tsdf_fusion_bench.json";
+};
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i) {
+        const char* arg = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(arg, "--frames") == 0 && value) {
+            options.frames = std::max(1u, static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10)));
+        }
+        else if (strcmp(arg, "--voxel") == 0 && value) {
+            options.voxelSize = std::max(0.001f, static_cast<float>(std::atof(argv[++i])));
+        }
+        else if (strcmp(arg, "--output") == 0 && value) {
+            options.output = argv[++i];
+        }
+        else {
+            printf("Usage: tsdf_fusion_bench [--frames N] [--voxel METERS] [--output FILE]\n");
+            return false;
+        }
+    }
+    return true;
+}
+
+//
+// Synthetic scene - sphere in front of wall standing on floor, camera (x right, y down, z forward) orbits the sphere
+//
+const glm::vec3 SphereCenter(0.f, 0.f, 0.f);
+const float SphereRadius = 0.5f;
+const float WallZ = 1.f;
+const float FloorY = 0.5f;
+
+glm::mat4 cameraPose(uint32_t frame, uint32_t frames)
+{
+    float angle = -0.4f + 0.8f * frame / std::max(1u, frames - 1);
+    glm::vec3 position(2.f * std::sin(angle), -0.3f, -2.f * std::cos(angle));
+    glm::vec3 forward = glm::normalize(SphereCenter - position);
+    glm::vec3 right = glm::normalize(glm::cross(glm::vec3(0.f, 1.f, 0.f), forward)); // y is down
+    glm::vec3 down = glm::cross(forward, right);
+    glm::mat4 pose(1.f);
+    pose[0] = glm::vec4(right, 0.f);
+    pose[1] = glm::vec4(down, 0.f);
+    pose[2] = glm::vec4(forward, 0.f);
+    pose[3] = glm::vec4(position, 1.f);
+    return pose;
+}
+
+///
+/// Distance along ray (origin + dir * t) to the nearest surface, infinity - nothing hit
+///
+float castRay(const glm::vec3& origin, const glm::vec3& dir)
+{
+    float nearest = std::numeric_limits<float>::infinity();
+    glm::vec3 toOrigin = origin - SphereCenter;
+    float a = glm::dot(dir, dir);
+    float b = glm::dot(toOrigin, dir);
+    float c = glm::dot(toOrigin, toOrigin) - SphereRadius * SphereRadius;
+    float discriminant = b * b - a * c;
+    if (discriminant >= 0.f) {
+        float t = (-b - std::sqrt(discriminant)) / a;
+        if (t > 0.f) {
+            nearest = t;
+        }
+    }
+    if (dir.z > 0.f) {
+        nearest = std::min(nearest, (WallZ - origin.z) / dir.z);
+    }
+    if (dir.y > 0.f) {
+        nearest = std::min(nearest, (FloorY - origin.y) / dir.y);
+    }
+    return nearest;
+}
+
+std::vector<uint16_t> renderDepth(const CameraIntrinsics& intrinsics, const glm::mat4& pose)
+{
+    std::vector<uint16_t> depth(size_t(intrinsics.width) * intrinsics.height, 0);
+    glm::vec3 origin(pose[3]);
+    for (uint32_t v = 0; v < intrinsics.height; ++v) {
+        for (uint32_t u = 0; u < intrinsics.width; ++u) {
+            glm::vec3 camDir((u - intrinsics.cx) / intrinsics.fx, (v - intrinsics.cy) / intrinsics.fy, 1.f);
+            glm::vec3 dir = glm::vec3(pose * glm::vec4(camDir, 0.f));
+            float t = castRay(origin, dir); // dir has camera z = 1, so t is depth
+            if (t < 10.f) {
+                depth[size_t(v) * intrinsics.width + u] = static_cast<uint16_t>(t * 1000.f + 0.5f);
+            }
+        }
+    }
+    return depth;
+}
+
+///
+/// Fused distance at world point in meters, NaN - not observed
+///
+float fusedDistance(const TsdfVolume& volume, const glm::vec3& point)
+{
+    float blockSize = volume.settings().voxelSize * TsdfVolume::BlockSize;
+    glm::vec3 voxel = point / volume.settings().voxelSize - 0.5f;
+    glm::ivec3 voxelCoord(glm::floor(voxel + 0.5f));
+    glm::ivec3 blockCoord(glm::floor(point / blockSize));
+    uint32_t blockIdx = volume.findBlock(blockCoord);
+    if (blockIdx == TsdfVolume::InvalidBlock) {
+        return std::numeric_limits<float>::quiet_NaN();
+    }
+    glm::ivec3 local = voxelCoord - blockCoord * TsdfVolume::BlockSize;
+    int voxelIdx = local.x + local.y * TsdfVolume::BlockSize + local.z * TsdfVolume::BlockSize * TsdfVolume::BlockSize;
+    if (volume.blockWeights(blockIdx)[voxelIdx] == 0) {
+        return std::numeric_limits<float>::quiet_NaN();
+    }
+    return volume.blockSdf(blockIdx)[voxelIdx] * volume.settings().truncation / TsdfVolume::SdfMax;
+}
+
+}
+
+///
+/// TSDF fusion (TsdfVolume) of synthetic 640x480 depth sequence with one and all threads - ms per frame split into
+/// block allocation and voxel integration, blocks and memory. Every frame is followed by incremental mesh extraction
+/// (TsdfMesher), compared at the end with meshing the whole volume from scratch.
+/// Fused distance on the sphere is checked at the end.
+///
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 1;
+    }
+
+    CameraIntrinsics intrinsics;
+    intrinsics.width = 640;
+    intrinsics.height = 480;
+    intrinsics.fx = intrinsics.fy = 525.f;
+    intrinsics.cx = 319.5f;
+    intrinsics.cy = 239.5f;
+
+    printf("Rendering %u frames...\n", options.frames);
+    std::vector<std::vector<uint16_t>> frames(options.frames);
+    std::vector<glm::mat4> poses(options.frames);
+    for (uint32_t f = 0; f < options.frames; ++f) {
+        poses[f] = cameraPose(f, options.frames);
+        frames[f] = renderDepth(intrinsics, poses[f]);
+    }
+    std::vector<uint32_t> colors(size_t(intrinsics.width) * intrinsics.height, 0xff8080c0u);
+    ColorImage color;
+    color.pixels = colors.data();
+    color.width = intrinsics.width;
+    color.height = intrinsics.height;
+
+    Bench::JsonReport report;
+    report.setInfo("hardwareThreads", std::to_string(std::thread::hardware_concurrency()));
+    report.setInfo("frames", std::to_string(options.frames));
+    report.setInfo("voxelSize", std::to_string(options.voxelSize));
+    bool ok = true;
+    const uint32_t threadCounts[] = {1, 0};
+    for (uint32_t threads : threadCounts) {
+        TsdfVolume::Settings settings;
+        settings.voxelSize = options.voxelSize;
+        settings.truncation = 4.f * options.voxelSize;
+        settings.threads = threads;
+        TsdfVolume volume;
+        volume.setSettings(settings);
+        TsdfMesher mesher(threads);
+
+        uint32_t frame = 0;
+        double allocateMs = 0.0;
+        double integrateMs = 0.0;
+        double meshMs = 0.0;
+        uint64_t meshedBlocks = 0;
+        uint64_t changedPages = 0;
+        Bench::Result result = Bench::run(options.frames, [&]() {
+            ok = volume.integrate(frames[frame].data(), 0.001f, intrinsics, poses[frame], color) && ok;
+            allocateMs += volume.stats().allocateMs;
+            integrateMs += volume.stats().integrateMs;
+            mesher.extract(volume);
+            meshMs += mesher.stats().ms;
+            meshedBlocks += mesher.stats().meshedBlocks;
+            changedPages += mesher.stats().changedVertexPages + mesher.stats().changedIndexPages;
+            ++frame;
+        }, 0);
+
+        const TsdfVolume::Stats& stats = volume.stats();
+        std::string name = "640x480 frame, threads: " + std::to_string(stats.threads);
+        Bench::print(name.c_str(), result, static_cast<double>(intrinsics.width) * intrinsics.height);
+        printf("%-40s allocate %.3f ms  integrate %.3f ms  last frame touched %u blocks\n", "",
+               allocateMs / options.frames, integrateMs / options.frames, stats.touchedBlocks);
+        printf("%-40s %u blocks  %.1f MiB  %.0f B/block\n", "",
+               stats.blocks, stats.bytes / (1024.0 * 1024.0), stats.blocks ? double(stats.bytes) / stats.blocks : 0.0);
+        report.add(name, result, static_cast<double>(intrinsics.width) * intrinsics.height);
+        report.setInfo(name + " blocks", std::to_string(stats.blocks));
+        report.setInfo(name + " bytes", std::to_string(stats.bytes));
+
+        // incremental meshing against extraction of whole volume from scratch
+        TsdfMesher fullMesher(threads);
+        Bench::Result fullResult = Bench::run(3, [&]() {
+            fullMesher.reset();
+            fullMesher.extract(volume);
+        }, 0);
+        const TsdfMesher::Stats& meshStats = mesher.stats();
+        printf("%-40s mesh %.3f ms  %.0f blocks  %.0f pages per frame  full re-mesh %.3f ms\n", "",
+               meshMs / options.frames, double(meshedBlocks) / options.frames, double(changedPages) / options.frames,
+               fullResult.medianMs);
+        printf("%-40s %u vertices  %u triangles\n", "", meshStats.vertices, meshStats.triangles);
+        report.add(name + " full re-mesh", fullResult);
+        report.setInfo(name + " mesh ms per frame", std::to_string(meshMs / options.frames));
+        report.setInfo(name + " triangles", std::to_string(meshStats.triangles));
+        if (meshStats.vertices != fullMesher.stats().vertices || meshStats.triangles != fullMesher.stats().triangles) {
+            printf("    ERROR: incremental mesh %u/%u differs from full mesh %u/%u vertices/triangles\n",
+                   meshStats.vertices, meshStats.triangles, fullMesher.stats().vertices, fullMesher.stats().triangles);
+            ok = false;
+        }
+
+        // surface seen by the camera - point of sphere nearest to the middle camera position
+        glm::vec3 middle(poses[options.frames / 2][3]);
+        glm::vec3 surface = SphereCenter + glm::normalize(middle - SphereCenter) * SphereRadius;
+        float distance = fusedDistance(volume, surface);
+        if (!(std::fabs(distance) <= options.voxelSize)) {
+            printf("    ERROR: fused distance on sphere surface %f m\n", distance);
+            ok = false;
+        }
+        float outside = fusedDistance(volume, surface + glm::normalize(middle - SphereCenter) * (2.f * options.voxelSize));
+        if (!(outside > options.voxelSize)) {
+            printf("    ERROR: fused distance in front of sphere %f m\n", outside);
+            ok = false;
+        }
+    }
+    return report.write(options.output.c_str()) && ok ? 0 : 1;
+}
@@ -0,0 +1,191 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BindlessTextureTable.hpp"
+#include "ResourceManager.hpp"
+#include "ImageViewDescr.hpp"
+#include "SamplerDescr.hpp"
+#include "Texture.hpp"
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
+
+BindlessTextureTable::BindlessTextureTable(ResourceManager* resourceMgr)
+    : mResourceMgr(resourceMgr)
+{
+    assert(mResourceMgr && "Resource Manager should be valid!");
+}
+
+BindlessTextureTable::~BindlessTextureTable()
+{
+    release();
+}
+
+void BindlessTextureTable::release()
+{
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VkDevice device = mResourceMgr->device();
+    devFuncs->vkDestroyDescriptorPool(device, mPool, nullptr); // frees mDescriptorSet too
+    devFuncs->vkDestroyDescriptorSetLayout(device, mLayout, nullptr);
+    mPool = nullptr;
+    mLayout = nullptr;
+    mDescriptorSet = nullptr;
+    mCapacity = 0;
+    mFreeSlots.clear();
+}
+
+bool BindlessTextureTable::create(uint32_t maxTextures)
+{
+    release();
+    VkResult result = VK_SUCCESS;
+
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VkDevice device = mResourceMgr->device();
+
+    //
+    // Layout - one binding with whole array
+    //
+    VkDescriptorSetLayoutBinding binding = {};
+    binding.binding = 0;
+    binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    binding.descriptorCount = maxTextures;
+    binding.stageFlags = VK_SHADER_STAGE_ALL;
+    binding.pImmutableSamplers = nullptr;
+
+    // Not all slots have to be valid and slots can be written while set is bound to pending command buffer
+    VkDescriptorBindingFlagsEXT bindingFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT
+                                             | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT
+                                             | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT;
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo = {};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+    bindingFlagsInfo.bindingCount = 1;
+    bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &binding;
+
+    result = devFuncs->vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &mLayout);
+    if (result != VK_SUCCESS) {
+        qWarning("Can't create bindless descriptor set layout. Result: %i", result);
+        return false;
+    }
+
+    //
+    // Pool - only for this one set
+    //
+    VkDescriptorPoolSize poolSize = {};
+    poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSize.descriptorCount = maxTextures;
+
+    VkDescriptorPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT;
+    poolInfo.maxSets = 1;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+
+    result = devFuncs->vkCreateDescriptorPool(device, &poolInfo, nullptr, &mPool);
+    if (result != VK_SUCCESS) {
+        qWarning("Can't create bindless descriptor pool. Result: %i", result);
+        release();
+        return false;
+    }
+
+    VkDescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = mPool;
+    allocateInfo.descriptorSetCount = 1;
+    allocateInfo.pSetLayouts = &mLayout;
+
+    result = devFuncs->vkAllocateDescriptorSets(device, &allocateInfo, &mDescriptorSet);
+    if (result != VK_SUCCESS) {
+        qWarning("Can't allocate bindless descriptor set. Result: %i", result);
+        release();
+        return false;
+    }
+
+    mCapacity = maxTextures;
+    mFreeSlots.resize(maxTextures);
+    for (uint32_t i = 0; i < maxTextures; ++i) {
+        mFreeSlots[i] = maxTextures - 1 - i;
+    }
+
+    qInfo("Bindless texture table created. Capacity: %d", mCapacity);
+    return true;
+}
+
+uint32_t BindlessTextureTable::registerTexture(Texture& texture, VkImageLayout layout)
+{
+    if (!mDescriptorSet) {
+        qWarning("Bindless texture table is not created!");
+        return InvalidIndex;
+    }
+    if (!texture.view || !texture.sampler) {
+        qWarning("Can't register incomplete texture in bindless table!");
+        return InvalidIndex;
+    }
+
+    if (texture.bindlessIndex == InvalidIndex) {
+        if (mFreeSlots.empty()) {
+            qWarning("Bindless texture table is full. Capacity: %d", mCapacity);
+            return InvalidIndex;
+        }
+        texture.bindlessIndex = mFreeSlots.back();
+        mFreeSlots.pop_back();
+    }
+
+    VkDescriptorImageInfo imageInfo = {};
+    imageInfo.sampler = texture.sampler->getSampler();
+    imageInfo.imageView = texture.view->getImageView();
+    imageInfo.imageLayout = layout;
+
+    VkWriteDescriptorSet writeDs = {};
+    writeDs.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writeDs.dstSet = mDescriptorSet;
+    writeDs.dstBinding = 0;
+    writeDs.dstArrayElement = texture.bindlessIndex;
+    writeDs.descriptorCount = 1;
+    writeDs.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writeDs.pImageInfo = &imageInfo;
+
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    devFuncs->vkUpdateDescriptorSets(mResourceMgr->device(), 1, &writeDs, 0, nullptr);
+
+    return texture.bindlessIndex;
+}
+
+void BindlessTextureTable::unregisterTexture(Texture& texture)
+{
+    if (texture.bindlessIndex == InvalidIndex) {
+        return;
+    }
+    assert(texture.bindlessIndex < mCapacity && "Texture registered in other table?");
+    // Slot stays written, it is partially bound so nobody should read it until it is reused
+    mFreeSlots.push_back(texture.bindlessIndex);
+    texture.bindlessIndex = InvalidIndex;
+}
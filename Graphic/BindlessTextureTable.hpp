@@ -0,0 +1,74 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+
+class ResourceManager;
+struct Texture;
+
+///
+/// One big array of combined image samplers in a single descriptor set (VK_EXT_descriptor_indexing).
+/// Binding is partially bound and update-after-bind, so textures can be added while the set is in use.
+/// Every registered Texture gets a stable index, shaders pick texture by this index e.g. from push constant:
+///     layout(set = X, binding = 0) uniform sampler2D bindlessTextures[];
+///
+class BindlessTextureTable
+{
+public:
+    static const uint32_t InvalidIndex = ~0u;
+
+    BindlessTextureTable(ResourceManager* resourceMgr);
+    ~BindlessTextureTable();
+
+    bool create(uint32_t maxTextures);
+
+    ///
+    /// Write texture into the first free slot. Index is stored in texture.bindlessIndex and returned.
+    /// Registering already registered texture only refreshes its descriptor.
+    ///
+    uint32_t registerTexture(Texture& texture, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    void unregisterTexture(Texture& texture);
+
+    VkDescriptorSetLayout getLayout() const { return mLayout; }
+    VkDescriptorSet getDescriptorSet() const { return mDescriptorSet; }
+    uint32_t capacity() const { return mCapacity; }
+    uint32_t size() const { return mCapacity - static_cast<uint32_t>(mFreeSlots.size()); }
+
+    BindlessTextureTable(const BindlessTextureTable&) = delete;
+    BindlessTextureTable& operator=(const BindlessTextureTable&) = delete;
+
+protected:
+    void release();
+
+    VkDescriptorSetLayout mLayout = nullptr;
+    VkDescriptorPool      mPool = nullptr;
+    VkDescriptorSet       mDescriptorSet = nullptr;
+    uint32_t              mCapacity = 0;
+    std::vector<uint32_t> mFreeSlots; // used as stack, initially lowest index on the top
+
+    ResourceManager* mResourceMgr;
+};
@@ -0,0 +1,311 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BoundsCuller.hpp"
+#include "CpuTrace.hpp"
+#include <WorkStealingPool.hpp>
+#include <chrono>
+#include <thread>
+#include <limits>
+#include <algorithm>
+#include <assert.h>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define BOUNDS_CULLER_X86 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BOUNDS_CULLER_NEON 1
+#include <arm_neon.h>
+#endif
+
+#if defined(BOUNDS_CULLER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define BOUNDS_CULLER_AVX 1 // compiled with target attribute, used only when CPU supports it
+#endif
+
+const float BoundsCuller::AlwaysVisibleRadius = std::numeric_limits<float>::infinity();
+
+namespace {
+
+const size_t Padding = 8; // the widest SIMD path
+const float PaddingRadius = -std::numeric_limits<float>::max(); // never passes plane test
+
+typedef const float (*Planes)[4]; // [Frustum::PlaneCount][4]
+
+void cullScalar(Planes planes, const float* x, const float* y, const float* z, const float* r, uint8_t* visible, size_t first, size_t last)
+{
+    for (size_t i = first; i < last; ++i) {
+        bool inside = true;
+        for (int p = 0; p < Frustum::PlaneCount; ++p) {
+            float distance = planes[p][0] * x[i] + planes[p][1] * y[i] + planes[p][2] * z[i] + planes[p][3];
+            inside = inside && distance >= -r[i];
+        }
+        visible[i] = inside ? 1 : 0;
+    }
+}
+
+#if defined(BOUNDS_CULLER_X86)
+void cullSse(Planes planes, const float* x, const float* y, const float* z, const float* r, uint8_t* visible, size_t first, size_t last)
+{
+    __m128 planeX[Frustum::PlaneCount], planeY[Frustum::PlaneCount], planeZ[Frustum::PlaneCount], planeW[Frustum::PlaneCount];
+    for (int p = 0; p < Frustum::PlaneCount; ++p) {
+        planeX[p] = _mm_set1_ps(planes[p][0]);
+        planeY[p] = _mm_set1_ps(planes[p][1]);
+        planeZ[p] = _mm_set1_ps(planes[p][2]);
+        planeW[p] = _mm_set1_ps(planes[p][3]);
+    }
+    const __m128 zero = _mm_setzero_ps();
+    for (size_t i = first; i < last; i += 4) {
+        __m128 cx = _mm_loadu_ps(x + i);
+        __m128 cy = _mm_loadu_ps(y + i);
+        __m128 cz = _mm_loadu_ps(z + i);
+        __m128 negR = _mm_sub_ps(zero, _mm_loadu_ps(r + i));
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < Frustum::PlaneCount; ++p) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+                                         _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negR));
+        }
+        int mask = _mm_movemask_ps(inside);
+        visible[i + 0] = static_cast<uint8_t>(mask & 1);
+        visible[i + 1] = static_cast<uint8_t>((mask >> 1) & 1);
+        visible[i + 2] = static_cast<uint8_t>((mask >> 2) & 1);
+        visible[i + 3] = static_cast<uint8_t>((mask >> 3) & 1);
+    }
+}
+#endif
+
+#if defined(BOUNDS_CULLER_AVX)
+__attribute__((target("avx")))
+void cullAvx(Planes planes, const float* x, const float* y, const float* z, const float* r, uint8_t* visible, size_t first, size_t last)
+{
+    __m256 planeX[Frustum::PlaneCount], planeY[Frustum::PlaneCount], planeZ[Frustum::PlaneCount], planeW[Frustum::PlaneCount];
+    for (int p = 0; p < Frustum::PlaneCount; ++p) {
+        planeX[p] = _mm256_set1_ps(planes[p][0]);
+        planeY[p] = _mm256_set1_ps(planes[p][1]);
+        planeZ[p] = _mm256_set1_ps(planes[p][2]);
+        planeW[p] = _mm256_set1_ps(planes[p][3]);
+    }
+    const __m256 zero = _mm256_setzero_ps();
+    for (size_t i = first; i < last; i += 8) {
+        __m256 cx = _mm256_loadu_ps(x + i);
+        __m256 cy = _mm256_loadu_ps(y + i);
+        __m256 cz = _mm256_loadu_ps(z + i);
+        __m256 negR = _mm256_sub_ps(zero, _mm256_loadu_ps(r + i));
+        __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ); // all bits set
+        for (int p = 0; p < Frustum::PlaneCount; ++p) {
+            __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], cx), _mm256_mul_ps(planeY[p], cy)),
+                                            _mm256_add_ps(_mm256_mul_ps(planeZ[p], cz), planeW[p]));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negR, _CMP_GE_OQ));
+        }
+        int mask = _mm256_movemask_ps(inside);
+        for (int lane = 0; lane < 8; ++lane) {
+            visible[i + lane] = static_cast<uint8_t>((mask >> lane) & 1);
+        }
+    }
+}
+#endif
+
+#if defined(BOUNDS_CULLER_NEON)
+void cullNeon(Planes planes, const float* x, const float* y, const float* z, const float* r, uint8_t* visible, size_t first, size_t last)
+{
+    for (size_t i = first; i < last; i += 4) {
+        float32x4_t cx = vld1q_f32(x + i);
+        float32x4_t cy = vld1q_f32(y + i);
+        float32x4_t cz = vld1q_f32(z + i);
+        float32x4_t negR = vnegq_f32(vld1q_f32(r + i));
+        uint32x4_t inside = vdupq_n_u32(~0u);
+        for (int p = 0; p < Frustum::PlaneCount; ++p) {
+            float32x4_t distance = vdupq_n_f32(planes[p][3]);
+            distance = vmlaq_n_f32(distance, cx, planes[p][0]);
+            distance = vmlaq_n_f32(distance, cy, planes[p][1]);
+            distance = vmlaq_n_f32(distance, cz, planes[p][2]);
+            inside = vandq_u32(inside, vcgeq_f32(distance, negR));
+        }
+        visible[i + 0] = static_cast<uint8_t>(vgetq_lane_u32(inside, 0) & 1);
+        visible[i + 1] = static_cast<uint8_t>(vgetq_lane_u32(inside, 1) & 1);
+        visible[i + 2] = static_cast<uint8_t>(vgetq_lane_u32(inside, 2) & 1);
+        visible[i + 3] = static_cast<uint8_t>(vgetq_lane_u32(inside, 3) & 1);
+    }
+}
+#endif
+
+size_t roundUp(size_t value, size_t multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+}
+
+BoundsCuller::BoundsCuller()
+{
+}
+
+BoundsCuller::~BoundsCuller()
+{
+}
+
+void BoundsCuller::resize(size_t count)
+{
+    size_t padded = roundUp(count, Padding);
+    mX.resize(padded, 0.f);
+    mY.resize(padded, 0.f);
+    mZ.resize(padded, 0.f);
+    mRadius.resize(padded, PaddingRadius);
+    std::fill(mRadius.begin() + count, mRadius.end(), PaddingRadius);
+    mCount = count;
+}
+
+uint32_t BoundsCuller::add(const glm::vec3& center, float radius)
+{
+    resize(mCount + 1);
+    set(mCount - 1, center, radius);
+    return static_cast<uint32_t>(mCount - 1);
+}
+
+void BoundsCuller::set(size_t idx, const glm::vec3& center, float radius)
+{
+    assert(idx < mCount);
+    mX[idx] = center.x;
+    mY[idx] = center.y;
+    mZ[idx] = center.z;
+    mRadius[idx] = radius;
+}
+
+bool BoundsCuller::isSupported(SimdPath path)
+{
+    switch (path) {
+    case SimdAuto:
+    case SimdScalar: return true;
+#if defined(BOUNDS_CULLER_X86)
+    case SimdSse: return true;
+#endif
+#if defined(BOUNDS_CULLER_AVX)
+    case SimdAvx: return __builtin_cpu_supports("avx");
+#endif
+#if defined(BOUNDS_CULLER_NEON)
+    case SimdNeon: return true;
+#endif
+    default: break;
+    }
+    return false;
+}
+
+BoundsCuller::SimdPath BoundsCuller::setSimdPath(SimdPath path)
+{
+    if (path == SimdAuto || !isSupported(path)) {
+        static const SimdPath bestFirst[] = {SimdAvx, SimdSse, SimdNeon, SimdScalar};
+        for (SimdPath candidate : bestFirst) {
+            if (isSupported(candidate)) {
+                path = candidate;
+                break;
+            }
+        }
+    }
+    mPath = path;
+    return mPath;
+}
+
+const char* BoundsCuller::simdPathName(SimdPath path)
+{
+    switch (path) {
+    case SimdAuto:   return "auto";
+    case SimdScalar: return "scalar";
+    case SimdSse:    return "SSE2";
+    case SimdAvx:    return "AVX";
+    case SimdNeon:   return "NEON";
+    }
+    return "unknown";
+}
+
+void BoundsCuller::cullRange(const float planes[Frustum::PlaneCount][4], size_t first, size_t last)
+{
+    const float* x = mX.data();
+    const float* y = mY.data();
+    const float* z = mZ.data();
+    const float* r = mRadius.data();
+    uint8_t* visible = mVisible.data();
+
+    switch (mPath) {
+#if defined(BOUNDS_CULLER_AVX)
+    case SimdAvx: cullAvx(planes, x, y, z, r, visible, first, last); return;
+#endif
+#if defined(BOUNDS_CULLER_X86)
+    case SimdSse: cullSse(planes, x, y, z, r, visible, first, last); return;
+#endif
+#if defined(BOUNDS_CULLER_NEON)
+    case SimdNeon: cullNeon(planes, x, y, z, r, visible, first, last); return;
+#endif
+    default: break;
+    }
+    cullScalar(planes, x, y, z, r, visible, first, last);
+}
+
+const std::vector<uint8_t>& BoundsCuller::cull(const Frustum& frustum)
+{
+    TRACE_SCOPE("BoundsCuller::cull");
+    auto start = std::chrono::steady_clock::now();
+    if (mPath == SimdAuto) {
+        setSimdPath(SimdAuto);
+    }
+
+    float planes[Frustum::PlaneCount][4];
+    for (int p = 0; p < Frustum::PlaneCount; ++p) {
+        planes[p][0] = frustum.planes[p].x;
+        planes[p][1] = frustum.planes[p].y;
+        planes[p][2] = frustum.planes[p].z;
+        planes[p][3] = frustum.planes[p].w;
+    }
+
+    size_t padded = mX.size();
+    mVisible.resize(padded);
+
+    // Ranges are multiple of Padding - every thread runs full SIMD width
+    const size_t blocks = padded / Padding;
+    const size_t grain = ParallelThreshold / 4 / Padding;
+    uint32_t threads = 1;
+    if (mCount >= ParallelThreshold) {
+        threads = mMaxThreads ? mMaxThreads : std::max(1u, std::thread::hardware_concurrency());
+        threads = static_cast<uint32_t>(std::min<size_t>(threads, (blocks + grain - 1) / grain)); // no idle pool threads
+    }
+
+    if (threads == 1) {
+        cullRange(planes, 0, padded);
+    }
+    else {
+        if (!mPool || mPool->threadCount() != threads) {
+            mPool.reset(new WorkStealingPool(threads));
+        }
+        mPool->parallelFor(blocks, grain, [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+            cullRange(planes, first * Padding, last * Padding);
+        });
+    }
+    mVisible.resize(mCount);
+
+    mStats.tested = static_cast<uint32_t>(mCount);
+    mStats.visible = static_cast<uint32_t>(std::count(mVisible.begin(), mVisible.end(), 1));
+    mStats.culled = mStats.tested - mStats.visible;
+    mStats.threads = threads;
+    mStats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return mVisible;
+}
@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <glm/glm.hpp>
+#include "Frustum.hpp"
+
+class WorkStealingPool;
+
+///
+/// Bounding spheres kept as structure of arrays (x[], y[], z[], radius[]) and tested against frustum
+/// with SIMD - AVX (runtime detected), SSE2, NEON or scalar fallback.
+/// Large tables are split between persistent threads of WorkStealingPool.
+///
+class BoundsCuller
+{
+public:
+    enum SimdPath {
+        SimdAuto,
+        SimdScalar,
+        SimdSse,
+        SimdAvx,
+        SimdNeon,
+    };
+
+    struct Stats {
+        uint32_t tested = 0;
+        uint32_t visible = 0;
+        uint32_t culled = 0;
+        uint32_t threads = 0;
+        double   timeMs = 0.0;
+    };
+
+    static const float AlwaysVisibleRadius; // infinite sphere - passes every plane
+
+    BoundsCuller();
+    ~BoundsCuller();
+
+    void resize(size_t count);
+    size_t size() const { return mCount; }
+    uint32_t add(const glm::vec3& center, float radius);
+    void set(size_t idx, const glm::vec3& center, float radius);
+
+    ///
+    /// Not supported path falls back to the best available one. Returns path which will be used.
+    ///
+    SimdPath setSimdPath(SimdPath path);
+    SimdPath simdPath() const { return mPath; }
+    static const char* simdPathName(SimdPath path);
+    static bool isSupported(SimdPath path);
+
+    ///
+    /// 0 - hardware concurrency. Tables smaller than ParallelThreshold are always tested on calling thread.
+    ///
+    void setMaxThreads(uint32_t maxThreads) { mMaxThreads = maxThreads; }
+    static const size_t ParallelThreshold = 16384;
+
+    ///
+    /// Returns visibility flag per sphere (1 - visible), valid until next call.
+    ///
+    const std::vector<uint8_t>& cull(const Frustum& frustum);
+    const Stats& stats() const { return mStats; }
+
+protected:
+    void cullRange(const float planes[Frustum::PlaneCount][4], size_t first, size_t last);
+
+    // Padded to multiple of 8 - padding spheres are never visible, SIMD loops don't need tail handling
+    std::vector<float> mX;
+    std::vector<float> mY;
+    std::vector<float> mZ;
+    std::vector<float> mRadius;
+    std::vector<uint8_t> mVisible; // padded as well, resized to mCount for the caller
+    size_t mCount = 0;
+
+    SimdPath mPath = SimdAuto;
+    uint32_t mMaxThreads = 0;
+    std::unique_ptr<WorkStealingPool> mPool; // created by the first cull() of large table
+    Stats mStats;
+};
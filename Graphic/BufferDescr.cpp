@@ -24,9 +24,8 @@ SOFTWARE.
 
 #include "BufferDescr.hpp"
 #include "ResourceManager.hpp"
-#include <QVulkanInstance>
-#include <QVulkanFunctions>
-#include <QVulkanDeviceFunctions>
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
 
 BufferDescr::BufferDescr(ResourceManager* resourceMgr)
     : mResourceMgr(resourceMgr)
@@ -41,12 +40,16 @@ BufferDescr::~BufferDescr()
 
 void BufferDescr::release()
 {
-    QVulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
+    unmap();
     devFuncs->vkDestroyBuffer(device, mBuffer, nullptr);
     devFuncs->vkFreeMemory(device, mMem, nullptr);
     mBuffer = nullptr;
     mMem = nullptr;
+    mSize = 0;
+    mMemoryProperties = 0;
+    mState = ResourceState();
 }
 
 BufferDescr::BufferDescr(BufferDescr&& other)
@@ -64,15 +67,23 @@ void BufferDescr::swapAll(BufferDescr&& other)
 {
     std::swap(mMem, other.mMem);
     std::swap(mBuffer, other.mBuffer);
+    std::swap(mSize, other.mSize);
+    std::swap(mMemoryProperties, other.mMemoryProperties);
+    std::swap(mMapped, other.mMapped);
+    std::swap(mState, other.mState);
     std::swap(mResourceMgr, other.mResourceMgr);
 }
 
-bool BufferDescr::createBuffer(const void* data, size_t dataSize, VkBufferUsageFlags usage)
+bool BufferDescr::createBuffer(const void* data, size_t dataSize, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties)
 {
     release();
+    if (data && !(memoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)) {
+        qWarning("Buffer without host visible memory can't be filled by host\n");
+        return false;
+    }
     VkResult result = VK_SUCCESS;
 
-    QVulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
 
     //
@@ -102,24 +113,10 @@ bool BufferDescr::createBuffer(const void* data, size_t dataSize, VkBufferUsageF
     //
     // Suitable memory type available on physical device
     //
-    uint32_t memoryTypeIndex = ~0u;
-    {
-        const VkPhysicalDeviceMemoryProperties& physDevMemProps = mResourceMgr->phyDevMemProps();
-
-        uint32_t memoryPropertyFlag = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT     // allow write by host
-                                    | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-                                    | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
-
-        for (uint32_t i = 0; i < physDevMemProps.memoryTypeCount; i++) {
-            if ((memReqs.memoryTypeBits & (1 << i)) && (physDevMemProps.memoryTypes[i].propertyFlags & memoryPropertyFlag) == memoryPropertyFlag) {
-                memoryTypeIndex = i;
-                break;
-            }
-        }
-        if (memoryTypeIndex == ~0u) {
-            qWarning("Can't find memory type for buffer\n");
-            return false;
-        }
+    uint32_t memoryTypeIndex = mResourceMgr->findMemoryType(memReqs.memoryTypeBits, memoryProperties);
+    if (memoryTypeIndex == ~0u) {
+        qWarning("Can't find memory type for buffer\n");
+        return false;
     }
 
     //
@@ -139,19 +136,45 @@ bool BufferDescr::createBuffer(const void* data, size_t dataSize, VkBufferUsageF
     // Copy from host
     //
     VkDeviceSize offset = 0;
-    VkMemoryMapFlags mappingFlags = 0; // reserved for future use
-    void* deviceMemMapped = nullptr;
-    devFuncs->vkMapMemory(device, mMem, offset, memReqs.size, mappingFlags, &deviceMemMapped);
+    if (data) {
+        VkMemoryMapFlags mappingFlags = 0; // reserved for future use
+        void* deviceMemMapped = nullptr;
+        devFuncs->vkMapMemory(device, mMem, offset, memReqs.size, mappingFlags, &deviceMemMapped);
 
-    memcpy(deviceMemMapped, data, dataSize);
+        memcpy(deviceMemMapped, data, dataSize);
 
-    devFuncs->vkUnmapMemory(device, mMem);
+        devFuncs->vkUnmapMemory(device, mMem);
+    }
 
     result = devFuncs->vkBindBufferMemory(device, mBuffer, mMem, offset);
     if (result != VK_SUCCESS) {
         qWarning("Can't bind memory to buffer\n");
         return false;
     }
+    mSize = dataSize;
+    mMemoryProperties = memoryProperties;
     return true;
 }
 
+void* BufferDescr::map()
+{
+    if (!mMapped && mMem && isHostVisible()) {
+        VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+        VkMemoryMapFlags mappingFlags = 0; // reserved for future use
+        VkResult result = devFuncs->vkMapMemory(mResourceMgr->device(), mMem, 0, VK_WHOLE_SIZE, mappingFlags, &mMapped);
+        if (result != VK_SUCCESS) {
+            qWarning("Can't map buffer memory\n");
+            mMapped = nullptr;
+        }
+    }
+    return mMapped;
+}
+
+void BufferDescr::unmap()
+{
+    if (mMapped) {
+        mResourceMgr->deviceFunctions()->vkUnmapMemory(mResourceMgr->device(), mMem);
+        mMapped = nullptr;
+    }
+}
+
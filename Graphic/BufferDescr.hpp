@@ -25,6 +25,7 @@ SOFTWARE.
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include "ResourceState.hpp"
 
 class ResourceManager;
 
@@ -34,10 +35,33 @@ public:
     BufferDescr(ResourceManager* resourceMgr);
     ~BufferDescr();
 
-    //TODO this is creating direct buffer for both host and device access - add other posibilities - some staging buffer
-    bool createBuffer(const void* data, size_t dataSize, VkBufferUsageFlags usage);
+    static const VkMemoryPropertyFlags HostVisibleMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                                                         | VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    static const VkMemoryPropertyFlags StagingMemory = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    static const VkMemoryPropertyFlags DeviceLocalMemory = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+
+    ///
+    /// data can be nullptr - content is undefined. Memory without VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT (e.g. DeviceLocalMemory)
+    /// can't be filled with data nor mapped - it is written by GPU e.g. copy from staging buffer (see BufferUploader).
+    ///
+    bool createBuffer(const void* data, size_t dataSize, VkBufferUsageFlags usage, VkMemoryPropertyFlags memoryProperties = HostVisibleMemory);
     VkBuffer getBuffer() const { return mBuffer; }
     VkDeviceMemory getMem() const { return mMem; }
+    VkDeviceSize getSize() const { return mSize; }
+    bool isHostVisible() const { return mMemoryProperties & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT; }
+
+    ///
+    /// Last GPU access - changed only through ResourceStateTracker
+    ///
+    ResourceState& state() { return mState; }
+    const ResourceState& state() const { return mState; }
+
+    ///
+    /// Memory is host coherent - writes through mapped pointer are visible without flush.
+    /// Buffer can stay mapped for its whole life.
+    ///
+    void* map();
+    void unmap();
 
     BufferDescr(const BufferDescr&) = delete;
     BufferDescr& operator=(const BufferDescr&) = delete;
@@ -51,6 +75,10 @@ protected:
 
     VkBuffer mBuffer = nullptr;
     VkDeviceMemory mMem = nullptr;
+    VkDeviceSize mSize = 0;
+    VkMemoryPropertyFlags mMemoryProperties = 0;
+    void* mMapped = nullptr;
+    ResourceState mState;
 
     ResourceManager* mResourceMgr;
 };
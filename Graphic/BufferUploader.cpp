@@ -0,0 +1,103 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "BufferUploader.hpp"
+#include "ResourceManager.hpp"
+#include "BufferDescr.hpp"
+#include "DrawManager.hpp"
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
+#include <assert.h>
+
+BufferUploader::BufferUploader(ResourceManager* resourceMgr, uint32_t framesInFlight)
+    : mFramesInFlight(framesInFlight)
+    , mResourceMgr(resourceMgr)
+{
+    assert(mResourceMgr && "Resource Manager should be valid!");
+    assert(framesInFlight && "At least one frame should be in flight!");
+}
+
+BufferUploader::~BufferUploader()
+{
+}
+
+bool BufferUploader::upload(BufferDescr& dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize dataSize)
+{
+    if (!data || !dataSize || dstOffset + dataSize > dst.getSize()) {
+        qWarning("Upload out of destination buffer range\n");
+        return false;
+    }
+    Copy copy;
+    copy.staging = std::unique_ptr<BufferDescr>(new BufferDescr(mResourceMgr));
+    if (!copy.staging->createBuffer(data, static_cast<size_t>(dataSize), VK_BUFFER_USAGE_TRANSFER_SRC_BIT, BufferDescr::StagingMemory)) {
+        qWarning("Can't create staging buffer\n");
+        return false;
+    }
+    copy.dst = &dst;
+    copy.dstOffset = dstOffset;
+    mPending.push_back(std::move(copy));
+    mPendingBytes += dataSize;
+    mStagingBytes += dataSize;
+    return true;
+}
+
+void BufferUploader::record(DrawManager* drawMgr, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess)
+{
+    assert(drawMgr);
+    ++mFrameCounter;
+
+    // Frame which used these staging buffers was waited before this frame started recording
+    while (!mInFlight.empty() && mInFlight.front().frame + mFramesInFlight <= mFrameCounter) {
+        mStagingBytes -= mInFlight.front().staging->getSize();
+        mInFlight.pop_front();
+    }
+
+    VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
+    if (mPending.empty() || !cmdBuf) {
+        return;
+    }
+
+    // Host writes are visible to GPU after submit - only destinations need barrier
+    ResourceStateTracker* tracker = mResourceMgr->stateTracker();
+    for (Copy& copy : mPending) {
+        tracker->useBuffer(*copy.dst, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    }
+    tracker->flush(cmdBuf);
+
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    for (Copy& copy : mPending) {
+        VkBufferCopy region = {};
+        region.dstOffset = copy.dstOffset;
+        region.size = copy.staging->getSize();
+        devFuncs->vkCmdCopyBuffer(cmdBuf, copy.staging->getBuffer(), copy.dst->getBuffer(), 1, &region);
+    }
+
+    for (Copy& copy : mPending) {
+        tracker->useBuffer(*copy.dst, dstStage, dstAccess);
+        copy.frame = mFrameCounter;
+        mInFlight.push_back(std::move(copy));
+    }
+    mPending.clear();
+    mPendingBytes = 0;
+}
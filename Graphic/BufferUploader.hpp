@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+class ResourceManager;
+class BufferDescr;
+class DrawManager;
+
+///
+/// Fills buffers which host can't write (BufferDescr::DeviceLocalMemory) through staging buffers.
+/// upload() copies data into new staging buffer immediately, record() records queued copies into frame command buffer.
+/// Staging buffer is released framesInFlight record() calls later - record() has to be called every frame (outside render pass).
+/// Destination buffers have to be created with VK_BUFFER_USAGE_TRANSFER_DST_BIT.
+///
+class BufferUploader
+{
+public:
+    BufferUploader(ResourceManager* resourceMgr, uint32_t framesInFlight);
+    ~BufferUploader(); // GPU can't use staging buffers anymore (e.g. called after device wait idle)
+
+    bool upload(BufferDescr& dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize dataSize);
+
+    ///
+    /// Record copies queued since last call. dstStage and dstAccess - next use of destination buffers,
+    /// barrier is queued in ResourceStateTracker and flushed by caller (e.g. Scene::setupBarrier).
+    ///
+    void record(DrawManager* drawMgr, VkPipelineStageFlags dstStage, VkAccessFlags dstAccess);
+
+    VkDeviceSize pendingBytes() const { return mPendingBytes; }   // uploaded but not recorded yet
+    VkDeviceSize stagingBytes() const { return mStagingBytes; }   // all alive staging buffers
+
+    BufferUploader(const BufferUploader&) = delete;
+    BufferUploader& operator=(const BufferUploader&) = delete;
+
+protected:
+    struct Copy {
+        std::unique_ptr<BufferDescr> staging;
+        BufferDescr* dst = nullptr;
+        VkDeviceSize dstOffset = 0;
+        uint64_t frame = 0; // record() counter when copy was recorded
+    };
+
+    std::vector<Copy> mPending;
+    std::deque<Copy> mInFlight;
+    uint64_t mFrameCounter = 0;
+    uint32_t mFramesInFlight;
+    VkDeviceSize mPendingBytes = 0;
+    VkDeviceSize mStagingBytes = 0;
+
+    ResourceManager* mResourceMgr;
+};
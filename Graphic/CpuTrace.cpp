@@ -0,0 +1,276 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "CpuTrace.hpp"
+#include <QtGlobal>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Event {
+    uint64_t beginNs;
+    uint64_t endNs;
+    char     name[CpuTrace::MaxNameLength + 1];
+};
+
+///
+/// Single writer ring - 'written' is published after event is complete.
+/// Ring of exited thread is reused by the next new thread, events before 'start' belong to previous owner.
+///
+struct ThreadBuffer {
+    explicit ThreadBuffer(uint32_t threadId)
+        : events(new Event[CpuTrace::EventsPerThread])
+        , tid(threadId)
+    {}
+
+    std::unique_ptr<Event[]> events;
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint64_t> start{0};
+    uint32_t tid;
+    std::string name;   // guarded by Registry::mutex
+    bool owned = true;  // guarded by Registry::mutex
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers; // kept after thread exit - events can be dumped until ring is reused
+    uint32_t nextTid = 1;
+};
+
+Registry& registry()
+{
+    static Registry sRegistry;
+    return sRegistry;
+}
+
+std::atomic<bool> sEnabled(true);
+
+///
+/// Ring of exited thread or new one - number of rings is the maximum of concurrently recording threads,
+/// not the number of threads ever created (worker pools are recreated e.g. when thread count changes).
+///
+std::shared_ptr<ThreadBuffer> acquireBuffer(const char* name)
+{
+    Registry& reg = registry();
+    std::lock_guard<std::mutex> lock(reg.mutex);
+    auto freeBuffer = std::find_if(reg.buffers.begin(), reg.buffers.end(),
+                                   [](const std::shared_ptr<ThreadBuffer>& buffer) { return !buffer->owned; });
+    std::shared_ptr<ThreadBuffer> buffer;
+    if (freeBuffer != reg.buffers.end()) {
+        buffer = *freeBuffer;
+        buffer->owned = true;
+        buffer->start.store(buffer->written.load(std::memory_order_relaxed), std::memory_order_release);
+    }
+    else {
+        buffer = std::make_shared<ThreadBuffer>(reg.nextTid++);
+        reg.buffers.push_back(buffer);
+    }
+    buffer->name = name ? name : ("Thread " + std::to_string(buffer->tid));
+    return buffer;
+}
+
+///
+/// Returns ring of the thread to registry at thread exit.
+///
+struct ThreadBufferOwner {
+    ~ThreadBufferOwner()
+    {
+        if (buffer) {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            buffer->owned = false;
+        }
+    }
+
+    std::shared_ptr<ThreadBuffer> buffer;
+};
+
+ThreadBuffer& threadBuffer()
+{
+    thread_local ThreadBufferOwner tOwner;
+    if (!tOwner.buffer) {
+        tOwner.buffer = acquireBuffer(nullptr);
+    }
+    return *tOwner.buffer;
+}
+
+void push(ThreadBuffer& buffer, const char* name, uint64_t beginNs, uint64_t endNs)
+{
+    uint64_t idx = buffer.written.load(std::memory_order_relaxed);
+    Event& event = buffer.events[idx % CpuTrace::EventsPerThread];
+    event.beginNs = beginNs;
+    event.endNs = endNs;
+    size_t length = name ? std::min(strlen(name), CpuTrace::MaxNameLength) : 0;
+    memcpy(event.name, name, length);
+    event.name[length] = '\0';
+    buffer.written.store(idx + 1, std::memory_order_release);
+}
+
+///
+/// Copy of events which are still in the ring. Events overwritten during copy are dropped.
+///
+void snapshot(const ThreadBuffer& buffer, std::vector<Event>& events)
+{
+    const uint64_t capacity = CpuTrace::EventsPerThread;
+    uint64_t start = buffer.start.load(std::memory_order_acquire);
+    uint64_t end = buffer.written.load(std::memory_order_acquire);
+    uint64_t begin = std::min(std::max(start, end > capacity ? end - capacity : 0), end);
+    size_t firstCopied = events.size();
+    for (uint64_t idx = begin; idx < end; ++idx) {
+        events.push_back(buffer.events[idx % capacity]);
+    }
+    // Writer could be filling slot of index 'after' - it is the slot of index after - capacity
+    uint64_t after = buffer.written.load(std::memory_order_acquire);
+    uint64_t firstValid = after + 1 > capacity ? after + 1 - capacity : 0;
+    if (firstValid > begin) {
+        size_t overwritten = static_cast<size_t>(std::min(firstValid - begin, end - begin));
+        events.erase(events.begin() + static_cast<std::ptrdiff_t>(firstCopied),
+                     events.begin() + static_cast<std::ptrdiff_t>(firstCopied + overwritten));
+    }
+}
+
+void writeJsonString(FILE* file, const char* str)
+{
+    fputc('"', file);
+    for (const char* c = str; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fputc('\\', file);
+            fputc(*c, file);
+        }
+        else if (static_cast<unsigned char>(*c) < 0x20) {
+            fprintf(file, "\\u%04x", static_cast<unsigned>(*c));
+        }
+        else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+}
+
+uint64_t CpuTrace::nowNs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void CpuTrace::setEnabled(bool enabled)
+{
+    sEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool CpuTrace::isEnabled()
+{
+    return sEnabled.load(std::memory_order_relaxed);
+}
+
+void CpuTrace::setThreadName(const char* name)
+{
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    buffer.name = name;
+}
+
+void CpuTrace::record(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+    push(threadBuffer(), name, beginNs, endNs);
+}
+
+void CpuTrace::recordGpu(const char* name, uint64_t beginNs, uint64_t endNs)
+{
+    if (!isEnabled()) {
+        return;
+    }
+    static std::shared_ptr<ThreadBuffer> sGpuBuffer = acquireBuffer("GPU"); // never released
+    push(*sGpuBuffer, name, beginNs, endNs);
+}
+
+bool CpuTrace::writeChromeTrace(const char* filePath)
+{
+    //
+    // Snapshot of all buffers - registry is locked only for copying list of buffers
+    //
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+    {
+        std::lock_guard<std::mutex> lock(registry().mutex);
+        buffers = registry().buffers;
+    }
+    std::vector<std::vector<Event>> events(buffers.size());
+    uint64_t firstNs = ~0ull;
+    for (size_t bufferIdx = 0; bufferIdx < buffers.size(); ++bufferIdx) {
+        snapshot(*buffers[bufferIdx], events[bufferIdx]);
+        for (const Event& event : events[bufferIdx]) {
+            firstNs = std::min(firstNs, event.beginNs);
+        }
+    }
+
+    FILE* file = fopen(filePath, "w");
+    if (!file) {
+        qWarning("Can't open trace file: %s", filePath);
+        return false;
+    }
+
+    size_t eventCount = 0;
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for (size_t bufferIdx = 0; bufferIdx < buffers.size(); ++bufferIdx) {
+        const ThreadBuffer& buffer = *buffers[bufferIdx];
+        std::string threadName;
+        {
+            std::lock_guard<std::mutex> lock(registry().mutex);
+            threadName = buffer.name;
+        }
+        fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", buffer.tid);
+        writeJsonString(file, threadName.c_str());
+        fprintf(file, "}}");
+        first = false;
+
+        for (const Event& event : events[bufferIdx]) {
+            fprintf(file, ",\n{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"name\":"
+                    , buffer.tid
+                    , static_cast<double>(event.beginNs - firstNs) / 1000.0
+                    , static_cast<double>(event.endNs - event.beginNs) / 1000.0);
+            writeJsonString(file, event.name);
+            fprintf(file, "}");
+        }
+        eventCount += events[bufferIdx].size();
+    }
+    fprintf(file, "\n]}\n");
+
+    bool ok = ferror(file) == 0;
+    ok = fclose(file) == 0 && ok;
+    if (!ok) {
+        qWarning("Can't write trace file: %s", filePath);
+        return false;
+    }
+    qInfo("Trace with %llu events of %d threads written to %s", static_cast<unsigned long long>(eventCount), static_cast<int>(buffers.size()), filePath);
+    return true;
+}
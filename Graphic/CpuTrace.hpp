@@ -0,0 +1,99 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+///
+/// CPU trace - scopes with nanosecond timestamps written to per thread ring buffers.
+/// Only the owner thread writes into its buffer (no locks, no allocation after the first event of the thread),
+/// the oldest events are overwritten when buffer is full. Buffer of exited thread is reused by the next new thread.
+/// writeChromeTrace dumps all buffers as Chrome/Perfetto trace_event JSON (chrome://tracing, ui.perfetto.dev).
+/// Instrumentation is done with macros which compile to nothing without GRAPHIC_TRACE:
+///     void Foo::bar() { TRACE_FUNCTION(); ... { TRACE_SCOPE("Part"); ... } }
+///
+class CpuTrace
+{
+public:
+    static const size_t MaxNameLength = 39;
+    static const size_t EventsPerThread = 16 * 1024;
+
+    static uint64_t nowNs(); // steady clock (CLOCK_MONOTONIC on Linux)
+
+    static void setEnabled(bool enabled); // runtime switch, enabled by default
+    static bool isEnabled();
+
+    static void setThreadName(const char* name); // name of calling thread in trace
+
+    ///
+    /// Event of the calling thread, name is copied.
+    ///
+    static void record(const char* name, uint64_t beginNs, uint64_t endNs);
+
+    ///
+    /// Event on separate "GPU" track - times have to be on nowNs timeline (see GpuProfiler calibration).
+    /// All GPU events have to be recorded by one thread.
+    ///
+    static void recordGpu(const char* name, uint64_t beginNs, uint64_t endNs);
+
+    ///
+    /// Dump events of all threads which are still in ring buffers. Can be called while other threads record.
+    ///
+    static bool writeChromeTrace(const char* filePath);
+
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name)
+            : mName(name)
+            , mBeginNs(isEnabled() ? nowNs() : 0)
+        {}
+        ~Scope()
+        {
+            if (mBeginNs) {
+                record(mName, mBeginNs, nowNs());
+            }
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* mName;
+        uint64_t    mBeginNs;
+    };
+};
+
+#define CPU_TRACE_CONCAT_IMPL(a, b) a##b
+#define CPU_TRACE_CONCAT(a, b) CPU_TRACE_CONCAT_IMPL(a, b)
+
+#ifdef GRAPHIC_TRACE
+#define TRACE_SCOPE(name) CpuTrace::Scope CPU_TRACE_CONCAT(cpuTraceScope, __LINE__)(name)
+#define TRACE_FUNCTION() TRACE_SCOPE(__FUNCTION__)
+#else
+#define TRACE_SCOPE(name)
+#define TRACE_FUNCTION()
+#endif
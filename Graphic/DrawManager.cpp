@@ -23,7 +23,44 @@ SOFTWARE.
 */
 
 #include "DrawManager.hpp"
+#include <assert.h>
 
+DrawManager::DrawManager()
+    : mFrameArena(std::make_shared<FrameArena>())
+{
+}
+
+void DrawManager::beginFrame()
+{
+    mFrameArena->reset();
+    mHeapAllocationsAtFrameBegin = FrameArena::heapAllocationCount();
+}
+
+FrameArena* DrawManager::frameArena() const
+{
+    return mFrameArena.get();
+}
+
+void DrawManager::setFrameArena(const std::shared_ptr<FrameArena>& arena)
+{
+    assert(arena && "Frame arena can't be null!");
+    mFrameArena = arena;
+}
+
+uint64_t DrawManager::heapAllocationsInFrame() const
+{
+    return FrameArena::heapAllocationCount() - mHeapAllocationsAtFrameBegin;
+}
+
+void DrawManager::setGpuProfiler(GpuProfiler* profiler)
+{
+    mGpuProfiler = profiler;
+}
+
+GpuProfiler* DrawManager::gpuProfiler() const
+{
+    return mGpuProfiler;
+}
 
 void DrawManager::setCmdBuffer(VkCommandBuffer cmdBuf)
 {
@@ -35,6 +72,43 @@ VkCommandBuffer DrawManager::getCmdBuffer() const
     return mCmdBuf;
 }
 
+void DrawManager::setRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer)
+{
+    mRenderPass = renderPass;
+    mFramebuffer = framebuffer;
+}
+
+VkRenderPass DrawManager::getRenderPass() const
+{
+    return mRenderPass;
+}
+
+VkFramebuffer DrawManager::getFramebuffer() const
+{
+    return mFramebuffer;
+}
+
+void DrawManager::setCurrentFrame(uint32_t frameIdx)
+{
+    mCurrentFrame = frameIdx;
+}
+
+uint32_t DrawManager::getCurrentFrame() const
+{
+    return mCurrentFrame;
+}
+
+void DrawManager::setViewportSize(uint32_t width, uint32_t height)
+{
+    mViewportSize.width = width;
+    mViewportSize.height = height;
+}
+
+VkExtent2D DrawManager::getViewportSize() const
+{
+    return mViewportSize;
+}
+
 void DrawManager::setProjMatrix(const std::shared_ptr<glm::mat4x4>& projMtx)
 {
     mProjMtx = projMtx;
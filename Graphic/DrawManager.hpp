@@ -27,13 +27,60 @@ SOFTWARE.
 #include <vulkan/vulkan.h>
 #include <memory>
 #include <glm/glm.hpp>
+#include "FrameArena.hpp"
+
+class GpuProfiler;
 
 class DrawManager
 {
 public:
+    DrawManager();
+
+    ///
+    /// Reset frame arena and remember heap allocation counter - call before anything is recorded in the frame.
+    ///
+    void beginFrame();
+
+    ///
+    /// Scratch memory valid until next beginFrame (see FrameArena). Copies of DrawManager share the arena,
+    /// thread which records with its own copy has to set its own arena.
+    ///
+    FrameArena* frameArena() const;
+    void setFrameArena(const std::shared_ptr<FrameArena>& arena);
+
+    ///
+    /// Global heap allocations since beginFrame, 0 when FrameArena::isHeapAllocationCountEnabled() is false.
+    ///
+    uint64_t heapAllocationsInFrame() const;
+
+    ///
+    /// Optional - GPU time of scopes recorded with GpuScope. Owner is the caller.
+    ///
+    void setGpuProfiler(GpuProfiler* profiler);
+    GpuProfiler* gpuProfiler() const;
+
     void setCmdBuffer(VkCommandBuffer cmdBuf);
     VkCommandBuffer getCmdBuffer() const;
 
+    ///
+    /// Render pass and framebuffer currently recorded into - needed e.g. for inheritance of secondary command buffers
+    ///
+    void setRenderPass(VkRenderPass renderPass, VkFramebuffer framebuffer);
+    VkRenderPass getRenderPass() const;
+    VkFramebuffer getFramebuffer() const;
+
+    ///
+    /// Index of frame in flight (0 .. framesInFlight-1) - selects per frame resources
+    ///
+    void setCurrentFrame(uint32_t frameIdx);
+    uint32_t getCurrentFrame() const;
+
+    ///
+    /// Size of the target in pixels - e.g. for screen space sizes (point size attenuation)
+    ///
+    void setViewportSize(uint32_t width, uint32_t height);
+    VkExtent2D getViewportSize() const;
+
     void setProjMatrix(const std::shared_ptr<glm::mat4x4>& projMtx);
     const std::shared_ptr<glm::mat4x4>& getProjMatrix() const;
 
@@ -41,7 +88,14 @@ public:
     const std::shared_ptr<glm::mat4x4>& getViewMatrix() const;
 
 private:
-    VkCommandBuffer mCmdBuf;
+    VkCommandBuffer mCmdBuf = nullptr;
+    VkRenderPass mRenderPass = nullptr;
+    VkFramebuffer mFramebuffer = nullptr;
+    uint32_t mCurrentFrame = 0;
+    VkExtent2D mViewportSize = {};
+    std::shared_ptr<FrameArena> mFrameArena;
+    uint64_t mHeapAllocationsAtFrameBegin = 0;
+    GpuProfiler* mGpuProfiler = nullptr;
 
     std::shared_ptr<glm::mat4x4> mViewMtx;
     std::shared_ptr<glm::mat4x4> mProjMtx;
@@ -0,0 +1,154 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "FrameArena.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <assert.h>
+
+#if defined(GRAPHIC_COUNT_HEAP_ALLOCATIONS)
+
+namespace {
+std::atomic<uint64_t> sHeapAllocations(0);
+}
+
+// Replaced global allocation functions - only counting, memory comes from malloc
+void* operator new(size_t size)
+{
+    sHeapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return ::operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t /*size*/) noexcept
+{
+    std::free(ptr);
+}
+
+uint64_t FrameArena::heapAllocationCount()
+{
+    return sHeapAllocations.load(std::memory_order_relaxed);
+}
+
+bool FrameArena::isHeapAllocationCountEnabled()
+{
+    return true;
+}
+
+#else
+
+uint64_t FrameArena::heapAllocationCount()
+{
+    return 0;
+}
+
+bool FrameArena::isHeapAllocationCountEnabled()
+{
+    return false;
+}
+
+#endif
+
+FrameArena::FrameArena(size_t blockSize)
+    : mBlockSize(blockSize)
+{
+    assert(blockSize && "Block size can't be 0!");
+}
+
+void* FrameArena::allocate(size_t bytes, size_t alignment)
+{
+    assert(alignment && (alignment & (alignment - 1)) == 0 && "Alignment has to be power of 2!");
+    if (!bytes) {
+        bytes = 1; // every allocation gets unique address
+    }
+
+    while (mBlockIdx < mBlocks.size()) {
+        Block& block = mBlocks[mBlockIdx];
+        uintptr_t base = reinterpret_cast<uintptr_t>(block.data.get());
+        size_t alignedOffset = ((base + mOffset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1)) - base;
+        if (alignedOffset + bytes <= block.size) {
+            mOffset = alignedOffset + bytes;
+            return block.data.get() + alignedOffset;
+        }
+        // Does not fit - rest of this block is wasted until reset
+        mUsedInPreviousBlocks += mOffset;
+        ++mBlockIdx;
+        mOffset = 0;
+    }
+
+    Block block;
+    block.size = std::max(mBlockSize, bytes + alignment);
+    block.data.reset(new uint8_t[block.size]);
+    mBlocks.push_back(std::move(block));
+    ++mBlockAllocations;
+    mBlockIdx = mBlocks.size() - 1;
+    mOffset = 0;
+    return allocate(bytes, alignment);
+}
+
+void FrameArena::reset()
+{
+    mBlockIdx = 0;
+    mOffset = 0;
+    mUsedInPreviousBlocks = 0;
+    mBlockAllocations = 0;
+}
+
+size_t FrameArena::used() const
+{
+    return mUsedInPreviousBlocks + mOffset;
+}
+
+size_t FrameArena::capacity() const
+{
+    size_t result = 0;
+    for (const Block& block : mBlocks) {
+        result += block.size;
+    }
+    return result;
+}
@@ -0,0 +1,129 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+///
+/// Linear (bump) allocator for data living at most one frame e.g. arrays passed to vkCmd* functions.
+/// Memory is released all at once by reset(). Blocks are kept between frames so after warm up there are no heap allocations.
+/// Not thread safe - every recording thread uses its own arena (see DrawManager::frameArena).
+///
+class FrameArena
+{
+public:
+    explicit FrameArena(size_t blockSize = 64 * 1024);
+
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    template <typename T>
+    T* allocate(size_t count) { return static_cast<T*>(allocate(count * sizeof(T), alignof(T))); }
+
+    ///
+    /// Forget all allocations, keeps blocks for next frame.
+    ///
+    void reset();
+
+    size_t used() const;                          // bytes allocated since last reset
+    size_t capacity() const;                      // bytes in all blocks
+    uint32_t blockAllocations() const { return mBlockAllocations; } // blocks allocated since last reset (0 in steady state)
+
+    ///
+    /// Number of global operator new calls since application start (all threads).
+    /// Counted only when built with GRAPHIC_COUNT_HEAP_ALLOCATIONS (Debug build), otherwise returns 0.
+    ///
+    static uint64_t heapAllocationCount();
+    static bool isHeapAllocationCountEnabled();
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+protected:
+    struct Block {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size;
+    };
+
+    std::vector<Block> mBlocks;
+    size_t mBlockIdx = 0;  // block currently used
+    size_t mOffset = 0;    // first free byte in mBlocks[mBlockIdx]
+    size_t mUsedInPreviousBlocks = 0;
+    size_t mBlockSize;
+    uint32_t mBlockAllocations = 0;
+};
+
+///
+/// STL allocator on top of FrameArena, deallocate does nothing. Without arena (nullptr) it uses heap.
+///
+template <typename T>
+class FrameArenaAllocator
+{
+public:
+    typedef T value_type;
+
+    FrameArenaAllocator(FrameArena* arena = nullptr) : mArena(arena) {}
+    template <typename U>
+    FrameArenaAllocator(const FrameArenaAllocator<U>& other) : mArena(other.arena()) {}
+
+    T* allocate(size_t count)
+    {
+        if (mArena) {
+            return mArena->allocate<T>(count);
+        }
+        return static_cast<T*>(::operator new(count * sizeof(T)));
+    }
+
+    void deallocate(T* ptr, size_t /*count*/)
+    {
+        if (!mArena) {
+            ::operator delete(ptr);
+        }
+    }
+
+    FrameArena* arena() const { return mArena; }
+
+    template <typename U>
+    bool operator==(const FrameArenaAllocator<U>& other) const { return mArena == other.arena(); }
+    template <typename U>
+    bool operator!=(const FrameArenaAllocator<U>& other) const { return mArena != other.arena(); }
+
+private:
+    FrameArena* mArena;
+};
+
+template <typename T>
+using FrameVector = std::vector<T, FrameArenaAllocator<T>>;
+
+///
+/// e.g. FrameVector<VkBuffer> buffers = makeFrameVector<VkBuffer>(drawMgr->frameArena(), count, nullptr);
+///
+template <typename T>
+FrameVector<T> makeFrameVector(FrameArena* arena, size_t count = 0, const T& value = T())
+{
+    return FrameVector<T>(count, value, FrameArenaAllocator<T>(arena));
+}
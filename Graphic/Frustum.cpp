@@ -0,0 +1,55 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Frustum.hpp"
+
+Frustum Frustum::fromMatrix(const glm::mat4x4& viewProjMtx)
+{
+    // glm is column major - row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    auto row = [&viewProjMtx](int i) { return glm::vec4(viewProjMtx[0][i], viewProjMtx[1][i], viewProjMtx[2][i], viewProjMtx[3][i]); };
+
+    Frustum frustum;
+    frustum.planes[Left]   = row(3) + row(0);
+    frustum.planes[Right]  = row(3) - row(0);
+    frustum.planes[Bottom] = row(3) + row(1);
+    frustum.planes[Top]    = row(3) - row(1);
+    frustum.planes[Near]   = row(2);          // 0 <= z
+    frustum.planes[Far]    = row(3) - row(2); // z <= w
+
+    for (glm::vec4& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        plane /= length > 0.f ? length : 1.f; // normalized - distance to plane is in world units
+    }
+    return frustum;
+}
+
+bool Frustum::intersectsSphere(const glm::vec3& center, float radius) const
+{
+    for (const glm::vec4& plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+            return false;
+        }
+    }
+    return true;
+}
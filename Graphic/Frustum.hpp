@@ -0,0 +1,50 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+
+///
+/// Six planes extracted from projection * view matrix (Vulkan clip space - depth 0..1).
+/// Plane normals point inside, point p is in front of plane when dot(plane.xyz, p) + plane.w >= 0.
+///
+struct Frustum
+{
+    enum Plane {
+        Left,
+        Right,
+        Bottom,
+        Top,
+        Near,
+        Far,
+        PlaneCount
+    };
+
+    glm::vec4 planes[PlaneCount];
+
+    static Frustum fromMatrix(const glm::mat4x4& viewProjMtx);
+
+    bool intersectsSphere(const glm::vec3& center, float radius) const;
+};
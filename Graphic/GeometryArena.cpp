@@ -0,0 +1,209 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "GeometryArena.hpp"
+#include "ResourceManager.hpp"
+#include <QtGlobal>
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+#include <iterator>
+
+//
+// RangeAllocator
+//
+
+RangeAllocator::RangeAllocator(uint32_t capacity)
+{
+    reset(capacity);
+}
+
+void RangeAllocator::reset(uint32_t capacity)
+{
+    mFreeRanges.clear();
+    if (capacity) {
+        mFreeRanges[0] = capacity;
+    }
+    mCapacity = capacity;
+    mUsed = 0;
+}
+
+uint32_t RangeAllocator::allocate(uint32_t size)
+{
+    if (!size) {
+        return InvalidOffset;
+    }
+    for (auto it = mFreeRanges.begin(); it != mFreeRanges.end(); ++it) {
+        if (it->second < size) {
+            continue;
+        }
+        uint32_t offset = it->first;
+        uint32_t rest = it->second - size;
+        mFreeRanges.erase(it);
+        if (rest) {
+            mFreeRanges[offset + size] = rest;
+        }
+        mUsed += size;
+        return offset;
+    }
+    return InvalidOffset;
+}
+
+void RangeAllocator::free(uint32_t offset, uint32_t size)
+{
+    if (!size || offset == InvalidOffset) {
+        return;
+    }
+    assert(offset + size <= mCapacity && "Range is out of allocator!");
+
+    auto next = mFreeRanges.lower_bound(offset);
+    assert((next == mFreeRanges.end() || offset + size <= next->first) && "Range is already free!");
+
+    // merge with previous
+    if (next != mFreeRanges.begin()) {
+        auto prev = std::prev(next);
+        assert(prev->first + prev->second <= offset && "Range is already free!");
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            size += prev->second;
+            mFreeRanges.erase(prev);
+        }
+    }
+    // merge with next
+    if (next != mFreeRanges.end() && offset + size == next->first) {
+        size += next->second;
+        mFreeRanges.erase(next);
+    }
+    mFreeRanges[offset] = size;
+    mUsed -= std::min(mUsed, size);
+}
+
+uint32_t RangeAllocator::largestFreeRange() const
+{
+    uint32_t largest = 0;
+    for (const auto& range : mFreeRanges) {
+        largest = std::max(largest, range.second);
+    }
+    return largest;
+}
+
+//
+// GeometryArena
+//
+
+GeometryArena::GeometryArena(ResourceManager* resourceMgr, uint32_t vertexStride)
+    : mVertexStride(vertexStride)
+    , mResourceMgr(resourceMgr)
+{
+    assert(mResourceMgr && "Resource Manager should be valid!");
+    assert(mVertexStride && "Vertex stride can't be 0!");
+}
+
+GeometryArena::~GeometryArena()
+{
+    // buffers are released with ResourceManager
+    if (mVertices) {
+        mVertices->unmap();
+    }
+    if (mIndices) {
+        mIndices->unmap();
+    }
+}
+
+bool GeometryArena::create(uint32_t vertexCapacity, uint32_t indexCapacity)
+{
+    assert(!mVertices && "Arena is already created!");
+
+    mVertices = mResourceMgr->createBuffer();
+    mIndices = mResourceMgr->createBuffer();
+    if (!mVertices->createBuffer(nullptr, static_cast<size_t>(vertexCapacity) * mVertexStride, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)
+     || !mIndices->createBuffer(nullptr, static_cast<size_t>(indexCapacity) * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT)) {
+        qWarning("Can't create geometry arena buffers (vertex stride %d)", mVertexStride);
+        return false;
+    }
+    mVerticesMapped = static_cast<uint8_t*>(mVertices->map());
+    mIndicesMapped = static_cast<uint32_t*>(mIndices->map());
+    if (!mVerticesMapped || !mIndicesMapped) {
+        qWarning("Can't map geometry arena buffers (vertex stride %d)", mVertexStride);
+        return false;
+    }
+
+    mVertexRanges.reset(vertexCapacity);
+    mIndexRanges.reset(indexCapacity);
+    return true;
+}
+
+GeometryArena::Mesh GeometryArena::allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount)
+{
+    assert(vertices && indices && "Mesh data should be valid!");
+    Mesh mesh;
+    if (!mVerticesMapped || !mIndicesMapped) {
+        qWarning("Geometry arena is not created!");
+        return mesh;
+    }
+
+    uint32_t vertexOffset = mVertexRanges.allocate(vertexCount);
+    uint32_t firstIndex = mIndexRanges.allocate(indexCount);
+    if (vertexOffset == RangeAllocator::InvalidOffset || firstIndex == RangeAllocator::InvalidOffset) {
+        mVertexRanges.free(vertexOffset, vertexCount);
+        mIndexRanges.free(firstIndex, indexCount);
+        ++mFailedAllocations;
+        qWarning("Geometry arena (vertex stride %d) is full - can't place %d vertices and %d indices"
+                 , mVertexStride, vertexCount, indexCount);
+        return mesh;
+    }
+
+    memcpy(mVerticesMapped + static_cast<size_t>(vertexOffset) * mVertexStride, vertices, static_cast<size_t>(vertexCount) * mVertexStride);
+    memcpy(mIndicesMapped + firstIndex, indices, static_cast<size_t>(indexCount) * sizeof(uint32_t));
+
+    mesh.firstIndex = firstIndex;
+    mesh.vertexOffset = static_cast<int32_t>(vertexOffset);
+    mesh.indexCount = indexCount;
+    mesh.vertexCount = vertexCount;
+    ++mMeshes;
+    return mesh;
+}
+
+void GeometryArena::free(Mesh& mesh)
+{
+    if (!mesh.isValid()) {
+        return;
+    }
+    mVertexRanges.free(static_cast<uint32_t>(mesh.vertexOffset), mesh.vertexCount);
+    mIndexRanges.free(mesh.firstIndex, mesh.indexCount);
+    --mMeshes;
+    mesh = Mesh();
+}
+
+GeometryArena::Stats GeometryArena::stats() const
+{
+    Stats stats;
+    stats.meshes = mMeshes;
+    stats.verticesUsed = mVertexRanges.used();
+    stats.vertexCapacity = mVertexRanges.capacity();
+    stats.indicesUsed = mIndexRanges.used();
+    stats.indexCapacity = mIndexRanges.capacity();
+    stats.failedAllocations = mFailedAllocations;
+    return stats;
+}
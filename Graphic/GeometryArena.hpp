@@ -0,0 +1,126 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <map>
+
+class ResourceManager;
+class BufferDescr;
+
+///
+/// First fit allocator of ranges [offset, offset + size) in space of given capacity.
+/// Free ranges are kept sorted by offset and neighbours are merged on free.
+/// Knows nothing about memory - units are chosen by user (e.g. vertices, indices).
+///
+class RangeAllocator
+{
+public:
+    static const uint32_t InvalidOffset = ~0u;
+
+    explicit RangeAllocator(uint32_t capacity = 0);
+
+    void reset(uint32_t capacity); // all allocations are forgotten
+
+    uint32_t allocate(uint32_t size); // InvalidOffset if there is no free range big enough
+    void free(uint32_t offset, uint32_t size);
+
+    uint32_t capacity() const { return mCapacity; }
+    uint32_t used() const { return mUsed; }
+    uint32_t largestFreeRange() const;
+    uint32_t freeRangeCount() const { return static_cast<uint32_t>(mFreeRanges.size()); }
+
+protected:
+    std::map<uint32_t, uint32_t> mFreeRanges; // offset -> size
+    uint32_t mCapacity = 0;
+    uint32_t mUsed = 0;
+};
+
+///
+/// Shared vertex and index buffer for static geometry with the same vertex layout.
+/// Mesh is a range in both buffers, drawn with vkCmdDrawIndexed(indexCount, .., firstIndex, vertexOffset, ..),
+/// so all meshes of the arena are drawn with one vertex and index buffer bind (see GraphicObject::firstIndex).
+/// Indices are 32 bit and relative to mesh vertices. Buffers have fixed capacity, they are host visible and stay mapped.
+///
+class GeometryArena
+{
+public:
+    struct Mesh {
+        uint32_t firstIndex = 0;
+        int32_t  vertexOffset = 0;
+        uint32_t indexCount = 0;
+        uint32_t vertexCount = 0;
+
+        bool isValid() const { return indexCount != 0; }
+    };
+
+    struct Stats {
+        uint32_t meshes = 0;
+        uint32_t verticesUsed = 0;
+        uint32_t vertexCapacity = 0;
+        uint32_t indicesUsed = 0;
+        uint32_t indexCapacity = 0;
+        uint32_t failedAllocations = 0;
+    };
+
+    GeometryArena(ResourceManager* resourceMgr, uint32_t vertexStride);
+    ~GeometryArena();
+
+    bool create(uint32_t vertexCapacity, uint32_t indexCapacity);
+
+    ///
+    /// Copy mesh into arena. vertices - vertexCount * vertexStride bytes.
+    /// Returns invalid mesh if there is no space.
+    ///
+    Mesh allocate(const void* vertices, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount);
+
+    ///
+    /// Range becomes free for next allocations - GPU can't use the mesh anymore (e.g. it is called after device wait idle).
+    ///
+    void free(Mesh& mesh);
+
+    BufferDescr* vertexBuffer() const { return mVertices; }
+    BufferDescr* indexBuffer() const { return mIndices; }
+    VkIndexType indexType() const { return VK_INDEX_TYPE_UINT32; }
+    uint32_t vertexStride() const { return mVertexStride; }
+    Stats stats() const;
+
+    GeometryArena(const GeometryArena&) = delete;
+    GeometryArena& operator=(const GeometryArena&) = delete;
+
+protected:
+    BufferDescr* mVertices = nullptr; // owned by ResourceManager
+    BufferDescr* mIndices = nullptr;
+    uint8_t*  mVerticesMapped = nullptr;
+    uint32_t* mIndicesMapped = nullptr;
+    RangeAllocator mVertexRanges;
+    RangeAllocator mIndexRanges;
+    uint32_t mVertexStride;
+    uint32_t mMeshes = 0;
+    uint32_t mFailedAllocations = 0;
+
+    ResourceManager* mResourceMgr;
+};
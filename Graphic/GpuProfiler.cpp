@@ -0,0 +1,298 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "GpuProfiler.hpp"
+#include "CpuTrace.hpp"
+#include "DrawManager.hpp"
+#include "ResourceManager.hpp"
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+namespace {
+void copyName(char* dst, const char* src)
+{
+    size_t length = src ? std::min(strlen(src), GpuProfiler::MaxNameLength) : 0;
+    memcpy(dst, src, length);
+    dst[length] = '\0';
+}
+}
+
+GpuProfiler::GpuProfiler(ResourceManager* resourceMgr)
+    : mResourceMgr(resourceMgr)
+{
+    assert(mResourceMgr && "Resource Manager should be valid!");
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    release();
+}
+
+void GpuProfiler::release()
+{
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    for (FrameQueries& frame : mFrames) {
+        devFuncs->vkDestroyQueryPool(mResourceMgr->device(), frame.pool, nullptr);
+    }
+    mFrames.clear();
+    mCurrent = nullptr;
+    mOpenScopes.clear();
+}
+
+bool GpuProfiler::create(uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxScopesPerFrame)
+{
+    release();
+    assert(framesInFlight && maxScopesPerFrame);
+
+    //
+    // Timestamp support of the queue
+    //
+    const VulkanInstanceFunctions* vulkanFunc = &mResourceMgr->instanceFunctions();
+    VkPhysicalDeviceProperties props;
+    vulkanFunc->vkGetPhysicalDeviceProperties(mResourceMgr->physicalDevice(), &props);
+
+    uint32_t familyCount = 0;
+    vulkanFunc->vkGetPhysicalDeviceQueueFamilyProperties(mResourceMgr->physicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vulkanFunc->vkGetPhysicalDeviceQueueFamilyProperties(mResourceMgr->physicalDevice(), &familyCount, families.data());
+    uint32_t validBits = queueFamilyIndex < familyCount ? families[queueFamilyIndex].timestampValidBits : 0;
+    if (!validBits || props.limits.timestampPeriod <= 0.f) {
+        qInfo("GPU profiler not available - queue family %d does not support timestamps", queueFamilyIndex);
+        return false;
+    }
+    mTimestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    mTimestampPeriod = props.limits.timestampPeriod;
+
+    //
+    // Query pool per frame in flight - 2 timestamps per scope
+    //
+    mQueriesPerFrame = 2 * maxScopesPerFrame;
+    VkQueryPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    poolInfo.queryCount = mQueriesPerFrame;
+
+    mFrames.resize(framesInFlight);
+    for (FrameQueries& frame : mFrames) {
+        if (mResourceMgr->deviceFunctions()->vkCreateQueryPool(mResourceMgr->device(), &poolInfo, nullptr, &frame.pool) != VK_SUCCESS) {
+            qWarning("Can't create timestamp query pool");
+            release();
+            return false;
+        }
+        frame.scopes.reserve(maxScopesPerFrame);
+    }
+    mOpenScopes.reserve(maxScopesPerFrame);
+    mTimestamps.resize(mQueriesPerFrame);
+    initCalibration();
+    mLastFrame.nodes.reserve(maxScopesPerFrame);
+    qInfo("GPU profiler: %d frames, %d scopes per frame, timestamp period %.3f ns, valid bits %d, calibrated: %d"
+          , framesInFlight, maxScopesPerFrame, static_cast<double>(mTimestampPeriod), validBits, isCalibrated() ? 1 : 0);
+    return true;
+}
+
+void GpuProfiler::initCalibration()
+{
+    mGetCalibratedTimestamps = nullptr;
+    if (!mResourceMgr->isDeviceExtensionSupported(VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME)) {
+        return;
+    }
+    PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT getTimeDomains = reinterpret_cast<PFN_vkGetPhysicalDeviceCalibrateableTimeDomainsEXT>(
+                mResourceMgr->instanceProcAddr("vkGetPhysicalDeviceCalibrateableTimeDomainsEXT"));
+    PFN_vkGetCalibratedTimestampsEXT getCalibratedTimestamps = reinterpret_cast<PFN_vkGetCalibratedTimestampsEXT>(
+                mResourceMgr->deviceProcAddr("vkGetCalibratedTimestampsEXT"));
+    if (!getTimeDomains || !getCalibratedTimestamps) {
+        return; // device created without the extension
+    }
+
+    // CpuTrace uses steady clock - CLOCK_MONOTONIC
+    uint32_t domainCount = 0;
+    getTimeDomains(mResourceMgr->physicalDevice(), &domainCount, nullptr);
+    std::vector<VkTimeDomainEXT> domains(domainCount);
+    getTimeDomains(mResourceMgr->physicalDevice(), &domainCount, domains.data());
+    bool hasDevice = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_DEVICE_EXT) != domains.end();
+    bool hasMonotonic = std::find(domains.begin(), domains.end(), VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT) != domains.end();
+    if (hasDevice && hasMonotonic) {
+        mGetCalibratedTimestamps = getCalibratedTimestamps;
+    }
+}
+
+void GpuProfiler::beginFrame(VkCommandBuffer cmdBuf, uint32_t frameIdx)
+{
+    mCurrent = nullptr;
+    mOpenScopes.clear();
+    if (!mEnabled || mFrames.empty()) {
+        return;
+    }
+    assert(frameIdx < mFrames.size() && "Frame index out of frames in flight!");
+    FrameQueries& frame = mFrames[frameIdx];
+    if (frame.recorded) {
+        collect(frame);
+    }
+
+    mResourceMgr->deviceFunctions()->vkCmdResetQueryPool(cmdBuf, frame.pool, 0, mQueriesPerFrame);
+    frame.scopes.clear();
+    frame.queryCount = 0;
+    frame.droppedScopes = 0;
+    frame.frameNumber = ++mFrameCounter;
+    frame.recorded = true;
+    mCurrent = &frame;
+}
+
+uint32_t GpuProfiler::beginScope(VkCommandBuffer cmdBuf, const char* name)
+{
+    if (!mCurrent) {
+        return InvalidScope;
+    }
+    if (mCurrent->queryCount + 2 > mQueriesPerFrame) {
+        ++mCurrent->droppedScopes;
+        return InvalidScope;
+    }
+    PendingScope scope;
+    copyName(scope.name, name);
+    scope.parent = mOpenScopes.empty() ? InvalidScope : mOpenScopes.back();
+    scope.depth = static_cast<uint32_t>(mOpenScopes.size());
+    scope.beginQuery = mCurrent->queryCount++;
+    scope.endQuery = InvalidScope;
+    mCurrent->queryCount++; // reserved for end - pool is never overfilled by open scopes
+
+    mResourceMgr->deviceFunctions()->vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, mCurrent->pool, scope.beginQuery);
+
+    uint32_t scopeIdx = static_cast<uint32_t>(mCurrent->scopes.size());
+    mCurrent->scopes.push_back(scope);
+    mOpenScopes.push_back(scopeIdx);
+    return scopeIdx;
+}
+
+void GpuProfiler::endScope(VkCommandBuffer cmdBuf, uint32_t scope)
+{
+    if (!mCurrent || scope == InvalidScope) {
+        return;
+    }
+    assert(!mOpenScopes.empty() && mOpenScopes.back() == scope && "Scopes have to be closed in reverse order!");
+    mOpenScopes.pop_back();
+
+    PendingScope& pending = mCurrent->scopes[scope];
+    pending.endQuery = pending.beginQuery + 1;
+    mResourceMgr->deviceFunctions()->vkCmdWriteTimestamp(cmdBuf, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, mCurrent->pool, pending.endQuery);
+}
+
+void GpuProfiler::collect(FrameQueries& frame)
+{
+    frame.recorded = false;
+    if (!frame.queryCount) {
+        return;
+    }
+
+    // Frame slot is reused - its fence was waited, so results are available (no VK_QUERY_RESULT_WAIT_BIT)
+    VkResult result = mResourceMgr->deviceFunctions()->vkGetQueryPoolResults(mResourceMgr->device(), frame.pool, 0, frame.queryCount,
+                                                                            frame.queryCount * sizeof(uint64_t), mTimestamps.data(),
+                                                                            sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return; // VK_NOT_READY - keep previous result
+    }
+
+    const double msPerTick = static_cast<double>(mTimestampPeriod) / 1e6;
+    uint64_t first = mTimestamps[frame.scopes.front().beginQuery] & mTimestampMask;
+    uint64_t last = first;
+
+    mLastFrame.nodes.clear();
+    for (const PendingScope& scope : frame.scopes) {
+        Node node;
+        memcpy(node.name, scope.name, sizeof(node.name));
+        node.parent = scope.parent;
+        node.depth = scope.depth;
+        uint64_t begin = mTimestamps[scope.beginQuery] & mTimestampMask;
+        node.beginMs = static_cast<double>((begin - first) & mTimestampMask) * msPerTick;
+        node.durationMs = 0.0;
+        if (scope.endQuery != InvalidScope) {
+            uint64_t end = mTimestamps[scope.endQuery] & mTimestampMask;
+            node.durationMs = static_cast<double>((end - begin) & mTimestampMask) * msPerTick;
+            if (((end - first) & mTimestampMask) > ((last - first) & mTimestampMask)) {
+                last = end;
+            }
+        }
+        mLastFrame.nodes.push_back(node);
+    }
+    mLastFrame.frameNumber = frame.frameNumber;
+    mLastFrame.frameMs = static_cast<double>((last - first) & mTimestampMask) * msPerTick;
+    mLastFrame.droppedScopes = frame.droppedScopes;
+
+#ifdef GRAPHIC_TRACE
+    traceFrame(frame);
+#endif
+}
+
+void GpuProfiler::traceFrame(const FrameQueries& frame)
+{
+    if (!mGetCalibratedTimestamps || !CpuTrace::isEnabled()) {
+        return;
+    }
+    VkCalibratedTimestampInfoEXT infos[2] = {};
+    infos[0].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[0].timeDomain = VK_TIME_DOMAIN_DEVICE_EXT;
+    infos[1].sType = VK_STRUCTURE_TYPE_CALIBRATED_TIMESTAMP_INFO_EXT;
+    infos[1].timeDomain = VK_TIME_DOMAIN_CLOCK_MONOTONIC_EXT;
+    uint64_t now[2] = {};
+    uint64_t maxDeviation = 0;
+    if (mGetCalibratedTimestamps(mResourceMgr->device(), 2, infos, now, &maxDeviation) != VK_SUCCESS) {
+        return;
+    }
+
+    // GPU ticks are in the past of 'now' - walk back from the calibration point
+    const double nsPerTick = static_cast<double>(mTimestampPeriod);
+    uint64_t deviceNow = now[0] & mTimestampMask;
+    for (const PendingScope& scope : frame.scopes) {
+        if (scope.endQuery == InvalidScope) {
+            continue;
+        }
+        uint64_t begin = mTimestamps[scope.beginQuery] & mTimestampMask;
+        uint64_t end = mTimestamps[scope.endQuery] & mTimestampMask;
+        uint64_t beginNs = now[1] - static_cast<uint64_t>(static_cast<double>((deviceNow - begin) & mTimestampMask) * nsPerTick);
+        uint64_t endNs = now[1] - static_cast<uint64_t>(static_cast<double>((deviceNow - end) & mTimestampMask) * nsPerTick);
+        CpuTrace::recordGpu(scope.name, beginNs, endNs);
+    }
+}
+
+//
+// GpuScope
+//
+
+GpuScope::GpuScope(DrawManager* drawMgr, const char* name)
+{
+    if (drawMgr && drawMgr->gpuProfiler()) {
+        mProfiler = drawMgr->gpuProfiler();
+        mCmdBuf = drawMgr->getCmdBuffer();
+        mScope = mProfiler->beginScope(mCmdBuf, name);
+    }
+}
+
+GpuScope::~GpuScope()
+{
+    if (mProfiler) {
+        mProfiler->endScope(mCmdBuf, mScope);
+    }
+}
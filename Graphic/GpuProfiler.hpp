@@ -0,0 +1,153 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+class ResourceManager;
+class DrawManager;
+
+///
+/// GPU time of nested scopes measured with vkCmdWriteTimestamp.
+/// Every frame in flight has own query pool. Results of a frame are read when its slot is used again
+/// (beginFrame of the same frameIdx) - the frame is finished by then, so reading never waits for GPU.
+/// Scopes have to be recorded into one command buffer by one thread (secondary buffers of workers are not measured).
+/// Inside render pass timestamps of neighbouring draws overlap - per draw times are approximate.
+///
+class GpuProfiler
+{
+public:
+    static const uint32_t InvalidScope = ~0u;
+    static const size_t MaxNameLength = 47;
+
+    struct Node {
+        char     name[MaxNameLength + 1];
+        uint32_t parent;     // index in FrameResult::nodes, InvalidScope - top level scope
+        uint32_t depth;
+        double   beginMs;    // since first timestamp of the frame
+        double   durationMs;
+    };
+
+    struct FrameResult {
+        uint64_t frameNumber = 0;    // beginFrame counter of measured frame
+        double   frameMs = 0.0;      // from first to last timestamp
+        std::vector<Node> nodes;     // in order of beginScope - parent is always before its children
+        uint32_t droppedScopes = 0;  // query pool was full
+    };
+
+    GpuProfiler(ResourceManager* resourceMgr);
+    ~GpuProfiler();
+
+    ///
+    /// False if queue family of measured command buffers does not support timestamps.
+    ///
+    bool create(uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxScopesPerFrame = 256);
+    bool isCreated() const { return !mFrames.empty(); }
+
+    void setEnabled(bool enabled) { mEnabled = enabled; }
+    bool isEnabled() const { return mEnabled; }
+
+    ///
+    /// Collect results of the previous use of frameIdx and reset its queries.
+    /// Has to be recorded outside of render pass, before any scope of the frame.
+    ///
+    void beginFrame(VkCommandBuffer cmdBuf, uint32_t frameIdx);
+
+    uint32_t beginScope(VkCommandBuffer cmdBuf, const char* name); // name is copied, InvalidScope if not measured
+    void endScope(VkCommandBuffer cmdBuf, uint32_t scope);         // scopes are closed in reverse order
+
+    ///
+    /// The newest finished frame - framesInFlight frames behind recording.
+    ///
+    const FrameResult& lastFrame() const { return mLastFrame; }
+    float timestampPeriod() const { return mTimestampPeriod; } // ns per tick
+
+    ///
+    /// VK_EXT_calibrated_timestamps with CLOCK_MONOTONIC - with GRAPHIC_TRACE collected scopes are
+    /// also recorded into CpuTrace GPU track, on the same timeline as CPU events.
+    ///
+    bool isCalibrated() const { return mGetCalibratedTimestamps != nullptr; }
+
+    GpuProfiler(const GpuProfiler&) = delete;
+    GpuProfiler& operator=(const GpuProfiler&) = delete;
+
+protected:
+    struct PendingScope {
+        char     name[MaxNameLength + 1];
+        uint32_t parent;
+        uint32_t depth;
+        uint32_t beginQuery;
+        uint32_t endQuery; // InvalidScope - not closed
+    };
+
+    struct FrameQueries {
+        VkQueryPool pool = nullptr;
+        std::vector<PendingScope> scopes;
+        uint32_t queryCount = 0;
+        uint32_t droppedScopes = 0;
+        uint64_t frameNumber = 0;
+        bool     recorded = false;
+    };
+
+    void collect(FrameQueries& frame);
+    void traceFrame(const FrameQueries& frame); // scopes of collected frame into CpuTrace
+    void initCalibration();
+    void release();
+
+    std::vector<FrameQueries> mFrames;
+    FrameQueries* mCurrent = nullptr;
+    std::vector<uint32_t> mOpenScopes;
+    std::vector<uint64_t> mTimestamps; // readback scratch
+    FrameResult mLastFrame;
+    uint32_t mQueriesPerFrame = 0;
+    uint64_t mTimestampMask = 0;
+    float    mTimestampPeriod = 1.f;
+    uint64_t mFrameCounter = 0;
+    PFN_vkGetCalibratedTimestampsEXT mGetCalibratedTimestamps = nullptr;
+    bool     mEnabled = true;
+
+    ResourceManager* mResourceMgr;
+};
+
+///
+/// Scope measured from construction to destruction with profiler of drawMgr (no-op when it has none).
+///     { GpuScope scope(drawMgr, "Shadows"); ... }
+///
+class GpuScope
+{
+public:
+    GpuScope(DrawManager* drawMgr, const char* name);
+    ~GpuScope();
+
+    GpuScope(const GpuScope&) = delete;
+    GpuScope& operator=(const GpuScope&) = delete;
+
+private:
+    GpuProfiler*    mProfiler = nullptr;
+    VkCommandBuffer mCmdBuf = nullptr;
+    uint32_t        mScope = GpuProfiler::InvalidScope;
+};
@@ -24,9 +24,18 @@ SOFTWARE.
 
 #include "GraphicObject.hpp"
 #include "BufferDescr.hpp"
-#include <QVulkanDeviceFunctions>
+#include "FrameArena.hpp"
+#include "VulkanFunctions.hpp"
 
-void GraphicObject::connectResourceWithUniformSets(QVulkanDeviceFunctions &devFuncs, VkDevice device)
+VkDescriptorSet GraphicObject::descriptorSet(size_t descriptorSetIdx) const
+{
+    if (descriptorSets.empty()) {
+        return pipelineInfo->descriptorSetInfo[descriptorSetIdx].descriptor;
+    }
+    return descriptorSets[descriptorSetIdx];
+}
+
+void GraphicObject::connectResourceWithUniformSets(VulkanDeviceFunctions &devFuncs, VkDevice device, FrameArena* scratchArena)
 {
     //
     // Validation
@@ -48,6 +57,16 @@ void GraphicObject::connectResourceWithUniformSets(QVulkanDeviceFunctions &devFu
     size_t allBindings = 0;
     for (size_t descriptorSetIdx = 0; descriptorSetIdx < pipelineInfo->descriptorSetInfo.size(); ++descriptorSetIdx) {
         const PipelineManager::DescriptorSetInfo& dsi = pipelineInfo->descriptorSetInfo[descriptorSetIdx];
+        if (dsi.external) {
+            // e.g. bindless texture table - updated by its owner, object should not provide anything here
+            if (!uniformMapping[descriptorSetIdx].empty()) {
+                qWarning("Inconsistent data. Descriptor = %d is external but object provides %d bindings"
+                         , static_cast<uint32_t>(descriptorSetIdx)
+                         , static_cast<uint32_t>(uniformMapping[descriptorSetIdx].size()));
+                return;
+            }
+            continue;
+        }
         size_t shaderBindings = dsi.bindingInfo.size();
         size_t objectBindings = uniformMapping[descriptorSetIdx].size();
 
@@ -72,6 +91,16 @@ void GraphicObject::connectResourceWithUniformSets(QVulkanDeviceFunctions &devFu
                              , static_cast<uint32_t>(dsi.bindingInfo[bindingIdx].byteSize));
                 }
             }
+            else if (dsi.bindingInfo[bindingIdx].vdslbInfo.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
+                const VkDescriptorBufferInfo* dbi = reinterpret_cast<const VkDescriptorBufferInfo*>(uniformMapping[descriptorSetIdx][bindingIdx].data());
+                if (dbi->range != VK_WHOLE_SIZE && dbi->range < dsi.bindingInfo[bindingIdx].byteSize) { // shader size is minimal - runtime arrays are not counted
+                    qWarning("Inconsistent data. Descriptor = %d binding = %d objectDataSize = %d, shaderMinDataSize = %d"
+                             , static_cast<uint32_t>(descriptorSetIdx)
+                             , static_cast<uint32_t>(bindingIdx)
+                             , static_cast<uint32_t>(dbi->range)
+                             , static_cast<uint32_t>(dsi.bindingInfo[bindingIdx].byteSize));
+                }
+            }
             else if (dsi.bindingInfo[bindingIdx].vdslbInfo.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
                 //const VkDescriptorImageInfo* dii = reinterpret_cast<const VkDescriptorImageInfo*>(uniformMapping[descriptorSetIdx][bindingIdx].data());
             }
@@ -81,14 +110,17 @@ void GraphicObject::connectResourceWithUniformSets(QVulkanDeviceFunctions &devFu
     //
     // Make connection between Buffor and DescriptorSet
     //
-    std::vector<VkWriteDescriptorSet> uniformsWrite(allBindings);
+    FrameVector<VkWriteDescriptorSet> uniformsWrite = makeFrameVector<VkWriteDescriptorSet>(scratchArena, allBindings, VkWriteDescriptorSet());
     VkWriteDescriptorSet* writeDs = uniformsWrite.data();
     for (size_t descriptorSetIdx = 0; descriptorSetIdx < pipelineInfo->descriptorSetInfo.size(); ++descriptorSetIdx) {
         const PipelineManager::DescriptorSetInfo& dsi = pipelineInfo->descriptorSetInfo[descriptorSetIdx];
+        if (dsi.external) {
+            continue;
+        }
         for (size_t bindingIdx = 0; bindingIdx < dsi.bindingInfo.size(); ++bindingIdx) {
             writeDs->sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
             writeDs->pNext = nullptr;
-            writeDs->dstSet = dsi.descriptor;
+            writeDs->dstSet = descriptorSet(descriptorSetIdx);
             writeDs->dstBinding = dsi.bindingInfo[bindingIdx].vdslbInfo.binding;
             writeDs->dstArrayElement = 0; // is the starting element in that array. If the descriptor binding identified by ... then dstArrayElement specifies the starting byte ...
             writeDs->descriptorType = dsi.bindingInfo[bindingIdx].vdslbInfo.descriptorType;
@@ -103,7 +135,8 @@ void GraphicObject::connectResourceWithUniformSets(QVulkanDeviceFunctions &devFu
                 writeDs->pImageInfo = dii;
             }
             writeDs->pBufferInfo = nullptr;
-            if (dsi.bindingInfo[bindingIdx].vdslbInfo.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER) {
+            if (dsi.bindingInfo[bindingIdx].vdslbInfo.descriptorType == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER
+             || dsi.bindingInfo[bindingIdx].vdslbInfo.descriptorType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
                 const VkDescriptorBufferInfo* dbi = reinterpret_cast<const VkDescriptorBufferInfo*>(uniformMapping[descriptorSetIdx][bindingIdx].data());
                 writeDs->pBufferInfo = dbi;
             }
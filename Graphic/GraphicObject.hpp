@@ -32,25 +32,34 @@ SOFTWARE.
 #include "Texture.hpp"
 
 class BufferDescr;
-class QVulkanDeviceFunctions;
+class FrameArena;
+struct VulkanDeviceFunctions;
 
 struct GraphicObject
 {
     std::vector<BufferDescr*> vertices; // vector index is binding of vertex attribute ( vertices[binding] )
 
-    BufferDescr* indices;
-    VkIndexType  indexType;
-    uint32_t     indicesCount;
+    BufferDescr* indices = nullptr;
+    VkIndexType  indexType = VK_INDEX_TYPE_UINT16;
+    uint32_t     indicesCount = 0;
+    uint32_t     firstIndex = 0;   // mesh range in shared buffers (see GeometryArena), 0 - object owns whole buffers
+    int32_t      vertexOffset = 0;
 
-    BufferDescr* uniforms;
+    BufferDescr* uniforms = nullptr;
     std::vector<std::vector<QVariant>> uniformMapping; // key1 - descr set id, key2 - binding  ( uniformMapping[descrSet][binding] = VkDescriptorBufferInfo|VkDescriptorImageInfo)
 
     std::vector<Texture> textures;
 
-    const PipelineManager::PipelineInfo* pipelineInfo;
+    const PipelineManager::PipelineInfo* pipelineInfo = nullptr;
+    std::vector<VkDescriptorSet> descriptorSets; // own sets from PipelineManager::allocateDescriptorSets, empty - sets of pipelineInfo are used
+    std::vector<uint8_t> pushConstants;          // data for pipelineInfo->pushConstantRanges[0], empty - nothing to push
 
     glm::mat4x4    modelMtx;
 
-    void connectResourceWithUniformSets(QVulkanDeviceFunctions &devFuncs, VkDevice device);
+    VkDescriptorSet descriptorSet(size_t descriptorSetIdx) const;
+    ///
+    /// scratchArena - temporary write structures are taken from arena (e.g. DrawManager::frameArena) instead of heap
+    ///
+    void connectResourceWithUniformSets(VulkanDeviceFunctions &devFuncs, VkDevice device, FrameArena* scratchArena = nullptr);
 };
 
@@ -0,0 +1,592 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "HeadlessContext.hpp"
+#include <QtGlobal>
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+HeadlessContext::HeadlessContext()
+{
+    memset(&mPhysicalDeviceProps, 0, sizeof(mPhysicalDeviceProps));
+}
+
+HeadlessContext::~HeadlessContext()
+{
+    release();
+}
+
+bool HeadlessContext::create(const Settings& settings)
+{
+    release();
+    assert(settings.width && settings.height && settings.framesInFlight && "Frame size and frames in flight should be valid!");
+    mWidth = settings.width;
+    mHeight = settings.height;
+
+    if (!createInstance(settings)
+     || !choosePhysicalDevice(settings)
+     || !createDevice(settings)
+     || !createTargets()
+     || !createRenderPass()
+     || !createFrames(settings.framesInFlight)) {
+        release();
+        return false;
+    }
+    qInfo("Headless context: %s, %dx%d, frames in flight: %d"
+          , mPhysicalDeviceProps.deviceName, mWidth, mHeight, settings.framesInFlight);
+    return true;
+}
+
+void HeadlessContext::release()
+{
+    if (mDevice) {
+        mDeviceFuncs.vkDeviceWaitIdle(mDevice);
+        for (Frame& frame : mFrames) {
+            mDeviceFuncs.vkDestroyFence(mDevice, frame.fence, nullptr);
+        }
+        mDeviceFuncs.vkDestroyCommandPool(mDevice, mCmdPool, nullptr); // frees command buffers
+        mDeviceFuncs.vkDestroyFramebuffer(mDevice, mFramebuffer, nullptr);
+        mDeviceFuncs.vkDestroyRenderPass(mDevice, mRenderPass, nullptr);
+        releaseTarget(mColor);
+        releaseTarget(mDepth);
+        mDeviceFuncs.vkDestroyDevice(mDevice, nullptr);
+    }
+    if (mInstance && mInstanceFuncs.vkDestroyInstance) {
+        mInstanceFuncs.vkDestroyInstance(mInstance, nullptr);
+    }
+    mFrames.clear();
+    mCurrentFrame = 0;
+    mCmdPool = nullptr;
+    mFramebuffer = nullptr;
+    mRenderPass = nullptr;
+    mQueue = nullptr;
+    mDevice = nullptr;
+    mPhysicalDevice = nullptr;
+    mInstance = nullptr;
+    mEnabledDeviceExtensions.clear();
+    mDescriptorIndexingEnabled = false;
+    mInstanceFuncs = VulkanInstanceFunctions();
+    mDeviceFuncs = VulkanDeviceFunctions();
+}
+
+//
+// Instance and device
+//
+
+bool HeadlessContext::createInstance(const Settings& settings)
+{
+    // Loader exported entry point - the only one which is linked directly
+    PFN_vkGetInstanceProcAddr getInstanceProcAddr = settings.getInstanceProcAddr ? settings.getInstanceProcAddr : ::vkGetInstanceProcAddr;
+    PFN_vkCreateInstance createInstance = reinterpret_cast<PFN_vkCreateInstance>(getInstanceProcAddr(nullptr, "vkCreateInstance"));
+    PFN_vkEnumerateInstanceExtensionProperties enumerateExtensions = reinterpret_cast<PFN_vkEnumerateInstanceExtensionProperties>(getInstanceProcAddr(nullptr, "vkEnumerateInstanceExtensionProperties"));
+    PFN_vkEnumerateInstanceLayerProperties enumerateLayers = reinterpret_cast<PFN_vkEnumerateInstanceLayerProperties>(getInstanceProcAddr(nullptr, "vkEnumerateInstanceLayerProperties"));
+    if (!createInstance || !enumerateExtensions || !enumerateLayers) {
+        qWarning("Vulkan loader is not available");
+        return false;
+    }
+
+    // Features2 queries (bindless textures, calibrated timestamps) on Vulkan 1.0 instance
+    std::vector<const char*> extensions;
+    uint32_t extCount = 0;
+    enumerateExtensions(nullptr, &extCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extCount);
+    enumerateExtensions(nullptr, &extCount, availableExtensions.data());
+    for (const VkExtensionProperties& ext : availableExtensions) {
+        if (strcmp(ext.extensionName, VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME) == 0) {
+            extensions.push_back(VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+        }
+    }
+
+    std::vector<const char*> layers;
+    if (settings.enableValidation) {
+        const char* validationLayer = "VK_LAYER_KHRONOS_validation";
+        uint32_t layerCount = 0;
+        enumerateLayers(&layerCount, nullptr);
+        std::vector<VkLayerProperties> availableLayers(layerCount);
+        enumerateLayers(&layerCount, availableLayers.data());
+        bool found = std::any_of(availableLayers.begin(), availableLayers.end(),
+                                 [validationLayer](const VkLayerProperties& layer) { return strcmp(layer.layerName, validationLayer) == 0; });
+        if (found) {
+            layers.push_back(validationLayer);
+        }
+        else {
+            qWarning("Validation layer %s is not available", validationLayer);
+        }
+    }
+
+    VkApplicationInfo appInfo = {};
+    appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    appInfo.pApplicationName = "3DModelScaner headless";
+    appInfo.apiVersion = VK_API_VERSION_1_0;
+
+    VkInstanceCreateInfo instanceInfo = {};
+    instanceInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    instanceInfo.pApplicationInfo = &appInfo;
+    instanceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    instanceInfo.ppEnabledExtensionNames = extensions.data();
+    instanceInfo.enabledLayerCount = static_cast<uint32_t>(layers.size());
+    instanceInfo.ppEnabledLayerNames = layers.data();
+
+    VkResult result = createInstance(&instanceInfo, nullptr, &mInstance);
+    if (result != VK_SUCCESS) {
+        qWarning("Can't create Vulkan instance: %d", result);
+        mInstance = nullptr;
+        return false;
+    }
+    return mInstanceFuncs.load(getInstanceProcAddr, mInstance);
+}
+
+bool HeadlessContext::choosePhysicalDevice(const Settings& settings)
+{
+    uint32_t deviceCount = 0;
+    mInstanceFuncs.vkEnumeratePhysicalDevices(mInstance, &deviceCount, nullptr);
+    std::vector<VkPhysicalDevice> devices(deviceCount);
+    mInstanceFuncs.vkEnumeratePhysicalDevices(mInstance, &deviceCount, devices.data());
+    if (devices.empty()) {
+        qWarning("No Vulkan physical device");
+        return false;
+    }
+
+    // Lower is better
+    auto typeRank = [&settings](VkPhysicalDeviceType type) {
+        if (settings.preferSoftwareDevice) {
+            return type == VK_PHYSICAL_DEVICE_TYPE_CPU ? 0 : 1;
+        }
+        switch (type) {
+        case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   return 0;
+        case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 1;
+        case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    return 2;
+        case VK_PHYSICAL_DEVICE_TYPE_CPU:            return 3;
+        default:                                     return 4;
+        }
+    };
+
+    int bestRank = 1 << 30;
+    for (uint32_t i = 0; i < deviceCount; ++i) {
+        VkPhysicalDeviceProperties props;
+        mInstanceFuncs.vkGetPhysicalDeviceProperties(devices[i], &props);
+
+        uint32_t familyCount = 0;
+        mInstanceFuncs.vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &familyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> families(familyCount);
+        mInstanceFuncs.vkGetPhysicalDeviceQueueFamilyProperties(devices[i], &familyCount, families.data());
+        const VkQueueFlags requiredFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT; // compute - GPU culling on the same queue
+        uint32_t familyIdx = 0;
+        while (familyIdx < familyCount && (families[familyIdx].queueFlags & requiredFlags) != requiredFlags) {
+            ++familyIdx;
+        }
+        if (familyIdx == familyCount) {
+            continue;
+        }
+
+        int rank = typeRank(props.deviceType);
+        if (settings.physicalDeviceIndex >= 0) {
+            rank = static_cast<uint32_t>(settings.physicalDeviceIndex) == i ? 0 : 1 << 29;
+        }
+        if (rank < bestRank) {
+            bestRank = rank;
+            mPhysicalDevice = devices[i];
+            mPhysicalDeviceProps = props;
+            mQueueFamilyIndex = familyIdx;
+        }
+    }
+
+    if (!mPhysicalDevice) {
+        qWarning("No Vulkan physical device with graphics queue");
+        return false;
+    }
+    if (settings.physicalDeviceIndex >= 0 && bestRank != 0) {
+        qWarning("Physical device %d is not available, using %s", settings.physicalDeviceIndex, mPhysicalDeviceProps.deviceName);
+    }
+    return true;
+}
+
+bool HeadlessContext::createDevice(const Settings& settings)
+{
+    uint32_t extCount = 0;
+    mInstanceFuncs.vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &extCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extCount);
+    mInstanceFuncs.vkEnumerateDeviceExtensionProperties(mPhysicalDevice, nullptr, &extCount, availableExtensions.data());
+
+    std::vector<const char*> requestedExtensions = settings.deviceExtensions;
+    if (settings.enableDescriptorIndexing) {
+        requestedExtensions.push_back(VK_KHR_MAINTENANCE3_EXTENSION_NAME); // required by descriptor indexing
+        requestedExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+    }
+
+    std::vector<const char*> extensions;
+    for (const char* requested : requestedExtensions) {
+        bool duplicate = std::any_of(extensions.begin(), extensions.end(),
+                                     [requested](const char* ext) { return strcmp(ext, requested) == 0; });
+        bool supported = std::any_of(availableExtensions.begin(), availableExtensions.end(),
+                                     [requested](const VkExtensionProperties& ext) { return strcmp(ext.extensionName, requested) == 0; });
+        if (supported && !duplicate) {
+            extensions.push_back(requested);
+            mEnabledDeviceExtensions.push_back(requested);
+        }
+    }
+
+    // All supported features as QVulkanWindow does, except robust buffer access which only costs
+    VkPhysicalDeviceFeatures features;
+    mInstanceFuncs.vkGetPhysicalDeviceFeatures(mPhysicalDevice, &features);
+    features.robustBufferAccess = VK_FALSE;
+
+    // Descriptor indexing features are not part of VkPhysicalDeviceFeatures - chained to device create info
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    if (settings.enableDescriptorIndexing) {
+        if (isDeviceExtensionEnabled(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)
+         && isDeviceExtensionEnabled(VK_KHR_MAINTENANCE3_EXTENSION_NAME)) {
+            mDescriptorIndexingEnabled = queryDescriptorIndexingFeatures(indexingFeatures);
+        }
+        if (!mDescriptorIndexingEnabled) {
+            qInfo("Descriptor indexing is not supported by %s", mPhysicalDeviceProps.deviceName);
+        }
+    }
+
+    const float priority = 1.f;
+    VkDeviceQueueCreateInfo queueInfo = {};
+    queueInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueInfo.queueFamilyIndex = mQueueFamilyIndex;
+    queueInfo.queueCount = 1;
+    queueInfo.pQueuePriorities = &priority;
+
+    VkDeviceCreateInfo deviceInfo = {};
+    deviceInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    deviceInfo.pNext = mDescriptorIndexingEnabled ? &indexingFeatures : nullptr;
+    deviceInfo.queueCreateInfoCount = 1;
+    deviceInfo.pQueueCreateInfos = &queueInfo;
+    deviceInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    deviceInfo.ppEnabledExtensionNames = extensions.data();
+    deviceInfo.pEnabledFeatures = &features;
+
+    VkResult result = mInstanceFuncs.vkCreateDevice(mPhysicalDevice, &deviceInfo, nullptr, &mDevice);
+    if (result != VK_SUCCESS) {
+        qWarning("Can't create Vulkan device: %d", result);
+        mDevice = nullptr;
+        return false;
+    }
+    if (!mDeviceFuncs.load(mInstanceFuncs, mDevice)) {
+        if (mDeviceFuncs.vkDestroyDevice) {
+            mDeviceFuncs.vkDestroyDevice(mDevice, nullptr);
+        }
+        mDevice = nullptr;
+        return false;
+    }
+    mDeviceFuncs.vkGetDeviceQueue(mDevice, mQueueFamilyIndex, 0, &mQueue);
+    return true;
+}
+
+///
+/// All supported descriptor indexing features are enabled (as all VkPhysicalDeviceFeatures are).
+/// Returns false if features can't be queried or ones used by BindlessTextureTable are missing.
+///
+bool HeadlessContext::queryDescriptorIndexingFeatures(VkPhysicalDeviceDescriptorIndexingFeaturesEXT& indexingFeatures) const
+{
+    // Vulkan 1.1 or VK_KHR_get_physical_device_properties2 (enabled with instance if available)
+    PFN_vkGetPhysicalDeviceFeatures2 getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(mInstanceFuncs.procAddr("vkGetPhysicalDeviceFeatures2"));
+    if (!getFeatures2) {
+        getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(mInstanceFuncs.procAddr("vkGetPhysicalDeviceFeatures2KHR"));
+    }
+    if (!getFeatures2) {
+        return false;
+    }
+
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &indexingFeatures;
+    getFeatures2(mPhysicalDevice, &features);
+    indexingFeatures.pNext = nullptr;
+
+    return indexingFeatures.runtimeDescriptorArray
+        && indexingFeatures.descriptorBindingPartiallyBound
+        && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+        && indexingFeatures.descriptorBindingUpdateUnusedWhilePending;
+}
+
+bool HeadlessContext::isDeviceExtensionEnabled(const char* extensionName) const
+{
+    return std::find(mEnabledDeviceExtensions.begin(), mEnabledDeviceExtensions.end(), extensionName) != mEnabledDeviceExtensions.end();
+}
+
+//
+// Offscreen targets
+//
+
+bool HeadlessContext::createTargets()
+{
+    const VkFormat depthCandidates[] = { VK_FORMAT_D24_UNORM_S8_UINT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D32_SFLOAT, VK_FORMAT_D16_UNORM };
+    for (VkFormat format : depthCandidates) {
+        VkFormatProperties formatProps;
+        mInstanceFuncs.vkGetPhysicalDeviceFormatProperties(mPhysicalDevice, format, &formatProps);
+        if (formatProps.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT) {
+            mDepthFormat = format;
+            break;
+        }
+    }
+    if (mDepthFormat == VK_FORMAT_UNDEFINED) {
+        qWarning("No supported depth format");
+        return false;
+    }
+
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    if (mDepthFormat == VK_FORMAT_D24_UNORM_S8_UINT || mDepthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT) {
+        depthAspect |= VK_IMAGE_ASPECT_STENCIL_BIT;
+    }
+    return createTarget(mColorFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_ASPECT_COLOR_BIT, mColor)
+        && createTarget(mDepthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthAspect, mDepth);
+}
+
+bool HeadlessContext::createTarget(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, Target& target)
+{
+    VkImageCreateInfo imageInfo = {};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { mWidth, mHeight, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    if (mDeviceFuncs.vkCreateImage(mDevice, &imageInfo, nullptr, &target.image) != VK_SUCCESS) {
+        qWarning("Can't create offscreen image");
+        return false;
+    }
+
+    VkMemoryRequirements memReqs;
+    mDeviceFuncs.vkGetImageMemoryRequirements(mDevice, target.image, &memReqs);
+    VkPhysicalDeviceMemoryProperties memProps;
+    mInstanceFuncs.vkGetPhysicalDeviceMemoryProperties(mPhysicalDevice, &memProps);
+    uint32_t memoryType = ~0u;
+    for (uint32_t i = 0; i < memProps.memoryTypeCount && memoryType == ~0u; ++i) {
+        if ((memReqs.memoryTypeBits & (1u << i))
+         && (memProps.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT)) {
+            memoryType = i;
+        }
+    }
+    if (memoryType == ~0u) {
+        qWarning("No device local memory for offscreen image");
+        return false;
+    }
+
+    VkMemoryAllocateInfo allocInfo = {};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memReqs.size;
+    allocInfo.memoryTypeIndex = memoryType;
+    if (mDeviceFuncs.vkAllocateMemory(mDevice, &allocInfo, nullptr, &target.memory) != VK_SUCCESS
+     || mDeviceFuncs.vkBindImageMemory(mDevice, target.image, target.memory, 0) != VK_SUCCESS) {
+        qWarning("Can't allocate memory of offscreen image");
+        return false;
+    }
+
+    VkImageViewCreateInfo viewInfo = {};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = target.image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = { aspect, 0, 1, 0, 1 };
+    if (mDeviceFuncs.vkCreateImageView(mDevice, &viewInfo, nullptr, &target.view) != VK_SUCCESS) {
+        qWarning("Can't create offscreen image view");
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::releaseTarget(Target& target)
+{
+    mDeviceFuncs.vkDestroyImageView(mDevice, target.view, nullptr);
+    mDeviceFuncs.vkDestroyImage(mDevice, target.image, nullptr);
+    mDeviceFuncs.vkFreeMemory(mDevice, target.memory, nullptr);
+    target = Target();
+}
+
+bool HeadlessContext::createRenderPass()
+{
+    VkAttachmentDescription attachments[2] = {};
+    attachments[0].format = mColorFormat;
+    attachments[0].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[0].storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    attachments[0].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[0].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[0].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[0].finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    attachments[1].format = mDepthFormat;
+    attachments[1].samples = VK_SAMPLE_COUNT_1_BIT;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    attachments[1].storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    attachments[1].stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    attachments[1].initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    attachments[1].finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference colorRef = { 0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL };
+    VkAttachmentReference depthRef = { 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = 1;
+    subpass.pColorAttachments = &colorRef;
+    subpass.pDepthStencilAttachment = &depthRef;
+
+    // Frames in flight render into the same targets - writes of previous frame have to finish first
+    VkSubpassDependency dependency = {};
+    dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+    dependency.dstSubpass = 0;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 2;
+    renderPassInfo.pAttachments = attachments;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    renderPassInfo.dependencyCount = 1;
+    renderPassInfo.pDependencies = &dependency;
+    if (mDeviceFuncs.vkCreateRenderPass(mDevice, &renderPassInfo, nullptr, &mRenderPass) != VK_SUCCESS) {
+        qWarning("Can't create offscreen render pass");
+        mRenderPass = nullptr;
+        return false;
+    }
+
+    VkImageView views[2] = { mColor.view, mDepth.view };
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = mRenderPass;
+    framebufferInfo.attachmentCount = 2;
+    framebufferInfo.pAttachments = views;
+    framebufferInfo.width = mWidth;
+    framebufferInfo.height = mHeight;
+    framebufferInfo.layers = 1;
+    if (mDeviceFuncs.vkCreateFramebuffer(mDevice, &framebufferInfo, nullptr, &mFramebuffer) != VK_SUCCESS) {
+        qWarning("Can't create offscreen framebuffer");
+        mFramebuffer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+QSize HeadlessContext::frameSize() const
+{
+    return QSize(static_cast<int>(mWidth), static_cast<int>(mHeight));
+}
+
+//
+// Frames
+//
+
+bool HeadlessContext::createFrames(uint32_t framesInFlight)
+{
+    VkCommandPoolCreateInfo poolInfo = {};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = mQueueFamilyIndex;
+    if (mDeviceFuncs.vkCreateCommandPool(mDevice, &poolInfo, nullptr, &mCmdPool) != VK_SUCCESS) {
+        qWarning("Can't create command pool");
+        mCmdPool = nullptr;
+        return false;
+    }
+
+    mFrames.resize(framesInFlight);
+    for (Frame& frame : mFrames) {
+        VkCommandBufferAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = mCmdPool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkFenceCreateInfo fenceInfo = {};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // first wait returns immediately
+
+        if (mDeviceFuncs.vkAllocateCommandBuffers(mDevice, &allocInfo, &frame.cmdBuf) != VK_SUCCESS
+         || mDeviceFuncs.vkCreateFence(mDevice, &fenceInfo, nullptr, &frame.fence) != VK_SUCCESS) {
+            qWarning("Can't create frame command buffer/fence");
+            return false;
+        }
+    }
+    mCurrentFrame = 0;
+    return true;
+}
+
+VkCommandBuffer HeadlessContext::beginFrame()
+{
+    assert(!mFrames.empty() && "Context should be created!");
+    Frame& frame = mFrames[mCurrentFrame];
+    if (mDeviceFuncs.vkWaitForFences(mDevice, 1, &frame.fence, VK_TRUE, UINT64_MAX) != VK_SUCCESS) {
+        qWarning("Wait for frame fence failed");
+        return nullptr;
+    }
+    mDeviceFuncs.vkResetFences(mDevice, 1, &frame.fence);
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (mDeviceFuncs.vkBeginCommandBuffer(frame.cmdBuf, &beginInfo) != VK_SUCCESS) {
+        qWarning("Can't begin frame command buffer");
+        return nullptr;
+    }
+    return frame.cmdBuf;
+}
+
+bool HeadlessContext::endFrame()
+{
+    Frame& frame = mFrames[mCurrentFrame];
+    mCurrentFrame = (mCurrentFrame + 1) % static_cast<uint32_t>(mFrames.size());
+    if (mDeviceFuncs.vkEndCommandBuffer(frame.cmdBuf) != VK_SUCCESS) {
+        qWarning("Can't end frame command buffer");
+        return false;
+    }
+
+    VkSubmitInfo submitInfo = {};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &frame.cmdBuf;
+    VkResult result = mDeviceFuncs.vkQueueSubmit(mQueue, 1, &submitInfo, frame.fence);
+    if (result != VK_SUCCESS) {
+        qWarning("Frame submit failed: %d", result);
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::waitIdle()
+{
+    if (mDevice) {
+        mDeviceFuncs.vkDeviceWaitIdle(mDevice);
+    }
+}
+
+VkCommandBuffer HeadlessContext::currentCommandBuffer() const
+{
+    return mFrames.empty() ? nullptr : mFrames[mCurrentFrame].cmdBuf;
+}
@@ -0,0 +1,141 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+#include <QSize>
+#include "VulkanFunctions.hpp"
+
+///
+/// Vulkan context without window and swapchain - own instance, device, offscreen colour/depth targets
+/// and default render pass. Renders frames the same way as QVulkanWindow does (frames in flight,
+/// command buffer per frame), so renderables can be used without Qt window e.g. in benchmarks
+/// on a software driver (lavapipe).
+///
+class HeadlessContext
+{
+public:
+    struct Settings {
+        uint32_t width = 1280;
+        uint32_t height = 720;
+        uint32_t framesInFlight = 2;
+        bool preferSoftwareDevice = false;  // VK_PHYSICAL_DEVICE_TYPE_CPU e.g. lavapipe, SwiftShader
+        int32_t physicalDeviceIndex = -1;   // -1 - choose by type
+        bool enableValidation = false;      // VK_LAYER_KHRONOS_validation if available
+        std::vector<const char*> deviceExtensions; // optional - unsupported are ignored (as in QVulkanWindow)
+        bool enableDescriptorIndexing = false; // VK_EXT_descriptor_indexing with its features (bindless textures) if supported
+        PFN_vkGetInstanceProcAddr getInstanceProcAddr = nullptr; // entry of other implementation e.g. NullDriver; nullptr - Vulkan loader
+    };
+
+    HeadlessContext();
+    ~HeadlessContext();
+
+    bool create(const Settings& settings);
+    void release();
+
+    ///
+    /// Wait until command buffer of next frame in flight is free and begin it.
+    /// Returns nullptr on error.
+    ///
+    VkCommandBuffer beginFrame();
+    bool endFrame(); // end command buffer and submit it to the graphics queue
+    void waitIdle();
+
+    const VulkanInstanceFunctions& instanceFunctions() const { return mInstanceFuncs; }
+    VulkanDeviceFunctions* deviceFunctions() { return &mDeviceFuncs; }
+    VkInstance instance() const { return mInstance; }
+    VkPhysicalDevice physicalDevice() const { return mPhysicalDevice; }
+    const VkPhysicalDeviceProperties& physicalDeviceProperties() const { return mPhysicalDeviceProps; }
+    VkDevice device() const { return mDevice; }
+    uint32_t graphicsQueueFamilyIndex() const { return mQueueFamilyIndex; }
+    VkQueue graphicsQueue() const { return mQueue; }
+    bool isDeviceExtensionEnabled(const char* extensionName) const;
+    bool isDescriptorIndexingEnabled() const { return mDescriptorIndexingEnabled; } // features required by BindlessTextureTable
+
+    ///
+    /// Colour and depth attachments cleared at load, 1 sample. Colour stays in TRANSFER_SRC layout after pass.
+    ///
+    VkRenderPass defaultRenderPass() const { return mRenderPass; }
+    VkFramebuffer framebuffer() const { return mFramebuffer; }
+    VkFormat colorFormat() const { return mColorFormat; }
+    VkFormat depthFormat() const { return mDepthFormat; }
+    QSize frameSize() const;
+
+    uint32_t framesInFlight() const { return static_cast<uint32_t>(mFrames.size()); }
+    uint32_t currentFrame() const { return mCurrentFrame; }
+    VkCommandBuffer currentCommandBuffer() const;
+
+    HeadlessContext(const HeadlessContext&) = delete;
+    HeadlessContext& operator=(const HeadlessContext&) = delete;
+
+protected:
+    struct Target {
+        VkImage image = nullptr;
+        VkDeviceMemory memory = nullptr;
+        VkImageView view = nullptr;
+    };
+
+    struct Frame {
+        VkCommandBuffer cmdBuf = nullptr;
+        VkFence fence = nullptr;
+    };
+
+    bool createInstance(const Settings& settings);
+    bool choosePhysicalDevice(const Settings& settings);
+    bool createDevice(const Settings& settings);
+    bool queryDescriptorIndexingFeatures(VkPhysicalDeviceDescriptorIndexingFeaturesEXT& indexingFeatures) const;
+    bool createTargets();
+    bool createTarget(VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, Target& target);
+    bool createRenderPass();
+    bool createFrames(uint32_t framesInFlight);
+    void releaseTarget(Target& target);
+
+    VulkanInstanceFunctions mInstanceFuncs;
+    VulkanDeviceFunctions mDeviceFuncs;
+
+    VkInstance mInstance = nullptr;
+    VkPhysicalDevice mPhysicalDevice = nullptr;
+    VkPhysicalDeviceProperties mPhysicalDeviceProps;
+    VkDevice mDevice = nullptr;
+    uint32_t mQueueFamilyIndex = ~0u;
+    VkQueue mQueue = nullptr;
+    std::vector<std::string> mEnabledDeviceExtensions;
+    bool mDescriptorIndexingEnabled = false;
+
+    uint32_t mWidth = 0;
+    uint32_t mHeight = 0;
+    VkFormat mColorFormat = VK_FORMAT_R8G8B8A8_UNORM;
+    VkFormat mDepthFormat = VK_FORMAT_UNDEFINED;
+    Target mColor;
+    Target mDepth;
+    VkRenderPass mRenderPass = nullptr;
+    VkFramebuffer mFramebuffer = nullptr;
+
+    VkCommandPool mCmdPool = nullptr;
+    std::vector<Frame> mFrames;
+    uint32_t mCurrentFrame = 0;
+};
@@ -24,9 +24,8 @@ SOFTWARE.
 
 #include "ImageDescr.hpp"
 #include "ResourceManager.hpp"
-#include <QVulkanInstance>
-#include <QVulkanFunctions>
-#include <QVulkanDeviceFunctions>
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
 
 ImageDescr::ImageDescr(ResourceManager* resourceMgr)
     : mResourceMgr(resourceMgr)
@@ -41,12 +40,17 @@ ImageDescr::~ImageDescr()
 
 void ImageDescr::release()
 {
-    QVulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
     devFuncs->vkDestroyImage(device, mImage, nullptr);
-    devFuncs->vkFreeMemory(device, mMem, nullptr);
+    if (mOwnsMem) {
+        devFuncs->vkFreeMemory(device, mMem, nullptr);
+    }
     mImage = nullptr;
     mMem = nullptr;
+    mMipLevels = 0;
+    mOwnsMem = true;
+    mState = ResourceState();
 }
 
 ImageDescr::ImageDescr(ImageDescr&& other)
@@ -64,6 +68,9 @@ void ImageDescr::swapAll(ImageDescr&& other)
 {
     std::swap(mMem, other.mMem);
     std::swap(mImage, other.mImage);
+    std::swap(mMipLevels, other.mMipLevels);
+    std::swap(mOwnsMem, other.mOwnsMem);
+    std::swap(mState, other.mState);
     std::swap(mResourceMgr, other.mResourceMgr);
 }
 
@@ -73,7 +80,7 @@ bool ImageDescr::createImage(VkFormat pixelFormat, VkExtent3D imageSize, uint32_
     release();
     VkResult result = VK_SUCCESS;
 
-    QVulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
 
     //
@@ -259,6 +266,47 @@ bool ImageDescr::createImage(VkFormat pixelFormat, VkExtent3D imageSize, uint32_
         return false;
     }
 
+    // Host writes are visible to the first submission which uses the image - only layout has to be changed
+    mMipLevels = mipLevels;
+    mState = ResourceState();
+    mState.layout = imageInfo.initialLayout;
+
+    return true;
+}
+
+bool ImageDescr::createUnbound(const VkImageCreateInfo& imageInfo)
+{
+    release();
+    VkResult result = mResourceMgr->deviceFunctions()->vkCreateImage(mResourceMgr->device(), &imageInfo, nullptr, &mImage);
+    if (result != VK_SUCCESS) {
+        qWarning("Can't create image. Result: %i", result);
+        mImage = nullptr;
+        return false;
+    }
+    mOwnsMem = false;
+    mMipLevels = imageInfo.mipLevels;
+    mState = ResourceState();
+    mState.layout = imageInfo.initialLayout;
     return true;
 }
 
+VkMemoryRequirements ImageDescr::getMemoryRequirements() const
+{
+    VkMemoryRequirements memReqs = {};
+    if (mImage) {
+        mResourceMgr->deviceFunctions()->vkGetImageMemoryRequirements(mResourceMgr->device(), mImage, &memReqs);
+    }
+    return memReqs;
+}
+
+bool ImageDescr::bindMemory(VkDeviceMemory memory, VkDeviceSize offset)
+{
+    assert(mImage && !mMem && "Image has to be created by createUnbound and not bound yet!");
+    VkResult result = mResourceMgr->deviceFunctions()->vkBindImageMemory(mResourceMgr->device(), mImage, memory, offset);
+    if (result != VK_SUCCESS) {
+        qWarning("Can't bind memory to image. Result: %i", result);
+        return false;
+    }
+    mMem = memory;
+    return true;
+}
@@ -25,6 +25,7 @@ SOFTWARE.
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include "ResourceState.hpp"
 
 class ResourceManager;
 
@@ -36,8 +37,24 @@ public:
 
     bool createImage(VkFormat pixelFormat, VkExtent3D imageSize, uint32_t mipLevels, const uint8_t* data,
                      bool generateMipMaps, VkImageUsageFlags usage);
+
+    ///
+    /// Image without memory (e.g. render graph attachment) - memory is bound later by bindMemory and it is not owned by image,
+    /// so the same memory can be shared by images which are not used at the same time.
+    ///
+    bool createUnbound(const VkImageCreateInfo& imageInfo);
+    VkMemoryRequirements getMemoryRequirements() const;
+    bool bindMemory(VkDeviceMemory memory, VkDeviceSize offset);
+
     VkImage getImage() const { return mImage; }
     VkDeviceMemory getMem() const { return mMem; }
+    uint32_t getMipLevels() const { return mMipLevels; }
+
+    ///
+    /// Current layout and access - changed only through ResourceStateTracker
+    ///
+    ResourceState& state() { return mState; }
+    const ResourceState& state() const { return mState; }
 
     ImageDescr(const ImageDescr&) = delete;
     ImageDescr& operator=(const ImageDescr&) = delete;
@@ -51,6 +68,9 @@ protected:
 
     VkImage mImage = nullptr;
     VkDeviceMemory mMem = nullptr;
+    uint32_t mMipLevels = 0;
+    bool mOwnsMem = true;
+    ResourceState mState;
 
     ResourceManager* mResourceMgr;
 };
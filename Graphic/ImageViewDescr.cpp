@@ -24,9 +24,8 @@ SOFTWARE.
 
 #include "ImageViewDescr.hpp"
 #include "ResourceManager.hpp"
-#include <QVulkanInstance>
-#include <QVulkanFunctions>
-#include <QVulkanDeviceFunctions>
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
 
 ImageViewDescr::ImageViewDescr(ResourceManager* resourceMgr)
     : mResourceMgr(resourceMgr)
@@ -41,7 +40,7 @@ ImageViewDescr::~ImageViewDescr()
 
 void ImageViewDescr::release()
 {
-    QVulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
     devFuncs->vkDestroyImageView(device, mImageView, nullptr);
     mImageView = nullptr;
@@ -69,7 +68,7 @@ bool ImageViewDescr::createImageView(const VkImageViewCreateInfo& imageViewInfo)
     release();
     VkResult result = VK_SUCCESS;
 
-    QVulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
 
     result = devFuncs->vkCreateImageView(device, &imageViewInfo, nullptr, &mImageView);
@@ -0,0 +1,237 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "IndirectDrawSet.hpp"
+#include "ResourceManager.hpp"
+#include "PipelineManager.hpp"
+#include "DrawManager.hpp"
+#include "BufferDescr.hpp"
+#include "Frustum.hpp"
+#include "VulkanFunctions.hpp"
+#include <assert.h>
+
+Q_DECLARE_METATYPE(VkDescriptorBufferInfo);
+
+namespace {
+const uint32_t cullGroupSize = 64; // local_size_x of cull_chunks.comp
+const VkDeviceSize commandStride = sizeof(VkDrawIndexedIndirectCommand);
+}
+
+IndirectDrawSet::IndirectDrawSet(ResourceManager* resourceMgr, uint32_t framesInFlight)
+    : mFrames(framesInFlight)
+    , mResourceMgr(resourceMgr)
+{
+    assert(mResourceMgr && "Resource Manager should be valid!");
+    assert(framesInFlight && "At least one frame should be in flight!");
+}
+
+IndirectDrawSet::~IndirectDrawSet()
+{
+    for (Frame& frame : mFrames) {
+        if (frame.cullParams) {
+            frame.cullParams->unmap(); // buffers are owned by ResourceManager
+        }
+    }
+}
+
+uint32_t IndirectDrawSet::addChunk(const glm::vec3& center, float radius, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset)
+{
+    Chunk chunk = {};
+    chunk.boundingSphere = glm::vec4(center, radius);
+    chunk.indexCount = indexCount;
+    chunk.firstIndex = firstIndex;
+    chunk.vertexOffset = vertexOffset;
+    mChunks.push_back(chunk);
+    return static_cast<uint32_t>(mChunks.size() - 1);
+}
+
+bool IndirectDrawSet::createResources()
+{
+    if (mChunks.empty()) {
+        qWarning("Indirect draw set without chunks!");
+        return false;
+    }
+    mCmdDrawIndexedIndirectCount = mResourceMgr->cmdDrawIndexedIndirectCount();
+
+    if (!mChunkBuffer) {
+        mChunkBuffer = mResourceMgr->createBuffer();
+    }
+    if (!mChunkBuffer->createBuffer(mChunks.data(), mChunks.size() * sizeof(Chunk), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+        return false;
+    }
+
+    for (Frame& frame : mFrames) {
+        if (!frame.commands) {
+            frame.commands = mResourceMgr->createBuffer();
+            frame.drawCount = mResourceMgr->createBuffer();
+            frame.cullParams = mResourceMgr->createBuffer();
+        }
+        bool created = frame.commands->createBuffer(nullptr, mChunks.size() * commandStride, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
+                    && frame.drawCount->createBuffer(nullptr, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT)
+                    && frame.cullParams->createBuffer(nullptr, sizeof(CullParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+        if (!created) {
+            qWarning("Can't create indirect draw buffers!");
+            return false;
+        }
+        frame.cullParamsMapped = static_cast<CullParams*>(frame.cullParams->map());
+        if (!frame.cullParamsMapped) {
+            return false;
+        }
+
+        frame.cullGo.uniformMapping.resize(1);
+        frame.cullGo.uniformMapping[0].resize(4);
+        VkDescriptorBufferInfo bufferInfos[4] = {
+            {frame.cullParams->getBuffer(), 0, sizeof(CullParams)},
+            {mChunkBuffer->getBuffer(),     0, VK_WHOLE_SIZE},
+            {frame.commands->getBuffer(),   0, VK_WHOLE_SIZE},
+            {frame.drawCount->getBuffer(),  0, VK_WHOLE_SIZE},
+        };
+        for (size_t binding = 0; binding < 4; ++binding) {
+            frame.cullGo.uniformMapping[0][binding] = QVariant::fromValue(bufferInfos[binding]);
+        }
+    }
+    return true;
+}
+
+bool IndirectDrawSet::initPipeline(PipelineManager* pipelineMgr)
+{
+    assert(pipelineMgr);
+    const PipelineManager::PipelineInfo* cullPipeline = pipelineMgr->getComputePipeline("../shaders/cull_chunks.comp.bin");
+    if (!cullPipeline) {
+        qWarning("Can't get culling pipeline!");
+        return false;
+    }
+
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    for (Frame& frame : mFrames) {
+        frame.cullGo.pipelineInfo = cullPipeline;
+        if (!pipelineMgr->allocateDescriptorSets(cullPipeline, frame.cullGo.descriptorSets)) {
+            qWarning("Can't allocate culling descriptor sets!");
+            frame.cullGo.pipelineInfo = nullptr;
+            return false;
+        }
+        frame.cullGo.connectResourceWithUniformSets(*devFuncs, mResourceMgr->device());
+    }
+    return true;
+}
+
+void IndirectDrawSet::releasePipeline()
+{
+    for (Frame& frame : mFrames) {
+        frame.cullGo.pipelineInfo = nullptr;
+        frame.cullGo.descriptorSets.clear(); // released with PipelineManager
+    }
+}
+
+void IndirectDrawSet::cull(DrawManager* drawMgr)
+{
+    assert(drawMgr);
+    assert(drawMgr->getProjMatrix());
+    assert(drawMgr->getViewMatrix());
+    Frame& frame = mFrames[drawMgr->getCurrentFrame()];
+    VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
+    if (!frame.cullGo.pipelineInfo || !cmdBuf) {
+        return;
+    }
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+
+    //
+    // Parameters - buffer of this frame is not used by GPU anymore
+    //
+    Frustum frustum = Frustum::fromMatrix(*drawMgr->getProjMatrix() * *drawMgr->getViewMatrix());
+    for (int plane = 0; plane < Frustum::PlaneCount; ++plane) {
+        frame.cullParamsMapped->planes[plane] = frustum.planes[plane];
+    }
+    frame.cullParamsMapped->chunkCount = chunkCount();
+    frame.cullParamsMapped->compact = usesDrawIndirectCount() ? 1 : 0;
+
+    // Buffers of this frame slot are not used by GPU anymore - frame fence was waited
+    ResourceStateTracker* tracker = mResourceMgr->stateTracker();
+    tracker->markIdle(*frame.drawCount);
+    tracker->markIdle(*frame.commands);
+
+    tracker->useBuffer(*frame.drawCount, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT);
+    tracker->flush(cmdBuf); // idle buffer - nothing to wait for, records only what other objects queued
+    devFuncs->vkCmdFillBuffer(cmdBuf, frame.drawCount->getBuffer(), 0, sizeof(uint32_t), 0);
+
+    tracker->useBuffer(*frame.drawCount, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    tracker->useBuffer(*frame.commands, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT);
+    tracker->flush(cmdBuf);
+
+    //
+    // Culling
+    //
+    const PipelineManager::PipelineInfo* pipelineInfo = frame.cullGo.pipelineInfo;
+    devFuncs->vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineInfo->pipeline);
+    devFuncs->vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineInfo->pipelineLayout,
+                                      0, static_cast<uint32_t>(frame.cullGo.descriptorSets.size()), frame.cullGo.descriptorSets.data(),
+                                      0, nullptr);
+    devFuncs->vkCmdDispatch(cmdBuf, (chunkCount() + cullGroupSize - 1) / cullGroupSize, 1, 1);
+
+    tracker->useBuffer(*frame.commands, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    tracker->useBuffer(*frame.drawCount, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    tracker->flush(cmdBuf);
+}
+
+void IndirectDrawSet::draw(DrawManager* drawMgr, const GraphicObject& go)
+{
+    assert(drawMgr);
+    const Frame& frame = mFrames[drawMgr->getCurrentFrame()];
+    VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
+    if (!go.pipelineInfo || !cmdBuf || !frame.cullGo.pipelineInfo) {
+        return;
+    }
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+
+    devFuncs->vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, go.pipelineInfo->pipeline);
+
+    FrameArena* arena = drawMgr->frameArena();
+    FrameVector<VkDescriptorSet> descriptorSets = makeFrameVector<VkDescriptorSet>(arena, go.pipelineInfo->descriptorSetInfo.size(), nullptr);
+    for (size_t descriptorSetIdx = 0; descriptorSetIdx < descriptorSets.size(); ++descriptorSetIdx) {
+        descriptorSets[descriptorSetIdx] = go.descriptorSet(descriptorSetIdx);
+    }
+    if (!descriptorSets.empty()) {
+        devFuncs->vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, go.pipelineInfo->pipelineLayout,
+                                          0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(),
+                                          0, nullptr);
+    }
+
+    FrameVector<VkBuffer> vertexBuffers = makeFrameVector<VkBuffer>(arena, go.vertices.size(), nullptr);
+    FrameVector<VkDeviceSize> offsets = makeFrameVector<VkDeviceSize>(arena, go.vertices.size(), 0);
+    for (size_t i = 0; i < go.vertices.size(); ++i) {
+        vertexBuffers[i] = go.vertices[i]->getBuffer();
+    }
+    devFuncs->vkCmdBindVertexBuffers(cmdBuf, 0, static_cast<uint32_t>(vertexBuffers.size()), vertexBuffers.data(), offsets.data());
+    devFuncs->vkCmdBindIndexBuffer(cmdBuf, go.indices->getBuffer(), 0, go.indexType);
+
+    if (mCmdDrawIndexedIndirectCount) {
+        mCmdDrawIndexedIndirectCount(cmdBuf, frame.commands->getBuffer(), 0, frame.drawCount->getBuffer(), 0, chunkCount(), commandStride);
+    }
+    else {
+        // multiDrawIndirect is not enabled by QVulkanWindow - draw count has to be 1
+        for (uint32_t chunkIdx = 0; chunkIdx < chunkCount(); ++chunkIdx) {
+            devFuncs->vkCmdDrawIndexedIndirect(cmdBuf, frame.commands->getBuffer(), chunkIdx * commandStride, 1, commandStride);
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "GraphicObject.hpp"
+
+class ResourceManager;
+class PipelineManager;
+class DrawManager;
+class BufferDescr;
+
+///
+/// GPU driven drawing of many chunks sharing one vertex/index buffer and pipeline.
+/// Chunk bounds and draw arguments live in storage buffer. Every frame compute pass (cull_chunks.comp)
+/// tests chunks against view frustum and writes draw commands of visible ones, then all of them are drawn
+/// with single vkCmdDrawIndexedIndirectCount - CPU cost does not depend on chunk count.
+/// Without VK_KHR_draw_indirect_count commands are not compacted (culled have instanceCount = 0)
+/// and they are issued with vkCmdDrawIndexedIndirect one by one.
+///
+class IndirectDrawSet
+{
+public:
+    struct Chunk { // std430 layout of Chunk in cull_chunks.comp
+        glm::vec4 boundingSphere; // xyz - center in world space, w - radius
+        uint32_t  indexCount;
+        uint32_t  firstIndex;
+        int32_t   vertexOffset;
+        uint32_t  padding;
+    };
+
+    IndirectDrawSet(ResourceManager* resourceMgr, uint32_t framesInFlight);
+    ~IndirectDrawSet();
+
+    ///
+    /// Chunks are uploaded by createResources, added later need another createResources call.
+    ///
+    uint32_t addChunk(const glm::vec3& center, float radius, uint32_t indexCount, uint32_t firstIndex, int32_t vertexOffset);
+    uint32_t chunkCount() const { return static_cast<uint32_t>(mChunks.size()); }
+    bool createResources();
+
+    bool initPipeline(PipelineManager* pipelineMgr);
+    void releasePipeline();
+
+    ///
+    /// Record culling compute pass. Has to be called outside of render pass, before draw in the same frame.
+    ///
+    void cull(DrawManager* drawMgr);
+
+    ///
+    /// Record indirect draws of go (its vertices and indices contain all chunks). Inside render pass.
+    ///
+    void draw(DrawManager* drawMgr, const GraphicObject& go);
+
+    bool usesDrawIndirectCount() const { return mCmdDrawIndexedIndirectCount != nullptr; }
+
+    IndirectDrawSet(const IndirectDrawSet&) = delete;
+    IndirectDrawSet& operator=(const IndirectDrawSet&) = delete;
+
+protected:
+    struct CullParams { // std140 layout of CullParams in cull_chunks.comp
+        glm::vec4 planes[6];
+        uint32_t  chunkCount;
+        uint32_t  compact;
+    };
+
+    struct Frame {
+        BufferDescr* commands = nullptr;   // VkDrawIndexedIndirectCommand[chunkCount]
+        BufferDescr* drawCount = nullptr;  // uint32_t
+        BufferDescr* cullParams = nullptr;
+        CullParams*  cullParamsMapped = nullptr;
+        GraphicObject cullGo;              // compute pipeline with own descriptor set of this frame
+    };
+
+    std::vector<Chunk> mChunks;
+    std::vector<Frame> mFrames;
+    BufferDescr* mChunkBuffer = nullptr;
+    PFN_vkCmdDrawIndexedIndirectCountKHR mCmdDrawIndexedIndirectCount = nullptr;
+
+    ResourceManager* mResourceMgr;
+};
@@ -0,0 +1,104 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "InstanceBuffer.hpp"
+#include "ResourceManager.hpp"
+#include "BufferDescr.hpp"
+#include <assert.h>
+#include <algorithm>
+
+InstanceBuffer::InstanceBuffer(ResourceManager* resourceMgr, uint32_t framesInFlight, uint32_t initialCapacity)
+    : mFrames(framesInFlight)
+    , mUsed(0)
+    , mRequiredCapacity(initialCapacity)
+    , mResourceMgr(resourceMgr)
+{
+    assert(mResourceMgr && "Resource Manager should be valid!");
+    assert(framesInFlight && "At least one frame should be in flight!");
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    for (Frame& frame : mFrames) {
+        if (frame.buffer) {
+            frame.buffer->unmap(); // buffer itself is owned by ResourceManager
+        }
+    }
+}
+
+bool InstanceBuffer::createFrameBuffer(Frame& frame, uint32_t capacity)
+{
+    if (frame.buffer) {
+        frame.buffer->unmap();
+    }
+    else {
+        frame.buffer = mResourceMgr->createBuffer();
+    }
+    frame.mapped = nullptr;
+    frame.capacity = 0;
+
+    if (!frame.buffer->createBuffer(nullptr, capacity * sizeof(InstanceData), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT)) {
+        qWarning("Can't create instance buffer for %d instances", capacity);
+        return false;
+    }
+    frame.mapped = static_cast<InstanceData*>(frame.buffer->map());
+    if (!frame.mapped) {
+        return false;
+    }
+    frame.capacity = capacity;
+    return true;
+}
+
+void InstanceBuffer::beginFrame(uint32_t frameIdx)
+{
+    assert(frameIdx < mFrames.size());
+    mRequiredCapacity = std::max(mRequiredCapacity, mUsed.load());
+    mCurrentFrame = frameIdx;
+    mUsed = 0;
+
+    Frame& frame = mFrames[frameIdx];
+    if (frame.capacity < mRequiredCapacity) {
+        uint32_t capacity = std::max(mRequiredCapacity, frame.capacity * 2);
+        createFrameBuffer(frame, capacity);
+    }
+}
+
+InstanceBuffer::Allocation InstanceBuffer::allocate(uint32_t instanceCount)
+{
+    Allocation allocation;
+    const Frame& frame = mFrames[mCurrentFrame];
+    uint32_t first = mUsed.fetch_add(instanceCount);
+    if (first + instanceCount > frame.capacity) {
+        return allocation; // mUsed keeps the demand - frame grows next time
+    }
+    allocation.data = frame.mapped + first;
+    allocation.buffer = frame.buffer->getBuffer();
+    allocation.offset = first * sizeof(InstanceData);
+    return allocation;
+}
+
+uint32_t InstanceBuffer::capacity() const
+{
+    return mFrames[mCurrentFrame].capacity;
+}
@@ -0,0 +1,91 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+class ResourceManager;
+class BufferDescr;
+
+///
+/// Per instance vertex data - matches instance inputs of instanced shaders (e.g. cube_instanced.vert):
+///     layout(location = N)     in mat4 instanceModel;
+///     layout(location = N + 4) in vec4 instanceColor;
+///
+struct InstanceData
+{
+    glm::mat4x4 modelMtx;
+    glm::vec4   color;
+};
+
+///
+/// Host visible vertex buffer per frame in flight, refilled every frame with InstanceData.
+/// Allocation is lock free - can be called from many threads between beginFrame() calls.
+/// When frame runs out of space allocation fails and buffer of this frame grows on its next beginFrame().
+///
+class InstanceBuffer
+{
+public:
+    struct Allocation {
+        InstanceData* data = nullptr; // nullptr - allocation failed
+        VkBuffer      buffer = nullptr;
+        VkDeviceSize  offset = 0;     // in bytes - offset for vkCmdBindVertexBuffers
+    };
+
+    InstanceBuffer(ResourceManager* resourceMgr, uint32_t framesInFlight, uint32_t initialCapacity = 4096);
+    ~InstanceBuffer();
+
+    ///
+    /// Start filling buffer of frameIdx. GPU can't use this buffer anymore (fence of the frame was waited).
+    ///
+    void beginFrame(uint32_t frameIdx);
+    Allocation allocate(uint32_t instanceCount);
+
+    uint32_t capacity() const;                        // instances in current frame buffer
+    uint32_t used() const { return std::min(mUsed.load(), capacity()); }
+
+    InstanceBuffer(const InstanceBuffer&) = delete;
+    InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+protected:
+    struct Frame {
+        BufferDescr* buffer = nullptr;
+        InstanceData* mapped = nullptr;
+        uint32_t capacity = 0;
+    };
+
+    bool createFrameBuffer(Frame& frame, uint32_t capacity);
+
+    std::vector<Frame> mFrames;
+    uint32_t mCurrentFrame = 0;
+    std::atomic<uint32_t> mUsed;      // instances requested in current frame, can exceed capacity
+    uint32_t mRequiredCapacity = 0;   // the highest demand seen
+
+    ResourceManager* mResourceMgr;
+};
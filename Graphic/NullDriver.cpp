@@ -0,0 +1,664 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "NullDriver.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+
+namespace {
+
+struct CounterSet {
+    std::atomic<uint64_t> calls[NullDriver::CallCount];
+    std::atomic<uint64_t> descriptorWrites;
+    std::atomic<uint64_t> allocatedBytes;
+
+    void reset()
+    {
+        for (std::atomic<uint64_t>& call : calls) {
+            call.store(0, std::memory_order_relaxed);
+        }
+        descriptorWrites.store(0, std::memory_order_relaxed);
+        allocatedBytes.store(0, std::memory_order_relaxed);
+    }
+
+    NullDriver::Counters snapshot() const
+    {
+        NullDriver::Counters counters;
+        for (size_t i = 0; i < NullDriver::CallCount; ++i) {
+            counters.calls[i] = calls[i].load(std::memory_order_relaxed);
+        }
+        counters.descriptorWrites = descriptorWrites.load(std::memory_order_relaxed);
+        counters.allocatedBytes = allocatedBytes.load(std::memory_order_relaxed);
+        return counters;
+    }
+};
+
+// Zero initialized - static storage
+CounterSet sFrame;
+CounterSet sTotal;
+std::atomic<uint64_t> sLiveAllocations;
+std::atomic<uintptr_t> sNextHandle(0x1000);
+
+struct ImageInfo {
+    VkFormat format;
+    VkExtent3D extent;
+    uint32_t mipLevels;
+    uint32_t arrayLayers;
+};
+
+std::mutex sObjectsMutex;
+std::map<uintptr_t, std::unique_ptr<uint8_t[]>> sMemory; // host storage of VkDeviceMemory
+std::map<uintptr_t, VkDeviceSize> sBuffers;
+std::map<uintptr_t, ImageInfo> sImages;
+
+const VkDeviceSize MemoryAlignment = 256;
+
+void count(NullDriver::Call call)
+{
+    sFrame.calls[call].fetch_add(1, std::memory_order_relaxed);
+    sTotal.calls[call].fetch_add(1, std::memory_order_relaxed);
+}
+
+template <typename Handle>
+Handle newHandle()
+{
+    return reinterpret_cast<Handle>(sNextHandle.fetch_add(1, std::memory_order_relaxed));
+}
+
+template <typename Handle>
+uintptr_t key(Handle handle)
+{
+    return reinterpret_cast<uintptr_t>(handle);
+}
+
+VkDeviceSize alignUp(VkDeviceSize size)
+{
+    return (size + MemoryAlignment - 1) / MemoryAlignment * MemoryAlignment;
+}
+
+uint32_t texelSize(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_R8_UNORM: case VK_FORMAT_R8_SNORM: case VK_FORMAT_R8_UINT: case VK_FORMAT_R8_SINT: case VK_FORMAT_S8_UINT:
+        return 1;
+    case VK_FORMAT_R8G8_UNORM: case VK_FORMAT_R8G8_SNORM: case VK_FORMAT_R8G8_UINT: case VK_FORMAT_R8G8_SINT:
+    case VK_FORMAT_R16_UNORM: case VK_FORMAT_R16_SFLOAT: case VK_FORMAT_R16_UINT: case VK_FORMAT_R16_SINT: case VK_FORMAT_D16_UNORM:
+        return 2;
+    case VK_FORMAT_R16G16B16A16_UNORM: case VK_FORMAT_R16G16B16A16_SFLOAT: case VK_FORMAT_R16G16B16A16_UINT:
+    case VK_FORMAT_R32G32_SFLOAT: case VK_FORMAT_R32G32_UINT: case VK_FORMAT_R32G32_SINT: case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return 8;
+    case VK_FORMAT_R32G32B32_SFLOAT: case VK_FORMAT_R32G32B32_UINT: case VK_FORMAT_R32G32B32_SINT:
+        return 12;
+    case VK_FORMAT_R32G32B32A32_SFLOAT: case VK_FORMAT_R32G32B32A32_UINT: case VK_FORMAT_R32G32B32A32_SINT:
+        return 16;
+    default:
+        return 4; // RGBA8, BGRA8, R32, D32, D24S8, ...
+    }
+}
+
+// Tightly packed levels of each layer one after another
+VkDeviceSize levelSize(const ImageInfo& image, uint32_t level, VkDeviceSize* rowPitch = nullptr)
+{
+    VkDeviceSize width = std::max(1u, image.extent.width >> level);
+    VkDeviceSize height = std::max(1u, image.extent.height >> level);
+    VkDeviceSize depth = std::max(1u, image.extent.depth >> level);
+    VkDeviceSize pitch = width * texelSize(image.format);
+    if (rowPitch) {
+        *rowPitch = pitch;
+    }
+    return pitch * height * depth;
+}
+
+VkDeviceSize layerSize(const ImageInfo& image)
+{
+    VkDeviceSize size = 0;
+    for (uint32_t level = 0; level < image.mipLevels; ++level) {
+        size += levelSize(image, level);
+    }
+    return size;
+}
+
+//
+// Stubs - generic one only counts and returns VK_SUCCESS/nothing
+//
+
+template <NullDriver::Call call, typename Function>
+struct Stub;
+
+template <NullDriver::Call call, typename R, typename... Args>
+struct Stub<call, R (VKAPI_PTR *)(Args...)>
+{
+    static R VKAPI_CALL function(Args...)
+    {
+        count(call);
+        return R();
+    }
+};
+
+template <NullDriver::Call call, typename Info, typename Handle>
+VkResult VKAPI_CALL createHandle(VkDevice, const Info*, const VkAllocationCallbacks*, Handle* handle)
+{
+    count(call);
+    *handle = newHandle<Handle>();
+    return VK_SUCCESS;
+}
+
+template <NullDriver::Call call, typename Info>
+VkResult VKAPI_CALL createPipelines(VkDevice, VkPipelineCache, uint32_t createInfoCount, const Info*,
+                                    const VkAllocationCallbacks*, VkPipeline* pipelines)
+{
+    count(call);
+    for (uint32_t i = 0; i < createInfoCount; ++i) {
+        pipelines[i] = newHandle<VkPipeline>();
+    }
+    return VK_SUCCESS;
+}
+
+template <typename T>
+VkResult fillProperties(uint32_t* count, T* properties, const T* available, uint32_t availableCount)
+{
+    if (!properties) {
+        *count = availableCount;
+        return VK_SUCCESS;
+    }
+    uint32_t written = std::min(*count, availableCount);
+    std::copy(available, available + written, properties);
+    *count = written;
+    return written < availableCount ? VK_INCOMPLETE : VK_SUCCESS;
+}
+
+//
+// Global and instance level
+//
+
+VkResult VKAPI_CALL createInstance(const VkInstanceCreateInfo*, const VkAllocationCallbacks*, VkInstance* instance)
+{
+    sFrame.reset();
+    sTotal.reset();
+    *instance = newHandle<VkInstance>();
+    return VK_SUCCESS;
+}
+
+VkResult VKAPI_CALL enumerateInstanceExtensionProperties(const char*, uint32_t* propertyCount, VkExtensionProperties* properties)
+{
+    return fillProperties<VkExtensionProperties>(propertyCount, properties, nullptr, 0);
+}
+
+VkResult VKAPI_CALL enumerateInstanceLayerProperties(uint32_t* propertyCount, VkLayerProperties* properties)
+{
+    return fillProperties<VkLayerProperties>(propertyCount, properties, nullptr, 0);
+}
+
+VkPhysicalDevice physicalDeviceHandle()
+{
+    static const VkPhysicalDevice physicalDevice = newHandle<VkPhysicalDevice>();
+    return physicalDevice;
+}
+
+VkResult VKAPI_CALL enumeratePhysicalDevices(VkInstance, uint32_t* count, VkPhysicalDevice* physicalDevices)
+{
+    ::count(NullDriver::Call_vkEnumeratePhysicalDevices);
+    VkPhysicalDevice physicalDevice = physicalDeviceHandle();
+    return fillProperties(count, physicalDevices, &physicalDevice, 1);
+}
+
+void VKAPI_CALL getPhysicalDeviceProperties(VkPhysicalDevice, VkPhysicalDeviceProperties* properties)
+{
+    count(NullDriver::Call_vkGetPhysicalDeviceProperties);
+    memset(properties, 0, sizeof(*properties));
+    properties->apiVersion = VK_API_VERSION_1_0;
+    properties->deviceType = VK_PHYSICAL_DEVICE_TYPE_OTHER;
+    strncpy(properties->deviceName, "Null driver", VK_MAX_PHYSICAL_DEVICE_NAME_SIZE - 1);
+
+    VkPhysicalDeviceLimits& limits = properties->limits;
+    limits.maxImageDimension1D = limits.maxImageDimension2D = limits.maxImageDimension3D = 16384;
+    limits.maxImageDimensionCube = 16384;
+    limits.maxImageArrayLayers = 2048;
+    limits.maxTexelBufferElements = 1u << 27;
+    limits.maxUniformBufferRange = 65536;
+    limits.maxStorageBufferRange = 1u << 30;
+    limits.maxPushConstantsSize = 128;
+    limits.maxMemoryAllocationCount = 4096;
+    limits.maxSamplerAllocationCount = 4000;
+    limits.bufferImageGranularity = 1;
+    limits.maxBoundDescriptorSets = 8;
+    limits.maxPerStageDescriptorSamplers = limits.maxPerStageDescriptorSampledImages = 4096;
+    limits.maxPerStageDescriptorUniformBuffers = limits.maxPerStageDescriptorStorageBuffers = 64;
+    limits.maxPerStageDescriptorStorageImages = 64;
+    limits.maxPerStageResources = 8192;
+    limits.maxDescriptorSetSamplers = limits.maxDescriptorSetSampledImages = 8192;
+    limits.maxDescriptorSetUniformBuffers = limits.maxDescriptorSetStorageBuffers = 256;
+    limits.maxVertexInputAttributes = limits.maxVertexInputBindings = 32;
+    limits.maxVertexInputAttributeOffset = 2047;
+    limits.maxVertexInputBindingStride = 2048;
+    limits.maxComputeSharedMemorySize = 32768;
+    limits.maxComputeWorkGroupCount[0] = limits.maxComputeWorkGroupCount[1] = limits.maxComputeWorkGroupCount[2] = 65535;
+    limits.maxComputeWorkGroupInvocations = 1024;
+    limits.maxComputeWorkGroupSize[0] = limits.maxComputeWorkGroupSize[1] = 1024;
+    limits.maxComputeWorkGroupSize[2] = 64;
+    limits.maxDrawIndexedIndexValue = ~0u;
+    limits.maxDrawIndirectCount = 1;
+    limits.maxViewports = 1;
+    limits.maxViewportDimensions[0] = limits.maxViewportDimensions[1] = 16384;
+    limits.minMemoryMapAlignment = 64;
+    limits.minTexelBufferOffsetAlignment = limits.minUniformBufferOffsetAlignment = limits.minStorageBufferOffsetAlignment = MemoryAlignment;
+    limits.maxFramebufferWidth = limits.maxFramebufferHeight = 16384;
+    limits.maxFramebufferLayers = 1024;
+    limits.framebufferColorSampleCounts = limits.framebufferDepthSampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    limits.sampledImageColorSampleCounts = limits.sampledImageDepthSampleCounts = VK_SAMPLE_COUNT_1_BIT;
+    limits.maxColorAttachments = 8;
+    limits.timestampComputeAndGraphics = VK_TRUE;
+    limits.timestampPeriod = 1.f;
+    limits.pointSizeRange[0] = 1.f;
+    limits.pointSizeRange[1] = 64.f;
+    limits.pointSizeGranularity = 1.f;
+    limits.lineWidthRange[0] = limits.lineWidthRange[1] = 1.f;
+    limits.nonCoherentAtomSize = 64;
+    limits.optimalBufferCopyOffsetAlignment = limits.optimalBufferCopyRowPitchAlignment = 1;
+}
+
+void VKAPI_CALL getPhysicalDeviceFeatures(VkPhysicalDevice, VkPhysicalDeviceFeatures* features)
+{
+    count(NullDriver::Call_vkGetPhysicalDeviceFeatures);
+    *features = VkPhysicalDeviceFeatures();
+    // Only features consistent with limits of getPhysicalDeviceProperties (e.g. maxDrawIndirectCount 1 - no multiDrawIndirect)
+    features->fullDrawIndexUint32 = VK_TRUE;
+    features->drawIndirectFirstInstance = VK_TRUE;
+    features->largePoints = VK_TRUE;
+}
+
+void VKAPI_CALL getPhysicalDeviceFormatProperties(VkPhysicalDevice, VkFormat, VkFormatProperties* properties)
+{
+    count(NullDriver::Call_vkGetPhysicalDeviceFormatProperties);
+    properties->linearTilingFeatures = properties->optimalTilingFeatures = properties->bufferFeatures = ~0u; // everything is supported
+}
+
+void VKAPI_CALL getPhysicalDeviceMemoryProperties(VkPhysicalDevice, VkPhysicalDeviceMemoryProperties* properties)
+{
+    count(NullDriver::Call_vkGetPhysicalDeviceMemoryProperties);
+    memset(properties, 0, sizeof(*properties));
+    properties->memoryTypeCount = 1;
+    properties->memoryTypes[0].propertyFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    properties->memoryTypes[0].heapIndex = 0;
+    properties->memoryHeapCount = 1;
+    properties->memoryHeaps[0].size = 4ull * 1024 * 1024 * 1024;
+    properties->memoryHeaps[0].flags = VK_MEMORY_HEAP_DEVICE_LOCAL_BIT;
+}
+
+void VKAPI_CALL getPhysicalDeviceQueueFamilyProperties(VkPhysicalDevice, uint32_t* count, VkQueueFamilyProperties* properties)
+{
+    ::count(NullDriver::Call_vkGetPhysicalDeviceQueueFamilyProperties);
+    VkQueueFamilyProperties family = {};
+    family.queueFlags = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT | VK_QUEUE_TRANSFER_BIT;
+    family.queueCount = 1;
+    family.timestampValidBits = 64;
+    family.minImageTransferGranularity = { 1, 1, 1 };
+    fillProperties(count, properties, &family, 1);
+}
+
+VkResult VKAPI_CALL enumerateDeviceExtensionProperties(VkPhysicalDevice, const char*, uint32_t* propertyCount, VkExtensionProperties* properties)
+{
+    count(NullDriver::Call_vkEnumerateDeviceExtensionProperties);
+    return fillProperties<VkExtensionProperties>(propertyCount, properties, nullptr, 0); // only Vulkan 1.0
+}
+
+VkResult VKAPI_CALL createDevice(VkPhysicalDevice, const VkDeviceCreateInfo*, const VkAllocationCallbacks*, VkDevice* device)
+{
+    count(NullDriver::Call_vkCreateDevice);
+    *device = newHandle<VkDevice>();
+    return VK_SUCCESS;
+}
+
+PFN_vkVoidFunction VKAPI_CALL getDeviceProcAddr(VkDevice, const char* name);
+
+//
+// Device level
+//
+
+void VKAPI_CALL getDeviceQueue(VkDevice, uint32_t, uint32_t, VkQueue* queue)
+{
+    count(NullDriver::Call_vkGetDeviceQueue);
+    static const VkQueue nullQueue = newHandle<VkQueue>();
+    *queue = nullQueue;
+}
+
+VkResult VKAPI_CALL allocateMemory(VkDevice, const VkMemoryAllocateInfo* allocateInfo, const VkAllocationCallbacks*, VkDeviceMemory* memory)
+{
+    count(NullDriver::Call_vkAllocateMemory);
+    sFrame.allocatedBytes.fetch_add(allocateInfo->allocationSize, std::memory_order_relaxed);
+    sTotal.allocatedBytes.fetch_add(allocateInfo->allocationSize, std::memory_order_relaxed);
+    sLiveAllocations.fetch_add(1, std::memory_order_relaxed);
+
+    *memory = newHandle<VkDeviceMemory>();
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    sMemory[key(*memory)].reset(new uint8_t[allocateInfo->allocationSize]);
+    return VK_SUCCESS;
+}
+
+void VKAPI_CALL freeMemory(VkDevice, VkDeviceMemory memory, const VkAllocationCallbacks*)
+{
+    count(NullDriver::Call_vkFreeMemory);
+    if (!memory) {
+        return;
+    }
+    sLiveAllocations.fetch_sub(1, std::memory_order_relaxed);
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    sMemory.erase(key(memory));
+}
+
+VkResult VKAPI_CALL mapMemory(VkDevice, VkDeviceMemory memory, VkDeviceSize offset, VkDeviceSize, VkMemoryMapFlags, void** data)
+{
+    count(NullDriver::Call_vkMapMemory);
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    auto it = sMemory.find(key(memory));
+    if (it == sMemory.end()) {
+        return VK_ERROR_MEMORY_MAP_FAILED;
+    }
+    *data = it->second.get() + offset;
+    return VK_SUCCESS;
+}
+
+VkResult VKAPI_CALL createBuffer(VkDevice, const VkBufferCreateInfo* createInfo, const VkAllocationCallbacks*, VkBuffer* buffer)
+{
+    count(NullDriver::Call_vkCreateBuffer);
+    *buffer = newHandle<VkBuffer>();
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    sBuffers[key(*buffer)] = createInfo->size;
+    return VK_SUCCESS;
+}
+
+void VKAPI_CALL destroyBuffer(VkDevice, VkBuffer buffer, const VkAllocationCallbacks*)
+{
+    count(NullDriver::Call_vkDestroyBuffer);
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    sBuffers.erase(key(buffer));
+}
+
+void VKAPI_CALL getBufferMemoryRequirements(VkDevice, VkBuffer buffer, VkMemoryRequirements* requirements)
+{
+    count(NullDriver::Call_vkGetBufferMemoryRequirements);
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    auto it = sBuffers.find(key(buffer));
+    requirements->size = alignUp(it != sBuffers.end() ? it->second : 0);
+    requirements->alignment = MemoryAlignment;
+    requirements->memoryTypeBits = 1;
+}
+
+VkResult VKAPI_CALL createImage(VkDevice, const VkImageCreateInfo* createInfo, const VkAllocationCallbacks*, VkImage* image)
+{
+    count(NullDriver::Call_vkCreateImage);
+    *image = newHandle<VkImage>();
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    sImages[key(*image)] = ImageInfo{ createInfo->format, createInfo->extent, std::max(1u, createInfo->mipLevels), std::max(1u, createInfo->arrayLayers) };
+    return VK_SUCCESS;
+}
+
+void VKAPI_CALL destroyImage(VkDevice, VkImage image, const VkAllocationCallbacks*)
+{
+    count(NullDriver::Call_vkDestroyImage);
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    sImages.erase(key(image));
+}
+
+void VKAPI_CALL getImageMemoryRequirements(VkDevice, VkImage image, VkMemoryRequirements* requirements)
+{
+    count(NullDriver::Call_vkGetImageMemoryRequirements);
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    auto it = sImages.find(key(image));
+    requirements->size = it != sImages.end() ? alignUp(layerSize(it->second) * it->second.arrayLayers) : 0;
+    requirements->alignment = MemoryAlignment;
+    requirements->memoryTypeBits = 1;
+}
+
+void VKAPI_CALL getImageSubresourceLayout(VkDevice, VkImage image, const VkImageSubresource* subresource, VkSubresourceLayout* layout)
+{
+    count(NullDriver::Call_vkGetImageSubresourceLayout);
+    memset(layout, 0, sizeof(*layout));
+    std::lock_guard<std::mutex> lock(sObjectsMutex);
+    auto it = sImages.find(key(image));
+    if (it == sImages.end()) {
+        return;
+    }
+    const ImageInfo& info = it->second;
+    layout->arrayPitch = layerSize(info);
+    layout->offset = layout->arrayPitch * subresource->arrayLayer;
+    for (uint32_t level = 0; level < subresource->mipLevel && level < info.mipLevels; ++level) {
+        layout->offset += levelSize(info, level);
+    }
+    layout->size = levelSize(info, subresource->mipLevel, &layout->rowPitch);
+    layout->depthPitch = layout->rowPitch * std::max(1u, info.extent.height >> subresource->mipLevel);
+}
+
+VkResult VKAPI_CALL allocateDescriptorSets(VkDevice, const VkDescriptorSetAllocateInfo* allocateInfo, VkDescriptorSet* descriptorSets)
+{
+    count(NullDriver::Call_vkAllocateDescriptorSets);
+    for (uint32_t i = 0; i < allocateInfo->descriptorSetCount; ++i) {
+        descriptorSets[i] = newHandle<VkDescriptorSet>();
+    }
+    return VK_SUCCESS;
+}
+
+void VKAPI_CALL updateDescriptorSets(VkDevice, uint32_t descriptorWriteCount, const VkWriteDescriptorSet*,
+                                     uint32_t descriptorCopyCount, const VkCopyDescriptorSet*)
+{
+    count(NullDriver::Call_vkUpdateDescriptorSets);
+    sFrame.descriptorWrites.fetch_add(descriptorWriteCount + descriptorCopyCount, std::memory_order_relaxed);
+    sTotal.descriptorWrites.fetch_add(descriptorWriteCount + descriptorCopyCount, std::memory_order_relaxed);
+}
+
+VkResult VKAPI_CALL getQueryPoolResults(VkDevice, VkQueryPool, uint32_t, uint32_t, size_t dataSize, void* data,
+                                        VkDeviceSize, VkQueryResultFlags)
+{
+    count(NullDriver::Call_vkGetQueryPoolResults);
+    memset(data, 0, dataSize); // all timestamps are 0 - GPU takes no time
+    return VK_SUCCESS;
+}
+
+VkResult VKAPI_CALL allocateCommandBuffers(VkDevice, const VkCommandBufferAllocateInfo* allocateInfo, VkCommandBuffer* commandBuffers)
+{
+    count(NullDriver::Call_vkAllocateCommandBuffers);
+    for (uint32_t i = 0; i < allocateInfo->commandBufferCount; ++i) {
+        commandBuffers[i] = newHandle<VkCommandBuffer>();
+    }
+    return VK_SUCCESS;
+}
+
+//
+// Tables
+//
+
+struct Tables {
+    VulkanInstanceFunctions instance;
+    VulkanDeviceFunctions device;
+
+    Tables()
+    {
+#define GRAPHIC_NULL_DRIVER_STUB(name) instance.name = &Stub<NullDriver::Call_##name, PFN_##name>::function;
+        GRAPHIC_VK_INSTANCE_FUNCTIONS(GRAPHIC_NULL_DRIVER_STUB)
+#undef GRAPHIC_NULL_DRIVER_STUB
+#define GRAPHIC_NULL_DRIVER_STUB(name) device.name = &Stub<NullDriver::Call_##name, PFN_##name>::function;
+        GRAPHIC_VK_DEVICE_FUNCTIONS(GRAPHIC_NULL_DRIVER_STUB)
+#undef GRAPHIC_NULL_DRIVER_STUB
+
+        instance.vkGetInstanceProcAddr = &NullDriver::getInstanceProcAddr;
+        instance.vkEnumeratePhysicalDevices = enumeratePhysicalDevices;
+        instance.vkGetPhysicalDeviceProperties = getPhysicalDeviceProperties;
+        instance.vkGetPhysicalDeviceFeatures = getPhysicalDeviceFeatures;
+        instance.vkGetPhysicalDeviceFormatProperties = getPhysicalDeviceFormatProperties;
+        instance.vkGetPhysicalDeviceMemoryProperties = getPhysicalDeviceMemoryProperties;
+        instance.vkGetPhysicalDeviceQueueFamilyProperties = getPhysicalDeviceQueueFamilyProperties;
+        instance.vkEnumerateDeviceExtensionProperties = enumerateDeviceExtensionProperties;
+        instance.vkCreateDevice = createDevice;
+        instance.vkGetDeviceProcAddr = getDeviceProcAddr;
+
+        device.vkGetDeviceQueue = getDeviceQueue;
+        device.vkAllocateMemory = allocateMemory;
+        device.vkFreeMemory = freeMemory;
+        device.vkMapMemory = mapMemory;
+        device.vkCreateBuffer = createBuffer;
+        device.vkDestroyBuffer = destroyBuffer;
+        device.vkGetBufferMemoryRequirements = getBufferMemoryRequirements;
+        device.vkCreateImage = createImage;
+        device.vkDestroyImage = destroyImage;
+        device.vkGetImageMemoryRequirements = getImageMemoryRequirements;
+        device.vkGetImageSubresourceLayout = getImageSubresourceLayout;
+        device.vkAllocateDescriptorSets = allocateDescriptorSets;
+        device.vkUpdateDescriptorSets = updateDescriptorSets;
+        device.vkGetQueryPoolResults = getQueryPoolResults;
+        device.vkAllocateCommandBuffers = allocateCommandBuffers;
+        device.vkCreateGraphicsPipelines = createPipelines<NullDriver::Call_vkCreateGraphicsPipelines, VkGraphicsPipelineCreateInfo>;
+        device.vkCreateComputePipelines = createPipelines<NullDriver::Call_vkCreateComputePipelines, VkComputePipelineCreateInfo>;
+        device.vkCreateFence = createHandle<NullDriver::Call_vkCreateFence, VkFenceCreateInfo, VkFence>;
+        device.vkCreateImageView = createHandle<NullDriver::Call_vkCreateImageView, VkImageViewCreateInfo, VkImageView>;
+        device.vkCreateSampler = createHandle<NullDriver::Call_vkCreateSampler, VkSamplerCreateInfo, VkSampler>;
+        device.vkCreateShaderModule = createHandle<NullDriver::Call_vkCreateShaderModule, VkShaderModuleCreateInfo, VkShaderModule>;
+        device.vkCreatePipelineCache = createHandle<NullDriver::Call_vkCreatePipelineCache, VkPipelineCacheCreateInfo, VkPipelineCache>;
+        device.vkCreatePipelineLayout = createHandle<NullDriver::Call_vkCreatePipelineLayout, VkPipelineLayoutCreateInfo, VkPipelineLayout>;
+        device.vkCreateDescriptorSetLayout = createHandle<NullDriver::Call_vkCreateDescriptorSetLayout, VkDescriptorSetLayoutCreateInfo, VkDescriptorSetLayout>;
+        device.vkCreateDescriptorPool = createHandle<NullDriver::Call_vkCreateDescriptorPool, VkDescriptorPoolCreateInfo, VkDescriptorPool>;
+        device.vkCreateRenderPass = createHandle<NullDriver::Call_vkCreateRenderPass, VkRenderPassCreateInfo, VkRenderPass>;
+        device.vkCreateFramebuffer = createHandle<NullDriver::Call_vkCreateFramebuffer, VkFramebufferCreateInfo, VkFramebuffer>;
+        device.vkCreateQueryPool = createHandle<NullDriver::Call_vkCreateQueryPool, VkQueryPoolCreateInfo, VkQueryPool>;
+        device.vkCreateCommandPool = createHandle<NullDriver::Call_vkCreateCommandPool, VkCommandPoolCreateInfo, VkCommandPool>;
+    }
+};
+
+const Tables& tables()
+{
+    static const Tables sTables;
+    return sTables;
+}
+
+PFN_vkVoidFunction deviceFunction(const char* name)
+{
+    const VulkanDeviceFunctions& device = tables().device;
+#define GRAPHIC_NULL_DRIVER_LOOKUP(fn) if (strcmp(name, #fn) == 0) { return reinterpret_cast<PFN_vkVoidFunction>(device.fn); }
+    GRAPHIC_VK_DEVICE_FUNCTIONS(GRAPHIC_NULL_DRIVER_LOOKUP)
+#undef GRAPHIC_NULL_DRIVER_LOOKUP
+    return nullptr; // extensions and Vulkan > 1.0 are not available
+}
+
+PFN_vkVoidFunction VKAPI_CALL getDeviceProcAddr(VkDevice, const char* name)
+{
+    count(NullDriver::Call_vkGetDeviceProcAddr);
+    return deviceFunction(name);
+}
+
+}
+
+//
+// NullDriver
+//
+
+NullDriver::Counters::Counters()
+{
+    std::fill(std::begin(calls), std::end(calls), 0);
+}
+
+uint64_t NullDriver::Counters::binds() const
+{
+    return calls[Call_vkCmdBindPipeline] + calls[Call_vkCmdBindDescriptorSets]
+         + calls[Call_vkCmdBindVertexBuffers] + calls[Call_vkCmdBindIndexBuffer];
+}
+
+uint64_t NullDriver::Counters::draws() const
+{
+    return calls[Call_vkCmdDraw] + calls[Call_vkCmdDrawIndexed] + calls[Call_vkCmdDrawIndexedIndirect];
+}
+
+uint64_t NullDriver::Counters::dispatches() const
+{
+    return calls[Call_vkCmdDispatch];
+}
+
+uint64_t NullDriver::Counters::allocations() const
+{
+    return calls[Call_vkAllocateMemory] + calls[Call_vkAllocateDescriptorSets] + calls[Call_vkAllocateCommandBuffers];
+}
+
+uint64_t NullDriver::Counters::total() const
+{
+    uint64_t sum = 0;
+    for (uint64_t callCount : calls) {
+        sum += callCount;
+    }
+    return sum;
+}
+
+PFN_vkVoidFunction VKAPI_CALL NullDriver::getInstanceProcAddr(VkInstance /*instance*/, const char* name)
+{
+    if (strcmp(name, "vkGetInstanceProcAddr") == 0) {
+        return reinterpret_cast<PFN_vkVoidFunction>(&NullDriver::getInstanceProcAddr);
+    }
+    if (strcmp(name, "vkCreateInstance") == 0) {
+        return reinterpret_cast<PFN_vkVoidFunction>(createInstance);
+    }
+    if (strcmp(name, "vkEnumerateInstanceExtensionProperties") == 0) {
+        return reinterpret_cast<PFN_vkVoidFunction>(enumerateInstanceExtensionProperties);
+    }
+    if (strcmp(name, "vkEnumerateInstanceLayerProperties") == 0) {
+        return reinterpret_cast<PFN_vkVoidFunction>(enumerateInstanceLayerProperties);
+    }
+    const VulkanInstanceFunctions& instance = tables().instance;
+#define GRAPHIC_NULL_DRIVER_LOOKUP(fn) if (strcmp(name, #fn) == 0) { return reinterpret_cast<PFN_vkVoidFunction>(instance.fn); }
+    GRAPHIC_VK_INSTANCE_FUNCTIONS(GRAPHIC_NULL_DRIVER_LOOKUP)
+#undef GRAPHIC_NULL_DRIVER_LOOKUP
+    return deviceFunction(name);
+}
+
+void NullDriver::beginFrame()
+{
+    sFrame.reset();
+}
+
+NullDriver::Counters NullDriver::frameCounters()
+{
+    return sFrame.snapshot();
+}
+
+NullDriver::Counters NullDriver::totalCounters()
+{
+    return sTotal.snapshot();
+}
+
+uint64_t NullDriver::liveMemoryAllocations()
+{
+    return sLiveAllocations.load(std::memory_order_relaxed);
+}
+
+const char* NullDriver::callName(Call call)
+{
+    static const char* const sNames[] = {
+#define GRAPHIC_NULL_DRIVER_NAME(name) #name,
+        GRAPHIC_VK_INSTANCE_FUNCTIONS(GRAPHIC_NULL_DRIVER_NAME)
+        GRAPHIC_VK_DEVICE_FUNCTIONS(GRAPHIC_NULL_DRIVER_NAME)
+#undef GRAPHIC_NULL_DRIVER_NAME
+    };
+    return call < CallCount ? sNames[call] : "";
+}
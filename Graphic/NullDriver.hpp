@@ -0,0 +1,75 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include "VulkanFunctions.hpp"
+
+///
+/// Vulkan "driver" which records nothing on GPU - every entry point used by Graphic library only counts calls,
+/// returns fake handles and keeps host memory for mapped allocations. Frame construction (culling, render queue,
+/// descriptor updates, barriers) runs as with a real device, so its CPU cost and API call counts can be measured
+/// on any machine. Use getInstanceProcAddr instead of the loader one, e.g. HeadlessContext::Settings::getInstanceProcAddr.
+/// Only one null device at a time - counters are global. Counting is thread safe (recording threads).
+///
+class NullDriver
+{
+public:
+    enum Call {
+#define GRAPHIC_NULL_DRIVER_CALL(name) Call_##name,
+        GRAPHIC_VK_INSTANCE_FUNCTIONS(GRAPHIC_NULL_DRIVER_CALL)
+        GRAPHIC_VK_DEVICE_FUNCTIONS(GRAPHIC_NULL_DRIVER_CALL)
+#undef GRAPHIC_NULL_DRIVER_CALL
+        CallCount
+    };
+
+    struct Counters {
+        uint64_t calls[CallCount];
+        uint64_t descriptorWrites = 0;   // VkWriteDescriptorSet/VkCopyDescriptorSet in vkUpdateDescriptorSets
+        uint64_t allocatedBytes = 0;     // vkAllocateMemory
+
+        Counters();
+        uint64_t binds() const;          // pipeline, descriptor sets, vertex/index buffers
+        uint64_t draws() const;          // direct and indirect draws
+        uint64_t dispatches() const;
+        uint64_t maps() const { return calls[Call_vkMapMemory]; }
+        uint64_t unmaps() const { return calls[Call_vkUnmapMemory]; }
+        uint64_t allocations() const;    // memory, descriptor sets, command buffers
+        uint64_t total() const;
+    };
+
+    static PFN_vkVoidFunction VKAPI_CALL getInstanceProcAddr(VkInstance instance, const char* name);
+
+    ///
+    /// Start new frame counters - frameCounters() are counted from here.
+    ///
+    static void beginFrame();
+    static Counters frameCounters();
+    static Counters totalCounters(); // since the null instance was created
+
+    static uint64_t liveMemoryAllocations(); // vkAllocateMemory without vkFreeMemory - leak check
+    static const char* callName(Call call);
+};
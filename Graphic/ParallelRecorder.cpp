@@ -0,0 +1,226 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ParallelRecorder.hpp"
+#include "DrawManager.hpp"
+#include "CpuTrace.hpp"
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
+#include <assert.h>
+#include <algorithm>
+#include <string>
+
+ParallelRecorder::ParallelRecorder(VulkanDeviceFunctions* devFuncs, VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight)
+    : mDevFuncs(devFuncs)
+    , mDevice(device)
+    , mQueueFamilyIndex(queueFamilyIndex)
+    , mFramesInFlight(framesInFlight)
+{
+    assert(mDevFuncs && "Device functions should be valid!");
+    assert(mDevice && "Device should be valid!");
+    assert(mFramesInFlight && "At least one frame should be in flight!");
+}
+
+ParallelRecorder::~ParallelRecorder()
+{
+    stopWorkers();
+}
+
+void ParallelRecorder::stopWorkers()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mStartCv.notify_all();
+    for (Worker& worker : mWorkers) {
+        if (worker.thread.joinable()) {
+            worker.thread.join();
+        }
+        for (VkCommandPool pool : worker.pools) {
+            mDevFuncs->vkDestroyCommandPool(mDevice, pool, nullptr); // buffers are freed with pool
+        }
+    }
+    mWorkers.clear();
+    mQuit = false;
+}
+
+void ParallelRecorder::setWorkerCount(uint32_t workerCount)
+{
+    if (workerCount == mWorkers.size()) {
+        return;
+    }
+    stopWorkers();
+
+    mWorkers.resize(workerCount);
+    for (Worker& worker : mWorkers) {
+        worker.pools.resize(mFramesInFlight, nullptr);
+        worker.cmdBufs.resize(mFramesInFlight, nullptr);
+        worker.arena = std::make_shared<FrameArena>();
+        for (uint32_t frameIdx = 0; frameIdx < mFramesInFlight; ++frameIdx) {
+            VkCommandPoolCreateInfo poolInfo = {};
+            poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT; // reset as a whole every frame
+            poolInfo.queueFamilyIndex = mQueueFamilyIndex;
+            VkResult result = mDevFuncs->vkCreateCommandPool(mDevice, &poolInfo, nullptr, &worker.pools[frameIdx]);
+            if (result != VK_SUCCESS) {
+                qWarning("Can't create worker command pool. Result: %i", result);
+                stopWorkers();
+                return;
+            }
+
+            VkCommandBufferAllocateInfo allocateInfo = {};
+            allocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocateInfo.commandPool = worker.pools[frameIdx];
+            allocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocateInfo.commandBufferCount = 1;
+            result = mDevFuncs->vkAllocateCommandBuffers(mDevice, &allocateInfo, &worker.cmdBufs[frameIdx]);
+            if (result != VK_SUCCESS) {
+                qWarning("Can't allocate worker command buffer. Result: %i", result);
+                stopWorkers();
+                return;
+            }
+        }
+    }
+
+    // Generation is taken before threads start - record() called right after this may bump it before
+    // a new thread runs, the thread would then wait for the next generation and record() would never finish
+    uint64_t startGeneration = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        startGeneration = mGeneration;
+    }
+    for (uint32_t workerIdx = 0; workerIdx < mWorkers.size(); ++workerIdx) {
+        mWorkers[workerIdx].thread = std::thread(&ParallelRecorder::workerLoop, this, workerIdx, startGeneration);
+    }
+    qInfo("Parallel recorder workers: %d", workerCount);
+}
+
+uint32_t ParallelRecorder::record(DrawManager* drawMgr, size_t itemCount, const RecordChunkFunc& recordChunk)
+{
+    assert(drawMgr);
+    assert(drawMgr->getRenderPass() && "Secondary command buffers have to know render pass!");
+    assert(drawMgr->getCurrentFrame() < mFramesInFlight);
+    if (mWorkers.empty() || itemCount == 0) {
+        return 0;
+    }
+
+    // Do not wake more workers than it is worth
+    size_t maxChunks = std::max<size_t>(1, itemCount / MinItemsPerChunk);
+    uint32_t chunkCount = static_cast<uint32_t>(std::min<size_t>(mWorkers.size(), maxChunks));
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRecordChunkFunc = &recordChunk;
+        mFrameDrawMgr = drawMgr;
+        mItemCount = itemCount;
+        mChunkCount = chunkCount;
+        mPending = chunkCount;
+        ++mGeneration;
+    }
+    mStartCv.notify_all();
+
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDoneCv.wait(lock, [this]() { return mPending == 0; });
+        mRecordChunkFunc = nullptr;
+        mFrameDrawMgr = nullptr;
+    }
+
+    //
+    // Secondaries are executed in chunk order - the same order as items were sorted
+    //
+    uint32_t frameIdx = drawMgr->getCurrentFrame();
+    FrameVector<VkCommandBuffer> secondaries = makeFrameVector<VkCommandBuffer>(drawMgr->frameArena(), chunkCount, nullptr);
+    for (uint32_t chunkIdx = 0; chunkIdx < chunkCount; ++chunkIdx) {
+        secondaries[chunkIdx] = mWorkers[chunkIdx].cmdBufs[frameIdx];
+    }
+    mDevFuncs->vkCmdExecuteCommands(drawMgr->getCmdBuffer(), chunkCount, secondaries.data());
+    return chunkCount;
+}
+
+void ParallelRecorder::workerLoop(uint32_t workerIdx, uint64_t startGeneration)
+{
+#ifdef GRAPHIC_TRACE
+    CpuTrace::setThreadName(("Recorder " + std::to_string(workerIdx)).c_str());
+#endif
+    uint64_t seenGeneration = startGeneration;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStartCv.wait(lock, [this, seenGeneration]() { return mQuit || mGeneration != seenGeneration; });
+            if (mQuit) {
+                return;
+            }
+            seenGeneration = mGeneration;
+            if (workerIdx >= mChunkCount) {
+                continue; // not needed in this frame
+            }
+        }
+
+        recordChunk(workerIdx);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mPending == 0) {
+                mDoneCv.notify_one();
+            }
+        }
+    }
+}
+
+void ParallelRecorder::recordChunk(uint32_t workerIdx)
+{
+    uint32_t frameIdx = mFrameDrawMgr->getCurrentFrame();
+    Worker& worker = mWorkers[workerIdx];
+    VkCommandBuffer cmdBuf = worker.cmdBufs[frameIdx];
+
+    // Frame slot is reused only after its fence was signaled, so whole pool can be reset
+    mDevFuncs->vkResetCommandPool(mDevice, worker.pools[frameIdx], 0);
+
+    VkCommandBufferInheritanceInfo inheritanceInfo = {};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.renderPass = mFrameDrawMgr->getRenderPass();
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = mFrameDrawMgr->getFramebuffer();
+
+    VkCommandBufferBeginInfo beginInfo = {};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+    mDevFuncs->vkBeginCommandBuffer(cmdBuf, &beginInfo);
+
+    size_t first = mItemCount * workerIdx / mChunkCount;
+    size_t last = mItemCount * (workerIdx + 1) / mChunkCount;
+
+    DrawManager workerDrawMgr = *mFrameDrawMgr;
+    workerDrawMgr.setCmdBuffer(cmdBuf);
+    worker.arena->reset();
+    workerDrawMgr.setFrameArena(worker.arena);
+    workerDrawMgr.setGpuProfiler(nullptr); // profiler scopes are recorded only to primary command buffer
+    (*mRecordChunkFunc)(first, last, &workerDrawMgr, workerIdx);
+
+    mDevFuncs->vkEndCommandBuffer(cmdBuf);
+}
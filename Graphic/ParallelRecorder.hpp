@@ -0,0 +1,106 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class DrawManager;
+class FrameArena;
+struct VulkanDeviceFunctions;
+
+///
+/// Pool of worker threads recording secondary command buffers.
+/// Each worker has its own command pool per frame in flight, so pools are never shared between threads.
+///
+class ParallelRecorder
+{
+public:
+    ///
+    /// first, last - range of items [first, last) to record
+    /// drawMgr - copy of frame DrawManager with worker's secondary command buffer
+    /// chunkIdx - index of the range, the same as worker index
+    ///
+    typedef std::function<void(size_t first, size_t last, DrawManager* drawMgr, uint32_t chunkIdx)> RecordChunkFunc;
+
+    ParallelRecorder(VulkanDeviceFunctions* devFuncs, VkDevice device, uint32_t queueFamilyIndex, uint32_t framesInFlight);
+    ~ParallelRecorder();
+
+    ///
+    /// 0 - no workers, record() should not be used (caller records inline)
+    /// Device has to be idle for current frames - command pools are recreated.
+    ///
+    void setWorkerCount(uint32_t workerCount);
+    uint32_t workerCount() const { return static_cast<uint32_t>(mWorkers.size()); }
+
+    ///
+    /// Split itemCount items into chunks, record them in parallel and execute secondaries in command buffer of drawMgr.
+    /// Has to be called inside render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+    /// Returns number of chunks used.
+    ///
+    uint32_t record(DrawManager* drawMgr, size_t itemCount, const RecordChunkFunc& recordChunk);
+
+    ParallelRecorder(const ParallelRecorder&) = delete;
+    ParallelRecorder& operator=(const ParallelRecorder&) = delete;
+
+protected:
+    struct Worker {
+        std::thread thread;
+        std::vector<VkCommandPool> pools;      // [frame]
+        std::vector<VkCommandBuffer> cmdBufs;  // [frame] - secondary
+        std::shared_ptr<FrameArena> arena;     // scratch memory of worker's DrawManager, reset every chunk
+    };
+
+    void workerLoop(uint32_t workerIdx, uint64_t startGeneration);
+    void recordChunk(uint32_t workerIdx);
+    void stopWorkers();
+
+    static const size_t MinItemsPerChunk = 64;
+
+    std::vector<Worker> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mStartCv;
+    std::condition_variable mDoneCv;
+    uint64_t mGeneration = 0;
+    uint32_t mPending = 0;
+    bool mQuit = false;
+
+    // Current job - valid only during record()
+    const RecordChunkFunc* mRecordChunkFunc = nullptr;
+    DrawManager* mFrameDrawMgr = nullptr;
+    size_t mItemCount = 0;
+    uint32_t mChunkCount = 0;
+
+    VulkanDeviceFunctions* mDevFuncs;
+    VkDevice mDevice;
+    uint32_t mQueueFamilyIndex;
+    uint32_t mFramesInFlight;
+};
@@ -23,23 +23,25 @@ SOFTWARE.
 */
 
 #include "PipelineManager.hpp"
-#include <QVulkanInstance>
-#include <QVulkanDeviceFunctions>
+#include "BindlessTextureTable.hpp"
+#include "CpuTrace.hpp"
+#include "VulkanFunctions.hpp"
 #include <fstream>
+#include <algorithm>
 #include <spirv_cross.hpp>
 
-PipelineManager::PipelineManager(QVulkanInstance &vulkanInstance,
+PipelineManager::PipelineManager(VulkanDeviceFunctions *devFuncs,
                                  VkDevice device,
                                  const QSize& frameSize,
                                  uint32_t rasterizationSamples,
                                  VkRenderPass defaultRenderPass)
     : mDevice(device)
+    , mDevFuncs(devFuncs)
     , mFrameSize(frameSize)
     , mRasterizationSamples(rasterizationSamples)
     , mDefaultRenderPass(defaultRenderPass)
 {
     assert(mDevice && "Device should be valid!");
-    mDevFuncs = vulkanInstance.deviceFunctions(mDevice);
     assert(mDevFuncs && "Device functions should be valid!");
 
     qInfo("Creating pipeline manager: %p", this);
@@ -51,12 +53,22 @@ PipelineManager::~PipelineManager()
 
     cleanUpShaders();
 
+    for (const auto& objectPools : mObjectDescriptorPools) {
+        for (VkDescriptorPool pool : objectPools.second.pools) {
+            mDevFuncs->vkDestroyDescriptorPool(mDevice, pool, nullptr);
+        }
+    }
+    mObjectDescriptorPools.clear();
+
     std::for_each(mPipelines.begin(), mPipelines.end(),
                   [this](const decltype(mPipelines)::value_type& pair) { const PipelineInfo& pi = pair.second;
                                                                          mDevFuncs->vkDestroyPipeline(mDevice, pi.pipeline, nullptr);
                                                                          mDevFuncs->vkDestroyPipelineLayout(mDevice, pi.pipelineLayout, nullptr);
                                                                          //mDevFuncs->vkDestroyPipelineCache(mDevice, pi.pipelineCache, nullptr);
                                                                          for (const DescriptorSetInfo& dsi : pi.descriptorSetInfo) {
+                                                                             if (dsi.external) {
+                                                                                 continue;
+                                                                             }
                                                                              mDevFuncs->vkDestroyDescriptorSetLayout(mDevice, dsi.layout, nullptr);
                                                                              mDevFuncs->vkFreeDescriptorSets(mDevice, pi.descriptorPool, 1, &dsi.descriptor);
                                                                          }
@@ -72,6 +84,88 @@ void PipelineManager::cleanUpShaders()
     mShaders.clear();
 }
 
+void PipelineManager::setBindlessTextureTable(const BindlessTextureTable* table)
+{
+    mBindlessTable = table;
+}
+
+bool PipelineManager::allocateDescriptorSets(const PipelineInfo* pipelineInfo, std::vector<VkDescriptorSet>& descriptorSets)
+{
+    assert(pipelineInfo);
+    static const uint32_t objectsPerPool = 64;
+
+    descriptorSets.resize(pipelineInfo->descriptorSetInfo.size());
+    std::vector<VkDescriptorSetLayout> layouts;
+    for (size_t descriptorSetIdx = 0; descriptorSetIdx < pipelineInfo->descriptorSetInfo.size(); ++descriptorSetIdx) {
+        const DescriptorSetInfo& dsi = pipelineInfo->descriptorSetInfo[descriptorSetIdx];
+        descriptorSets[descriptorSetIdx] = dsi.descriptor; // external stays as it is
+        if (!dsi.external) {
+            layouts.push_back(dsi.layout);
+        }
+    }
+    if (layouts.empty()) {
+        return true;
+    }
+
+    ObjectDescriptorPools& objectPools = mObjectDescriptorPools[pipelineInfo];
+    if (objectPools.freeObjectsInLastPool == 0) {
+        //
+        // Pool for next batch of objects - the same proportion of descriptor types as in pipeline pool
+        //
+        std::map<VkDescriptorType, uint32_t> descrTypeToCount;
+        for (const DescriptorSetInfo& dsi : pipelineInfo->descriptorSetInfo) {
+            if (dsi.external) {
+                continue;
+            }
+            for (const BindingInfo& bindingInfo : dsi.bindingInfo) {
+                descrTypeToCount[bindingInfo.vdslbInfo.descriptorType] += bindingInfo.vdslbInfo.descriptorCount * objectsPerPool;
+            }
+        }
+
+        std::vector<VkDescriptorPoolSize> descriptorPoolSizes;
+        for (const auto& pairValue : descrTypeToCount) {
+            descriptorPoolSizes.push_back({pairValue.first, pairValue.second});
+        }
+
+        VkDescriptorPoolCreateInfo descriptorPoolInfo = {};
+        descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descriptorPoolInfo.maxSets = static_cast<uint32_t>(layouts.size()) * objectsPerPool;
+        descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
+        descriptorPoolInfo.pPoolSizes = descriptorPoolSizes.data();
+
+        VkDescriptorPool pool = nullptr;
+        VkResult result = mDevFuncs->vkCreateDescriptorPool(mDevice, &descriptorPoolInfo, nullptr, &pool);
+        if (result != VK_SUCCESS) {
+            qWarning("Failed to create object descriptor pool. Result: %i", result);
+            return false;
+        }
+        objectPools.pools.push_back(pool);
+        objectPools.freeObjectsInLastPool = objectsPerPool;
+    }
+
+    std::vector<VkDescriptorSet> descriptors(layouts.size());
+    VkDescriptorSetAllocateInfo allocateInfo = {};
+    allocateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocateInfo.descriptorPool = objectPools.pools.back();
+    allocateInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+    allocateInfo.pSetLayouts = layouts.data();
+
+    VkResult result = mDevFuncs->vkAllocateDescriptorSets(mDevice, &allocateInfo, descriptors.data());
+    if (result != VK_SUCCESS) {
+        qWarning("Can't allocate object descriptor sets. Result: %i", result);
+        return false;
+    }
+    --objectPools.freeObjectsInLastPool;
+
+    size_t descriptorCtr = 0;
+    for (size_t descriptorSetIdx = 0; descriptorSetIdx < descriptorSets.size(); ++descriptorSetIdx) {
+        if (!pipelineInfo->descriptorSetInfo[descriptorSetIdx].external) {
+            descriptorSets[descriptorSetIdx] = descriptors[descriptorCtr++];
+        }
+    }
+    return true;
+}
+
 /*
 #include <libshaderc/shaderc.hpp>
 
@@ -260,11 +354,22 @@ static void fillShaderInput(const std::string& shaderPath,
 {
     auto separatedParam = parameters.find(PipelineManager::ApSeparatedAttributes);
     bool isSeparate = separatedParam == parameters.end() ? false : separatedParam->second.toBool();
+    auto instanceParam = parameters.find(PipelineManager::ApInstanceAttributesFromLocation);
+    uint32_t instanceFromLocation = instanceParam == parameters.end() ? ~0u : instanceParam->second.toUInt();
+
+    // Attributes are laid out in buffers in location order
+    std::vector<spirv_cross::Resource> stageInputs(resources.stage_inputs.begin(), resources.stage_inputs.end());
+    std::sort(stageInputs.begin(), stageInputs.end(), [&resourcesCtx](const spirv_cross::Resource& a, const spirv_cross::Resource& b) {
+        return resourcesCtx.get_decoration(a.id, spv::DecorationLocation) < resourcesCtx.get_decoration(b.id, spv::DecorationLocation);
+    });
+
+    std::vector<VkVertexInputAttributeDescription> instanceAtrDesc;
+    uint32_t instanceStructureSize = 0;
     uint32_t inputStructureSize = 0;
     uint32_t bindCtr = 0;
     uint32_t offset = 0;
-    for (uint32_t i = 0; i < resources.stage_inputs.size(); ++i) {
-        const spirv_cross::Resource& inputRes = resources.stage_inputs[i];
+    for (uint32_t i = 0; i < stageInputs.size(); ++i) {
+        const spirv_cross::Resource& inputRes = stageInputs[i];
         spirv_cross::SPIRType variableType = resourcesCtx.get_type(inputRes.type_id);
 
         uint32_t location = resourcesCtx.get_decoration(inputRes.id, spv::DecorationLocation);
@@ -281,8 +386,21 @@ static void fillShaderInput(const std::string& shaderPath,
             continue;
         }
 
+        //
+        // Per instance - all instance inputs are interleaved in one binding placed after vertex bindings.
+        // Matrix takes one location per column.
+        //
+        if (location >= instanceFromLocation) {
+            uint32_t columnSize = variableSize / variableType.columns;
+            for (uint32_t column = 0; column < variableType.columns; ++column) {
+                instanceAtrDesc.push_back({location + column, 0, variableFormat, instanceStructureSize});
+                instanceStructureSize += columnSize;
+            }
+            continue;
+        }
+
         if (isSeparate) {
-            vertexBindings.push_back({i, variableSize, VK_VERTEX_INPUT_RATE_VERTEX});
+            vertexBindings.push_back({bindCtr, variableSize, VK_VERTEX_INPUT_RATE_VERTEX});
         }
         else {
             inputStructureSize += variableSize;
@@ -300,6 +418,14 @@ static void fillShaderInput(const std::string& shaderPath,
     if (!isSeparate && inputStructureSize) {
         vertexBindings.push_back({0, inputStructureSize, VK_VERTEX_INPUT_RATE_VERTEX});
     }
+    if (instanceStructureSize) {
+        uint32_t instanceBinding = static_cast<uint32_t>(vertexBindings.size());
+        vertexBindings.push_back({instanceBinding, instanceStructureSize, VK_VERTEX_INPUT_RATE_INSTANCE});
+        for (VkVertexInputAttributeDescription& atrDesc : instanceAtrDesc) {
+            atrDesc.binding = instanceBinding;
+            vertexAtrDesc.push_back(atrDesc);
+        }
+    }
 }
 
 static void fillUniformInfo(const std::string& shaderPath,
@@ -407,7 +533,12 @@ static void fillSamlerInfo(const std::string& shaderPath,
         uint32_t descriptorSet = resourcesCtx.get_decoration(sampledRes.id, spv::DecorationDescriptorSet);
 
         uint32_t arraySize = 1;
+        bool unsizedArray = false;
         for (uint32_t j = 0; j < variableType.array.size(); ++j) {
+            if (variableType.array[j] == 0) { // runtime array e.g. sampler2D textures[]
+                unsizedArray = true;
+                continue;
+            }
             arraySize += arraySize * variableType.array[j];
         }
 
@@ -422,7 +553,7 @@ static void fillSamlerInfo(const std::string& shaderPath,
         //
         bindingInfo.vdslbInfo.binding = binding; //start from binding
         bindingInfo.vdslbInfo.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        bindingInfo.vdslbInfo.descriptorCount = arraySize; // for arrays
+        bindingInfo.vdslbInfo.descriptorCount = unsizedArray ? 0 : arraySize; // for arrays, 0 - unsized array served by BindlessTextureTable
         bindingInfo.vdslbInfo.stageFlags = stage;
         bindingInfo.vdslbInfo.pImmutableSamplers = nullptr;
 
@@ -434,6 +565,76 @@ static void fillSamlerInfo(const std::string& shaderPath,
     }
 }
 
+static void fillStorageInfo(VkShaderStageFlagBits stage,
+                            const spirv_cross::Compiler& resourcesCtx,
+                            const spirv_cross::ShaderResources& resources,
+                            std::vector<std::vector<PipelineManager::BindingInfo>>& descriptorSetsSpecifications)
+{
+    for (uint32_t i = 0; i < resources.storage_buffers.size(); ++i) {
+        const spirv_cross::Resource& storageRes = resources.storage_buffers[i];
+        spirv_cross::SPIRType variableType = resourcesCtx.get_type(storageRes.type_id);
+
+        uint32_t binding = resourcesCtx.get_decoration(storageRes.id, spv::DecorationBinding); //if not parameter provided then 0
+        uint32_t descriptorSet = resourcesCtx.get_decoration(storageRes.id, spv::DecorationDescriptorSet);
+
+        if (descriptorSetsSpecifications.size() <= descriptorSet) {
+            descriptorSetsSpecifications.resize(descriptorSet + 1); // assume that there will be no empty descriptor set, if not then change it on the map
+        }
+        descriptorSetsSpecifications[descriptorSet].push_back(PipelineManager::BindingInfo());
+        PipelineManager::BindingInfo& bindingInfo = descriptorSetsSpecifications[descriptorSet].back();
+
+        bindingInfo.vdslbInfo.binding = binding;
+        bindingInfo.vdslbInfo.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindingInfo.vdslbInfo.descriptorCount = 1;
+        bindingInfo.vdslbInfo.stageFlags = stage;
+        bindingInfo.vdslbInfo.pImmutableSamplers = nullptr;
+        // Minimal size - runtime array at the end of the block (e.g. Chunk chunks[]) is counted as empty
+        bindingInfo.byteSize = resourcesCtx.get_declared_struct_size(variableType);
+
+        qInfo("Storage: %s id:%d type:%d base:%d minSize:%d binding:%d descriptorSet:%d"
+              , storageRes.name.c_str(), storageRes.id, storageRes.type_id, storageRes.base_type_id
+              , static_cast<uint32_t>(bindingInfo.byteSize)
+              , binding
+              , descriptorSet);
+    }
+}
+
+static void fillPushConstantInfo(VkShaderStageFlagBits stage,
+                                 const spirv_cross::Compiler& resourcesCtx,
+                                 const spirv_cross::ShaderResources& resources,
+                                 std::vector<VkPushConstantRange>& pushConstantRanges)
+{
+    for (uint32_t i = 0; i < resources.push_constant_buffers.size(); ++i) {
+        const spirv_cross::Resource& pushConstantRes = resources.push_constant_buffers[i];
+        spirv_cross::SPIRType variableType = resourcesCtx.get_type(pushConstantRes.type_id);
+
+        uint32_t offset = ~0u;
+        for (uint32_t j = 0; j < variableType.member_types.size(); ++j) {
+            offset = std::min(offset, resourcesCtx.type_struct_member_offset(variableType, j));
+        }
+        offset = offset == ~0u ? 0 : offset;
+        uint32_t size = static_cast<uint32_t>(resourcesCtx.get_declared_struct_size(variableType)) - offset;
+
+        pushConstantRanges.push_back({static_cast<VkShaderStageFlags>(stage), offset, size});
+
+        qInfo("Push constant: %s id:%d offset:%d size:%d"
+              , pushConstantRes.name.c_str(), pushConstantRes.id
+              , offset
+              , size);
+    }
+}
+
+static bool isBindlessSet(const std::vector<PipelineManager::BindingInfo>& bindings)
+{
+    for (const PipelineManager::BindingInfo& bindingInfo : bindings) {
+        if (bindingInfo.vdslbInfo.descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+         && bindingInfo.vdslbInfo.descriptorCount == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 static const PipelineManager::DescriptorSetsSpecifications EMPTY_DESCR_SETS_SPEC;
 
 template <VkDescriptorType descrType>
@@ -445,6 +646,9 @@ const PipelineManager::DescriptorSetsSpecifications& PipelineManager::getDescrip
     else if (descrType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) {
         return shaderInfos.samplerInfo.descriptorSetsSpecifications;
     }
+    else if (descrType == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) {
+        return shaderInfos.storageInfo.descriptorSetsSpecifications;
+    }
     return EMPTY_DESCR_SETS_SPEC;
 }
 
@@ -522,7 +726,8 @@ bool PipelineManager::createLayoutAndPoolForDescriptorSets(const std::vector<con
     //
     size_t maxUniformDescrSets = getMaxDescriptorSet<VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER>(shaderInfos);
     size_t maxSamplerDescrSets = getMaxDescriptorSet<VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER>(shaderInfos);
-    size_t maxDescriptorSets = std::max(maxUniformDescrSets, maxSamplerDescrSets);
+    size_t maxStorageDescrSets = getMaxDescriptorSet<VK_DESCRIPTOR_TYPE_STORAGE_BUFFER>(shaderInfos);
+    size_t maxDescriptorSets = std::max(std::max(maxUniformDescrSets, maxSamplerDescrSets), maxStorageDescrSets);
 
     //
     // Pick max size to not doing unnecessary reallocations for binding level
@@ -530,6 +735,7 @@ bool PipelineManager::createLayoutAndPoolForDescriptorSets(const std::vector<con
     std::vector<size_t> maxBindings(maxDescriptorSets);
     fillMaxDescriptorSetBindings<VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER>(shaderInfos, maxBindings);
     fillMaxDescriptorSetBindings<VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER>(shaderInfos, maxBindings);
+    fillMaxDescriptorSetBindings<VK_DESCRIPTOR_TYPE_STORAGE_BUFFER>(shaderInfos, maxBindings);
 
     //
     // Allocate memory
@@ -545,6 +751,7 @@ bool PipelineManager::createLayoutAndPoolForDescriptorSets(const std::vector<con
     //
     fillDescriptorSetBindingsInfo<VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER>(shaderInfos, allShadersDescrSetsSpecs);
     fillDescriptorSetBindingsInfo<VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER>(shaderInfos, allShadersDescrSetsSpecs);
+    fillDescriptorSetBindingsInfo<VK_DESCRIPTOR_TYPE_STORAGE_BUFFER>(shaderInfos, allShadersDescrSetsSpecs);
 
     pipelineInfo.descriptorSetInfo.resize(allShadersDescrSetsSpecs.size());
     for (size_t i = 0; i < allShadersDescrSetsSpecs.size(); ++i) {
@@ -554,8 +761,24 @@ bool PipelineManager::createLayoutAndPoolForDescriptorSets(const std::vector<con
     //
     // Create descriptor set LAYOUTs
     //
-    std::vector<VkDescriptorSetLayout> layouts(allShadersDescrSetsSpecs.size());
+    std::vector<VkDescriptorSetLayout> layouts; // only sets owned by pipeline
     for (size_t descriptorSetIdx = 0; descriptorSetIdx < allShadersDescrSetsSpecs.size(); ++descriptorSetIdx) {
+        if (isBindlessSet(allShadersDescrSetsSpecs[descriptorSetIdx])) {
+            if (!mBindlessTable) {
+                qWarning("Shader uses unsized sampler array (set = %d) but there is no bindless texture table!", static_cast<uint32_t>(descriptorSetIdx));
+                return false;
+            }
+            if (allShadersDescrSetsSpecs[descriptorSetIdx].size() != 1) {
+                qWarning("Bindless descriptor set (set = %d) should contain only one binding!", static_cast<uint32_t>(descriptorSetIdx));
+                return false;
+            }
+            DescriptorSetInfo& dsi = pipelineInfo.descriptorSetInfo[descriptorSetIdx];
+            dsi.layout = mBindlessTable->getLayout();
+            dsi.descriptor = mBindlessTable->getDescriptorSet();
+            dsi.external = true;
+            continue;
+        }
+
         std::vector<VkDescriptorSetLayoutBinding> bindings(allShadersDescrSetsSpecs[descriptorSetIdx].size());
         for (size_t bindingIdx = 0; bindingIdx < bindings.size(); ++bindingIdx) {
             bindings[bindingIdx] = allShadersDescrSetsSpecs[descriptorSetIdx][bindingIdx].vdslbInfo;
@@ -571,7 +794,12 @@ bool PipelineManager::createLayoutAndPoolForDescriptorSets(const std::vector<con
             qFatal("Failed to create pipeline layout. Result: %i", result);
             return false;
         }
-        layouts[descriptorSetIdx] = pipelineInfo.descriptorSetInfo[descriptorSetIdx].layout;
+        layouts.push_back(pipelineInfo.descriptorSetInfo[descriptorSetIdx].layout);
+    }
+
+    pipelineInfo.descriptorPool = nullptr;
+    if (layouts.empty()) {
+        return true; // nothing to allocate by pipeline
     }
 
     //
@@ -579,6 +807,9 @@ bool PipelineManager::createLayoutAndPoolForDescriptorSets(const std::vector<con
     //
     std::map<VkDescriptorType, uint32_t> descrTypeToCount;
     for (size_t descriptorSetIdx = 0; descriptorSetIdx < allShadersDescrSetsSpecs.size(); ++descriptorSetIdx) {
+        if (pipelineInfo.descriptorSetInfo[descriptorSetIdx].external) {
+            continue;
+        }
         for (size_t bindingIdx = 0; bindingIdx < allShadersDescrSetsSpecs[descriptorSetIdx].size(); ++bindingIdx) {
             const VkDescriptorSetLayoutBinding& dslbInfo = allShadersDescrSetsSpecs[descriptorSetIdx][bindingIdx].vdslbInfo;
             descrTypeToCount[dslbInfo.descriptorType] += dslbInfo.descriptorCount;
@@ -596,7 +827,7 @@ bool PipelineManager::createLayoutAndPoolForDescriptorSets(const std::vector<con
     VkDescriptorPoolCreateInfo descriptorPoolInfo = {};
     descriptorPoolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     //maxSets is the maximum number of descriptor sets that can be allocated from the pool.
-    descriptorPoolInfo.maxSets = static_cast<uint32_t>(pipelineInfo.descriptorSetInfo.size());
+    descriptorPoolInfo.maxSets = static_cast<uint32_t>(layouts.size());
     descriptorPoolInfo.poolSizeCount = static_cast<uint32_t>(descriptorPoolSizes.size());
     descriptorPoolInfo.pPoolSizes = descriptorPoolSizes.data();
 
@@ -622,19 +853,52 @@ bool PipelineManager::createLayoutAndPoolForDescriptorSets(const std::vector<con
         return false;
     }
 
-    for (size_t i = 0; i < descriptors.size(); ++i) {
-        pipelineInfo.descriptorSetInfo[i].descriptor = descriptors[i];
+    size_t descriptorCtr = 0;
+    for (size_t i = 0; i < pipelineInfo.descriptorSetInfo.size(); ++i) {
+        if (!pipelineInfo.descriptorSetInfo[i].external) {
+            pipelineInfo.descriptorSetInfo[i].descriptor = descriptors[descriptorCtr++];
+        }
     }
 
     return true;
 }
 
+std::string PipelineManager::parametersKey(const std::map<AdditionalParameters, QVariant> &parameters, bool shaderParametersOnly)
+{
+    std::string key;
+    for (const auto& parameter : parameters) {
+        if (shaderParametersOnly && !isShaderParameter(parameter.first)) {
+            continue;
+        }
+        key += "|" + std::to_string(parameter.first) + "=" + parameter.second.toString().toStdString();
+    }
+    return key;
+}
+
+bool PipelineManager::isShaderParameter(AdditionalParameters parameter)
+{
+    switch (parameter) {
+    case ApSeparatedAttributes:
+    case ApInstanceAttributesFromLocation:
+        return true;
+    case ApRenderPass:
+    case ApColorAttachmentCount:
+    case ApRasterizationSamples:
+    case ApPrimitiveTopology:
+        break;
+    }
+    return false;
+}
+
 const PipelineManager::ShaderInfo* PipelineManager::getShader(const std::string& shaderPath, VkShaderStageFlagBits stage, const std::map<AdditionalParameters, QVariant> &parameters)
 {
-    auto foundIt = mShaders.find(shaderPath);
+    // Parameters change reflected input layout - the same shader file can be used with different parameters
+    std::string key = shaderPath + parametersKey(parameters, true);
+    auto foundIt = mShaders.find(key);
     if (foundIt != mShaders.end()) {
         return &foundIt->second;
     }
+    TRACE_SCOPE("PipelineManager::getShader"); // load and reflection - only not cached shaders
 
     std::ifstream ifs;
     ifs.open(shaderPath, std::ios::in | std::ios::binary);
@@ -671,7 +935,7 @@ const PipelineManager::ShaderInfo* PipelineManager::getShader(const std::string&
         qInfo("Failed to create shader module. Result: %i", result);
         return nullptr;
     }
-    auto inserted = mShaders.insert(std::make_pair(shaderPath, ShaderInfo()));
+    auto inserted = mShaders.insert(std::make_pair(key, ShaderInfo()));
     if (!inserted.second) {
         return nullptr;
     }
@@ -709,6 +973,14 @@ const PipelineManager::ShaderInfo* PipelineManager::getShader(const std::string&
     // Samplers
     //
     fillSamlerInfo(shaderPath, stage, glsl, resources, shaderInfo->samplerInfo.descriptorSetsSpecifications);
+    //
+    // Storage buffers
+    //
+    fillStorageInfo(stage, glsl, resources, shaderInfo->storageInfo.descriptorSetsSpecifications);
+    //
+    // Push constants
+    //
+    fillPushConstantInfo(stage, glsl, resources, shaderInfo->pushConstantRanges);
 
     return shaderInfo;
 }
@@ -720,12 +992,14 @@ const PipelineManager::PipelineInfo* PipelineManager::getPipeline(const std::str
                                                                   const std::string& fragmentShaderPath,
                                                                   const std::map<AdditionalParameters, QVariant> &parameters)
 {
-    std::string key = vertexShaderPath + tesselationControlShaderPath + tesselationEvaluationShaderPath + geometryShaderPath + fragmentShaderPath;
+    std::string key = vertexShaderPath + tesselationControlShaderPath + tesselationEvaluationShaderPath + geometryShaderPath + fragmentShaderPath
+                    + parametersKey(parameters);
 
     auto foundIt = mPipelines.find(key);
     if (foundIt != mPipelines.end()) {
         return &foundIt->second;
     }
+    TRACE_SCOPE("PipelineManager::getPipeline");
 
     VkResult result = VK_SUCCESS;
 
@@ -746,6 +1020,7 @@ const PipelineManager::PipelineInfo* PipelineManager::getPipeline(const std::str
     PipelineInfo pipelineInfo;
 
     createLayoutAndPoolForDescriptorSets(shaderInfos, pipelineInfo);
+    createPipelineLayout(shaderInfos, pipelineInfo);
 
     //
     // Shaders to stages
@@ -777,12 +1052,14 @@ const PipelineManager::PipelineInfo* PipelineManager::getPipeline(const std::str
     //
     // Topology
     //
-    static const VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo =
+    auto topologyIt = parameters.find(ApPrimitiveTopology);
+    VkPrimitiveTopology topology = topologyIt != parameters.end() ? VkPrimitiveTopology(topologyIt->second.toUInt()) : VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    const VkPipelineInputAssemblyStateCreateInfo inputAssemblyStateCreateInfo =
     {
         VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,// sType
         nullptr,                                                    // pNext
         0,                                                          // flags
-        VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,                        // topology
+        topology,                                                   // topology
         VK_FALSE                                                    // primitiveRestartEnable
     };
 
@@ -830,11 +1107,13 @@ const PipelineManager::PipelineInfo* PipelineManager::getPipeline(const std::str
     //
     // Multisample
     //
-    static const VkPipelineMultisampleStateCreateInfo multisampleState = {
+    auto samplesIt = parameters.find(ApRasterizationSamples);
+    uint32_t rasterizationSamples = samplesIt != parameters.end() ? samplesIt->second.toUInt() : mRasterizationSamples;
+    const VkPipelineMultisampleStateCreateInfo multisampleState = {
         VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO, // sType;
         nullptr,                       // pNext;
         0,                             // flags;
-        VkSampleCountFlagBits(mRasterizationSamples),  // rasterizationSamples;
+        VkSampleCountFlagBits(rasterizationSamples),  // rasterizationSamples;
         VK_FALSE,                      // sampleShadingEnable;
         0.f,//1.0f,                    // minSampleShading;
         nullptr,                       // pSampleMask;
@@ -911,37 +1190,20 @@ const PipelineManager::PipelineInfo* PipelineManager::getPipeline(const std::str
         | VK_COLOR_COMPONENT_A_BIT           // colorWriteMask;
     };
 
-    static const VkPipelineColorBlendStateCreateInfo colorBlendState = {
+    auto colorAttachmentsIt = parameters.find(ApColorAttachmentCount);
+    uint32_t colorAttachmentCount = colorAttachmentsIt != parameters.end() ? colorAttachmentsIt->second.toUInt() : 1;
+    std::vector<VkPipelineColorBlendAttachmentState> colorAttachments(colorAttachmentCount, takeSrcColorAttachment);
+    const VkPipelineColorBlendStateCreateInfo colorBlendState = {
         VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO, // sType;
         nullptr,                    // pNext;
         0,                          // flags;
         VK_FALSE,                   // logicOpEnable;
         VK_LOGIC_OP_COPY,           // logicOp;
-        1,                          // attachmentCount;
-        &takeSrcColorAttachment,    // pAttachments;
+        colorAttachmentCount,       // attachmentCount;
+        colorAttachments.data(),    // pAttachments;
         {0.0f, 0.0f, 0.0f, 0.0f}    // blendConstants[4];
     };
 
-    //
-    // Pipeline layout - Uniforms, Samplers
-    //
-    std::vector<VkDescriptorSetLayout> descriptorSetlayouts(pipelineInfo.descriptorSetInfo.size());
-    for (size_t descriptorSetIdx = 0; descriptorSetIdx < descriptorSetlayouts.size(); ++descriptorSetIdx) {
-        descriptorSetlayouts[descriptorSetIdx] = pipelineInfo.descriptorSetInfo[descriptorSetIdx].layout;
-    }
-
-    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetlayouts.size());  // Optional
-    pipelineLayoutInfo.pSetLayouts = descriptorSetlayouts.data();                            // Optional
-    pipelineLayoutInfo.pushConstantRangeCount = 0;    // Optional
-    pipelineLayoutInfo.pPushConstantRanges = nullptr; // Optional
-
-    result = mDevFuncs->vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &pipelineInfo.pipelineLayout);
-    if (result != VK_SUCCESS) {
-        qFatal("Failed to create pipeline layout. Result: %i", result);
-    }
-
     //
     // Dynamic state e.g. dynamic viewport
     //
@@ -968,7 +1230,10 @@ const PipelineManager::PipelineInfo* PipelineManager::getPipeline(const std::str
     graphicsPipelineCreateInfo.pDynamicState = nullptr;//&dynamicStateInfo;         // Optional
 
     graphicsPipelineCreateInfo.layout = pipelineInfo.pipelineLayout;
-    graphicsPipelineCreateInfo.renderPass = mDefaultRenderPass;
+    auto renderPassIt = parameters.find(ApRenderPass);
+    graphicsPipelineCreateInfo.renderPass = renderPassIt != parameters.end()
+                                          ? reinterpret_cast<VkRenderPass>(static_cast<uintptr_t>(renderPassIt->second.toULongLong()))
+                                          : mDefaultRenderPass;
     graphicsPipelineCreateInfo.subpass = 0;
     graphicsPipelineCreateInfo.basePipelineHandle = nullptr;
     graphicsPipelineCreateInfo.basePipelineIndex = -1;
@@ -992,3 +1257,90 @@ const PipelineManager::PipelineInfo* PipelineManager::getPipeline(const std::str
     return (inserted.second ? &inserted.first->second : nullptr);
 }
 
+bool PipelineManager::createPipelineLayout(const std::vector<const ShaderInfo *> &shaderInfos,
+                                           PipelineInfo &pipelineInfo)
+{
+    //
+    // Push constants - the same range used in a few stages is merged
+    //
+    for (const ShaderInfo *shaderInfo : shaderInfos) {
+        if (!shaderInfo) {
+            continue;
+        }
+        for (const VkPushConstantRange& range : shaderInfo->pushConstantRanges) {
+            auto sameRange = std::find_if(pipelineInfo.pushConstantRanges.begin(), pipelineInfo.pushConstantRanges.end(),
+                                          [&range](const VkPushConstantRange& r) { return r.offset == range.offset && r.size == range.size; });
+            if (sameRange != pipelineInfo.pushConstantRanges.end()) {
+                sameRange->stageFlags |= range.stageFlags;
+            }
+            else {
+                pipelineInfo.pushConstantRanges.push_back(range);
+            }
+        }
+    }
+
+    //
+    // Pipeline layout - Uniforms, Samplers, Storage buffers
+    //
+    std::vector<VkDescriptorSetLayout> descriptorSetlayouts(pipelineInfo.descriptorSetInfo.size());
+    for (size_t descriptorSetIdx = 0; descriptorSetIdx < descriptorSetlayouts.size(); ++descriptorSetIdx) {
+        descriptorSetlayouts[descriptorSetIdx] = pipelineInfo.descriptorSetInfo[descriptorSetIdx].layout;
+    }
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(descriptorSetlayouts.size());  // Optional
+    pipelineLayoutInfo.pSetLayouts = descriptorSetlayouts.data();                            // Optional
+    pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(pipelineInfo.pushConstantRanges.size()); // Optional
+    pipelineLayoutInfo.pPushConstantRanges = pipelineInfo.pushConstantRanges.data();                            // Optional
+
+    VkResult result = mDevFuncs->vkCreatePipelineLayout(mDevice, &pipelineLayoutInfo, nullptr, &pipelineInfo.pipelineLayout);
+    if (result != VK_SUCCESS) {
+        qFatal("Failed to create pipeline layout. Result: %i", result);
+        return false;
+    }
+    return true;
+}
+
+const PipelineManager::PipelineInfo* PipelineManager::getComputePipeline(const std::string& computeShaderPath,
+                                                                         const std::map<AdditionalParameters, QVariant> &parameters)
+{
+    std::string key = "compute:" + computeShaderPath + parametersKey(parameters);
+
+    auto foundIt = mPipelines.find(key);
+    if (foundIt != mPipelines.end()) {
+        return &foundIt->second;
+    }
+    TRACE_SCOPE("PipelineManager::getComputePipeline");
+
+    const ShaderInfo* computeShader = getShader(computeShaderPath, VK_SHADER_STAGE_COMPUTE_BIT, parameters);
+    if (!computeShader) {
+        return nullptr;
+    }
+    std::vector<const ShaderInfo *> shaderInfos(1, computeShader);
+
+    PipelineInfo pipelineInfo;
+    createLayoutAndPoolForDescriptorSets(shaderInfos, pipelineInfo);
+    if (!createPipelineLayout(shaderInfos, pipelineInfo)) {
+        return nullptr;
+    }
+
+    VkComputePipelineCreateInfo computePipelineCreateInfo = {};
+    computePipelineCreateInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    computePipelineCreateInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    computePipelineCreateInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    computePipelineCreateInfo.stage.module = computeShader->shader;
+    computePipelineCreateInfo.stage.pName = "main";
+    computePipelineCreateInfo.layout = pipelineInfo.pipelineLayout;
+    computePipelineCreateInfo.basePipelineHandle = nullptr;
+    computePipelineCreateInfo.basePipelineIndex = -1;
+
+    VkResult result = mDevFuncs->vkCreateComputePipelines(mDevice, nullptr, 1, &computePipelineCreateInfo, nullptr, &pipelineInfo.pipeline);
+    if (result != VK_SUCCESS) {
+        qWarning("Can't create compute pipeline. Result: %i", result);
+        mDevFuncs->vkDestroyPipelineLayout(mDevice, pipelineInfo.pipelineLayout, nullptr);
+        return nullptr;
+    }
+    auto inserted = mPipelines.insert(std::make_pair(key, pipelineInfo));
+    return (inserted.second ? &inserted.first->second : nullptr);
+}
@@ -31,14 +31,20 @@ SOFTWARE.
 #include <QSize>
 #include <QVariant> //TODO exchange with c++17 std::variant
 
-class QVulkanInstance;
-class QVulkanDeviceFunctions;
+struct VulkanDeviceFunctions;
+class BindlessTextureTable;
 
 class PipelineManager
 {
 public:
     enum AdditionalParameters {
         ApSeparatedAttributes, // [bool] 0 - interleaved (default); 1 - separated
+        ApInstanceAttributesFromLocation, // [uint] inputs with location >= value are per instance (VK_VERTEX_INPUT_RATE_INSTANCE),
+                                          //        interleaved in one binding following vertex bindings; not set - no instance inputs
+        ApRenderPass,            // [qulonglong] VkRenderPass pipeline is used with (e.g. RenderGraph pass); not set - default render pass
+        ApColorAttachmentCount,  // [uint] color attachments of the render pass subpass; not set - 1
+        ApRasterizationSamples,  // [uint] VkSampleCountFlagBits of render pass attachments; not set - samples of default render pass
+        ApPrimitiveTopology,     // [uint] VkPrimitiveTopology e.g. VK_PRIMITIVE_TOPOLOGY_POINT_LIST; not set - triangle list
     };
 
     struct BindingInfo {
@@ -50,6 +56,7 @@ public:
         VkDescriptorSetLayout layout;
         VkDescriptorSet       descriptor;
         std::vector<BindingInfo> bindingInfo;
+        bool                  external = false; // layout and set are owned by someone else e.g. BindlessTextureTable
     };
 
     struct PipelineInfo {
@@ -58,11 +65,12 @@ public:
         //VkPipelineCache pipelineCache;
         std::vector<DescriptorSetInfo> descriptorSetInfo;
         VkDescriptorPool               descriptorPool;
+        std::vector<VkPushConstantRange> pushConstantRanges;
     };
 
     typedef std::vector<std::vector<BindingInfo>> DescriptorSetsSpecifications; // DescriptorSetsSpecifications[ descriptorSet ][ bindingIdx ]
 
-    PipelineManager(QVulkanInstance &vulkanInstance,
+    PipelineManager(VulkanDeviceFunctions *devFuncs,
                     VkDevice device,
                     const QSize& frameSize,
                     uint32_t rasterizationSamples,
@@ -80,8 +88,28 @@ public:
                                     const std::string& fragmentShaderPath,
                                     const std::map<AdditionalParameters, QVariant> &parameters = std::map<AdditionalParameters, QVariant>());
 
+    ///
+    /// Get or Create compute pipeline - descriptor sets are reflected the same way as for graphic pipeline
+    /// Owner of the returned object is PipelineManager
+    ///
+    const PipelineInfo* getComputePipeline(const std::string& computeShaderPath,
+                                           const std::map<AdditionalParameters, QVariant> &parameters = std::map<AdditionalParameters, QVariant>());
+
     void cleanUpShaders();
 
+    ///
+    /// Allocate own descriptor sets with layouts of the pipeline - each object can have its own uniforms.
+    /// External sets (e.g. bindless table) are shared, they are copied from pipelineInfo.
+    /// Sets are released together with PipelineManager.
+    ///
+    bool allocateDescriptorSets(const PipelineInfo* pipelineInfo, std::vector<VkDescriptorSet>& descriptorSets);
+
+    ///
+    /// Descriptor set which in shader contains unsized sampler array (e.g. sampler2D textures[])
+    /// is replaced by set from provided table. Table has to outlive created pipelines.
+    ///
+    void setBindlessTextureTable(const BindlessTextureTable* table);
+
 
     static VkFormat chooseFloatFormat(uint32_t fieldBitWidth, uint32_t fieldCount);
     static VkFormat chooseIntFormat(uint32_t fieldBitWidth, uint32_t fieldCount, bool sign);
@@ -100,17 +128,28 @@ protected:
         DescriptorSetsSpecifications descriptorSetsSpecifications; // descriptorSetSpecifications[ descriptorSet ][ bindingIdx ]
     };
 
+    struct StorageInfo{
+        DescriptorSetsSpecifications descriptorSetsSpecifications; // descriptorSetSpecifications[ descriptorSet ][ bindingIdx ]
+    };
+
     struct ShaderInfo {
         VkShaderModule shader;
         VertexInfo vertexInfo;
         UniformInfo uniformInfo;
         SamplerInfo samplerInfo;
+        StorageInfo storageInfo;
+        std::vector<VkPushConstantRange> pushConstantRanges;
     };
 
+    static std::string parametersKey(const std::map<AdditionalParameters, QVariant> &parameters, bool shaderParametersOnly = false);
+    static bool isShaderParameter(AdditionalParameters parameter); // changes reflected shader input
+
     //VkShaderModule createShader(const char* shaderStr, uint32_t shaderLen, int shadercShaderKindEnumVal);
     const ShaderInfo* getShader(const std::string& shaderPath, VkShaderStageFlagBits stage, const std::map<AdditionalParameters, QVariant> &parameters);
     bool createLayoutAndPoolForDescriptorSets(const std::vector<const ShaderInfo*>& shaderInfos,
                                               PipelineInfo& pipelineInfo);
+    bool createPipelineLayout(const std::vector<const ShaderInfo*>& shaderInfos,
+                              PipelineInfo& pipelineInfo); // push constants and descriptor set layouts
 
     template <VkDescriptorType descrType>
     const DescriptorSetsSpecifications& getDescriptorSetSpec(const PipelineManager::ShaderInfo &shaderInfos);
@@ -124,14 +163,21 @@ protected:
     template <VkDescriptorType descrType>
     void fillDescriptorSetBindingsInfo(const std::vector<const PipelineManager::ShaderInfo *> &shaderInfos, DescriptorSetsSpecifications& infos);
 
+    struct ObjectDescriptorPools {
+        std::vector<VkDescriptorPool> pools;
+        uint32_t freeObjectsInLastPool = 0;
+    };
+
     std::map<std::string, ShaderInfo> mShaders;
     std::map<std::string, PipelineInfo> mPipelines;
+    std::map<const PipelineInfo*, ObjectDescriptorPools> mObjectDescriptorPools;
 
     VkDevice mDevice = nullptr;
-    QVulkanDeviceFunctions *mDevFuncs = nullptr;
+    VulkanDeviceFunctions *mDevFuncs = nullptr;
 
     QSize mFrameSize;
     uint32_t mRasterizationSamples;
     VkRenderPass mDefaultRenderPass;
+    const BindlessTextureTable* mBindlessTable = nullptr;
 };
 
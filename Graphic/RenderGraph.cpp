@@ -0,0 +1,714 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "RenderGraph.hpp"
+#include "ResourceManager.hpp"
+#include "DrawManager.hpp"
+#include "GpuProfiler.hpp"
+#include "VulkanFunctions.hpp"
+#include <algorithm>
+#include <queue>
+#include <assert.h>
+
+RenderGraph::RenderGraph(ResourceManager* resourceMgr)
+    : mResourceMgr(resourceMgr)
+{
+    assert(mResourceMgr && "Resource Manager should be valid!");
+}
+
+RenderGraph::~RenderGraph()
+{
+    release();
+}
+
+//
+// Declaration
+//
+
+RenderGraph::ResourceHandle RenderGraph::createAttachment(const std::string& name, VkFormat format)
+{
+    Resource resource;
+    resource.name = name;
+    resource.format = format;
+    resource.imported = false;
+    mResources.push_back(std::move(resource));
+    return static_cast<ResourceHandle>(mResources.size() - 1);
+}
+
+RenderGraph::ResourceHandle RenderGraph::importResource(const std::string& name)
+{
+    Resource resource;
+    resource.name = name;
+    resource.format = VK_FORMAT_UNDEFINED;
+    resource.imported = true;
+    mResources.push_back(std::move(resource));
+    return static_cast<ResourceHandle>(mResources.size() - 1);
+}
+
+RenderGraph::PassHandle RenderGraph::addPass(const std::string& name, const ExecuteFunc& execute, bool external)
+{
+    Pass pass;
+    pass.name = name;
+    pass.execute = execute;
+    pass.external = external;
+    mPasses.push_back(std::move(pass));
+    return static_cast<PassHandle>(mPasses.size() - 1);
+}
+
+void RenderGraph::writeColor(PassHandle pass, ResourceHandle resource, bool clear, const VkClearColorValue& clearValue)
+{
+    assert(pass < mPasses.size() && resource < mResources.size());
+    if (mResources[resource].imported && !mPasses[pass].external) {
+        qWarning("Render graph: imported resource %s can be written only by external pass, not by %s",
+                 mResources[resource].name.c_str(), mPasses[pass].name.c_str());
+        return;
+    }
+    Use use = {};
+    use.resource = resource;
+    use.type = UseColorWrite;
+    use.clear = clear;
+    use.clearValue.color = clearValue;
+    mPasses[pass].uses.push_back(use);
+}
+
+void RenderGraph::writeDepth(PassHandle pass, ResourceHandle resource, bool clear, float clearDepth)
+{
+    assert(pass < mPasses.size() && resource < mResources.size());
+    assert(mResources[resource].imported || isDepthFormat(mResources[resource].format));
+    Use use = {};
+    use.resource = resource;
+    use.type = UseDepthWrite;
+    use.clear = clear;
+    use.clearValue.depthStencil.depth = clearDepth;
+    use.clearValue.depthStencil.stencil = 0;
+    mPasses[pass].uses.push_back(use);
+}
+
+void RenderGraph::readTexture(PassHandle pass, ResourceHandle resource, VkPipelineStageFlags stages)
+{
+    assert(pass < mPasses.size() && resource < mResources.size());
+    Use use = {};
+    use.resource = resource;
+    use.type = UseTextureRead;
+    use.clear = false;
+    use.stages = stages;
+    mPasses[pass].uses.push_back(use);
+}
+
+//
+// Compilation
+//
+
+bool RenderGraph::compile(const QSize& frameSize)
+{
+    release();
+    mFrameSize = frameSize;
+    mStats = Stats();
+    mStats.passes = static_cast<uint32_t>(mPasses.size());
+
+    cullPasses();
+    if (!sortPasses()) {
+        release();
+        return false;
+    }
+    computeLifetimes();
+    if (!createImages()) {
+        release();
+        return false;
+    }
+    for (PassHandle passIdx : mOrder) {
+        Pass& pass = mPasses[passIdx];
+        if (!pass.external && !createRenderPass(pass)) {
+            release();
+            return false;
+        }
+    }
+
+    qInfo("Render graph: %d passes (%d culled), %d transient images in %d memory blocks, %llu KB (%llu KB without aliasing)"
+          , mStats.passes, mStats.culledPasses, mStats.transientImages, mStats.memoryBlocks
+          , static_cast<unsigned long long>(mStats.transientBytes / 1024)
+          , static_cast<unsigned long long>(mStats.unaliasedBytes / 1024));
+    return true;
+}
+
+void RenderGraph::cullPasses()
+{
+    //
+    // Writers of each resource in declaration order
+    //
+    std::vector<std::vector<PassHandle>> writers(mResources.size());
+    for (PassHandle passIdx = 0; passIdx < mPasses.size(); ++passIdx) {
+        for (const Use& use : mPasses[passIdx].uses) {
+            bool write = use.type != UseTextureRead;
+            if (write && (writers[use.resource].empty() || writers[use.resource].back() != passIdx)) {
+                writers[use.resource].push_back(passIdx);
+            }
+        }
+    }
+
+    //
+    // From passes which have to be executed (external) back through everything they depend on
+    //
+    std::vector<bool> needed(mPasses.size(), false);
+    std::vector<PassHandle> toVisit;
+    for (PassHandle passIdx = 0; passIdx < mPasses.size(); ++passIdx) {
+        if (mPasses[passIdx].external) {
+            needed[passIdx] = true;
+            toVisit.push_back(passIdx);
+        }
+    }
+    while (!toVisit.empty()) {
+        PassHandle passIdx = toVisit.back();
+        toVisit.pop_back();
+        for (const Use& use : mPasses[passIdx].uses) {
+            if (use.clear) {
+                continue; // previous content is not needed
+            }
+            // Texture read needs all writers, loading write needs writers declared before this pass - back to the one which clears
+            const std::vector<PassHandle>& resourceWriters = writers[use.resource];
+            for (auto it = resourceWriters.rbegin(); it != resourceWriters.rend(); ++it) {
+                PassHandle writer = *it;
+                if (use.type != UseTextureRead && writer >= passIdx) {
+                    continue;
+                }
+                if (!needed[writer]) {
+                    needed[writer] = true;
+                    toVisit.push_back(writer);
+                }
+                bool writerClears = false;
+                for (const Use& writerUse : mPasses[writer].uses) {
+                    writerClears = writerClears || (writerUse.resource == use.resource && writerUse.type != UseTextureRead && writerUse.clear);
+                }
+                if (writerClears) {
+                    break;
+                }
+            }
+        }
+    }
+
+    for (PassHandle passIdx = 0; passIdx < mPasses.size(); ++passIdx) {
+        mPasses[passIdx].culled = !needed[passIdx];
+        if (mPasses[passIdx].culled) {
+            ++mStats.culledPasses;
+        }
+    }
+}
+
+bool RenderGraph::sortPasses()
+{
+    //
+    // Edges: writers of a resource in declaration order, last writer before readers
+    //
+    std::vector<std::vector<PassHandle>> edges(mPasses.size());
+    std::vector<uint32_t> inDegree(mPasses.size(), 0);
+    auto addEdge = [&](PassHandle from, PassHandle to) {
+        if (from != to && std::find(edges[from].begin(), edges[from].end(), to) == edges[from].end()) {
+            edges[from].push_back(to);
+            ++inDegree[to];
+        }
+    };
+
+    for (ResourceHandle resourceIdx = 0; resourceIdx < mResources.size(); ++resourceIdx) {
+        PassHandle lastWriter = InvalidHandle;
+        std::vector<PassHandle> readers;
+        for (PassHandle passIdx = 0; passIdx < mPasses.size(); ++passIdx) {
+            if (mPasses[passIdx].culled) {
+                continue;
+            }
+            bool writes = false;
+            bool reads = false;
+            for (const Use& use : mPasses[passIdx].uses) {
+                if (use.resource == resourceIdx) {
+                    writes = writes || use.type != UseTextureRead;
+                    reads = reads || use.type == UseTextureRead;
+                }
+            }
+            if (writes && reads) {
+                qWarning("Render graph: pass %s reads and writes %s - feedback loop is not supported",
+                         mPasses[passIdx].name.c_str(), mResources[resourceIdx].name.c_str());
+                return false;
+            }
+            if (writes) {
+                if (lastWriter != InvalidHandle) {
+                    addEdge(lastWriter, passIdx);
+                }
+                lastWriter = passIdx;
+            }
+            else if (reads) {
+                readers.push_back(passIdx);
+            }
+        }
+        if (lastWriter != InvalidHandle) {
+            for (PassHandle reader : readers) {
+                addEdge(lastWriter, reader);
+            }
+        }
+    }
+
+    //
+    // Topological order, among ready passes the one declared first
+    //
+    std::priority_queue<PassHandle, std::vector<PassHandle>, std::greater<PassHandle>> ready;
+    uint32_t notCulled = 0;
+    for (PassHandle passIdx = 0; passIdx < mPasses.size(); ++passIdx) {
+        if (!mPasses[passIdx].culled) {
+            ++notCulled;
+            if (!inDegree[passIdx]) {
+                ready.push(passIdx);
+            }
+        }
+    }
+    mOrder.clear();
+    while (!ready.empty()) {
+        PassHandle passIdx = ready.top();
+        ready.pop();
+        mOrder.push_back(passIdx);
+        for (PassHandle next : edges[passIdx]) {
+            if (--inDegree[next] == 0) {
+                ready.push(next);
+            }
+        }
+    }
+    if (mOrder.size() != notCulled) {
+        qWarning("Render graph: passes have cyclic dependencies");
+        return false;
+    }
+    return true;
+}
+
+void RenderGraph::computeLifetimes()
+{
+    for (uint32_t orderIdx = 0; orderIdx < mOrder.size(); ++orderIdx) {
+        for (const Use& use : mPasses[mOrder[orderIdx]].uses) {
+            Resource& resource = mResources[use.resource];
+            if (resource.firstUse == InvalidHandle) {
+                resource.firstUse = orderIdx;
+            }
+            resource.lastUse = orderIdx;
+            switch (use.type) {
+            case UseColorWrite:  resource.usage |= VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT; break;
+            case UseDepthWrite:  resource.usage |= VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT; break;
+            case UseTextureRead: resource.usage |= VK_IMAGE_USAGE_SAMPLED_BIT; break;
+            }
+        }
+    }
+}
+
+bool RenderGraph::createImages()
+{
+    std::vector<ResourceHandle> transients;
+    for (ResourceHandle resourceIdx = 0; resourceIdx < mResources.size(); ++resourceIdx) {
+        const Resource& resource = mResources[resourceIdx];
+        if (!resource.imported && resource.firstUse != InvalidHandle) {
+            transients.push_back(resourceIdx);
+        }
+    }
+    // Assigning in order of first use - block is free when its last occupant isn't used anymore
+    std::sort(transients.begin(), transients.end(), [this](ResourceHandle a, ResourceHandle b) {
+        return mResources[a].firstUse < mResources[b].firstUse;
+    });
+
+    for (ResourceHandle resourceIdx : transients) {
+        Resource& resource = mResources[resourceIdx];
+
+        VkImageCreateInfo imageInfo = {};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = resource.format;
+        imageInfo.extent.width = static_cast<uint32_t>(mFrameSize.width());
+        imageInfo.extent.height = static_cast<uint32_t>(mFrameSize.height());
+        imageInfo.extent.depth = 1;
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = resource.usage;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        resource.image = std::unique_ptr<ImageDescr>(new ImageDescr(mResourceMgr));
+        if (!resource.image->createUnbound(imageInfo)) {
+            qWarning("Render graph: can't create image %s", resource.name.c_str());
+            return false;
+        }
+        VkMemoryRequirements memReqs = resource.image->getMemoryRequirements();
+        mStats.unaliasedBytes += memReqs.size;
+        ++mStats.transientImages;
+
+        //
+        // Best fitting free block, if none fits the biggest free one grows
+        //
+        uint32_t bestBlock = InvalidHandle;
+        for (uint32_t blockIdx = 0; blockIdx < mMemoryBlocks.size(); ++blockIdx) {
+            const MemoryBlock& block = mMemoryBlocks[blockIdx];
+            if (block.lastUse >= resource.firstUse || !(block.memoryTypeBits & memReqs.memoryTypeBits)) {
+                continue;
+            }
+            if (bestBlock == InvalidHandle) {
+                bestBlock = blockIdx;
+                continue;
+            }
+            const MemoryBlock& best = mMemoryBlocks[bestBlock];
+            bool fits = block.size >= memReqs.size;
+            bool bestFits = best.size >= memReqs.size;
+            if ((fits && (!bestFits || block.size < best.size)) || (!fits && !bestFits && block.size > best.size)) {
+                bestBlock = blockIdx;
+            }
+        }
+        if (bestBlock == InvalidHandle) {
+            mMemoryBlocks.push_back(MemoryBlock());
+            bestBlock = static_cast<uint32_t>(mMemoryBlocks.size() - 1);
+        }
+        MemoryBlock& block = mMemoryBlocks[bestBlock];
+        block.size = std::max(block.size, memReqs.size);
+        block.memoryTypeBits &= memReqs.memoryTypeBits;
+        block.lastUse = resource.lastUse;
+        resource.memoryBlock = bestBlock;
+    }
+
+    //
+    // Memory and binding - every image is placed at the beginning of its block
+    //
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    for (MemoryBlock& block : mMemoryBlocks) {
+        VkMemoryAllocateInfo allocInfo = {};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = block.size;
+        allocInfo.memoryTypeIndex = mResourceMgr->findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        if (allocInfo.memoryTypeIndex == ~0u) {
+            qWarning("Render graph: can't find memory type for transient images");
+            return false;
+        }
+        VkResult result = devFuncs->vkAllocateMemory(mResourceMgr->device(), &allocInfo, nullptr, &block.memory);
+        if (result != VK_SUCCESS) {
+            qWarning("Render graph: can't allocate memory for transient images. Result: %i", result);
+            block.memory = nullptr;
+            return false;
+        }
+        block.lastOccupant = InvalidHandle;
+        mStats.transientBytes += block.size;
+    }
+    mStats.memoryBlocks = static_cast<uint32_t>(mMemoryBlocks.size());
+
+    for (ResourceHandle resourceIdx : transients) {
+        Resource& resource = mResources[resourceIdx];
+        if (!resource.image->bindMemory(mMemoryBlocks[resource.memoryBlock].memory, 0)) {
+            return false;
+        }
+
+        VkImageViewCreateInfo viewInfo = {};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = resource.image->getImage();
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = resource.format;
+        viewInfo.subresourceRange.aspectMask = isDepthFormat(resource.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+        resource.view = std::unique_ptr<ImageViewDescr>(new ImageViewDescr(mResourceMgr));
+        if (!resource.view->createImageView(viewInfo)) {
+            qWarning("Render graph: can't create image view %s", resource.name.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool RenderGraph::createRenderPass(Pass& pass)
+{
+    uint32_t orderIdx = static_cast<uint32_t>(std::find(mOrder.begin(), mOrder.end(), static_cast<PassHandle>(&pass - mPasses.data())) - mOrder.begin());
+
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkAttachmentReference> colorRefs;
+    VkAttachmentReference depthRef = {VK_ATTACHMENT_UNUSED, VK_IMAGE_LAYOUT_UNDEFINED};
+    std::vector<VkImageView> views;
+    pass.clearValues.clear();
+
+    // Colors first, depth is the last attachment
+    for (int depthPhase = 0; depthPhase < 2; ++depthPhase) {
+        for (const Use& use : pass.uses) {
+            if (use.type == UseTextureRead || (use.type == UseDepthWrite) != (depthPhase == 1)) {
+                continue;
+            }
+            const Resource& resource = mResources[use.resource];
+            bool depth = use.type == UseDepthWrite;
+            VkImageLayout layout = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+            VkAttachmentDescription attachment = {};
+            attachment.format = resource.format;
+            attachment.samples = VK_SAMPLE_COUNT_1_BIT;
+            attachment.loadOp = use.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                              : (resource.firstUse == orderIdx ? VK_ATTACHMENT_LOAD_OP_DONT_CARE : VK_ATTACHMENT_LOAD_OP_LOAD);
+            attachment.storeOp = resource.lastUse > orderIdx ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+            attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            // Transitions are done by ResourceStateTracker before the pass
+            attachment.initialLayout = layout;
+            attachment.finalLayout = layout;
+
+            VkAttachmentReference ref = {static_cast<uint32_t>(attachments.size()), layout};
+            if (depth) {
+                if (depthRef.attachment != VK_ATTACHMENT_UNUSED) {
+                    qWarning("Render graph: pass %s writes more than one depth attachment", pass.name.c_str());
+                    return false;
+                }
+                depthRef = ref;
+            }
+            else {
+                colorRefs.push_back(ref);
+            }
+            attachments.push_back(attachment);
+            views.push_back(resource.view->getImageView());
+            pass.clearValues.push_back(use.clearValue);
+        }
+    }
+    pass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    if (attachments.empty()) {
+        return true; // e.g. compute only pass - nothing to begin
+    }
+
+    VkSubpassDescription subpass = {};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pDepthStencilAttachment = depthRef.attachment != VK_ATTACHMENT_UNUSED ? &depthRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo = {};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    renderPassInfo.pAttachments = attachments.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VkResult result = devFuncs->vkCreateRenderPass(mResourceMgr->device(), &renderPassInfo, nullptr, &pass.renderPass);
+    if (result != VK_SUCCESS) {
+        qWarning("Render graph: can't create render pass %s. Result: %i", pass.name.c_str(), result);
+        pass.renderPass = nullptr;
+        return false;
+    }
+
+    VkFramebufferCreateInfo framebufferInfo = {};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = pass.renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = static_cast<uint32_t>(mFrameSize.width());
+    framebufferInfo.height = static_cast<uint32_t>(mFrameSize.height());
+    framebufferInfo.layers = 1;
+    result = devFuncs->vkCreateFramebuffer(mResourceMgr->device(), &framebufferInfo, nullptr, &pass.framebuffer);
+    if (result != VK_SUCCESS) {
+        qWarning("Render graph: can't create framebuffer %s. Result: %i", pass.name.c_str(), result);
+        pass.framebuffer = nullptr;
+        return false;
+    }
+    return true;
+}
+
+void RenderGraph::release()
+{
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VkDevice device = mResourceMgr->device();
+    for (Pass& pass : mPasses) {
+        devFuncs->vkDestroyFramebuffer(device, pass.framebuffer, nullptr);
+        devFuncs->vkDestroyRenderPass(device, pass.renderPass, nullptr);
+        pass.framebuffer = nullptr;
+        pass.renderPass = nullptr;
+        pass.clearValues.clear();
+        pass.colorAttachmentCount = 0;
+        pass.culled = false;
+    }
+    for (Resource& resource : mResources) {
+        resource.view.reset();
+        resource.image.reset(); // memory is owned by block
+        resource.usage = 0;
+        resource.firstUse = InvalidHandle;
+        resource.lastUse = InvalidHandle;
+        resource.memoryBlock = InvalidHandle;
+    }
+    for (MemoryBlock& block : mMemoryBlocks) {
+        devFuncs->vkFreeMemory(device, block.memory, nullptr);
+    }
+    mMemoryBlocks.clear();
+    mOrder.clear();
+}
+
+//
+// Execution
+//
+
+void RenderGraph::beginResourceLifetime(Resource& resource)
+{
+    // Previous occupant of the memory (from this or previous frame) has to finish before content is discarded
+    MemoryBlock& block = mMemoryBlocks[resource.memoryBlock];
+    ResourceHandle handle = static_cast<ResourceHandle>(&resource - mResources.data());
+    ResourceState state;
+    if (block.lastOccupant != InvalidHandle) {
+        state = mResources[block.lastOccupant].image->state();
+    }
+    state.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.image->state() = state;
+    block.lastOccupant = handle;
+}
+
+void RenderGraph::execute(DrawManager* drawMgr)
+{
+    assert(drawMgr);
+    VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
+    if (!cmdBuf) {
+        qWarning("Invalid command buffer provided! While executing render graph");
+        return;
+    }
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    ResourceStateTracker* tracker = mResourceMgr->stateTracker();
+    VkRenderPass frameRenderPass = drawMgr->getRenderPass();
+    VkFramebuffer frameFramebuffer = drawMgr->getFramebuffer();
+
+    for (uint32_t orderIdx = 0; orderIdx < mOrder.size(); ++orderIdx) {
+        Pass& pass = mPasses[mOrder[orderIdx]];
+        GpuScope gpuScope(drawMgr, pass.name.c_str());
+
+        //
+        // Barriers for all resources of the pass - one vkCmdPipelineBarrier
+        //
+        for (size_t useIdx = 0; useIdx < pass.uses.size(); ++useIdx) {
+            const Use& use = pass.uses[useIdx];
+            Resource& resource = mResources[use.resource];
+            if (resource.imported) {
+                continue; // synchronized by its owner
+            }
+            bool firstUseInPass = true;
+            for (size_t prevIdx = 0; prevIdx < useIdx; ++prevIdx) {
+                firstUseInPass = firstUseInPass && pass.uses[prevIdx].resource != use.resource;
+            }
+            if (resource.firstUse == orderIdx && firstUseInPass) {
+                beginResourceLifetime(resource);
+            }
+
+            VkImageAspectFlags aspect = barrierAspect(resource.format);
+            switch (use.type) {
+            case UseColorWrite:
+                tracker->useImage(*resource.image, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                  VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                  VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | (use.clear ? 0 : VK_ACCESS_COLOR_ATTACHMENT_READ_BIT),
+                                  aspect);
+                break;
+            case UseDepthWrite:
+                tracker->useImage(*resource.image, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                                  VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                                  VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                                  aspect);
+                break;
+            case UseTextureRead:
+                tracker->useImage(*resource.image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, use.stages, VK_ACCESS_SHADER_READ_BIT, aspect);
+                break;
+            }
+        }
+        tracker->flush(cmdBuf);
+
+        if (pass.external || !pass.renderPass) {
+            drawMgr->setRenderPass(frameRenderPass, frameFramebuffer);
+            pass.execute(drawMgr);
+            continue;
+        }
+
+        VkRenderPassBeginInfo beginInfo = {};
+        beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        beginInfo.renderPass = pass.renderPass;
+        beginInfo.framebuffer = pass.framebuffer;
+        beginInfo.renderArea.extent.width = static_cast<uint32_t>(mFrameSize.width());
+        beginInfo.renderArea.extent.height = static_cast<uint32_t>(mFrameSize.height());
+        beginInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+        beginInfo.pClearValues = pass.clearValues.data();
+        devFuncs->vkCmdBeginRenderPass(cmdBuf, &beginInfo, VK_SUBPASS_CONTENTS_INLINE);
+        drawMgr->setRenderPass(pass.renderPass, pass.framebuffer);
+        pass.execute(drawMgr);
+        devFuncs->vkCmdEndRenderPass(cmdBuf);
+    }
+    drawMgr->setRenderPass(frameRenderPass, frameFramebuffer);
+}
+
+//
+// Queries
+//
+
+bool RenderGraph::isPassCulled(PassHandle pass) const
+{
+    assert(pass < mPasses.size());
+    return mPasses[pass].culled;
+}
+
+VkRenderPass RenderGraph::renderPass(PassHandle pass) const
+{
+    assert(pass < mPasses.size());
+    return mPasses[pass].renderPass;
+}
+
+VkImageView RenderGraph::imageView(ResourceHandle resource) const
+{
+    assert(resource < mResources.size());
+    return mResources[resource].view ? mResources[resource].view->getImageView() : nullptr;
+}
+
+void RenderGraph::pipelineParameters(PassHandle pass, std::map<PipelineManager::AdditionalParameters, QVariant>& parameters) const
+{
+    assert(pass < mPasses.size());
+    const Pass& p = mPasses[pass];
+    if (p.external || !p.renderPass) {
+        return; // default render pass
+    }
+    parameters[PipelineManager::ApRenderPass] = static_cast<qulonglong>(reinterpret_cast<uintptr_t>(p.renderPass));
+    parameters[PipelineManager::ApColorAttachmentCount] = p.colorAttachmentCount;
+    parameters[PipelineManager::ApRasterizationSamples] = static_cast<uint32_t>(VK_SAMPLE_COUNT_1_BIT);
+}
+
+VkImageAspectFlags RenderGraph::barrierAspect(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        break;
+    }
+    return isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+}
+
+bool RenderGraph::isDepthFormat(VkFormat format)
+{
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return true;
+    default:
+        break;
+    }
+    return false;
+}
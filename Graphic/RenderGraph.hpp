@@ -0,0 +1,177 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <QSize>
+#include <QVariant>
+#include "PipelineManager.hpp"
+
+class ResourceManager;
+class DrawManager;
+class ImageDescr;
+class ImageViewDescr;
+
+///
+/// Frame described as passes which declare attachments/textures they write and read.
+/// compile():
+///  - orders passes - writers of a resource before its readers, writers of the same resource in declaration order,
+///  - culls passes which output is not used (external passes are always kept),
+///  - creates transient images (frame size) and lets images with not overlapping lifetimes share memory,
+///  - creates render pass and framebuffer for each not external pass.
+/// execute() records barriers (through ResourceStateTracker) and passes in compiled order.
+///
+/// External pass records everything itself (e.g. default render pass of the window - imported backbuffer).
+///
+class RenderGraph
+{
+public:
+    typedef uint32_t ResourceHandle;
+    typedef uint32_t PassHandle;
+    static const uint32_t InvalidHandle = ~0u;
+
+    typedef std::function<void(DrawManager* drawMgr)> ExecuteFunc;
+
+    struct Stats {
+        uint32_t passes = 0;
+        uint32_t culledPasses = 0;
+        uint32_t transientImages = 0;
+        uint32_t memoryBlocks = 0;
+        VkDeviceSize transientBytes = 0;  // memory allocated for transient images
+        VkDeviceSize unaliasedBytes = 0;  // memory which would be needed without aliasing
+    };
+
+    explicit RenderGraph(ResourceManager* resourceMgr);
+    ~RenderGraph();
+
+    ///
+    /// Transient image with size of the frame, usage is derived from passes.
+    ///
+    ResourceHandle createAttachment(const std::string& name, VkFormat format);
+    ///
+    /// Resource which is not owned by graph e.g. window backbuffer - only external passes can use it.
+    ///
+    ResourceHandle importResource(const std::string& name);
+
+    PassHandle addPass(const std::string& name, const ExecuteFunc& execute, bool external = false);
+    void writeColor(PassHandle pass, ResourceHandle resource, bool clear = true, const VkClearColorValue& clearValue = VkClearColorValue());
+    void writeDepth(PassHandle pass, ResourceHandle resource, bool clear = true, float clearDepth = 1.f); // not clear - depth of previous pass is tested and updated
+    void readTexture(PassHandle pass, ResourceHandle resource, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    bool compile(const QSize& frameSize);
+    void execute(DrawManager* drawMgr);
+    void release(); // Vulkan objects, declarations are kept - can be compiled again e.g. for new frame size
+
+    ///
+    /// Valid after compile
+    ///
+    bool isPassCulled(PassHandle pass) const;
+    VkRenderPass renderPass(PassHandle pass) const;
+    VkImageView imageView(ResourceHandle resource) const; // for descriptor of texture read
+    ///
+    /// Fill parameters needed to create pipeline used in pass (render pass, attachments count, samples)
+    ///
+    void pipelineParameters(PassHandle pass, std::map<PipelineManager::AdditionalParameters, QVariant>& parameters) const;
+    const std::vector<PassHandle>& executionOrder() const { return mOrder; }
+    const Stats& stats() const { return mStats; }
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+protected:
+    enum UseType {
+        UseColorWrite,
+        UseDepthWrite,
+        UseTextureRead,
+    };
+
+    struct Use {
+        ResourceHandle resource;
+        UseType type;
+        bool clear;
+        VkClearValue clearValue;
+        VkPipelineStageFlags stages; // texture read
+    };
+
+    struct Pass {
+        std::string name;
+        ExecuteFunc execute;
+        bool external;
+        std::vector<Use> uses;
+
+        // compiled
+        bool culled = false;
+        VkRenderPass renderPass = nullptr;
+        VkFramebuffer framebuffer = nullptr;
+        std::vector<VkClearValue> clearValues;
+        uint32_t colorAttachmentCount = 0;
+    };
+
+    struct Resource {
+        std::string name;
+        VkFormat format;
+        bool imported;
+
+        // compiled
+        VkImageUsageFlags usage = 0;
+        uint32_t firstUse = InvalidHandle; // index in mOrder
+        uint32_t lastUse = InvalidHandle;
+        uint32_t memoryBlock = InvalidHandle;
+        std::unique_ptr<ImageDescr> image;
+        std::unique_ptr<ImageViewDescr> view;
+    };
+
+    struct MemoryBlock {
+        VkDeviceMemory memory = nullptr;
+        VkDeviceSize size = 0;
+        uint32_t memoryTypeBits = ~0u;
+        uint32_t lastUse = 0;                    // last pass (index in mOrder) of current occupant, used while assigning
+        ResourceHandle lastOccupant = InvalidHandle; // next occupant has to wait for its accesses (also from previous frame)
+    };
+
+    bool sortPasses();
+    void cullPasses();
+    void computeLifetimes();
+    bool createImages();
+    bool createRenderPass(Pass& pass);
+    void beginResourceLifetime(Resource& resource);
+
+    static bool isDepthFormat(VkFormat format);
+    static VkImageAspectFlags barrierAspect(VkFormat format); // depth/stencil formats need both aspects in barrier
+
+    std::vector<Pass> mPasses;
+    std::vector<Resource> mResources;
+    std::vector<PassHandle> mOrder; // not culled passes in execution order
+    std::vector<MemoryBlock> mMemoryBlocks;
+    QSize mFrameSize;
+    Stats mStats;
+
+    ResourceManager* mResourceMgr;
+};
@@ -0,0 +1,416 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "RenderQueue.hpp"
+#include "GraphicObject.hpp"
+#include "BufferDescr.hpp"
+#include "DrawManager.hpp"
+#include "GpuProfiler.hpp"
+#include "CpuTrace.hpp"
+#include "ParallelRecorder.hpp"
+#include <IRenderable.hpp>
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+inline uint64_t mixValue(uint64_t seed, uint64_t value)
+{
+    value ^= seed;
+    value *= 0x9E3779B97F4A7C15ull; // Fibonacci hashing - high bits are well mixed
+    return value ^ (value >> 29);
+}
+
+template <typename Handle>
+uint64_t mixHandle(uint64_t seed, Handle handle)
+{
+    return mixValue(seed, reinterpret_cast<uint64_t>(handle));
+}
+
+inline uint64_t topBits(uint64_t value, uint32_t bits)
+{
+    return value >> (64 - bits);
+}
+
+inline uint64_t depthBits(float viewDepth)
+{
+    viewDepth = std::max(viewDepth, 0.f);
+    uint32_t bits = 0;
+    memcpy(&bits, &viewDepth, sizeof(bits));
+    return bits >> 16; // positive floats keep their order when compared as integers
+}
+
+}
+
+uint32_t RenderQueue::Stats::stateChangesSkipped() const
+{
+    return pipelineBindsSkipped + descriptorSetBindsSkipped + vertexBufferBindsSkipped + indexBufferBindsSkipped + pushConstantsSkipped;
+}
+
+RenderQueue::Stats& RenderQueue::Stats::operator+=(const Stats& other)
+{
+    items += other.items;
+    draws += other.draws;
+    customDraws += other.customDraws;
+    pipelineBinds += other.pipelineBinds;
+    pipelineBindsSkipped += other.pipelineBindsSkipped;
+    descriptorSetBinds += other.descriptorSetBinds;
+    descriptorSetBindsSkipped += other.descriptorSetBindsSkipped;
+    vertexBufferBinds += other.vertexBufferBinds;
+    vertexBufferBindsSkipped += other.vertexBufferBindsSkipped;
+    indexBufferBinds += other.indexBufferBinds;
+    indexBufferBindsSkipped += other.indexBufferBindsSkipped;
+    pushConstants += other.pushConstants;
+    pushConstantsSkipped += other.pushConstantsSkipped;
+    recordingChunks += other.recordingChunks;
+    instances += other.instances;
+    instancedDraws += other.instancedDraws;
+    instancesDropped += other.instancesDropped;
+    return *this;
+}
+
+uint64_t RenderQueue::makeKey(const GraphicObject& go, float viewDepth)
+{
+    assert(go.pipelineInfo);
+
+    uint64_t pipelineHash = mixHandle(0, go.pipelineInfo->pipeline);
+
+    uint64_t descriptorHash = 0;
+    for (size_t descriptorSetIdx = 0; descriptorSetIdx < go.pipelineInfo->descriptorSetInfo.size(); ++descriptorSetIdx) {
+        descriptorHash = mixHandle(descriptorHash, go.descriptorSet(descriptorSetIdx));
+    }
+
+    uint64_t vertexHash = 0;
+    for (const BufferDescr* vertexBuffer : go.vertices) {
+        vertexHash = mixHandle(vertexHash, vertexBuffer->getBuffer());
+    }
+    vertexHash = mixHandle(vertexHash, go.indices ? go.indices->getBuffer() : nullptr);
+
+    // Meshes sharing GeometryArena buffers differ only in their range - it is a tie-breaker below buffer bits,
+    // so they stay next to each other (no rebinds) and the same mesh stays together (instance batching)
+    uint64_t rangeHash = mixValue(mixValue(0, go.firstIndex), static_cast<uint32_t>(go.vertexOffset));
+
+    return topBits(pipelineHash, 12)   << 52
+         | topBits(descriptorHash, 20) << 32
+         | topBits(vertexHash, 12)     << 20
+         | topBits(rangeHash, 4)       << 16
+         | depthBits(viewDepth);
+}
+
+void RenderQueue::clear()
+{
+    mItems.clear();
+    mInstances.clear();
+    mBatchStats = Stats();
+}
+
+void RenderQueue::push(const GraphicObject& go, IRenderable* renderable, float viewDepth)
+{
+    if (!go.pipelineInfo) {
+        qWarning("%s does not contain pipelineInfo object! Not added to render queue.", renderable ? renderable->id() : "");
+        return;
+    }
+    mItems.push_back({makeKey(go, viewDepth), &go, renderable, NoInstance, 1, nullptr, 0});
+}
+
+void RenderQueue::pushCustom(IRenderable* renderable, uint64_t key)
+{
+    assert(renderable);
+    mItems.push_back({key, nullptr, renderable, NoInstance, 1, nullptr, 0});
+}
+
+void RenderQueue::pushInstance(const GraphicObject& go, IRenderable* renderable, const InstanceData& instance, float viewDepth)
+{
+    if (!go.pipelineInfo) {
+        qWarning("%s does not contain pipelineInfo object! Not added to render queue.", renderable ? renderable->id() : "");
+        return;
+    }
+    uint32_t instanceIdx = static_cast<uint32_t>(mInstances.size());
+    mInstances.push_back(instance);
+    mItems.push_back({makeKey(go, viewDepth), &go, renderable, instanceIdx, 1, nullptr, 0});
+}
+
+void RenderQueue::sort()
+{
+    std::sort(mItems.begin(), mItems.end(), [](const Item& a, const Item& b) { return a.key < b.key; });
+}
+
+bool RenderQueue::canBatch(const GraphicObject& a, const GraphicObject& b)
+{
+    if (&a == &b) {
+        return true;
+    }
+    if (a.pipelineInfo != b.pipelineInfo
+     || a.vertices.size() != b.vertices.size()
+     || a.indices->getBuffer() != b.indices->getBuffer()
+     || a.indexType != b.indexType
+     || a.indicesCount != b.indicesCount
+     || a.firstIndex != b.firstIndex
+     || a.vertexOffset != b.vertexOffset
+     || a.pushConstants != b.pushConstants) {
+        return false;
+    }
+    for (size_t binding = 0; binding < a.vertices.size(); ++binding) {
+        if (a.vertices[binding]->getBuffer() != b.vertices[binding]->getBuffer()) {
+            return false;
+        }
+    }
+    for (size_t descriptorSetIdx = 0; descriptorSetIdx < a.pipelineInfo->descriptorSetInfo.size(); ++descriptorSetIdx) {
+        if (a.descriptorSet(descriptorSetIdx) != b.descriptorSet(descriptorSetIdx)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void RenderQueue::batchInstances(InstanceBuffer& instanceBuffer)
+{
+    mBatchedItems.clear();
+    mBatchedItems.reserve(mItems.size());
+
+    size_t itemIdx = 0;
+    while (itemIdx < mItems.size()) {
+        const Item& first = mItems[itemIdx];
+        if (first.instanceIdx == NoInstance) {
+            mBatchedItems.push_back(first);
+            ++itemIdx;
+            continue;
+        }
+
+        // Sorting put items with the same pipeline/sets/mesh next to each other, ordered by depth
+        size_t batchEnd = itemIdx + 1;
+        while (batchEnd < mItems.size()
+            && mItems[batchEnd].instanceIdx != NoInstance
+            && canBatch(*first.go, *mItems[batchEnd].go)) {
+            ++batchEnd;
+        }
+
+        uint32_t instanceCount = static_cast<uint32_t>(batchEnd - itemIdx);
+        InstanceBuffer::Allocation allocation = instanceBuffer.allocate(instanceCount);
+        if (!allocation.data) {
+            mBatchStats.instancesDropped += instanceCount;
+            itemIdx = batchEnd;
+            continue;
+        }
+        for (uint32_t instance = 0; instance < instanceCount; ++instance) {
+            allocation.data[instance] = mInstances[mItems[itemIdx + instance].instanceIdx];
+        }
+
+        Item batch = first;
+        batch.instanceCount = instanceCount;
+        batch.instanceBuffer = allocation.buffer;
+        batch.instanceOffset = allocation.offset;
+        mBatchedItems.push_back(batch);
+        itemIdx = batchEnd;
+    }
+    mItems.swap(mBatchedItems);
+
+    if (mBatchStats.instancesDropped) {
+        qWarning("Instance buffer is full - %d instances not drawn in this frame", mBatchStats.instancesDropped);
+    }
+}
+
+void RenderQueue::submit(DrawManager* drawMgr, VulkanDeviceFunctions& devFuncs, ParallelRecorder* recorder)
+{
+    assert(drawMgr);
+    if (!drawMgr->getCmdBuffer()) {
+        qWarning("Invalid command buffer provided! While submitting render queue");
+        return;
+    }
+
+    mStats = mBatchStats;
+    if (!recorder || recorder->workerCount() == 0) {
+        record(0, mItems.size(), drawMgr, devFuncs, mStats);
+        return;
+    }
+
+    // Each chunk writes only its own stats - merged after all workers finished
+    mChunkStats.assign(recorder->workerCount(), Stats());
+    uint32_t chunks = recorder->record(drawMgr, mItems.size(), [this, &devFuncs](size_t first, size_t last, DrawManager* workerDrawMgr, uint32_t chunkIdx) {
+        record(first, last, workerDrawMgr, devFuncs, mChunkStats[chunkIdx]);
+    });
+    for (uint32_t chunkIdx = 0; chunkIdx < chunks; ++chunkIdx) {
+        mStats += mChunkStats[chunkIdx];
+    }
+    mStats.recordingChunks = chunks;
+}
+
+void RenderQueue::record(size_t first, size_t last, DrawManager* drawMgr, VulkanDeviceFunctions& devFuncs, Stats& stats) const
+{
+    TRACE_SCOPE("RenderQueue::record");
+    VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
+    stats.items += static_cast<uint32_t>(last - first);
+
+    //
+    // State cache - what is currently bound in cmdBuf
+    //
+    VkPipeline boundPipeline = nullptr;
+    VkPipelineLayout boundLayout = nullptr;
+    FrameArena* arena = drawMgr->frameArena(); // scratch arrays - no heap allocation per recorded chunk
+    FrameVector<VkDescriptorSet> boundSets = makeFrameVector<VkDescriptorSet>(arena);
+    FrameVector<VkBuffer> boundVertexBuffers = makeFrameVector<VkBuffer>(arena);
+    FrameVector<VkDeviceSize> vertexOffsets = makeFrameVector<VkDeviceSize>(arena);
+    VkBuffer boundIndexBuffer = nullptr;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_UINT16;
+    const std::vector<uint8_t>* boundPushConstants = nullptr;
+
+    for (size_t itemIdx = first; itemIdx < last; ++itemIdx) {
+        const Item& item = mItems[itemIdx];
+        GpuScope gpuScope(drawMgr, item.renderable ? item.renderable->id() : "Draw");
+        if (!item.go) {
+            item.renderable->draw(drawMgr);
+            ++stats.customDraws;
+            // Custom recording could change anything
+            boundPipeline = nullptr;
+            boundLayout = nullptr;
+            boundSets.clear();
+            boundVertexBuffers.clear();
+            boundIndexBuffer = nullptr;
+            boundPushConstants = nullptr;
+            continue;
+        }
+
+        if (item.instanceIdx != NoInstance && !item.instanceBuffer) {
+            assert(false && "Instance items have to be batched before submit!");
+            continue;
+        }
+
+        const GraphicObject& go = *item.go;
+        const PipelineManager::PipelineInfo* pipelineInfo = go.pipelineInfo;
+
+        //
+        // Pipeline
+        //
+        if (pipelineInfo->pipeline != boundPipeline) {
+            devFuncs.vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineInfo->pipeline);
+            boundPipeline = pipelineInfo->pipeline;
+            ++stats.pipelineBinds;
+            if (pipelineInfo->pipelineLayout != boundLayout) {
+                // Each pipeline has own layout object - treat sets as disturbed
+                boundLayout = pipelineInfo->pipelineLayout;
+                boundSets.clear();
+                boundPushConstants = nullptr;
+            }
+        }
+        else {
+            ++stats.pipelineBindsSkipped;
+        }
+
+        //
+        // Descriptor sets - only changed range is bound
+        //
+        size_t setCount = pipelineInfo->descriptorSetInfo.size();
+        if (setCount) {
+            boundSets.resize(std::max(boundSets.size(), setCount), nullptr);
+            size_t firstChanged = setCount;
+            size_t lastChanged = 0;
+            for (size_t descriptorSetIdx = 0; descriptorSetIdx < setCount; ++descriptorSetIdx) {
+                VkDescriptorSet descriptorSet = go.descriptorSet(descriptorSetIdx);
+                if (boundSets[descriptorSetIdx] != descriptorSet) {
+                    boundSets[descriptorSetIdx] = descriptorSet;
+                    firstChanged = std::min(firstChanged, descriptorSetIdx);
+                    lastChanged = descriptorSetIdx;
+                }
+            }
+            if (firstChanged < setCount) {
+                devFuncs.vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineInfo->pipelineLayout,
+                                                 static_cast<uint32_t>(firstChanged), static_cast<uint32_t>(lastChanged - firstChanged + 1), &boundSets[firstChanged], //descriptor set info
+                                                 0, nullptr); //dynamic offset
+                ++stats.descriptorSetBinds;
+            }
+            else {
+                ++stats.descriptorSetBindsSkipped;
+            }
+        }
+
+        //
+        // Push constants
+        //
+        if (!go.pushConstants.empty() && !pipelineInfo->pushConstantRanges.empty()) {
+            if (!boundPushConstants || *boundPushConstants != go.pushConstants) {
+                devFuncs.vkCmdPushConstants(cmdBuf, pipelineInfo->pipelineLayout, pipelineInfo->pushConstantRanges[0].stageFlags,
+                                            pipelineInfo->pushConstantRanges[0].offset, static_cast<uint32_t>(go.pushConstants.size()), go.pushConstants.data());
+                boundPushConstants = &go.pushConstants;
+                ++stats.pushConstants;
+            }
+            else {
+                ++stats.pushConstantsSkipped;
+            }
+        }
+
+        //
+        // Vertex buffers - only changed range is bound. Instance data follows vertex bindings.
+        //
+        bool instanced = item.instanceIdx != NoInstance;
+        size_t vertexBindings = go.vertices.size() + (instanced ? 1 : 0);
+        if (vertexBindings) {
+            boundVertexBuffers.resize(std::max(boundVertexBuffers.size(), vertexBindings), nullptr);
+            vertexOffsets.resize(boundVertexBuffers.size(), 0);
+            size_t firstChanged = vertexBindings;
+            size_t lastChanged = 0;
+            for (size_t binding = 0; binding < vertexBindings; ++binding) {
+                bool instanceBinding = binding == go.vertices.size();
+                VkBuffer vertexBuffer = instanceBinding ? item.instanceBuffer : go.vertices[binding]->getBuffer();
+                VkDeviceSize vertexOffset = instanceBinding ? item.instanceOffset : 0;
+                if (boundVertexBuffers[binding] != vertexBuffer || vertexOffsets[binding] != vertexOffset) {
+                    boundVertexBuffers[binding] = vertexBuffer;
+                    vertexOffsets[binding] = vertexOffset;
+                    firstChanged = std::min(firstChanged, binding);
+                    lastChanged = binding;
+                }
+            }
+            if (firstChanged < vertexBindings) {
+                devFuncs.vkCmdBindVertexBuffers(cmdBuf, static_cast<uint32_t>(firstChanged), static_cast<uint32_t>(lastChanged - firstChanged + 1),
+                                                &boundVertexBuffers[firstChanged], &vertexOffsets[firstChanged]);
+                ++stats.vertexBufferBinds;
+            }
+            else {
+                ++stats.vertexBufferBindsSkipped;
+            }
+        }
+
+        //
+        // Index buffer
+        //
+        if (go.indices->getBuffer() != boundIndexBuffer || go.indexType != boundIndexType) {
+            VkDeviceSize indexOffset = 0;
+            devFuncs.vkCmdBindIndexBuffer(cmdBuf, go.indices->getBuffer(), indexOffset, go.indexType);
+            boundIndexBuffer = go.indices->getBuffer();
+            boundIndexType = go.indexType;
+            ++stats.indexBufferBinds;
+        }
+        else {
+            ++stats.indexBufferBindsSkipped;
+        }
+
+        devFuncs.vkCmdDrawIndexed(cmdBuf, go.indicesCount, item.instanceCount, go.firstIndex, go.vertexOffset, 0);
+        ++stats.draws;
+        if (instanced) {
+            stats.instances += item.instanceCount;
+            ++stats.instancedDraws;
+        }
+    }
+}
@@ -0,0 +1,131 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "InstanceBuffer.hpp"
+
+class IRenderable;
+class DrawManager;
+class ParallelRecorder;
+struct VulkanDeviceFunctions;
+struct GraphicObject;
+
+///
+/// List of draw items collected each frame. Items are sorted by packed key
+/// (pipeline, descriptor sets, vertex buffer, depth) and recorded with state cache,
+/// so redundant pipeline/descriptor/vertex/index binds are skipped.
+/// Instance items (pushInstance) sharing mesh, pipeline and descriptor sets are merged into one instanced draw.
+///
+class RenderQueue
+{
+public:
+    static const uint32_t NoInstance = ~0u;
+
+    struct Item {
+        uint64_t key;
+        const GraphicObject* go; // nullptr - custom item, renderable->draw() is invoked
+        IRenderable* renderable;
+        uint32_t instanceIdx;        // index of data from pushInstance, NoInstance - not instanced draw
+        uint32_t instanceCount;      // filled by batchInstances
+        VkBuffer instanceBuffer;     // bound at binding go->vertices.size()
+        VkDeviceSize instanceOffset;
+    };
+
+    struct Stats {
+        uint32_t items = 0;
+        uint32_t draws = 0;
+        uint32_t customDraws = 0;
+        uint32_t pipelineBinds = 0;
+        uint32_t pipelineBindsSkipped = 0;
+        uint32_t descriptorSetBinds = 0;        // vkCmdBindDescriptorSets calls
+        uint32_t descriptorSetBindsSkipped = 0; // calls not issued because all sets were already bound
+        uint32_t vertexBufferBinds = 0;
+        uint32_t vertexBufferBindsSkipped = 0;
+        uint32_t indexBufferBinds = 0;
+        uint32_t indexBufferBindsSkipped = 0;
+        uint32_t pushConstants = 0;
+        uint32_t pushConstantsSkipped = 0;
+
+        uint32_t recordingChunks = 0; // command buffers recorded in parallel, 0 - recorded inline
+        uint32_t instances = 0;       // instances drawn by instanced draws
+        uint32_t instancedDraws = 0;
+        uint32_t instancesDropped = 0; // not drawn - instance buffer was full
+
+        uint32_t stateChangesSkipped() const;
+        Stats& operator+=(const Stats& other);
+    };
+
+    ///
+    /// Key layout (from most significant): pipeline 12b | descriptor sets 20b | vertex buffer 12b | mesh range 4b | depth 16b
+    /// Handles are hashed to the field width - collision can only make sorting worse, never the result wrong.
+    /// viewDepth - distance in front of the camera, smaller is drawn first (front to back)
+    ///
+    static uint64_t makeKey(const GraphicObject& go, float viewDepth);
+
+    void clear();
+    void push(const GraphicObject& go, IRenderable* renderable, float viewDepth);
+    void pushCustom(IRenderable* renderable, uint64_t key);
+
+    ///
+    /// go has to use pipeline with per instance inputs matching InstanceData (PipelineManager::ApInstanceAttributesFromLocation).
+    /// The same go can be pushed by many renderables.
+    ///
+    void pushInstance(const GraphicObject& go, IRenderable* renderable, const InstanceData& instance, float viewDepth);
+    void sort();
+
+    ///
+    /// Has to be called after sort(). Neighbouring instance items which can be drawn together are merged
+    /// and their data is copied into instanceBuffer. Instances which do not fit into buffer are dropped.
+    ///
+    void batchInstances(InstanceBuffer& instanceBuffer);
+
+    ///
+    /// Record all items into command buffer of drawMgr. Has to be called inside render pass.
+    /// With recorder (having workers) items are split into contiguous ranges recorded into secondary
+    /// command buffers in parallel - render pass has to be begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+    /// and custom items (IRenderable::draw) have to be safe to call from worker threads.
+    ///
+    void submit(DrawManager* drawMgr, VulkanDeviceFunctions& devFuncs, ParallelRecorder* recorder = nullptr);
+
+    const std::vector<Item>& items() const { return mItems; }
+    const Stats& stats() const { return mStats; }
+
+protected:
+    ///
+    /// Record items [first, last) with fresh state cache - cache is not shared between command buffers
+    ///
+    void record(size_t first, size_t last, DrawManager* drawMgr, VulkanDeviceFunctions& devFuncs, Stats& stats) const;
+
+    static bool canBatch(const GraphicObject& a, const GraphicObject& b);
+
+    std::vector<Item> mItems;
+    std::vector<Item> mBatchedItems;
+    std::vector<InstanceData> mInstances;
+    std::vector<Stats> mChunkStats;
+    Stats mBatchStats;
+    Stats mStats;
+};
@@ -23,29 +23,31 @@ SOFTWARE.
 */
 
 #include "ResourceManager.hpp"
-#include <QVulkanInstance>
-#include <QVulkanFunctions>
-#include <QVulkanDeviceFunctions>
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
 #include <assert.h>
+#include <cstring>
+#include <algorithm>
 
 std::map<VkDevice, VkPhysicalDeviceMemoryProperties> ResourceManager::sMemPropMap;
 
-ResourceManager::ResourceManager(QVulkanInstance &vulkanInstance,
+ResourceManager::ResourceManager(const VulkanInstanceFunctions &instanceFuncs,
+                                 VulkanDeviceFunctions *devFuncs,
                                  VkDevice device,
                                  VkPhysicalDevice physicalDev)
-    : mVulkanInstance(vulkanInstance)
+    : mInstanceFuncs(instanceFuncs)
+    , mDevFuncs(devFuncs)
     , mDevice(device)
     , mPhysicalDev(physicalDev)
 {
     assert(mDevice && "Device should be valid!");
-    mDevFuncs = vulkanInstance.deviceFunctions(mDevice);
     assert(mDevFuncs && "Device functions should be valid!");
+    mStateTracker = std::unique_ptr<ResourceStateTracker>(new ResourceStateTracker(mDevFuncs));
 
-    QVulkanFunctions *vulkanFunc = vulkanInstance.functions();
-    assert(vulkanFunc && "Vulkan instance functions should be valid!");
+    assert(mInstanceFuncs.vkGetPhysicalDeviceMemoryProperties && "Vulkan instance functions should be valid!");
     assert(physicalDev && "Physical device should be valid!");
     VkPhysicalDeviceMemoryProperties& memProperties = sMemPropMap[device];
-    vulkanFunc->vkGetPhysicalDeviceMemoryProperties(physicalDev, &memProperties);
+    mInstanceFuncs.vkGetPhysicalDeviceMemoryProperties(physicalDev, &memProperties);
 }
 
 ImageDescr* ResourceManager::createImage()
@@ -72,12 +74,157 @@ BufferDescr* ResourceManager::createBuffer()
     return mBuffers.back().get();
 }
 
-const QVulkanInstance& ResourceManager::vulkanInstance() const
+BindlessTextureTable* ResourceManager::enableBindlessTextures(uint32_t maxTextures)
 {
-    return mVulkanInstance;
+    if (mBindlessTextures) {
+        return mBindlessTextures.get();
+    }
+
+    //
+    // Extension
+    //
+    if (!isDeviceExtensionSupported(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME)) {
+        qInfo("Bindless textures not available - missing %s", VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+        return nullptr;
+    }
+
+    //
+    // Features and limits - Vulkan 1.1 or VK_KHR_get_physical_device_properties2
+    //
+    PFN_vkGetPhysicalDeviceFeatures2 getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(mInstanceFuncs.procAddr("vkGetPhysicalDeviceFeatures2"));
+    if (!getFeatures2) {
+        getFeatures2 = reinterpret_cast<PFN_vkGetPhysicalDeviceFeatures2>(mInstanceFuncs.procAddr("vkGetPhysicalDeviceFeatures2KHR"));
+    }
+    PFN_vkGetPhysicalDeviceProperties2 getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(mInstanceFuncs.procAddr("vkGetPhysicalDeviceProperties2"));
+    if (!getProperties2) {
+        getProperties2 = reinterpret_cast<PFN_vkGetPhysicalDeviceProperties2>(mInstanceFuncs.procAddr("vkGetPhysicalDeviceProperties2KHR"));
+    }
+    if (!getFeatures2 || !getProperties2) {
+        qInfo("Bindless textures not available - can't query descriptor indexing features");
+        return nullptr;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures = {};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+    VkPhysicalDeviceFeatures2 features = {};
+    features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features.pNext = &indexingFeatures;
+    getFeatures2(mPhysicalDev, &features);
+
+    if (!indexingFeatures.runtimeDescriptorArray
+     || !indexingFeatures.descriptorBindingPartiallyBound
+     || !indexingFeatures.descriptorBindingSampledImageUpdateAfterBind
+     || !indexingFeatures.descriptorBindingUpdateUnusedWhilePending) {
+        qInfo("Bindless textures not available - descriptor indexing features are missing");
+        return nullptr;
+    }
+
+    VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProps = {};
+    indexingProps.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+    VkPhysicalDeviceProperties2 props = {};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    props.pNext = &indexingProps;
+    getProperties2(mPhysicalDev, &props);
+
+    uint32_t limit = std::min(indexingProps.maxDescriptorSetUpdateAfterBindSampledImages,
+                              indexingProps.maxPerStageDescriptorUpdateAfterBindSampledImages);
+    limit = std::min(limit, indexingProps.maxDescriptorSetUpdateAfterBindSamplers);
+    if (maxTextures > limit) {
+        qWarning("Bindless texture table limited by device from %d to %d", maxTextures, limit);
+        maxTextures = limit;
+    }
+
+    std::unique_ptr<BindlessTextureTable> table(new BindlessTextureTable(this));
+    if (!table->create(maxTextures)) {
+        return nullptr;
+    }
+    mBindlessTextures = std::move(table);
+    return mBindlessTextures.get();
 }
 
-QVulkanDeviceFunctions* ResourceManager::deviceFunctions() const
+bool ResourceManager::isDeviceExtensionSupported(const char* extensionName) const
+{
+    uint32_t extCount = 0;
+    mInstanceFuncs.vkEnumerateDeviceExtensionProperties(mPhysicalDev, nullptr, &extCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extCount);
+    mInstanceFuncs.vkEnumerateDeviceExtensionProperties(mPhysicalDev, nullptr, &extCount, extensions.data());
+    return std::any_of(extensions.begin(), extensions.end(),
+                       [extensionName](const VkExtensionProperties& ext) { return strcmp(ext.extensionName, extensionName) == 0; });
+}
+
+PFN_vkCmdDrawIndexedIndirectCountKHR ResourceManager::cmdDrawIndexedIndirectCount()
+{
+    if (mDrawIndirectCountResolved) {
+        return mCmdDrawIndexedIndirectCount;
+    }
+    mDrawIndirectCountResolved = true;
+
+    if (!isDeviceExtensionSupported(VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME)) {
+        qInfo("%s is not supported - indirect draws are issued one by one", VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME);
+        return nullptr;
+    }
+    // VulkanDeviceFunctions knows only Vulkan 1.0 functions
+    mCmdDrawIndexedIndirectCount = reinterpret_cast<PFN_vkCmdDrawIndexedIndirectCountKHR>(deviceProcAddr("vkCmdDrawIndexedIndirectCountKHR"));
+    return mCmdDrawIndexedIndirectCount;
+}
+
+PFN_vkVoidFunction ResourceManager::instanceProcAddr(const char* name) const
+{
+    return mInstanceFuncs.procAddr(name);
+}
+
+PFN_vkVoidFunction ResourceManager::deviceProcAddr(const char* name) const
+{
+    return mInstanceFuncs.vkGetDeviceProcAddr ? mInstanceFuncs.vkGetDeviceProcAddr(mDevice, name) : nullptr;
+}
+
+BindlessTextureTable* ResourceManager::bindlessTextures() const
+{
+    return mBindlessTextures.get();
+}
+
+ResourceStateTracker* ResourceManager::stateTracker() const
+{
+    return mStateTracker.get();
+}
+
+GeometryArena* ResourceManager::geometryArena(uint32_t vertexStride)
+{
+    std::unique_ptr<GeometryArena>& arena = mGeometryArenas[vertexStride];
+    if (!arena) {
+        const uint32_t vertexCapacity = 1024 * 1024;
+        const uint32_t indexCapacity = 4 * 1024 * 1024;
+        std::unique_ptr<GeometryArena> newArena(new GeometryArena(this, vertexStride));
+        if (!newArena->create(vertexCapacity, indexCapacity)) {
+            mGeometryArenas.erase(vertexStride);
+            return nullptr;
+        }
+        arena = std::move(newArena);
+    }
+    return arena.get();
+}
+
+GraphicObject* ResourceManager::sharedObject(const std::string& name, bool& created)
+{
+    std::unique_ptr<GraphicObject>& object = mSharedObjects[name];
+    created = !object;
+    if (created) {
+        object = std::unique_ptr<GraphicObject>(new GraphicObject());
+    }
+    return object.get();
+}
+
+void ResourceManager::releaseSharedObject(const std::string& name)
+{
+    mSharedObjects.erase(name);
+}
+
+const VulkanInstanceFunctions& ResourceManager::instanceFunctions() const
+{
+    return mInstanceFuncs;
+}
+
+VulkanDeviceFunctions* ResourceManager::deviceFunctions() const
 {
     return mDevFuncs;
 }
@@ -96,3 +243,14 @@ const VkPhysicalDeviceMemoryProperties& ResourceManager::phyDevMemProps() const
 {
     return sMemPropMap[mDevice];
 }
+
+uint32_t ResourceManager::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const
+{
+    const VkPhysicalDeviceMemoryProperties& physDevMemProps = phyDevMemProps();
+    for (uint32_t i = 0; i < physDevMemProps.memoryTypeCount; i++) {
+        if ((typeBits & (1 << i)) && (physDevMemProps.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    return ~0u;
+}
@@ -28,21 +28,26 @@ SOFTWARE.
 #include "ImageViewDescr.hpp"
 #include "SamplerDescr.hpp"
 #include "BufferDescr.hpp"
+#include "BindlessTextureTable.hpp"
+#include "ResourceStateTracker.hpp"
+#include "GeometryArena.hpp"
+#include "GraphicObject.hpp"
+#include "VulkanFunctions.hpp"
 #include <memory>
 #include <vector>
 #include <map>
+#include <string>
 #include <vulkan/vulkan.h>
 
-class QVulkanInstance;
-class QVulkanDeviceFunctions;
-
 class ResourceManager 
 {
 public:
     ///
-    /// Device should be created from provided physicalDevice
+    /// Device should be created from provided physicalDevice.
+    /// Function tables are owned by the caller and have to outlive ResourceManager.
     ///
-    ResourceManager(QVulkanInstance &vulkanInstance,
+    ResourceManager(const VulkanInstanceFunctions &instanceFuncs,
+                    VulkanDeviceFunctions *devFuncs,
                     VkDevice device,
                     VkPhysicalDevice physicalDev);
 
@@ -55,20 +60,72 @@ public:
     SamplerDescr* createSampler();
     BufferDescr* createBuffer();
 
-    const QVulkanInstance& vulkanInstance() const;
-    QVulkanDeviceFunctions* deviceFunctions() const;
+    ///
+    /// Optional bindless mode - one texture table shared by all pipelines.
+    /// Returns nullptr if device does not support descriptor indexing.
+    /// Device has to be created with VK_EXT_descriptor_indexing extension.
+    ///
+    BindlessTextureTable* enableBindlessTextures(uint32_t maxTextures);
+    BindlessTextureTable* bindlessTextures() const;
+
+    ///
+    /// Layout/access tracking of created images and buffers - barriers between their uses are generated by it.
+    ///
+    ResourceStateTracker* stateTracker() const;
+
+    ///
+    /// Shared vertex/index buffers for static meshes with given vertex stride - created on first use.
+    /// Returns nullptr if buffers can't be created.
+    ///
+    GeometryArena* geometryArena(uint32_t vertexStride);
+
+    ///
+    /// Graphic object shared by renderables of one kind (e.g. mesh and uniforms of instanced cubes) - lives with
+    /// this ResourceManager, so it never outlives the device. Created empty on first use - created is set then
+    /// and the caller fills it. releaseSharedObject forgets it, next call creates new one.
+    ///
+    GraphicObject* sharedObject(const std::string& name, bool& created);
+    void releaseSharedObject(const std::string& name);
+
+    bool isDeviceExtensionSupported(const char* extensionName) const;
+
+    ///
+    /// VK_KHR_draw_indirect_count entry point (core in Vulkan 1.2), nullptr if not available.
+    /// Device has to be created with this extension.
+    ///
+    PFN_vkCmdDrawIndexedIndirectCountKHR cmdDrawIndexedIndirectCount();
+
+    ///
+    /// Entry points which are not in VulkanInstanceFunctions/VulkanDeviceFunctions (extensions, Vulkan > 1.0), nullptr if not available.
+    ///
+    PFN_vkVoidFunction instanceProcAddr(const char* name) const;
+    PFN_vkVoidFunction deviceProcAddr(const char* name) const;
+
+    const VulkanInstanceFunctions& instanceFunctions() const;
+    VulkanDeviceFunctions* deviceFunctions() const;
     VkDevice device() const;
     VkPhysicalDevice physicalDevice() const;
     const VkPhysicalDeviceMemoryProperties& phyDevMemProps() const;
 
+    ///
+    /// First memory type allowed by typeBits (VkMemoryRequirements::memoryTypeBits) with all requested properties, ~0u if none.
+    ///
+    uint32_t findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+
 private:
     std::vector<std::unique_ptr<BufferDescr>> mBuffers;
     std::vector<std::unique_ptr<ImageDescr>> mImages;
     std::vector<std::unique_ptr<ImageViewDescr>> mImageViews;
     std::vector<std::unique_ptr<SamplerDescr>> mSamplers;
+    std::unique_ptr<BindlessTextureTable> mBindlessTextures;
+    std::unique_ptr<ResourceStateTracker> mStateTracker;
+    std::map<uint32_t, std::unique_ptr<GeometryArena>> mGeometryArenas; // key - vertex stride
+    std::map<std::string, std::unique_ptr<GraphicObject>> mSharedObjects;
+    PFN_vkCmdDrawIndexedIndirectCountKHR mCmdDrawIndexedIndirectCount = nullptr;
+    bool mDrawIndirectCountResolved = false;
 
-    QVulkanInstance &mVulkanInstance;
-    QVulkanDeviceFunctions *mDevFuncs;
+    const VulkanInstanceFunctions &mInstanceFuncs;
+    VulkanDeviceFunctions *mDevFuncs;
     VkDevice mDevice;
     VkPhysicalDevice mPhysicalDev;
     static std::map<VkDevice, VkPhysicalDeviceMemoryProperties> sMemPropMap; // TODO make it thread safe
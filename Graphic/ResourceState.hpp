@@ -0,0 +1,40 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+///
+/// Last known GPU usage of image or buffer in recording order - maintained by ResourceStateTracker.
+///
+struct ResourceState
+{
+    VkImageLayout        layout = VK_IMAGE_LAYOUT_UNDEFINED; // images only
+    VkPipelineStageFlags writeStages = 0;   // last write or layout transition, 0 - nothing pending
+    VkAccessFlags        writeAccess = 0;
+    VkPipelineStageFlags visibleStages = 0; // stages/accesses which already wait for the last write
+    VkAccessFlags        visibleAccess = 0;
+    VkPipelineStageFlags readStages = 0;    // reads since last write - next write has to wait for them
+};
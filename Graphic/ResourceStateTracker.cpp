@@ -0,0 +1,173 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ResourceStateTracker.hpp"
+#include "ImageDescr.hpp"
+#include "BufferDescr.hpp"
+#include "VulkanFunctions.hpp"
+#include <assert.h>
+
+namespace {
+
+const VkAccessFlags WriteAccessMask = VK_ACCESS_SHADER_WRITE_BIT
+                                    | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                    | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+                                    | VK_ACCESS_TRANSFER_WRITE_BIT
+                                    | VK_ACCESS_HOST_WRITE_BIT
+                                    | VK_ACCESS_MEMORY_WRITE_BIT;
+
+}
+
+ResourceStateTracker::ResourceStateTracker(VulkanDeviceFunctions* devFuncs)
+    : mDevFuncs(devFuncs)
+{
+    assert(mDevFuncs && "Device functions should be valid!");
+}
+
+bool ResourceStateTracker::isWriteAccess(VkAccessFlags access)
+{
+    return (access & WriteAccessMask) != 0;
+}
+
+bool ResourceStateTracker::transition(ResourceState& state, VkImageLayout newLayout, VkPipelineStageFlags stage, VkAccessFlags access,
+                                      VkPipelineStageFlags& srcStages, VkAccessFlags& srcAccess)
+{
+    bool layoutChange = newLayout != state.layout;
+    if (layoutChange || isWriteAccess(access)) {
+        // Layout transition is a write as well - has to wait for previous reads and writes
+        srcStages = state.writeStages | state.readStages;
+        srcAccess = state.writeAccess; // reads don't need flush, only execution dependency
+        bool needed = layoutChange || srcStages != 0;
+
+        state.layout = newLayout;
+        state.writeStages = stage;
+        state.writeAccess = access & WriteAccessMask;
+        state.visibleStages = layoutChange ? stage : 0; // transition result is visible to dst of its barrier
+        state.visibleAccess = layoutChange ? (access & ~WriteAccessMask) : 0;
+        state.readStages = 0;
+        return needed;
+    }
+
+    // Read in the same layout
+    state.readStages |= stage;
+    if (!state.writeStages) {
+        return false; // nothing written by GPU since resource was idle
+    }
+    if ((stage & ~state.visibleStages) == 0 && (access & ~state.visibleAccess) == 0) {
+        return false; // already waits for the last write
+    }
+    srcStages = state.writeStages;
+    srcAccess = state.writeAccess;
+    state.visibleStages |= stage;
+    state.visibleAccess |= access;
+    return true;
+}
+
+void ResourceStateTracker::useImage(ImageDescr& image, VkImageLayout layout, VkPipelineStageFlags stage, VkAccessFlags access,
+                                    VkImageAspectFlags aspect)
+{
+    assert(image.getImage() && "Image has to be created!");
+    VkImageLayout oldLayout = image.state().layout;
+    VkPipelineStageFlags srcStages = 0;
+    VkAccessFlags srcAccess = 0;
+    if (!transition(image.state(), layout, stage, access, srcStages, srcAccess)) {
+        ++mStats.skipped;
+        return;
+    }
+
+    VkImageMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = access;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = layout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image.getImage();
+    barrier.subresourceRange.aspectMask = aspect;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+    mImageBarriers.push_back(barrier);
+
+    mSrcStages |= srcStages;
+    mDstStages |= stage;
+}
+
+void ResourceStateTracker::useBuffer(BufferDescr& buffer, VkPipelineStageFlags stage, VkAccessFlags access)
+{
+    assert(buffer.getBuffer() && "Buffer has to be created!");
+    VkPipelineStageFlags srcStages = 0;
+    VkAccessFlags srcAccess = 0;
+    if (!transition(buffer.state(), VK_IMAGE_LAYOUT_UNDEFINED, stage, access, srcStages, srcAccess)) {
+        ++mStats.skipped;
+        return;
+    }
+
+    VkBufferMemoryBarrier barrier = {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = access;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer.getBuffer();
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    mBufferBarriers.push_back(barrier);
+
+    mSrcStages |= srcStages;
+    mDstStages |= stage;
+}
+
+void ResourceStateTracker::markIdle(BufferDescr& buffer)
+{
+    buffer.state() = ResourceState();
+}
+
+bool ResourceStateTracker::flush(VkCommandBuffer cmdBuf)
+{
+    if (!hasPendingBarriers()) {
+        return false;
+    }
+    assert(cmdBuf && "Command buffer should be valid!");
+
+    mDevFuncs->vkCmdPipelineBarrier(cmdBuf,
+                                    mSrcStages ? mSrcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, // first use - nothing to wait for
+                                    mDstStages,
+                                    0,
+                                    0, nullptr,
+                                    static_cast<uint32_t>(mBufferBarriers.size()), mBufferBarriers.data(),
+                                    static_cast<uint32_t>(mImageBarriers.size()), mImageBarriers.data());
+
+    mStats.imageBarriers += static_cast<uint32_t>(mImageBarriers.size());
+    mStats.bufferBarriers += static_cast<uint32_t>(mBufferBarriers.size());
+    ++mStats.pipelineBarriers;
+
+    mImageBarriers.clear();
+    mBufferBarriers.clear();
+    mSrcStages = 0;
+    mDstStages = 0;
+    return true;
+}
@@ -0,0 +1,90 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <vector>
+#include "ResourceState.hpp"
+
+struct VulkanDeviceFunctions;
+class ImageDescr;
+class BufferDescr;
+
+///
+/// Tracks layout and access of images and buffers (ResourceState) in command recording order.
+/// use...() declares how resource is going to be used next, barrier is queued only if it is really needed:
+///  - layout change or write after read/write - always,
+///  - read after write - only if these stages/accesses don't wait for the write yet,
+///  - read after read in the same layout - never.
+/// flush() records all queued barriers with one vkCmdPipelineBarrier.
+/// Not thread safe - used while recording primary command buffer.
+///
+class ResourceStateTracker
+{
+public:
+    struct Stats {
+        uint32_t imageBarriers = 0;
+        uint32_t bufferBarriers = 0;
+        uint32_t pipelineBarriers = 0;  // vkCmdPipelineBarrier calls
+        uint32_t skipped = 0;           // use...() requests which didn't need barrier
+    };
+
+    explicit ResourceStateTracker(VulkanDeviceFunctions* devFuncs);
+
+    void useImage(ImageDescr& image, VkImageLayout layout, VkPipelineStageFlags stage, VkAccessFlags access,
+                  VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT);
+    void useBuffer(BufferDescr& buffer, VkPipelineStageFlags stage, VkAccessFlags access);
+
+    ///
+    /// All earlier GPU work on buffer is known to be finished (e.g. per frame buffer after its fence) and content can be discarded.
+    ///
+    void markIdle(BufferDescr& buffer);
+
+    ///
+    /// Record queued barriers. Returns false if there was nothing to record.
+    ///
+    bool flush(VkCommandBuffer cmdBuf);
+    bool hasPendingBarriers() const { return !mImageBarriers.empty() || !mBufferBarriers.empty(); }
+
+    const Stats& stats() const { return mStats; }
+    void resetStats() { mStats = Stats(); }
+
+    static bool isWriteAccess(VkAccessFlags access);
+
+protected:
+    ///
+    /// Decide about barrier and update state. Returns false if barrier is not needed.
+    ///
+    bool transition(ResourceState& state, VkImageLayout newLayout, VkPipelineStageFlags stage, VkAccessFlags access,
+                    VkPipelineStageFlags& srcStages, VkAccessFlags& srcAccess);
+
+    std::vector<VkImageMemoryBarrier> mImageBarriers;
+    std::vector<VkBufferMemoryBarrier> mBufferBarriers;
+    VkPipelineStageFlags mSrcStages = 0;
+    VkPipelineStageFlags mDstStages = 0;
+
+    Stats mStats;
+    VulkanDeviceFunctions* mDevFuncs;
+};
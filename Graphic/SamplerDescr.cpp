@@ -24,9 +24,8 @@ SOFTWARE.
 
 #include "SamplerDescr.hpp"
 #include "ResourceManager.hpp"
-#include <QVulkanInstance>
-#include <QVulkanFunctions>
-#include <QVulkanDeviceFunctions>
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
 
 SamplerDescr::SamplerDescr(ResourceManager* resourceMgr)
     : mResourceMgr(resourceMgr)
@@ -41,7 +40,7 @@ SamplerDescr::~SamplerDescr()
 
 bool SamplerDescr::createSampler(const VkSamplerCreateInfo& samplerInfo)
 {
-    QVulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
 
     VkResult result = devFuncs->vkCreateSampler(device, &samplerInfo, nullptr, &mSampler);
@@ -54,7 +53,7 @@ bool SamplerDescr::createSampler(const VkSamplerCreateInfo& samplerInfo)
 
 void SamplerDescr::release()
 {
-    QVulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions* devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
 
     devFuncs->vkDestroySampler(device, mSampler, nullptr);
@@ -0,0 +1,147 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "Scene.hpp"
+#include "ResourceManager.hpp"
+#include "DrawManager.hpp"
+#include "GpuProfiler.hpp"
+#include "CpuTrace.hpp"
+#include "Frustum.hpp"
+#include "VulkanFunctions.hpp"
+
+IRenderable* Scene::add(std::unique_ptr<IRenderable> renderable)
+{
+    assert(renderable);
+    if (mResourceMgr) {
+        renderable->initResource(mResourceMgr);
+    }
+    if (mPipelineMgr) {
+        renderable->initPipeline(mPipelineMgr);
+    }
+    mRenderables.push_back(std::move(renderable));
+    return mRenderables.back().get();
+}
+
+void Scene::initResource(ResourceManager* resourceMgr, uint32_t framesInFlight)
+{
+    TRACE_SCOPE("Scene::initResource");
+    assert(resourceMgr);
+    mResourceMgr = resourceMgr;
+    mInstanceBuffer = std::unique_ptr<InstanceBuffer>(new InstanceBuffer(mResourceMgr, framesInFlight));
+    for (const std::unique_ptr<IRenderable>& renderable : mRenderables) {
+        TRACE_SCOPE(renderable->id());
+        renderable->initResource(mResourceMgr);
+    }
+}
+
+void Scene::initPipeline(PipelineManager* pipelineMgr)
+{
+    TRACE_SCOPE("Scene::initPipeline");
+    assert(pipelineMgr);
+    mPipelineMgr = pipelineMgr;
+    for (const std::unique_ptr<IRenderable>& renderable : mRenderables) {
+        TRACE_SCOPE(renderable->id());
+        renderable->initPipeline(mPipelineMgr);
+    }
+}
+
+void Scene::update(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("Scene::update");
+    for (const std::unique_ptr<IRenderable>& renderable : mRenderables) {
+        renderable->update(drawMgr);
+    }
+}
+
+void Scene::setupBarrier(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("Scene::setupBarrier");
+    assert(mResourceMgr);
+    for (const std::unique_ptr<IRenderable>& renderable : mRenderables) {
+        GpuScope gpuScope(drawMgr, renderable->id());
+        renderable->setupBarrier(drawMgr);
+    }
+    // Transitions requested by renderables through ResourceStateTracker - one barrier for all of them
+    mResourceMgr->stateTracker()->flush(drawMgr->getCmdBuffer());
+}
+
+void Scene::buildRenderQueue(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("Scene::buildRenderQueue");
+    assert(mInstanceBuffer);
+    mRenderQueue.clear();
+    if (!mFrustumCulling || !drawMgr->getProjMatrix() || !drawMgr->getViewMatrix()) {
+        for (const std::unique_ptr<IRenderable>& renderable : mRenderables) {
+            renderable->enqueue(&mRenderQueue, drawMgr);
+        }
+    }
+    else {
+        mCuller.resize(mRenderables.size());
+        for (size_t i = 0; i < mRenderables.size(); ++i) {
+            glm::vec4 sphere;
+            if (mRenderables[i]->boundingSphere(sphere)) {
+                mCuller.set(i, glm::vec3(sphere), sphere.w);
+            }
+            else {
+                mCuller.set(i, glm::vec3(0.f), BoundsCuller::AlwaysVisibleRadius);
+            }
+        }
+        const std::vector<uint8_t>& visible = mCuller.cull(Frustum::fromMatrix(*drawMgr->getProjMatrix() * *drawMgr->getViewMatrix()));
+        for (size_t i = 0; i < mRenderables.size(); ++i) {
+            if (visible[i]) {
+                mRenderables[i]->enqueue(&mRenderQueue, drawMgr);
+            }
+        }
+    }
+    mRenderQueue.sort();
+
+    mInstanceBuffer->beginFrame(drawMgr->getCurrentFrame());
+    mRenderQueue.batchInstances(*mInstanceBuffer);
+}
+
+void Scene::draw(DrawManager* drawMgr, ParallelRecorder* recorder)
+{
+    TRACE_SCOPE("Scene::draw");
+    assert(mResourceMgr);
+    mRenderQueue.submit(drawMgr, *mResourceMgr->deviceFunctions(), recorder);
+}
+
+void Scene::releasePipeline()
+{
+    mRenderQueue.clear(); // items point to objects which are going to be changed
+    for (const std::unique_ptr<IRenderable>& renderable : mRenderables) {
+        renderable->releasePipeline();
+    }
+    mPipelineMgr = nullptr;
+}
+
+void Scene::releaseResource()
+{
+    mRenderQueue.clear();
+    for (const std::unique_ptr<IRenderable>& renderable : mRenderables) {
+        renderable->releaseResource();
+    }
+    mInstanceBuffer.reset();
+    mResourceMgr = nullptr;
+}
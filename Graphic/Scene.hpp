@@ -0,0 +1,84 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <IRenderable.hpp>
+#include "RenderQueue.hpp"
+#include "BoundsCuller.hpp"
+#include <memory>
+#include <vector>
+
+class ResourceManager;
+class PipelineManager;
+class DrawManager;
+class ParallelRecorder;
+
+///
+/// Container of all renderables. Each frame it builds sorted render queue instead of drawing objects one by one.
+///
+class Scene
+{
+public:
+    ///
+    /// Scene takes ownership. Renderable added after initResource/initPipeline is initialized immediately.
+    ///
+    IRenderable* add(std::unique_ptr<IRenderable> renderable);
+    size_t size() const { return mRenderables.size(); }
+
+    ///
+    /// framesInFlight - number of per frame copies of instance data (see DrawManager::setCurrentFrame)
+    ///
+    void initResource(ResourceManager* resourceMgr, uint32_t framesInFlight);
+    void initPipeline(PipelineManager* pipelineMgr);
+    void update(DrawManager* drawMgr);
+    void setupBarrier(DrawManager* drawMgr);
+    ///
+    /// Renderables with bounding sphere outside of view frustum (DrawManager proj * view) are not enqueued.
+    ///
+    void buildRenderQueue(DrawManager* drawMgr);
+    ///
+    /// Has to be called inside render pass. With recorder render queue is recorded into secondary command buffers.
+    ///
+    void draw(DrawManager* drawMgr, ParallelRecorder* recorder = nullptr);
+    void releasePipeline();
+    void releaseResource();
+
+    const RenderQueue& renderQueue() const { return mRenderQueue; }
+
+    void setFrustumCulling(bool enable) { mFrustumCulling = enable; }
+    bool frustumCulling() const { return mFrustumCulling; }
+    BoundsCuller& boundsCuller() { return mCuller; }
+    const BoundsCuller::Stats& cullStats() const { return mCuller.stats(); }
+
+protected:
+    std::vector<std::unique_ptr<IRenderable>> mRenderables;
+    RenderQueue mRenderQueue;
+    std::unique_ptr<InstanceBuffer> mInstanceBuffer;
+    BoundsCuller mCuller; // mCuller[i] - bounds of mRenderables[i]
+    bool mFrustumCulling = true;
+
+    ResourceManager* mResourceMgr = nullptr;
+    PipelineManager* mPipelineMgr = nullptr;
+};
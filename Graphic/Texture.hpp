@@ -24,6 +24,8 @@ SOFTWARE.
 
 #pragma once
 
+#include <cstdint>
+
 class ImageDescr;
 class ImageViewDescr;
 class SamplerDescr;
@@ -33,5 +35,6 @@ struct Texture
     ImageDescr       *image;
     ImageViewDescr   *view;
     SamplerDescr     *sampler;
+    uint32_t          bindlessIndex = ~0u; // slot in BindlessTextureTable, ~0u - not registered
 };
 
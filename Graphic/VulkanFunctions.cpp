@@ -0,0 +1,67 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "VulkanFunctions.hpp"
+#include <QtGlobal>
+#include <assert.h>
+
+bool VulkanInstanceFunctions::load(PFN_vkGetInstanceProcAddr getInstanceProcAddr, VkInstance vkInstance)
+{
+    assert(getInstanceProcAddr && "vkGetInstanceProcAddr should be valid!");
+    instance = vkInstance;
+    vkGetInstanceProcAddr = getInstanceProcAddr;
+
+    bool complete = true;
+#define GRAPHIC_VK_LOAD_FUNCTION(name) \
+    name = reinterpret_cast<PFN_##name>(vkGetInstanceProcAddr(instance, #name)); \
+    if (!name) { \
+        qWarning("Missing instance function: %s", #name); \
+        complete = false; \
+    }
+    GRAPHIC_VK_INSTANCE_FUNCTIONS(GRAPHIC_VK_LOAD_FUNCTION)
+#undef GRAPHIC_VK_LOAD_FUNCTION
+    return complete;
+}
+
+PFN_vkVoidFunction VulkanInstanceFunctions::procAddr(const char* name) const
+{
+    return vkGetInstanceProcAddr ? vkGetInstanceProcAddr(instance, name) : nullptr;
+}
+
+bool VulkanDeviceFunctions::load(const VulkanInstanceFunctions& instanceFuncs, VkDevice device)
+{
+    assert(instanceFuncs.vkGetDeviceProcAddr && "Instance functions should be loaded!");
+    assert(device && "Device should be valid!");
+
+    bool complete = true;
+#define GRAPHIC_VK_LOAD_FUNCTION(name) \
+    name = reinterpret_cast<PFN_##name>(instanceFuncs.vkGetDeviceProcAddr(device, #name)); \
+    if (!name) { \
+        qWarning("Missing device function: %s", #name); \
+        complete = false; \
+    }
+    GRAPHIC_VK_DEVICE_FUNCTIONS(GRAPHIC_VK_LOAD_FUNCTION)
+#undef GRAPHIC_VK_LOAD_FUNCTION
+    return complete;
+}
@@ -24,9 +24,12 @@ SOFTWARE.
 
 #pragma once
 
+#include <glm/glm.hpp>
+
 class PipelineManager;
 class DrawManager;
 class ResourceManager;
+class RenderQueue;
 
 class IRenderable
 {
@@ -38,8 +41,15 @@ public:
     virtual void initResource(ResourceManager* resourceMgr) = 0;
     virtual void initPipeline(PipelineManager* pipelineMgr) = 0;
     virtual void update(DrawManager* drawMgr) = 0;
-    virtual void setupBarrier(DrawManager* drawMgr) = 0; // TODO probably to change
-    virtual void draw(DrawManager* drawMgr) = 0;
+    virtual void setupBarrier(DrawManager* drawMgr) = 0; // outside render pass, declare resource usage with ResourceStateTracker (flushed by Scene)
+    virtual void enqueue(RenderQueue* queue, DrawManager* drawMgr) = 0; // put draw items into queue, queue records them sorted
+    virtual void draw(DrawManager* drawMgr) = 0;                         // direct recording, used for items without GraphicObject
     virtual void releasePipeline() = 0;
     virtual void releaseResource() = 0;
+
+    ///
+    /// World space bounding sphere (xyz - center, w - radius) used by scene frustum culling.
+    /// Renderables without bounds (default) are never culled.
+    ///
+    virtual bool boundingSphere(glm::vec4& /*sphere*/) const { return false; }
 };
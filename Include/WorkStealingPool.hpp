@@ -0,0 +1,224 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+///
+/// Persistent threads for loops run every frame (e.g. TSDF integration), where starting threads per call
+/// (see Scan/Parallel.hpp) costs too much. Items [0, count) are split evenly between threads at start; thread which
+/// runs out of items steals upper half of the remaining range of another thread - items of very different cost
+/// (empty and full voxel blocks) still keep all threads busy.
+/// Calling thread works as thread 0. Not reentrant - func must not call parallelFor of the same pool.
+///
+class WorkStealingPool
+{
+public:
+    ///
+    /// first, last - items [first, last) of at most grain items, threadIdx - 0 .. threadCount()-1
+    ///
+    typedef std::function<void(size_t first, size_t last, uint32_t threadIdx)> RangeFunc;
+
+    ///
+    /// threads including calling one, 0 - hardware concurrency
+    ///
+    explicit WorkStealingPool(uint32_t threads = 0);
+    ~WorkStealingPool();
+
+    uint32_t threadCount() const { return static_cast<uint32_t>(mRanges.size()); }
+
+    void parallelFor(size_t count, size_t grain, const RangeFunc& func);
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+protected:
+    struct Range {
+        std::mutex mutex;
+        size_t first = 0;
+        size_t last = 0;
+        char padding[64]; // ranges of different threads never share cache line
+    };
+
+    void workerLoop(uint32_t threadIdx);
+    void work(uint32_t threadIdx);
+    bool steal(uint32_t threadIdx);
+
+    std::vector<std::unique_ptr<Range>> mRanges; // [threadIdx]
+    std::vector<std::thread> mWorkers;           // threads 1 .. threadCount()-1
+
+    std::mutex mMutex;
+    std::condition_variable mStartCv;
+    std::condition_variable mDoneCv;
+    uint64_t mGeneration = 0;
+    uint32_t mPending = 0;
+    bool mQuit = false;
+
+    // Current job - valid only during parallelFor()
+    const RangeFunc* mFunc = nullptr;
+    size_t mGrain = 1;
+};
+
+inline WorkStealingPool::WorkStealingPool(uint32_t threads)
+{
+    threads = threads ? threads : std::max(1u, std::thread::hardware_concurrency());
+    mRanges.reserve(threads);
+    for (uint32_t t = 0; t < threads; ++t) {
+        mRanges.emplace_back(new Range());
+    }
+    mWorkers.reserve(threads - 1);
+    for (uint32_t t = 1; t < threads; ++t) {
+        mWorkers.emplace_back(&WorkStealingPool::workerLoop, this, t);
+    }
+}
+
+inline WorkStealingPool::~WorkStealingPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mStartCv.notify_all();
+    for (std::thread& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+inline void WorkStealingPool::parallelFor(size_t count, size_t grain, const RangeFunc& func)
+{
+    if (count == 0) {
+        return;
+    }
+    grain = std::max<size_t>(1, grain);
+    uint32_t threads = threadCount();
+    if (threads == 1 || count <= grain) {
+        for (size_t first = 0; first < count; first += grain) {
+            func(first, std::min(count, first + grain), 0);
+        }
+        return;
+    }
+
+    for (uint32_t t = 0; t < threads; ++t) {
+        Range& range = *mRanges[t];
+        std::lock_guard<std::mutex> lock(range.mutex);
+        range.first = count * t / threads;
+        range.last = count * (t + 1) / threads;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mFunc = &func;
+        mGrain = grain;
+        mPending = threads - 1;
+        ++mGeneration;
+    }
+    mStartCv.notify_all();
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    mDoneCv.wait(lock, [this]() { return mPending == 0; });
+    mFunc = nullptr;
+}
+
+inline void WorkStealingPool::workerLoop(uint32_t threadIdx)
+{
+    uint64_t seenGeneration = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mStartCv.wait(lock, [this, seenGeneration]() { return mQuit || mGeneration != seenGeneration; });
+            if (mQuit) {
+                return;
+            }
+            seenGeneration = mGeneration;
+        }
+
+        work(threadIdx);
+
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (--mPending == 0) {
+                mDoneCv.notify_one();
+            }
+        }
+    }
+}
+
+inline void WorkStealingPool::work(uint32_t threadIdx)
+{
+    Range& own = *mRanges[threadIdx];
+    while (true) {
+        size_t first = 0;
+        size_t last = 0;
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            first = own.first;
+            last = std::min(own.last, first + mGrain);
+            own.first = last;
+        }
+        if (first < last) {
+            (*mFunc)(first, last, threadIdx);
+        }
+        else if (!steal(threadIdx)) {
+            return; // nothing left anywhere - ranges only shrink, so nobody can refill
+        }
+    }
+}
+
+inline bool WorkStealingPool::steal(uint32_t threadIdx)
+{
+    uint32_t threads = threadCount();
+    for (uint32_t i = 1; i < threads; ++i) {
+        Range& victim = *mRanges[(threadIdx + i) % threads];
+        size_t first = 0;
+        size_t last = 0;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.first >= victim.last) {
+                continue;
+            }
+            // victim keeps lower half - it continues from its first item, stealing doesn't disturb its cache
+            size_t remaining = victim.last - victim.first;
+            first = remaining > mGrain ? victim.first + remaining / 2 : victim.first;
+            last = victim.last;
+            victim.last = first;
+        }
+        Range& own = *mRanges[threadIdx];
+        {
+            std::lock_guard<std::mutex> lock(own.mutex);
+            own.first = first;
+            own.last = last;
+        }
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,238 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "ChunkField.hpp"
+#include <Graphic/VulkanFunctions.hpp>
+
+#include <Graphic/IndirectDrawSet.hpp>
+#include <Graphic/DrawManager.hpp>
+#include <Graphic/ResourceManager.hpp>
+#include <Graphic/RenderQueue.hpp>
+#include <Graphic/CpuTrace.hpp>
+
+Q_DECLARE_METATYPE(VkDescriptorBufferInfo);
+
+namespace {
+struct Uniform {
+    glm::mat4x4 viewProjMtx;
+};
+
+const glm::vec3 cubeCorners[] = {
+    {-1.0f,-1.0f,-1.0f},
+    {-1.0f,-1.0f, 1.0f},
+    {-1.0f, 1.0f, 1.0f},
+    { 1.0f, 1.0f, 1.0f},
+    { 1.0f, 1.0f,-1.0f},
+    { 1.0f,-1.0f,-1.0f},
+    { 1.0f,-1.0f, 1.0f},
+    {-1.0f, 1.0f,-1.0f},
+};
+
+const uint32_t cubeIndices[] = {
+    7,0,5,    4,7,5, //front
+    2,3,1,    1,3,6, //back
+    4,5,6,    3,4,6, //right
+    1,7,2,    1,0,7, //left
+    3,2,7,    3,7,4, //up
+    5,0,1,    5,1,6, //down
+};
+}
+
+ChunkField::ChunkField(uint32_t chunksPerSide, float spacing, float height)
+    : mChunksPerSide(chunksPerSide)
+    , mSpacing(spacing)
+    , mHeight(height)
+{
+    mId = "ChunkField";
+    mDescr = "Chunks culled on GPU and drawn indirectly";
+    qInfo("Creating: %s - %s", mId.c_str(), mDescr.c_str());
+}
+
+ChunkField::~ChunkField()
+{
+    qInfo("Destroying: %s - %s", mId.c_str(), mDescr.c_str());
+}
+
+const char* ChunkField::id() const
+{
+    return mId.c_str();
+}
+
+const char* ChunkField::description() const
+{
+    return mDescr.c_str();
+}
+
+void ChunkField::setFramesInFlight(uint32_t framesInFlight)
+{
+    mFramesInFlight = framesInFlight;
+}
+
+void ChunkField::initResource(ResourceManager* resourceMgr)
+{
+    assert(resourceMgr);
+    mResourceMgr = resourceMgr;
+    mDrawSet = std::unique_ptr<IndirectDrawSet>(new IndirectDrawSet(mResourceMgr, mFramesInFlight));
+
+    //
+    // All chunks in world space in one mesh of geometry arena - each chunk is a cube with own size
+    //
+    const uint32_t verticesPerChunk = sizeof(cubeCorners) / sizeof(cubeCorners[0]);
+    const uint32_t indicesPerChunk = sizeof(cubeIndices) / sizeof(cubeIndices[0]);
+    std::vector<glm::vec3> vertices;
+    vertices.reserve(mChunksPerSide * mChunksPerSide * verticesPerChunk);
+    std::vector<uint32_t> indices(cubeIndices, cubeIndices + indicesPerChunk); // shared by chunks - vertexOffset selects chunk
+
+    struct ChunkBounds {
+        glm::vec3 center;
+        float radius;
+    };
+    std::vector<ChunkBounds> bounds;
+    bounds.reserve(mChunksPerSide * mChunksPerSide);
+
+    float halfSide = 0.5f * mSpacing * (mChunksPerSide - 1);
+    for (uint32_t x = 0; x < mChunksPerSide; ++x) {
+        for (uint32_t z = 0; z < mChunksPerSide; ++z) {
+            glm::vec3 center(x * mSpacing - halfSide, mHeight, z * mSpacing - halfSide);
+            float halfSize = 0.2f + 0.2f * static_cast<float>((x * 7 + z * 13) % 5) / 4.f;
+            for (const glm::vec3& corner : cubeCorners) {
+                vertices.push_back(center + corner * halfSize);
+            }
+            bounds.push_back({center, halfSize * 1.7320508f}); // radius of cube circumsphere
+        }
+    }
+
+    GeometryArena* arena = mResourceMgr->geometryArena(sizeof(glm::vec3));
+    if (arena) {
+        mArenaMesh = arena->allocate(vertices.data(), static_cast<uint32_t>(vertices.size()),
+                                     indices.data(), static_cast<uint32_t>(indices.size()));
+    }
+    if (mArenaMesh.isValid()) {
+        mGo.vertices.push_back(arena->vertexBuffer());
+        mGo.indices = arena->indexBuffer();
+    }
+    else {
+        mGo.vertices.push_back(mResourceMgr->createBuffer());
+        mGo.vertices[0]->createBuffer(vertices.data(), vertices.size() * sizeof(glm::vec3), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+        mGo.indices = mResourceMgr->createBuffer();
+        mGo.indices->createBuffer(indices.data(), indices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    }
+    mGo.indexType = VK_INDEX_TYPE_UINT32;
+    mGo.indicesCount = static_cast<uint32_t>(indices.size());
+    mGo.firstIndex = mArenaMesh.firstIndex;
+    mGo.vertexOffset = mArenaMesh.vertexOffset;
+
+    for (size_t chunkIdx = 0; chunkIdx < bounds.size(); ++chunkIdx) {
+        int32_t vertexOffset = mGo.vertexOffset + static_cast<int32_t>(chunkIdx * verticesPerChunk);
+        mDrawSet->addChunk(bounds[chunkIdx].center, bounds[chunkIdx].radius, indicesPerChunk, mGo.firstIndex, vertexOffset);
+    }
+
+    ::Uniform uniformDefinition = {};
+    mGo.uniforms = mResourceMgr->createBuffer();
+    mGo.uniforms->createBuffer(&uniformDefinition, sizeof(uniformDefinition), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    mGo.uniformMapping.resize(1);
+    mGo.uniformMapping[0].resize(1);
+    VkDescriptorBufferInfo uniformBufferInfo;
+    uniformBufferInfo.buffer = mGo.uniforms->getBuffer();
+    uniformBufferInfo.offset = 0;
+    uniformBufferInfo.range = sizeof(::Uniform);
+    mGo.uniformMapping[0][0] = QVariant::fromValue(uniformBufferInfo);
+    mGo.modelMtx = glm::mat4x4(1.f);
+
+    if (!mDrawSet->createResources()) {
+        qWarning("%s can't create indirect draw resources!", mId.c_str());
+    }
+    qInfo("%s: %d chunks, draw indirect count: %d", mId.c_str(), mDrawSet->chunkCount(), mDrawSet->usesDrawIndirectCount() ? 1 : 0);
+}
+
+void ChunkField::initPipeline(PipelineManager* pipelineMgr)
+{
+    mGo.pipelineInfo = pipelineMgr->getPipeline("../shaders/world_position.vert.bin", "", "", "", "../shaders/gradient.frag.bin");
+    if (!mGo.pipelineInfo) {
+        qWarning("%s can't get pipeline!", mId.c_str());
+        return;
+    }
+    if (!pipelineMgr->allocateDescriptorSets(mGo.pipelineInfo, mGo.descriptorSets)) {
+        qWarning("%s can't allocate descriptor sets!", mId.c_str());
+        mGo.descriptorSets.clear();
+    }
+    mGo.connectResourceWithUniformSets(*mResourceMgr->deviceFunctions(), mResourceMgr->device());
+
+    if (!mDrawSet->initPipeline(pipelineMgr)) {
+        qWarning("%s can't init culling!", mId.c_str());
+    }
+}
+
+void ChunkField::update(DrawManager* drawMgr)
+{
+    assert(drawMgr);
+    glm::mat4x4 viewProjMtx = *drawMgr->getProjMatrix() * *drawMgr->getViewMatrix();
+
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    VkDevice device = mResourceMgr->device();
+    void* deviceMemMappedPtr = nullptr;
+    devFuncs->vkMapMemory(device, mGo.uniforms->getMem(), 0, sizeof(Uniform), 0, &deviceMemMappedPtr);
+    memcpy(static_cast<char*>(deviceMemMappedPtr) + offsetof(Uniform, viewProjMtx), &viewProjMtx[0], sizeof(viewProjMtx));
+    devFuncs->vkUnmapMemory(device, mGo.uniforms->getMem());
+}
+
+void ChunkField::setupBarrier(DrawManager* drawMgr)
+{
+    // Outside of render pass - the right place for compute culling
+    mDrawSet->cull(drawMgr);
+}
+
+void ChunkField::enqueue(RenderQueue* queue, DrawManager* /*drawMgr*/)
+{
+    if (!mGo.pipelineInfo) {
+        return;
+    }
+    queue->pushCustom(this, RenderQueue::makeKey(mGo, 0.f));
+}
+
+void ChunkField::draw(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("ChunkField::draw");
+    mDrawSet->draw(drawMgr, mGo);
+}
+
+void ChunkField::releasePipeline()
+{
+    mGo.pipelineInfo = nullptr;
+    mGo.descriptorSets.clear(); // released with PipelineManager
+    if (mDrawSet) {
+        mDrawSet->releasePipeline();
+    }
+}
+
+void ChunkField::releaseResource()
+{
+    if (mArenaMesh.isValid()) {
+        mResourceMgr->geometryArena(sizeof(glm::vec3))->free(mArenaMesh);
+    }
+    mDrawSet.reset();
+    mGo = {};
+}
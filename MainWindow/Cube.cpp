@@ -24,18 +24,25 @@ SOFTWARE.
 
 #include "Cube.hpp"
 #include <atomic>
+#include <algorithm>
+#include <cmath>
 #include <glm/ext.hpp>
-#include <QVulkanDeviceFunctions>
+#include <Graphic/VulkanFunctions.hpp>
 
 #include <Graphic/ImageDescr.hpp>
 #include <Graphic/SamplerDescr.hpp>
 #include <Graphic/DrawManager.hpp>
 #include <Graphic/ResourceManager.hpp>
+#include <Graphic/RenderQueue.hpp>
+#include <Graphic/CpuTrace.hpp>
 
 
-Cube::Cube(bool useTexture)
+Cube::Cube(bool useTexture, bool useBindless)
     : mUseTexture(useTexture)
+    , mUseBindless(useTexture && useBindless)
 {
+    mModelMtx = glm::identity<glm::mat4>();
+
     static std::atomic_uint counter;
     uint32_t localId = ++counter;
     mId = std::string("Cube ") + std::to_string(localId);
@@ -67,6 +74,32 @@ struct Uniform {
     glm::mat4x4    modelMtx;
 };
 
+struct InstancedUniform {
+    glm::mat4x4    viewProjMtx;
+};
+
+const char* SharedGoName = "Cube.instanced"; // ResourceManager::sharedObject
+
+const float cubeVertices[] = {
+    -1.0f,-1.0f,-1.0f, //0               2--------- 3
+    -1.0f,-1.0f, 1.0f, //1            /  .      /   |
+    -1.0f, 1.0f, 1.0f, //2          7-------- 4     |
+     1.0f, 1.0f, 1.0f, //3          |    .    |     |
+     1.0f, 1.0f,-1.0f, //4          |    1....|.... 6
+     1.0f,-1.0f,-1.0f, //5          |  /      |  /
+     1.0f,-1.0f, 1.0f, //6          0-------- 5
+    -1.0f, 1.0f,-1.0f, //7
+};
+
+const uint32_t cubeIndices[] = {
+    7,0,5,    4,7,5, //front
+    2,3,1,    1,3,6, //back
+    4,5,6,    3,4,6, //right
+    1,7,2,    1,0,7, //left
+    3,2,7,    3,7,4, //up
+    5,0,1,    5,1,6, //down
+};
+
 const char* qImgFormatToStr(QImage::Format format) {
     switch (format) {
         case QImage::Format_Invalid                : return "Invalid";
@@ -112,16 +145,10 @@ void Cube::initResource(ResourceManager* resourceMgr)
     assert(resourceMgr);
     mResourceMgr = resourceMgr;
 
-    static const float cubeVertices[] = {
-        -1.0f,-1.0f,-1.0f, //0               2--------- 3
-        -1.0f,-1.0f, 1.0f, //1            /  .      /   |
-        -1.0f, 1.0f, 1.0f, //2          7-------- 4     |
-         1.0f, 1.0f, 1.0f, //3          |    .    |     |
-         1.0f, 1.0f,-1.0f, //4          |    1....|.... 6
-         1.0f,-1.0f,-1.0f, //5          |  /      |  /
-         1.0f,-1.0f, 1.0f, //6          0-------- 5
-        -1.0f, 1.0f,-1.0f, //7
-    };
+    if (mInstanced) {
+        initSharedResource();
+        return;
+    }
 
     static const float cubeUV[] = {
         0.0f  , 0.0f,   //0
@@ -140,117 +167,185 @@ void Cube::initResource(ResourceManager* resourceMgr)
      // front | up     | back |
     //};
 
-    static const uint16_t indices[] = {
-        7,0,5,    4,7,5, //front
-        2,3,1,    1,3,6, //back
-        4,5,6,    3,4,6, //right
-        1,7,2,    1,0,7, //left
-        3,2,7,    3,7,4, //up
-        5,0,1,    5,1,6, //down
-    };
-
-    mGo.vertices.push_back(mResourceMgr->createBuffer());
-    mGo.vertices[0]->createBuffer(cubeVertices, sizeof(cubeVertices), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-
     if (mUseTexture) {
+        // positions and UV are separated bindings - vertexOffset would move both, so textured cube owns its buffers
+        initOwnMesh(mGo);
+
         mGo.vertices.push_back(mResourceMgr->createBuffer());
         mGo.vertices[1]->createBuffer(cubeUV, sizeof(cubeUV), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
 
         prepareTexture();
     }
-
-    mGo.indices = mResourceMgr->createBuffer();
-    mGo.indices->createBuffer(indices, sizeof(indices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
-    mGo.indexType = VK_INDEX_TYPE_UINT16;
-    mGo.indicesCount = sizeof(indices)/sizeof(indices[0]);
+    else if (!initArenaMesh(mGo)) {
+        initOwnMesh(mGo);
+    }
 
     ::Uniform uniformDefinition = {};
     mGo.uniforms = mResourceMgr->createBuffer();
     mGo.uniforms->createBuffer(&uniformDefinition, sizeof(uniformDefinition), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 
-    mGo.uniformMapping.resize(1); // descriptor sets
-    mGo.uniformMapping.back().resize(1 + (mUseTexture ? 1 : 0)); // bindings
+    if (mUseBindless && !mResourceMgr->bindlessTextures()) {
+        qWarning("%s - bindless textures are not enabled, fallback to texture binding", mId.c_str());
+        mUseBindless = false;
+    }
+
+    mGo.uniformMapping.resize(mUseBindless ? 2 : 1); // descriptor sets - set 1 is bindless table, filled by ResourceManager
+    mGo.uniformMapping[0].resize(1 + (mUseTexture && !mUseBindless ? 1 : 0)); // bindings
     VkDescriptorBufferInfo uniformBufferInfo;
     uniformBufferInfo.buffer = mGo.uniforms->getBuffer();
     uniformBufferInfo.offset = 0;
     uniformBufferInfo.range = sizeof(::Uniform);
     mGo.uniformMapping[0][0] = QVariant::fromValue(uniformBufferInfo);
 
-    if (mUseTexture) {
+    if (mUseBindless) {
+        uint32_t textureIdx = mResourceMgr->bindlessTextures()->registerTexture(mGo.textures.back(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        mGo.pushConstants.resize(sizeof(textureIdx));
+        memcpy(mGo.pushConstants.data(), &textureIdx, sizeof(textureIdx));
+    }
+    else if (mUseTexture) {
         VkDescriptorImageInfo uniformSamplerInfo;
         uniformSamplerInfo.sampler = mGo.textures.back().sampler->getSampler();
         uniformSamplerInfo.imageView = mGo.textures.back().view->getImageView();
-        uniformSamplerInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        uniformSamplerInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL; // see setImageLayout
         mGo.uniformMapping[0][1] = QVariant::fromValue(uniformSamplerInfo);
-        mSetTextureLayout = true;
     }
 
-    mGo.modelMtx = glm::identity<glm::mat4>();
+    mGo.modelMtx = mModelMtx;
 }
 
-void Cube::setImageLayout(VkCommandBuffer cmdBuf)
+void Cube::initSharedResource()
 {
-    // TODO
-    // Similar found in some Vulkan example but it works without this also. Is this bug? Does't matter which layout I choose, for my device.
-    // I have to check if it is realy faster, read more!!!
-    if (!mSetTextureLayout) {
+    bool created = false;
+    mSharedGo = mResourceMgr->sharedObject(SharedGoName, created);
+    if (!created) {
         return;
     }
-    mSetTextureLayout = false;
-
-    auto imgLayoutToDstAccessMask = [](const VkImageLayout &layout) -> uint32_t {
-        switch (layout) {
-        case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL            : return VK_ACCESS_TRANSFER_WRITE_BIT;
-        case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL            : return VK_ACCESS_TRANSFER_READ_BIT;
-        case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL        : return VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
-        case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-        case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-            // Make sure any Copy or CPU writes to image are flushed
-                                                             : return (VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_INPUT_ATTACHMENT_READ_BIT);
-        case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR                 : return VK_ACCESS_MEMORY_READ_BIT;
-        default:
-            break;
-        }
-        return 0;
-    };
+    mOwnsSharedGo = true;
+
+    GraphicObject& go = *mSharedGo;
+    if (!initArenaMesh(go)) {
+        initOwnMesh(go);
+    }
+
+    ::InstancedUniform uniformDefinition = {};
+    go.uniforms = mResourceMgr->createBuffer();
+    go.uniforms->createBuffer(&uniformDefinition, sizeof(uniformDefinition), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
 
-    VkImageMemoryBarrier barrier = {};
-    barrier.sType = VK_STRUCTURE_TYPE_BIND_IMAGE_MEMORY_INFO;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_PREINITIALIZED;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = 0;
-    barrier.dstAccessMask = imgLayoutToDstAccessMask(barrier.newLayout);
-    barrier.srcQueueFamilyIndex = 0;
-    barrier.dstQueueFamilyIndex = 0;
-    barrier.image = mGo.textures.back().image->getImage();
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.subresourceRange.levelCount = 1;
-    barrier.subresourceRange.baseMipLevel = 0;
-    barrier.subresourceRange.baseArrayLayer = 0;
-
-    QVulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
-    devFuncs->vkCmdPipelineBarrier(cmdBuf,
-                                   VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                                   VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                                   VkDependencyFlagBits(),
-                                   0, nullptr,
-                                   0, nullptr,
-                                   1, &barrier);
+    go.uniformMapping.resize(1);
+    go.uniformMapping[0].resize(1);
+    VkDescriptorBufferInfo uniformBufferInfo;
+    uniformBufferInfo.buffer = go.uniforms->getBuffer();
+    uniformBufferInfo.offset = 0;
+    uniformBufferInfo.range = sizeof(::InstancedUniform);
+    go.uniformMapping[0][0] = QVariant::fromValue(uniformBufferInfo);
+
+    go.modelMtx = glm::identity<glm::mat4>(); // per instance matrices are used
+}
+
+bool Cube::initArenaMesh(GraphicObject& go)
+{
+    GeometryArena* arena = mResourceMgr->geometryArena(sizeof(glm::vec3));
+    if (!arena) {
+        return false;
+    }
+    mArenaMesh = arena->allocate(cubeVertices, sizeof(cubeVertices) / sizeof(glm::vec3),
+                                 cubeIndices, sizeof(cubeIndices) / sizeof(cubeIndices[0]));
+    if (!mArenaMesh.isValid()) {
+        return false;
+    }
+    go.vertices.push_back(arena->vertexBuffer());
+    go.indices = arena->indexBuffer();
+    go.indexType = arena->indexType();
+    go.indicesCount = mArenaMesh.indexCount;
+    go.firstIndex = mArenaMesh.firstIndex;
+    go.vertexOffset = mArenaMesh.vertexOffset;
+    return true;
+}
+
+void Cube::initOwnMesh(GraphicObject& go)
+{
+    go.vertices.push_back(mResourceMgr->createBuffer());
+    go.vertices[0]->createBuffer(cubeVertices, sizeof(cubeVertices), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+
+    go.indices = mResourceMgr->createBuffer();
+    go.indices->createBuffer(cubeIndices, sizeof(cubeIndices), VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+    go.indexType = VK_INDEX_TYPE_UINT32;
+    go.indicesCount = sizeof(cubeIndices)/sizeof(cubeIndices[0]);
+}
+
+bool Cube::boundingSphere(glm::vec4& sphere) const
+{
+    // unit cube (-1..1) - radius is half of diagonal scaled by the biggest axis scale
+    float maxScale = std::max(glm::length(glm::vec3(mModelMtx[0])),
+                              std::max(glm::length(glm::vec3(mModelMtx[1])), glm::length(glm::vec3(mModelMtx[2]))));
+    sphere = glm::vec4(glm::vec3(mModelMtx[3]), maxScale * std::sqrt(3.f));
+    return true;
+}
+
+void Cube::setModelMatrix(const glm::mat4x4& modelMtx)
+{
+    mModelMtx = modelMtx;
+    mGo.modelMtx = modelMtx;
+}
+
+void Cube::setInstanced(bool instanced, const glm::vec4& color)
+{
+    assert(!mResourceMgr && "Instanced mode has to be set before initResource!");
+    mInstanced = instanced && !mUseTexture;
+    mColor = color;
+}
+
+void Cube::setImageLayout()
+{
+    if (!mUseTexture || mGo.textures.empty()) {
+        return;
+    }
+    // Declared every frame - tracker records transition only once, when texture is not in this layout yet
+    mResourceMgr->stateTracker()->useImage(*mGo.textures.back().image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                           VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
 }
 
 void Cube::initPipeline(PipelineManager *pipelineMgr)
 {
+    if (mInstanced) {
+        assert(mSharedGo);
+        if (mSharedGo->pipelineInfo) {
+            return; // already done by other instanced cube
+        }
+        std::map<PipelineManager::AdditionalParameters, QVariant> parameter;
+        parameter[PipelineManager::ApInstanceAttributesFromLocation] = 1u;
+        mSharedGo->pipelineInfo = pipelineMgr->getPipeline("../shaders/cube_instanced.vert.bin", "", "", "", "../shaders/instance_color.frag.bin", parameter);
+        if (!mSharedGo->pipelineInfo) {
+            qWarning("%s can't get instanced pipeline!", mId.c_str());
+            return;
+        }
+        // Uniforms are common for all instances - descriptor sets of pipeline are used
+        mSharedGo->connectResourceWithUniformSets(*mResourceMgr->deviceFunctions(), mResourceMgr->device());
+        return;
+    }
+
     if (mUseTexture) {
         std::map<PipelineManager::AdditionalParameters, QVariant> parameter;
         parameter[PipelineManager::ApSeparatedAttributes] = true;
-        mGo.pipelineInfo = pipelineMgr->getPipeline("../shaders/calc_position_uv.vert.bin", "", "", "", "../shaders/texture.frag.bin", parameter);
+        const char* fragmentShader = mUseBindless ? "../shaders/texture_bindless.frag.bin" : "../shaders/texture.frag.bin";
+        mGo.pipelineInfo = pipelineMgr->getPipeline("../shaders/calc_position_uv.vert.bin", "", "", "", fragmentShader, parameter);
     }
     else {
         mGo.pipelineInfo = pipelineMgr->getPipeline("../shaders/calc_position.vert.bin", "", "", "", "../shaders/gradient.frag.bin");
     }
 
-    QVulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    if (!mGo.pipelineInfo) {
+        qWarning("%s can't get pipeline!", mId.c_str());
+        return;
+    }
+
+    // Own descriptor sets - uniform buffer of this cube is not shared with other cubes using the same pipeline
+    if (!pipelineMgr->allocateDescriptorSets(mGo.pipelineInfo, mGo.descriptorSets)) {
+        qWarning("%s can't allocate descriptor sets!", mId.c_str());
+        mGo.descriptorSets.clear();
+    }
+
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
 
     mGo.connectResourceWithUniformSets(*devFuncs, device);
@@ -258,12 +353,21 @@ void Cube::initPipeline(PipelineManager *pipelineMgr)
 
 void Cube::update(DrawManager* drawMgr)
 {
+    if (mInstanced) {
+        if (mOwnsSharedGo) {
+            updateSharedUniformBuffer(drawMgr);
+        }
+        return;
+    }
     updateUniformBuffer(drawMgr);
 }
 
 void Cube::setupBarrier(DrawManager* drawMgr)
 {
     assert(drawMgr);
+    if (mInstanced) {
+        return; // nothing to transition - no texture
+    }
     if (!mGo.pipelineInfo) {
         qWarning("%s does not contain pipelineInfo object!", mId.c_str());
         return;
@@ -274,18 +378,39 @@ void Cube::setupBarrier(DrawManager* drawMgr)
         return;
     }
 
-    setImageLayout(drawMgr->getCmdBuffer());
+    setImageLayout();
+}
+
+void Cube::enqueue(RenderQueue* queue, DrawManager* drawMgr)
+{
+    assert(queue);
+    assert(drawMgr);
+    assert(drawMgr->getViewMatrix());
+    const glm::mat4x4& viewMtx = *drawMgr->getViewMatrix().get();
+    glm::vec4 viewPos = viewMtx * mModelMtx[3]; // camera looks at -Z
+    if (mInstanced) {
+        if (mSharedGo && mSharedGo->pipelineInfo) {
+            queue->pushInstance(*mSharedGo, this, {mModelMtx, mColor}, -viewPos.z);
+        }
+        return;
+    }
+    queue->push(mGo, this, -viewPos.z);
 }
 
 void Cube::draw(DrawManager* drawMgr)
 {
+    TRACE_SCOPE("Cube::draw");
     assert(drawMgr);
+    if (mInstanced) {
+        qWarning("%s is instanced - it can be drawn only through render queue!", mId.c_str());
+        return;
+    }
     if (!mGo.pipelineInfo) {
         qWarning("%s does not contain pipelineInfo object!", mId.c_str());
         return;
     }
 
-    QVulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
     VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
 
     if (!cmdBuf) {
@@ -295,19 +420,27 @@ void Cube::draw(DrawManager* drawMgr)
 
     devFuncs->vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mGo.pipelineInfo->pipeline);
 
-    std::vector<VkDescriptorSet> descriptorSets(mGo.pipelineInfo->descriptorSetInfo.size());
+    FrameArena* arena = drawMgr->frameArena();
+    FrameVector<VkDescriptorSet> descriptorSets = makeFrameVector<VkDescriptorSet>(arena, mGo.pipelineInfo->descriptorSetInfo.size(), nullptr);
     for (size_t descriptorSetIdx = 0; descriptorSetIdx < descriptorSets.size(); ++descriptorSetIdx) {
-        descriptorSets[descriptorSetIdx] = mGo.pipelineInfo->descriptorSetInfo[descriptorSetIdx].descriptor;
+        descriptorSets[descriptorSetIdx] = mGo.descriptorSet(descriptorSetIdx);
     }
 
     devFuncs->vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mGo.pipelineInfo->pipelineLayout,
                                        0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(), //descriptor set info
                                        0, nullptr); //dynamic offset
 
+    if (!mGo.pushConstants.empty()) {
+        assert(!mGo.pipelineInfo->pushConstantRanges.empty() && "Shader should declare push constant!");
+        const VkPushConstantRange& range = mGo.pipelineInfo->pushConstantRanges[0];
+        devFuncs->vkCmdPushConstants(cmdBuf, mGo.pipelineInfo->pipelineLayout, range.stageFlags,
+                                     range.offset, static_cast<uint32_t>(mGo.pushConstants.size()), mGo.pushConstants.data());
+    }
+
     uint32_t firstBinding = 0;
 
-    std::vector<VkBuffer> vertexBuffers(mGo.vertices.size(), nullptr);
-    std::vector<VkDeviceSize> offsets(mGo.vertices.size(), 0);
+    FrameVector<VkBuffer> vertexBuffers = makeFrameVector<VkBuffer>(arena, mGo.vertices.size(), nullptr);
+    FrameVector<VkDeviceSize> offsets = makeFrameVector<VkDeviceSize>(arena, mGo.vertices.size(), 0);
 
     for (size_t i = 0; i < mGo.vertices.size(); ++i) {
         vertexBuffers[i] = mGo.vertices[i]->getBuffer();
@@ -319,27 +452,45 @@ void Cube::draw(DrawManager* drawMgr)
     devFuncs->vkCmdBindIndexBuffer(cmdBuf, mGo.indices->getBuffer(), indexOffset,  mGo.indexType);
 
     //vkCmdDrawIndexed(VkCommandBuffer commandBuffer, uint32_t indexCount, uint32_t instanceCount, uint32_t firstIndex, int32_t vertexOffset, uint32_t firstInstance);
-    devFuncs->vkCmdDrawIndexed(cmdBuf, mGo.indicesCount, 1, 0, 0, 0);
+    devFuncs->vkCmdDrawIndexed(cmdBuf, mGo.indicesCount, 1, mGo.firstIndex, mGo.vertexOffset, 0);
 }
 
 void Cube::releasePipeline()
 {
+    if (mSharedGo) {
+        mSharedGo->pipelineInfo = nullptr;
+    }
     mGo.pipelineInfo = nullptr;
+    mGo.descriptorSets.clear(); // released with PipelineManager
 }
 
 void Cube::releaseResource()
 {
+    if (mUseBindless && mResourceMgr->bindlessTextures()) {
+        for (Texture& texture : mGo.textures) {
+            mResourceMgr->bindlessTextures()->unregisterTexture(texture);
+        }
+    }
+    if (mArenaMesh.isValid()) {
+        mResourceMgr->geometryArena(sizeof(glm::vec3))->free(mArenaMesh);
+    }
     mGo = {};
+    if (mOwnsSharedGo) {
+        mResourceMgr->releaseSharedObject(SharedGoName); // its arena mesh is freed above
+    }
+    mSharedGo = nullptr;
+    mOwnsSharedGo = false;
 }
 
 void Cube::updateUniformBuffer(DrawManager* drawMgr)
 {
+    TRACE_SCOPE("Cube::updateUniformBuffer");
     assert(drawMgr);
     assert(drawMgr->getProjMatrix());
     assert(drawMgr->getViewMatrix());
     const glm::mat4x4& projMtx = *drawMgr->getProjMatrix().get();
     const glm::mat4x4& viewMtx = *drawMgr->getViewMatrix().get();
-    QVulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
     VkDevice device = mResourceMgr->device();
 
     VkDeviceSize offset = 0;
@@ -358,11 +509,38 @@ void Cube::updateUniformBuffer(DrawManager* drawMgr)
     devFuncs->vkUnmapMemory(device, mGo.uniforms->getMem());
 }
 
+void Cube::updateSharedUniformBuffer(DrawManager* drawMgr)
+{
+    assert(drawMgr);
+    assert(drawMgr->getProjMatrix());
+    assert(drawMgr->getViewMatrix());
+    const glm::mat4x4& projMtx = *drawMgr->getProjMatrix().get();
+    const glm::mat4x4& viewMtx = *drawMgr->getViewMatrix().get();
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    VkDevice device = mResourceMgr->device();
+
+    VkDeviceSize offset = 0;
+    VkMemoryMapFlags mappingFlags = 0; // reserved for future use
+    void* deviceMemMappedPtr = nullptr;
+    devFuncs->vkMapMemory(device, mSharedGo->uniforms->getMem(), offset, sizeof(InstancedUniform), mappingFlags, &deviceMemMappedPtr);
+
+    glm::mat4x4 viewProjMtx = projMtx * viewMtx;
+    memcpy(static_cast<char*>(deviceMemMappedPtr) + offsetof(InstancedUniform, viewProjMtx), &viewProjMtx[0], sizeof(viewProjMtx));
+
+    devFuncs->vkUnmapMemory(device, mSharedGo->uniforms->getMem());
+}
+
 void Cube::prepareTexture()
 {
+    TRACE_SCOPE("Cube::prepareTexture");
     //QString imageFilePath = "../../resources/textures/wood_001.jpg";
     QString imageFilePath = "../../resources/textures/test.png";
-    if (!mImage.load(imageFilePath)) {
+    bool loaded = false;
+    {
+        TRACE_SCOPE("Texture decode");
+        loaded = mImage.load(imageFilePath);
+    }
+    if (!loaded) {
         qWarning("Can't load image: %s", imageFilePath.toLatin1().data());
     }
     else {
@@ -28,10 +28,11 @@ SOFTWARE.
 #include <string>
 #include <vulkan/vulkan.h>
 #include <Graphic/GraphicObject.hpp>
+#include <Graphic/GeometryArena.hpp>
 #include <QImage>
+#include <memory>
 
-class QVulkanInstance;
-class QVulkanDeviceFunctions;
+struct VulkanDeviceFunctions;
 class DrawManager;
 class ResourceManager;
 
@@ -39,7 +40,7 @@ class Cube : public IRenderable
 {
 public:
 
-    Cube(bool useTexture = false);
+    Cube(bool useTexture = false, bool useBindless = false); // useBindless - texture from ResourceManager::bindlessTextures()
     ~Cube() override;
 
     const char* id() const override;
@@ -49,23 +50,44 @@ public:
     void initPipeline(PipelineManager* pipelineMgr) override;
     void update(DrawManager* drawMgr) override;
     void setupBarrier(DrawManager* drawMgr) override;
+    void enqueue(RenderQueue* queue, DrawManager* drawMgr) override;
     void draw(DrawManager* drawMgr) override;
     void releasePipeline() override;
     void releaseResource() override;
+    bool boundingSphere(glm::vec4& sphere) const override;
+
+    void setModelMatrix(const glm::mat4x4& modelMtx);
+
+    ///
+    /// Instanced cubes share one mesh and pipeline, render queue draws all of them with one call.
+    /// Model matrix and color are per instance data. Has to be set before initResource. Not used with texture.
+    ///
+    void setInstanced(bool instanced, const glm::vec4& color = glm::vec4(0.f));
 
 protected:
     void updateUniformBuffer(DrawManager* drawMgr);
-    void setImageLayout(VkCommandBuffer cmdBuf);
+    void setImageLayout(); // texture transition through ResourceStateTracker
     void prepareTexture();
+    void initSharedResource();
+    bool initArenaMesh(GraphicObject& go); // mesh in ResourceManager::geometryArena - common buffers with other meshes
+    void initOwnMesh(GraphicObject& go);
+    void updateSharedUniformBuffer(DrawManager* drawMgr);
 
 protected:
     std::string mId;
     std::string mDescr;
     GraphicObject mGo;
+    glm::mat4x4 mModelMtx;
 
-    ResourceManager *mResourceMgr;
+    ResourceManager *mResourceMgr = nullptr;
+    GeometryArena::Mesh mArenaMesh; // valid when mesh of mGo (or created mSharedGo) is in geometry arena
 
     bool mUseTexture = false;
-    bool mSetTextureLayout = false;
+    bool mUseBindless = false;
     QImage mImage;
+
+    bool mInstanced = false;
+    glm::vec4 mColor;
+    GraphicObject* mSharedGo = nullptr; // instanced mode - mesh shared by all instanced cubes, owned by ResourceManager
+    bool mOwnsSharedGo = false;         // this cube created mSharedGo and updates its uniforms
 };
@@ -0,0 +1,97 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "GpuProfilerWidget.hpp"
+#include "VulkanWindow.hpp"
+
+#include <QApplication>
+#include <QVBoxLayout>
+#include <QTreeWidget>
+#include <QHeaderView>
+#include <QTimer>
+#include <vector>
+
+#include <Graphic/GpuProfiler.hpp>
+
+GpuProfilerWidget::GpuProfilerWidget(VulkanWindow* vulkanWindow)
+    : QWidget(nullptr, Qt::Tool)
+    , mVulkanWindow(vulkanWindow)
+{
+    setWindowTitle(QApplication::translate("gpuProfiler", "GPU profiler"));
+    resize(420, 360);
+
+    QLayout* layout = new QVBoxLayout(this);
+    mTree = new QTreeWidget(this);
+    mTree->setColumnCount(3);
+    mTree->setHeaderLabels(QStringList() << QApplication::translate("gpuProfiler", "Scope")
+                                         << QApplication::translate("gpuProfiler", "GPU [ms]")
+                                         << QApplication::translate("gpuProfiler", "Start [ms]"));
+    mTree->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+    layout->addWidget(mTree);
+
+    mTimer = new QTimer(this);
+    mTimer->setInterval(500);
+    connect(mTimer, &QTimer::timeout, this, &GpuProfilerWidget::refresh);
+}
+
+void GpuProfilerWidget::showEvent(QShowEvent *event)
+{
+    refresh();
+    mTimer->start();
+    QWidget::showEvent(event);
+}
+
+void GpuProfilerWidget::hideEvent(QHideEvent *event)
+{
+    mTimer->stop();
+    QWidget::hideEvent(event);
+}
+
+void GpuProfilerWidget::refresh()
+{
+    mTree->clear();
+    const GpuProfiler* profiler = mVulkanWindow ? mVulkanWindow->gpuProfiler() : nullptr;
+    if (!profiler) {
+        setWindowTitle(QApplication::translate("gpuProfiler", "GPU profiler - not available"));
+        return;
+    }
+
+    const GpuProfiler::FrameResult& frame = profiler->lastFrame();
+    setWindowTitle(QApplication::translate("gpuProfiler", "GPU profiler - frame %1: %2 ms")
+                   .arg(frame.frameNumber)
+                   .arg(frame.frameMs, 0, 'f', 3));
+
+    // Parent is always before its children - items can be created in one pass
+    std::vector<QTreeWidgetItem*> items(frame.nodes.size(), nullptr);
+    for (size_t nodeIdx = 0; nodeIdx < frame.nodes.size(); ++nodeIdx) {
+        const GpuProfiler::Node& node = frame.nodes[nodeIdx];
+        QTreeWidgetItem* item = node.parent == GpuProfiler::InvalidScope ? new QTreeWidgetItem(mTree)
+                                                                         : new QTreeWidgetItem(items[node.parent]);
+        item->setText(0, QString::fromLatin1(node.name));
+        item->setText(1, QString::number(node.durationMs, 'f', 3));
+        item->setText(2, QString::number(node.beginMs, 'f', 3));
+        items[nodeIdx] = item;
+    }
+    mTree->expandAll();
+}
@@ -0,0 +1,460 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "PointCloud.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/gtc/packing.hpp>
+#include <Graphic/VulkanFunctions.hpp>
+
+#include <Graphic/BufferDescr.hpp>
+#include <Graphic/BufferUploader.hpp>
+#include <Graphic/DrawManager.hpp>
+#include <Graphic/ResourceManager.hpp>
+#include <Graphic/RenderQueue.hpp>
+#include <Graphic/FrameArena.hpp>
+#include <Graphic/Frustum.hpp>
+#include <Graphic/CpuTrace.hpp>
+
+Q_DECLARE_METATYPE(VkDescriptorBufferInfo);
+
+namespace {
+struct Uniform {
+    glm::mat4x4 viewProjMtx;
+    glm::vec4 cameraPos;
+    glm::vec4 pointSize; // size, pixels per world unit at distance 1 (0 - size in pixels), min, max
+};
+
+const uint32_t SortGridBits = 5; // 32^3 cells - chunks are compact enough for culling
+
+// Spread lower 10 bits - two zero bits between each
+uint32_t part1By2(uint32_t x)
+{
+    x &= 0x000003ff;
+    x = (x ^ (x << 16)) & 0xff0000ff;
+    x = (x ^ (x <<  8)) & 0x0300f00f;
+    x = (x ^ (x <<  4)) & 0x030c30c3;
+    x = (x ^ (x <<  2)) & 0x09249249;
+    return x;
+}
+
+template <typename T>
+void reorder(std::vector<T>& values, const std::vector<uint32_t>& order)
+{
+    if (values.empty()) {
+        return;
+    }
+    std::vector<T> sorted(values.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        sorted[i] = values[order[i]];
+    }
+    values.swap(sorted);
+}
+
+template <typename T>
+uint64_t hostBytes(const std::vector<T>& values)
+{
+    return values.capacity() * sizeof(T);
+}
+}
+
+PointCloud::PointCloud(std::vector<glm::vec3> positions, std::vector<uint32_t> colors, std::vector<glm::vec3> normals)
+    : mPositions(std::move(positions))
+    , mColors(std::move(colors))
+{
+    mId = "PointCloud";
+    mDescr = "Scanned points drawn from chunked device local buffers";
+    qInfo("Creating: %s - %s", mId.c_str(), mDescr.c_str());
+
+    mPointCount = mPositions.size();
+    if (mColors.size() != mPointCount) {
+        if (!mColors.empty()) {
+            qWarning("%s: %d colors for %d points - white is used", mId.c_str(), static_cast<int>(mColors.size()), static_cast<int>(mPointCount));
+        }
+        mColors.assign(mPointCount, 0xffffffffu);
+    }
+    if (!normals.empty()) {
+        if (normals.size() == mPointCount) {
+            mHasNormals = true;
+            mNormals.resize(mPointCount);
+            for (size_t i = 0; i < normals.size(); ++i) {
+                mNormals[i] = glm::packSnorm4x8(glm::vec4(normals[i], 0.f));
+            }
+        }
+        else {
+            qWarning("%s: %d normals for %d points - normals are ignored", mId.c_str(), static_cast<int>(normals.size()), static_cast<int>(mPointCount));
+        }
+    }
+}
+
+PointCloud::PointCloud(PointCloudData&& data)
+    : PointCloud(std::move(data.positions), std::move(data.colors), std::move(data.normals))
+{
+    data.clear();
+}
+
+PointCloud::~PointCloud()
+{
+    qInfo("Destroying: %s - %s", mId.c_str(), mDescr.c_str());
+}
+
+const char* PointCloud::id() const
+{
+    return mId.c_str();
+}
+
+const char* PointCloud::description() const
+{
+    return mDescr.c_str();
+}
+
+void PointCloud::setPointSize(float size, bool attenuated)
+{
+    mPointSize = size;
+    mAttenuated = attenuated;
+}
+
+void PointCloud::setFramesInFlight(uint32_t framesInFlight)
+{
+    mFramesInFlight = std::max(1u, framesInFlight);
+}
+
+void PointCloud::setMaxPointsPerChunk(uint32_t maxPointsPerChunk)
+{
+    mMaxPointsPerChunk = std::max(1u, maxPointsPerChunk);
+}
+
+void PointCloud::setUploadBudget(uint64_t bytesPerFrame)
+{
+    mUploadBudget = bytesPerFrame;
+}
+
+void PointCloud::sortPoints()
+{
+    TRACE_SCOPE("PointCloud::sortPoints");
+    if (mSorted || mPositions.empty()) {
+        return;
+    }
+    glm::vec3 minPos = mPositions[0];
+    glm::vec3 maxPos = mPositions[0];
+    for (const glm::vec3& position : mPositions) {
+        minPos = glm::min(minPos, position);
+        maxPos = glm::max(maxPos, position);
+    }
+    mSphere = glm::vec4(0.5f * (minPos + maxPos), 0.5f * glm::length(maxPos - minPos));
+
+    //
+    // Counting sort by Morton code of grid cell - neighbour points end up in the same chunk
+    //
+    const uint32_t cellsPerAxis = 1u << SortGridBits;
+    const uint32_t cellCount = cellsPerAxis * cellsPerAxis * cellsPerAxis;
+    glm::vec3 scale = glm::vec3(static_cast<float>(cellsPerAxis)) / glm::max(maxPos - minPos, glm::vec3(1e-6f));
+
+    std::vector<uint32_t> pointCell(mPositions.size());
+    std::vector<uint32_t> cellStart(cellCount + 1, 0);
+    for (size_t i = 0; i < mPositions.size(); ++i) {
+        glm::uvec3 cell = glm::min(glm::uvec3((mPositions[i] - minPos) * scale), glm::uvec3(cellsPerAxis - 1));
+        pointCell[i] = part1By2(cell.x) | (part1By2(cell.y) << 1) | (part1By2(cell.z) << 2);
+        ++cellStart[pointCell[i] + 1];
+    }
+    for (uint32_t cell = 0; cell < cellCount; ++cell) {
+        cellStart[cell + 1] += cellStart[cell];
+    }
+    std::vector<uint32_t> order(mPositions.size());
+    for (size_t i = 0; i < mPositions.size(); ++i) {
+        order[cellStart[pointCell[i]]++] = static_cast<uint32_t>(i);
+    }
+    std::vector<uint32_t>().swap(pointCell);
+
+    // One attribute at a time - peak memory is one extra attribute array
+    reorder(mPositions, order);
+    reorder(mColors, order);
+    reorder(mNormals, order);
+    mSorted = true;
+}
+
+uint32_t PointCloud::chunkCapacity() const
+{
+    VkPhysicalDeviceProperties props;
+    mResourceMgr->instanceFunctions().vkGetPhysicalDeviceProperties(mResourceMgr->physicalDevice(), &props);
+
+    // maxMemoryAllocationSize (Vulkan 1.1) is at least 1 GiB, buffer should also take only a part of the device heap
+    uint64_t maxBufferBytes = 1ull << 30;
+    const VkPhysicalDeviceMemoryProperties& memProps = mResourceMgr->phyDevMemProps();
+    for (uint32_t heapIdx = 0; heapIdx < memProps.memoryHeapCount; ++heapIdx) {
+        if (memProps.memoryHeaps[heapIdx].flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) {
+            maxBufferBytes = std::min<uint64_t>(maxBufferBytes, memProps.memoryHeaps[heapIdx].size / 16);
+        }
+    }
+    uint64_t capacity = std::min<uint64_t>(mMaxPointsPerChunk, std::max<uint64_t>(1, maxBufferBytes / sizeof(glm::vec3)));
+
+    // Every buffer is a separate allocation - cloud may take half of maxMemoryAllocationCount
+    uint64_t buffersPerChunk = mHasNormals ? 3 : 2;
+    uint64_t maxChunks = std::max<uint64_t>(1, props.limits.maxMemoryAllocationCount / 2 / buffersPerChunk);
+    if ((mPointCount + capacity - 1) / capacity > maxChunks) {
+        capacity = (mPointCount + maxChunks - 1) / maxChunks;
+        if (capacity * sizeof(glm::vec3) > maxBufferBytes) {
+            qWarning("%s: %llu points don't fit into %llu chunks within buffer size limit", mId.c_str(),
+                     static_cast<unsigned long long>(mPointCount), static_cast<unsigned long long>(maxChunks));
+        }
+    }
+    return static_cast<uint32_t>(std::min<uint64_t>(capacity, ~0u));
+}
+
+void PointCloud::initResource(ResourceManager* resourceMgr)
+{
+    TRACE_SCOPE("PointCloud::initResource");
+    assert(resourceMgr);
+    mResourceMgr = resourceMgr;
+    mUploader = std::unique_ptr<BufferUploader>(new BufferUploader(mResourceMgr, mFramesInFlight));
+
+    VkPhysicalDeviceProperties props;
+    mResourceMgr->instanceFunctions().vkGetPhysicalDeviceProperties(mResourceMgr->physicalDevice(), &props);
+    mPointSizeRange[0] = props.limits.pointSizeRange[0];
+    mPointSizeRange[1] = props.limits.pointSizeRange[1];
+
+    sortPoints();
+    if (mPositions.size() != mPointCount) {
+        qWarning("%s: host points were released after previous upload - cloud is empty", mId.c_str());
+        mPointCount = 0;
+    }
+
+    //
+    // Chunks - buffers are filled by GPU copy in setupBarrier
+    //
+    const uint32_t capacity = chunkCapacity();
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    for (uint64_t firstPoint = 0; firstPoint < mPointCount; firstPoint += capacity) {
+        Chunk chunk;
+        chunk.firstPoint = static_cast<uint32_t>(firstPoint);
+        chunk.pointCount = static_cast<uint32_t>(std::min<uint64_t>(capacity, mPointCount - firstPoint));
+
+        glm::vec3 minPos = mPositions[chunk.firstPoint];
+        glm::vec3 maxPos = minPos;
+        for (uint32_t i = chunk.firstPoint; i < chunk.firstPoint + chunk.pointCount; ++i) {
+            minPos = glm::min(minPos, mPositions[i]);
+            maxPos = glm::max(maxPos, mPositions[i]);
+        }
+        chunk.sphere = glm::vec4(0.5f * (minPos + maxPos), 0.5f * glm::length(maxPos - minPos));
+
+        chunk.positions = std::unique_ptr<BufferDescr>(new BufferDescr(mResourceMgr));
+        chunk.colors = std::unique_ptr<BufferDescr>(new BufferDescr(mResourceMgr));
+        bool created = chunk.positions->createBuffer(nullptr, chunk.pointCount * sizeof(glm::vec3), usage, BufferDescr::DeviceLocalMemory)
+                    && chunk.colors->createBuffer(nullptr, chunk.pointCount * sizeof(uint32_t), usage, BufferDescr::DeviceLocalMemory);
+        if (created && mHasNormals) {
+            chunk.normals = std::unique_ptr<BufferDescr>(new BufferDescr(mResourceMgr));
+            created = chunk.normals->createBuffer(nullptr, chunk.pointCount * sizeof(uint32_t), usage, BufferDescr::DeviceLocalMemory);
+        }
+        if (!created) {
+            qWarning("%s can't create buffers of chunk %d - rest of points is dropped", mId.c_str(), static_cast<int>(mChunks.size()));
+            break;
+        }
+        mChunks.push_back(std::move(chunk));
+    }
+    mNextUploadChunk = 0;
+
+    ::Uniform uniformDefinition = {};
+    mGo.uniforms = mResourceMgr->createBuffer();
+    mGo.uniforms->createBuffer(&uniformDefinition, sizeof(uniformDefinition), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    mGo.uniformMapping.resize(1);
+    mGo.uniformMapping[0].resize(1);
+    VkDescriptorBufferInfo uniformBufferInfo;
+    uniformBufferInfo.buffer = mGo.uniforms->getBuffer();
+    uniformBufferInfo.offset = 0;
+    uniformBufferInfo.range = sizeof(::Uniform);
+    mGo.uniformMapping[0][0] = QVariant::fromValue(uniformBufferInfo);
+    mGo.modelMtx = glm::mat4x4(1.f);
+
+    MemoryFootprint footprint = memoryFootprint();
+    qInfo("%s: %llu points in %d chunks (max %d points), device memory: %.1f MiB", mId.c_str(),
+          static_cast<unsigned long long>(footprint.points), footprint.chunks, capacity,
+          static_cast<double>(footprint.deviceBytes) / (1024.0 * 1024.0));
+}
+
+void PointCloud::initPipeline(PipelineManager* pipelineMgr)
+{
+    std::map<PipelineManager::AdditionalParameters, QVariant> parameters;
+    parameters[PipelineManager::ApSeparatedAttributes] = true; // buffer per attribute
+    parameters[PipelineManager::ApPrimitiveTopology] = static_cast<uint32_t>(VK_PRIMITIVE_TOPOLOGY_POINT_LIST);
+    const char* vertexShader = mHasNormals ? "../shaders/point_cloud_normal.vert.bin" : "../shaders/point_cloud.vert.bin";
+    mGo.pipelineInfo = pipelineMgr->getPipeline(vertexShader, "", "", "", "../shaders/point_cloud.frag.bin", parameters);
+    if (!mGo.pipelineInfo) {
+        qWarning("%s can't get pipeline!", mId.c_str());
+        return;
+    }
+    if (!pipelineMgr->allocateDescriptorSets(mGo.pipelineInfo, mGo.descriptorSets)) {
+        qWarning("%s can't allocate descriptor sets!", mId.c_str());
+        mGo.descriptorSets.clear();
+    }
+    mGo.connectResourceWithUniformSets(*mResourceMgr->deviceFunctions(), mResourceMgr->device());
+}
+
+void PointCloud::update(DrawManager* drawMgr)
+{
+    assert(drawMgr);
+    const glm::mat4x4& projMtx = *drawMgr->getProjMatrix();
+    const glm::mat4x4& viewMtx = *drawMgr->getViewMatrix();
+
+    ::Uniform uniform;
+    uniform.viewProjMtx = projMtx * viewMtx;
+    uniform.cameraPos = glm::inverse(viewMtx)[3];
+    // Pixels covered by one world unit at distance 1 - projected size is divided by clip w in shader
+    float pixelsPerUnit = mAttenuated ? 0.5f * std::abs(projMtx[1][1]) * static_cast<float>(drawMgr->getViewportSize().height) : 0.f;
+    uniform.pointSize = glm::vec4(mPointSize, pixelsPerUnit, mPointSizeRange[0], mPointSizeRange[1]);
+
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    VkDevice device = mResourceMgr->device();
+    void* deviceMemMappedPtr = nullptr;
+    devFuncs->vkMapMemory(device, mGo.uniforms->getMem(), 0, sizeof(Uniform), 0, &deviceMemMappedPtr);
+    memcpy(deviceMemMappedPtr, &uniform, sizeof(uniform));
+    devFuncs->vkUnmapMemory(device, mGo.uniforms->getMem());
+}
+
+void PointCloud::uploadChunks()
+{
+    // At least one chunk per frame, more while they fit into budget
+    uint64_t budget = mUploadBudget;
+    const bool uploading = mNextUploadChunk < mChunks.size();
+    while (mNextUploadChunk < mChunks.size()) {
+        Chunk& chunk = mChunks[mNextUploadChunk];
+        uint64_t chunkBytes = chunk.positions->getSize() + chunk.colors->getSize() + (chunk.normals ? chunk.normals->getSize() : 0);
+        if (chunkBytes > budget && budget < mUploadBudget) {
+            break;
+        }
+        chunk.uploaded = mUploader->upload(*chunk.positions, 0, &mPositions[chunk.firstPoint], chunk.positions->getSize())
+                      && mUploader->upload(*chunk.colors, 0, &mColors[chunk.firstPoint], chunk.colors->getSize())
+                      && (!chunk.normals || mUploader->upload(*chunk.normals, 0, &mNormals[chunk.firstPoint], chunk.normals->getSize()));
+        if (!chunk.uploaded) {
+            qWarning("%s can't upload chunk %d", mId.c_str(), mNextUploadChunk);
+        }
+        budget -= std::min(budget, chunkBytes);
+        ++mNextUploadChunk;
+    }
+    if (uploading && mNextUploadChunk == mChunks.size()) {
+        if (mReleaseHostPoints) {
+            releaseHostPoints();
+        }
+        MemoryFootprint footprint = memoryFootprint();
+        qInfo("%s: upload finished, %d of %d chunks on device", mId.c_str(), footprint.uploadedChunks, footprint.chunks);
+    }
+}
+
+void PointCloud::releaseHostPoints()
+{
+    std::vector<glm::vec3>().swap(mPositions);
+    std::vector<uint32_t>().swap(mColors);
+    std::vector<uint32_t>().swap(mNormals);
+}
+
+void PointCloud::setupBarrier(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("PointCloud::setupBarrier");
+    if (!mUploader) {
+        return;
+    }
+    uploadChunks();
+    // Called every frame - staging buffers of finished frames are released here
+    mUploader->record(drawMgr, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+}
+
+void PointCloud::enqueue(RenderQueue* queue, DrawManager* /*drawMgr*/)
+{
+    if (!mGo.pipelineInfo || mChunks.empty()) {
+        return;
+    }
+    queue->pushCustom(this, RenderQueue::makeKey(mGo, 0.f));
+}
+
+void PointCloud::draw(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("PointCloud::draw");
+    assert(drawMgr);
+    VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
+    if (!mGo.pipelineInfo || !cmdBuf) {
+        return;
+    }
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    devFuncs->vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mGo.pipelineInfo->pipeline);
+
+    FrameArena* arena = drawMgr->frameArena();
+    FrameVector<VkDescriptorSet> descriptorSets = makeFrameVector<VkDescriptorSet>(arena, mGo.pipelineInfo->descriptorSetInfo.size(), nullptr);
+    for (size_t descriptorSetIdx = 0; descriptorSetIdx < descriptorSets.size(); ++descriptorSetIdx) {
+        descriptorSets[descriptorSetIdx] = mGo.descriptorSet(descriptorSetIdx);
+    }
+    if (!descriptorSets.empty()) {
+        devFuncs->vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mGo.pipelineInfo->pipelineLayout,
+                                          0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(),
+                                          0, nullptr);
+    }
+
+    bool culling = drawMgr->getProjMatrix() && drawMgr->getViewMatrix();
+    Frustum frustum = culling ? Frustum::fromMatrix(*drawMgr->getProjMatrix() * *drawMgr->getViewMatrix()) : Frustum();
+    const VkDeviceSize offsets[3] = {};
+    for (const Chunk& chunk : mChunks) {
+        if (!chunk.uploaded || (culling && !frustum.intersectsSphere(glm::vec3(chunk.sphere), chunk.sphere.w))) {
+            continue;
+        }
+        const VkBuffer buffers[3] = { chunk.positions->getBuffer(), chunk.colors->getBuffer(), chunk.normals ? chunk.normals->getBuffer() : nullptr };
+        devFuncs->vkCmdBindVertexBuffers(cmdBuf, 0, chunk.normals ? 3 : 2, buffers, offsets);
+        devFuncs->vkCmdDraw(cmdBuf, chunk.pointCount, 1, 0, 0);
+    }
+}
+
+void PointCloud::releasePipeline()
+{
+    mGo.pipelineInfo = nullptr;
+    mGo.descriptorSets.clear(); // released with PipelineManager
+}
+
+void PointCloud::releaseResource()
+{
+    mChunks.clear();
+    mUploader.reset();
+    mGo = {};
+}
+
+bool PointCloud::boundingSphere(glm::vec4& sphere) const
+{
+    if (mChunks.empty()) {
+        return false;
+    }
+    sphere = mSphere;
+    return true;
+}
+
+PointCloud::MemoryFootprint PointCloud::memoryFootprint() const
+{
+    MemoryFootprint footprint;
+    footprint.points = mPointCount;
+    footprint.chunks = static_cast<uint32_t>(mChunks.size());
+    for (const Chunk& chunk : mChunks) {
+        footprint.uploadedChunks += chunk.uploaded ? 1 : 0;
+        footprint.deviceBytes += chunk.positions->getSize() + chunk.colors->getSize() + (chunk.normals ? chunk.normals->getSize() : 0);
+    }
+    footprint.stagingBytes = mUploader ? mUploader->stagingBytes() : 0;
+    footprint.hostBytes = hostBytes(mPositions) + hostBytes(mColors) + hostBytes(mNormals);
+    return footprint;
+}
@@ -0,0 +1,143 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <IRenderable.hpp>
+#include <string>
+#include <memory>
+#include <vector>
+#include <Graphic/GraphicObject.hpp>
+#include <Scan/PointCloudData.hpp>
+
+class BufferDescr;
+class BufferUploader;
+
+///
+/// Scanner point cloud drawn as VK_PRIMITIVE_TOPOLOGY_POINT_LIST from device local buffers.
+/// Points are sorted along Morton curve of a coarse grid and split into chunks - each chunk has own buffers
+/// (positions, RGBA8 colors, optional snorm8 normals), bounding sphere for frustum culling and is uploaded
+/// through staging buffers within per frame budget. Host copy of points is kept, so device resources can be created
+/// again (e.g. new window surface), unless setReleaseHostPoints(true) frees it after whole upload.
+/// Point size is in pixels or in world units attenuated with distance (sizes > 1 need largePoints device feature).
+///
+class PointCloud : public IRenderable
+{
+public:
+    struct MemoryFootprint {
+        uint64_t points = 0;
+        uint32_t chunks = 0;
+        uint32_t uploadedChunks = 0;
+        uint64_t deviceBytes = 0;  // vertex buffers of all chunks
+        uint64_t stagingBytes = 0; // alive staging buffers
+        uint64_t hostBytes = 0;    // host copy of points
+    };
+
+    ///
+    /// colors - RGBA8 (red in the lowest byte), empty - white. normals - empty or one per point.
+    ///
+    PointCloud(std::vector<glm::vec3> positions, std::vector<uint32_t> colors = std::vector<uint32_t>(),
+               std::vector<glm::vec3> normals = std::vector<glm::vec3>());
+    ///
+    /// Points loaded by PointCloudLoader - arrays are moved, not copied.
+    ///
+    explicit PointCloud(PointCloudData&& data);
+    ~PointCloud() override;
+
+    const char* id() const override;
+    const char* description() const override;
+
+    void initResource(ResourceManager* resourceMgr) override;
+    void initPipeline(PipelineManager* pipelineMgr) override;
+    void update(DrawManager* drawMgr) override;
+    void setupBarrier(DrawManager* drawMgr) override;
+    void enqueue(RenderQueue* queue, DrawManager* drawMgr) override;
+    void draw(DrawManager* drawMgr) override;
+    void releasePipeline() override;
+    void releaseResource() override;
+    bool boundingSphere(glm::vec4& sphere) const override;
+
+    ///
+    /// attenuated - size is in world units and shrinks with distance, otherwise size is in pixels.
+    /// Result is clamped to device pointSizeRange.
+    ///
+    void setPointSize(float size, bool attenuated);
+
+    ///
+    /// Have to be set before initResource. maxPointsPerChunk is lowered if buffer would exceed device limits.
+    ///
+    void setFramesInFlight(uint32_t framesInFlight);
+    void setMaxPointsPerChunk(uint32_t maxPointsPerChunk);
+    void setUploadBudget(uint64_t bytesPerFrame);
+
+    ///
+    /// Frees host copy of points after whole upload - saves memory, but the cloud is empty after next initResource.
+    ///
+    void setReleaseHostPoints(bool release) { mReleaseHostPoints = release; }
+
+    MemoryFootprint memoryFootprint() const;
+
+protected:
+    struct Chunk {
+        uint32_t firstPoint = 0; // in sorted host arrays
+        uint32_t pointCount = 0;
+        glm::vec4 sphere;
+        std::unique_ptr<BufferDescr> positions;
+        std::unique_ptr<BufferDescr> colors;
+        std::unique_ptr<BufferDescr> normals;
+        bool uploaded = false;
+    };
+
+    void sortPoints();
+    uint32_t chunkCapacity() const; // points per chunk within device limits
+    void uploadChunks();
+    void releaseHostPoints();
+
+protected:
+    std::string mId;
+    std::string mDescr;
+    GraphicObject mGo; // pipeline, uniforms and descriptor sets - vertex buffers are per chunk
+
+    std::vector<glm::vec3> mPositions;
+    std::vector<uint32_t> mColors;
+    std::vector<uint32_t> mNormals; // packed snorm8 xyz
+    uint64_t mPointCount = 0;
+    bool mHasNormals = false;
+    bool mSorted = false;
+    bool mReleaseHostPoints = false;
+
+    std::vector<Chunk> mChunks;
+    uint32_t mNextUploadChunk = 0;
+    glm::vec4 mSphere = glm::vec4(0.f);
+    std::unique_ptr<BufferUploader> mUploader;
+
+    float mPointSize = 2.f;
+    bool mAttenuated = false;
+    float mPointSizeRange[2] = { 1.f, 1.f };
+    uint32_t mFramesInFlight = 1;
+    uint32_t mMaxPointsPerChunk = 1u << 20;
+    uint64_t mUploadBudget = 64ull * 1024 * 1024;
+
+    ResourceManager* mResourceMgr = nullptr;
+};
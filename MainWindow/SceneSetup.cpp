@@ -0,0 +1,135 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "SceneSetup.hpp"
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/ext.hpp>
+#include <chrono>
+#include <cstring>
+#include <memory>
+#include "Cube.hpp"
+#include "ChunkField.hpp"
+#include <Graphic/Scene.hpp>
+#include <Graphic/DrawManager.hpp>
+#include <Graphic/ParallelRecorder.hpp>
+#include <Graphic/RenderGraph.hpp>
+#include <Graphic/VulkanFunctions.hpp>
+
+namespace SceneSetup
+{
+
+void fill(Scene& scene, const Settings& settings)
+{
+    // Textured cube in the center and grid of small instanced cubes around
+    if (settings.texturedCube) {
+        scene.add(std::unique_ptr<IRenderable>(new Cube(true, settings.bindlessTextures)));
+    }
+
+    const int gridHalfSize = settings.gridHalfSize;
+    const float gridSpacing = 3.f;
+    for (int x = -gridHalfSize; x <= gridHalfSize; ++x) {
+        for (int z = -gridHalfSize; z <= gridHalfSize; ++z) {
+            if (x == 0 && z == 0) {
+                continue;
+            }
+            Cube* cube = new Cube(false);
+            glm::vec4 color(static_cast<float>(x + gridHalfSize) / (2 * gridHalfSize), 0.5f,
+                            static_cast<float>(z + gridHalfSize) / (2 * gridHalfSize), 0.5f); // alpha - how much it covers gradient
+            cube->setInstanced(true, color);
+            glm::mat4x4 modelMtx = glm::translate(glm::identity<glm::mat4>(), glm::vec3(x * gridSpacing, -2.f, z * gridSpacing));
+            cube->setModelMatrix(glm::scale(modelMtx, glm::vec3(0.5f)));
+            scene.add(std::unique_ptr<IRenderable>(cube));
+        }
+    }
+
+    if (settings.chunksPerSide) {
+        // Far below the grid - thousands of chunks culled on GPU
+        ChunkField* chunkField = new ChunkField(settings.chunksPerSide, 2.f, -8.f);
+        chunkField->setFramesInFlight(settings.framesInFlight);
+        scene.add(std::unique_ptr<IRenderable>(chunkField));
+    }
+}
+
+glm::mat4x4 perspective(float fovRadians, float width, float height, float minDepth, float maxDepth)
+{
+    float halfFov = 0.5f * fovRadians;
+    float f = glm::cos(halfFov) / glm::sin(halfFov);
+
+    glm::mat4x4 projMtx(0);
+    projMtx[0][0] = f * height / width;
+    projMtx[1][1] = -f;
+    projMtx[2][2] = maxDepth / (minDepth - maxDepth);
+    projMtx[2][3] = -1;
+    projMtx[3][2] = (minDepth * maxDepth) / (minDepth - maxDepth);
+    return projMtx;
+}
+
+double recordMainPass(const VulkanDeviceFunctions& devFuncs, DrawManager* drawMgr, Scene& scene,
+                      ParallelRecorder* recorder, const RenderTarget& target)
+{
+    VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
+    bool useSecondaries = recorder && recorder->workerCount() > 0;
+
+    VkClearColorValue clearColor = { {  0.2f, 0.2f, 0.2f, 1.0f } };
+    VkClearDepthStencilValue clearDS = { 1.0f, 0 };
+    VkClearValue clearValues[3];
+    memset(clearValues, 0, sizeof(clearValues));
+    clearValues[0].color = clearValues[2].color = clearColor;
+    clearValues[1].depthStencil = clearDS;
+
+    VkRenderPassBeginInfo rpBeginInfo;
+    memset(&rpBeginInfo, 0, sizeof(rpBeginInfo));
+    rpBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    rpBeginInfo.renderPass = target.renderPass;
+    rpBeginInfo.framebuffer = target.framebuffer;
+    rpBeginInfo.renderArea.extent.width = target.width;
+    rpBeginInfo.renderArea.extent.height = target.height;
+    rpBeginInfo.clearValueCount = target.samples > VK_SAMPLE_COUNT_1_BIT ? 3 : 2;
+    rpBeginInfo.pClearValues = clearValues;
+    devFuncs.vkCmdBeginRenderPass(cmdBuf, &rpBeginInfo, useSecondaries ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+
+    auto recordStart = std::chrono::steady_clock::now();
+    scene.draw(drawMgr, useSecondaries ? recorder : nullptr);
+    double recordMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - recordStart).count();
+
+    devFuncs.vkCmdEndRenderPass(cmdBuf);
+    return recordMs;
+}
+
+void buildRenderGraph(RenderGraph& graph, Scene& scene, const std::function<void(DrawManager*)>& recordMain)
+{
+    RenderGraph::ResourceHandle backbuffer = graph.importResource("Backbuffer"); // default render pass of the window or offscreen target
+
+    // Work outside of render pass - uniforms, texture transitions, GPU culling, render queue
+    graph.addPass("Prepare", [&scene](DrawManager* drawMgr) {
+        scene.update(drawMgr);
+        scene.setupBarrier(drawMgr);
+        scene.buildRenderQueue(drawMgr);
+    }, true);
+
+    RenderGraph::PassHandle mainPass = graph.addPass("Main", recordMain, true);
+    graph.writeColor(mainPass, backbuffer);
+}
+
+}
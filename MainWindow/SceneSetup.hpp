@@ -0,0 +1,88 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <functional>
+
+class Scene;
+class DrawManager;
+class ParallelRecorder;
+class RenderGraph;
+struct VulkanDeviceFunctions;
+
+///
+/// Scene and passes of the 3DModelScaner window - shared by VulkanRenderer and 3DModelScanerBench,
+/// so the bench measures what the window renders.
+///
+namespace SceneSetup
+{
+
+struct Settings {
+    bool texturedCube = true;      // in the center
+    bool bindlessTextures = false; // texture of the cube from bindless table
+    int gridHalfSize = 5;          // instanced cubes (2*N+1)^2 - 1 around, 0 - none
+    uint32_t chunksPerSide = 64;   // GPU culled chunk field below the grid, 0 - none
+    uint32_t framesInFlight = 1;
+};
+
+// Camera at start - looks at the textured cube from above
+const glm::vec3 EyePosition(0.f, 2.f, 5.f);
+const glm::vec3 LookAtPosition(0.f, 0.f, 0.f);
+const float FovDegrees = 60.f;
+const float MinDepth = 0.001f;
+const float MaxDepth = 1000.f;
+
+void fill(Scene& scene, const Settings& settings);
+
+///
+/// Vulkan clip space - y down, depth 0..1
+///
+glm::mat4x4 perspective(float fovRadians, float width, float height, float minDepth, float maxDepth);
+
+struct RenderTarget {
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT; // multisampled - resolve attachment is cleared too
+};
+
+///
+/// Scene drawn into cleared render pass of target - inline or into secondary command buffers when recorder has workers.
+/// Returns milliseconds spent by recording of scene draws.
+///
+double recordMainPass(const VulkanDeviceFunctions& devFuncs, DrawManager* drawMgr, Scene& scene,
+                      ParallelRecorder* recorder, const RenderTarget& target);
+
+///
+/// "Prepare" pass (uniforms, barriers, GPU culling, render queue) and "Main" pass writing imported "Backbuffer",
+/// recordMain records the main pass (see recordMainPass). Graph has to be compiled by the caller.
+///
+void buildRenderGraph(RenderGraph& graph, Scene& scene, const std::function<void(DrawManager*)>& recordMain);
+
+}
@@ -0,0 +1,476 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "StreamedPointCloud.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <Graphic/VulkanFunctions.hpp>
+
+#include <Graphic/BufferDescr.hpp>
+#include <Graphic/BufferUploader.hpp>
+#include <Graphic/DrawManager.hpp>
+#include <Graphic/ResourceManager.hpp>
+#include <Graphic/RenderQueue.hpp>
+#include <Graphic/FrameArena.hpp>
+#include <Graphic/Frustum.hpp>
+#include <Graphic/CpuTrace.hpp>
+
+Q_DECLARE_METATYPE(VkDescriptorBufferInfo);
+
+namespace {
+struct Uniform {
+    glm::mat4x4 viewProjMtx;
+    glm::vec4 cameraPos;
+    glm::vec4 pointSize; // size, pixels per world unit at distance 1 (0 - size in pixels), min, max
+};
+
+const uint64_t StaleFrames = 30; // loaded node not selected for so long is dropped instead of uploaded
+
+}
+
+StreamedPointCloud::StreamedPointCloud(const std::string& path)
+    : mPath(path)
+{
+    mId = "StreamedPointCloud";
+    mDescr = "Octree point cloud streamed from " + path;
+    qInfo("Creating: %s - %s", mId.c_str(), mDescr.c_str());
+}
+
+StreamedPointCloud::~StreamedPointCloud()
+{
+    qInfo("Destroying: %s - %s", mId.c_str(), mDescr.c_str());
+}
+
+const char* StreamedPointCloud::id() const
+{
+    return mId.c_str();
+}
+
+const char* StreamedPointCloud::description() const
+{
+    return mDescr.c_str();
+}
+
+void StreamedPointCloud::setPointSize(float size, bool attenuated)
+{
+    mPointSize = size;
+    mAttenuated = attenuated;
+}
+
+void StreamedPointCloud::setFramesInFlight(uint32_t framesInFlight)
+{
+    mFramesInFlight = std::max(1u, framesInFlight);
+}
+
+void StreamedPointCloud::setLoaderThreads(uint32_t threads)
+{
+    mLoaderThreads = std::max(1u, threads);
+}
+
+void StreamedPointCloud::setGpuBudget(uint64_t bytes)
+{
+    mGpuBudget = bytes;
+}
+
+void StreamedPointCloud::setUploadBudget(uint64_t bytesPerFrame)
+{
+    mUploadBudget = bytesPerFrame;
+}
+
+void StreamedPointCloud::setPointBudget(uint64_t points)
+{
+    mPointBudget = points;
+}
+
+void StreamedPointCloud::setMaxScreenSpaceError(float pixels)
+{
+    mMaxScreenSpaceError = std::max(0.01f, pixels);
+}
+
+glm::vec4 StreamedPointCloud::nodeSphere(uint32_t nodeIdx) const
+{
+    const OctreeFormat::Node& node = mReader.node(nodeIdx);
+    glm::vec3 minPos(node.boundsMin[0], node.boundsMin[1], node.boundsMin[2]);
+    glm::vec3 maxPos(node.boundsMax[0], node.boundsMax[1], node.boundsMax[2]);
+    return glm::vec4(0.5f * (minPos + maxPos), 0.5f * glm::length(maxPos - minPos));
+}
+
+void StreamedPointCloud::initResource(ResourceManager* resourceMgr)
+{
+    TRACE_SCOPE("StreamedPointCloud::initResource");
+    assert(resourceMgr);
+    mResourceMgr = resourceMgr;
+    if (!mReader.open(mPath)) {
+        qWarning("%s can't open %s", mId.c_str(), mPath.c_str());
+        return;
+    }
+    mNodes = std::vector<Node>(mReader.nodeCount());
+    mLoader = std::unique_ptr<OctreeNodeLoader>(new OctreeNodeLoader(&mReader, mLoaderThreads));
+    mUploader = std::unique_ptr<BufferUploader>(new BufferUploader(mResourceMgr, mFramesInFlight));
+    mBandwidthWindowStart = std::chrono::steady_clock::now();
+
+    VkPhysicalDeviceProperties props;
+    mResourceMgr->instanceFunctions().vkGetPhysicalDeviceProperties(mResourceMgr->physicalDevice(), &props);
+    mPointSizeRange[0] = props.limits.pointSizeRange[0];
+    mPointSizeRange[1] = props.limits.pointSizeRange[1];
+
+    ::Uniform uniformDefinition = {};
+    mGo.uniforms = mResourceMgr->createBuffer();
+    mGo.uniforms->createBuffer(&uniformDefinition, sizeof(uniformDefinition), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT);
+
+    mGo.uniformMapping.resize(1);
+    mGo.uniformMapping[0].resize(1);
+    VkDescriptorBufferInfo uniformBufferInfo;
+    uniformBufferInfo.buffer = mGo.uniforms->getBuffer();
+    uniformBufferInfo.offset = 0;
+    uniformBufferInfo.range = sizeof(::Uniform);
+    mGo.uniformMapping[0][0] = QVariant::fromValue(uniformBufferInfo);
+    mGo.modelMtx = glm::mat4x4(1.f);
+
+    qInfo("%s: %llu points in %u nodes, opened in %.3f ms, device budget: %.1f MiB", mId.c_str(),
+          static_cast<unsigned long long>(mReader.header().pointCount), mReader.nodeCount(), mReader.openMs(),
+          static_cast<double>(mGpuBudget) / (1024.0 * 1024.0));
+}
+
+void StreamedPointCloud::initPipeline(PipelineManager* pipelineMgr)
+{
+    if (!mReader.isOpen()) {
+        return;
+    }
+    std::map<PipelineManager::AdditionalParameters, QVariant> parameters;
+    parameters[PipelineManager::ApSeparatedAttributes] = true; // buffer per attribute
+    parameters[PipelineManager::ApPrimitiveTopology] = static_cast<uint32_t>(VK_PRIMITIVE_TOPOLOGY_POINT_LIST);
+    const bool hasNormals = mReader.header().attributes & OctreeFormat::AttributeNormals;
+    const char* vertexShader = hasNormals ? "../shaders/point_cloud_normal.vert.bin" : "../shaders/point_cloud.vert.bin";
+    mGo.pipelineInfo = pipelineMgr->getPipeline(vertexShader, "", "", "", "../shaders/point_cloud.frag.bin", parameters);
+    if (!mGo.pipelineInfo) {
+        qWarning("%s can't get pipeline!", mId.c_str());
+        return;
+    }
+    if (!pipelineMgr->allocateDescriptorSets(mGo.pipelineInfo, mGo.descriptorSets)) {
+        qWarning("%s can't allocate descriptor sets!", mId.c_str());
+        mGo.descriptorSets.clear();
+    }
+    mGo.connectResourceWithUniformSets(*mResourceMgr->deviceFunctions(), mResourceMgr->device());
+}
+
+void StreamedPointCloud::update(DrawManager* drawMgr)
+{
+    assert(drawMgr);
+    if (!mReader.isOpen()) {
+        return;
+    }
+    ++mFrame;
+    const glm::mat4x4& projMtx = *drawMgr->getProjMatrix();
+    const glm::mat4x4& viewMtx = *drawMgr->getViewMatrix();
+
+    ::Uniform uniform;
+    uniform.viewProjMtx = projMtx * viewMtx;
+    uniform.cameraPos = glm::inverse(viewMtx)[3];
+    // Pixels covered by one world unit at distance 1 - projected size is divided by clip w in shader
+    float pixelsPerUnit = mAttenuated ? 0.5f * std::abs(projMtx[1][1]) * static_cast<float>(drawMgr->getViewportSize().height) : 0.f;
+    uniform.pointSize = glm::vec4(mPointSize, pixelsPerUnit, mPointSizeRange[0], mPointSizeRange[1]);
+
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    VkDevice device = mResourceMgr->device();
+    void* deviceMemMappedPtr = nullptr;
+    devFuncs->vkMapMemory(device, mGo.uniforms->getMem(), 0, sizeof(Uniform), 0, &deviceMemMappedPtr);
+    memcpy(deviceMemMappedPtr, &uniform, sizeof(uniform));
+    devFuncs->vkUnmapMemory(device, mGo.uniforms->getMem());
+
+    selectNodes(drawMgr);
+}
+
+void StreamedPointCloud::selectNodes(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("StreamedPointCloud::selectNodes");
+    const glm::mat4x4& projMtx = *drawMgr->getProjMatrix();
+    const glm::mat4x4& viewMtx = *drawMgr->getViewMatrix();
+    const Frustum frustum = Frustum::fromMatrix(projMtx * viewMtx);
+    const glm::vec3 cameraPos = glm::vec3(glm::inverse(viewMtx)[3]);
+    const float viewportHeight = drawMgr->getViewportSize().height ? static_cast<float>(drawMgr->getViewportSize().height) : 1080.f;
+    const float pixelsPerUnit = 0.5f * std::abs(projMtx[1][1]) * viewportHeight;
+
+    // Screen space error in pixels, negative - node is not visible
+    auto screenSpaceError = [&](uint32_t nodeIdx) {
+        glm::vec4 sphere = nodeSphere(nodeIdx);
+        if (!frustum.intersectsSphere(glm::vec3(sphere), sphere.w)) {
+            return -1.f;
+        }
+        float distance = std::max(glm::length(glm::vec3(sphere) - cameraPos) - sphere.w, 1e-3f);
+        return mReader.node(nodeIdx).spacing * pixelsPerUnit / distance;
+    };
+
+    //
+    // Nodes with the largest error first until point budget is used
+    //
+    mCandidates.clear();
+    mRequests.clear();
+    mSelected.clear();
+    mStats.selectedPoints = 0;
+    float rootError = screenSpaceError(0);
+    if (rootError >= 0.f) {
+        mCandidates.emplace_back(rootError, 0);
+    }
+    while (!mCandidates.empty()) {
+        std::pop_heap(mCandidates.begin(), mCandidates.end());
+        const float error = mCandidates.back().first;
+        const uint32_t nodeIdx = mCandidates.back().second;
+        mCandidates.pop_back();
+        const uint32_t pointCount = mReader.node(nodeIdx).pointCount;
+        if (mStats.selectedPoints + pointCount > mPointBudget && !mSelected.empty()) {
+            break;
+        }
+        mSelected.push_back(nodeIdx);
+        mStats.selectedPoints += pointCount;
+
+        Node& node = mNodes[nodeIdx];
+        node.lastSelectedFrame = mFrame;
+        if (node.state == NodeResident) {
+            ++mStats.hits;
+            mLru.splice(mLru.begin(), mLru, node.lruIt);
+        }
+        else {
+            ++mStats.misses;
+            if (node.state == NodeAbsent) {
+                mRequests.push_back(OctreeNodeLoader::Request{ nodeIdx, error });
+            }
+        }
+
+        if (error <= mMaxScreenSpaceError) {
+            continue;
+        }
+        for (uint32_t octant = 0; octant < 8; ++octant) {
+            uint32_t childIdx = mReader.childIndex(nodeIdx, octant);
+            float childError = childIdx != OctreeFormat::InvalidNode ? screenSpaceError(childIdx) : -1.f;
+            if (childError >= 0.f) {
+                mCandidates.emplace_back(childError, childIdx);
+                std::push_heap(mCandidates.begin(), mCandidates.end());
+            }
+        }
+    }
+    mStats.selectedNodes = static_cast<uint32_t>(mSelected.size());
+    mLoader->setRequests(mRequests);
+}
+
+bool StreamedPointCloud::makeRoom(uint64_t bytes)
+{
+    while (mStats.residentBytes + bytes > mGpuBudget) {
+        if (mLru.empty() || mNodes[mLru.back()].lastSelectedFrame == mFrame) {
+            return false; // everything resident is needed in this frame
+        }
+        evict(mLru.back());
+    }
+    return true;
+}
+
+void StreamedPointCloud::evict(uint32_t nodeIdx)
+{
+    Node& node = mNodes[nodeIdx];
+    Retired retired;
+    retired.buffers[0] = std::move(node.positions);
+    retired.buffers[1] = std::move(node.colors);
+    retired.buffers[2] = std::move(node.normals);
+    retired.frame = mFrame;
+    mRetired.push_back(std::move(retired));
+
+    mLru.erase(node.lruIt);
+    mStats.residentBytes -= node.bytes;
+    --mStats.residentNodes;
+    ++mStats.evictions;
+    node.bytes = 0;
+    node.state = NodeAbsent;
+}
+
+void StreamedPointCloud::uploadReadyNodes()
+{
+    TRACE_SCOPE("StreamedPointCloud::uploadReadyNodes");
+    size_t firstNew = mReady.size();
+    mLoader->takeLoaded(mReady);
+    for (size_t i = firstNew; i < mReady.size(); ++i) {
+        mNodes[mReady[i].nodeIdx].state = NodeReady;
+    }
+
+    const VkBufferUsageFlags usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    auto createAndUpload = [&](std::unique_ptr<BufferDescr>& buffer, const void* data, size_t size) {
+        buffer = std::unique_ptr<BufferDescr>(new BufferDescr(mResourceMgr));
+        return buffer->createBuffer(nullptr, size, usage, BufferDescr::DeviceLocalMemory)
+            && mUploader->upload(*buffer, 0, data, size);
+    };
+
+    // At least one node per frame, more while they fit into budget - the rest waits for next frames
+    uint64_t budget = mUploadBudget;
+    uint64_t uploadedBytes = 0;
+    bool stopped = false;
+    size_t kept = 0;
+    for (size_t i = 0; i < mReady.size(); ++i) {
+        OctreeNodeLoader::LoadedNode& loaded = mReady[i];
+        Node& node = mNodes[loaded.nodeIdx];
+        if (mFrame - node.lastSelectedFrame > StaleFrames) {
+            node.state = NodeAbsent; // camera moved away
+            continue;
+        }
+        const uint64_t bytes = loaded.positions.size() * sizeof(glm::vec3) + loaded.colors.size() * sizeof(uint32_t)
+                             + loaded.normals.size() * sizeof(uint32_t);
+        stopped = stopped || (bytes > budget && budget < mUploadBudget) || !makeRoom(bytes);
+        if (stopped) {
+            if (kept != i) {
+                mReady[kept] = std::move(loaded);
+            }
+            ++kept;
+            continue;
+        }
+
+        bool uploaded = loaded.positions.empty()
+                     || (createAndUpload(node.positions, loaded.positions.data(), loaded.positions.size() * sizeof(glm::vec3))
+                         && createAndUpload(node.colors, loaded.colors.data(), loaded.colors.size() * sizeof(uint32_t))
+                         && (loaded.normals.empty() || createAndUpload(node.normals, loaded.normals.data(), loaded.normals.size() * sizeof(uint32_t))));
+        if (!uploaded) {
+            qWarning("%s can't upload node %u", mId.c_str(), loaded.nodeIdx);
+            node.positions.reset();
+            node.colors.reset();
+            node.normals.reset();
+            node.state = NodeAbsent;
+            continue;
+        }
+        node.state = NodeResident;
+        node.bytes = bytes;
+        mLru.push_front(loaded.nodeIdx);
+        node.lruIt = mLru.begin();
+        ++mStats.residentNodes;
+        mStats.residentBytes += bytes;
+        uploadedBytes += bytes;
+        budget -= std::min(budget, bytes);
+    }
+    mReady.erase(mReady.begin() + kept, mReady.end());
+
+    //
+    // Bandwidth over last second
+    //
+    mStats.uploadedBytes += uploadedBytes;
+    mBandwidthWindowBytes += uploadedBytes;
+    auto now = std::chrono::steady_clock::now();
+    double windowSeconds = std::chrono::duration<double>(now - mBandwidthWindowStart).count();
+    if (windowSeconds >= 1.0) {
+        mStats.uploadMegabytesPerSecond = mBandwidthWindowBytes / (1024.0 * 1024.0) / windowSeconds;
+        mBandwidthWindowBytes = 0;
+        mBandwidthWindowStart = now;
+    }
+    mStats.diskMegabytesPerSecond = mLoader->stats().megabytesPerSecond();
+}
+
+void StreamedPointCloud::setupBarrier(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("StreamedPointCloud::setupBarrier");
+    if (!mUploader) {
+        return;
+    }
+    // Evicted buffers are not used by frames still in flight
+    mRetired.erase(std::remove_if(mRetired.begin(), mRetired.end(),
+                                  [this](const Retired& retired) { return retired.frame + mFramesInFlight <= mFrame; }),
+                   mRetired.end());
+    uploadReadyNodes();
+    // Called every frame - staging buffers of finished frames are released here
+    mUploader->record(drawMgr, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT);
+}
+
+void StreamedPointCloud::enqueue(RenderQueue* queue, DrawManager* /*drawMgr*/)
+{
+    if (!mGo.pipelineInfo || mSelected.empty()) {
+        return;
+    }
+    queue->pushCustom(this, RenderQueue::makeKey(mGo, 0.f));
+}
+
+void StreamedPointCloud::draw(DrawManager* drawMgr)
+{
+    TRACE_SCOPE("StreamedPointCloud::draw");
+    assert(drawMgr);
+    VkCommandBuffer cmdBuf = drawMgr->getCmdBuffer();
+    if (!mGo.pipelineInfo || !cmdBuf) {
+        return;
+    }
+    VulkanDeviceFunctions *devFuncs = mResourceMgr->deviceFunctions();
+    devFuncs->vkCmdBindPipeline(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mGo.pipelineInfo->pipeline);
+
+    FrameArena* arena = drawMgr->frameArena();
+    FrameVector<VkDescriptorSet> descriptorSets = makeFrameVector<VkDescriptorSet>(arena, mGo.pipelineInfo->descriptorSetInfo.size(), nullptr);
+    for (size_t descriptorSetIdx = 0; descriptorSetIdx < descriptorSets.size(); ++descriptorSetIdx) {
+        descriptorSets[descriptorSetIdx] = mGo.descriptorSet(descriptorSetIdx);
+    }
+    if (!descriptorSets.empty()) {
+        devFuncs->vkCmdBindDescriptorSets(cmdBuf, VK_PIPELINE_BIND_POINT_GRAPHICS, mGo.pipelineInfo->pipelineLayout,
+                                          0, static_cast<uint32_t>(descriptorSets.size()), descriptorSets.data(),
+                                          0, nullptr);
+    }
+
+    // Selected nodes are already frustum culled
+    mStats.drawnPoints = 0;
+    const VkDeviceSize offsets[3] = {};
+    for (uint32_t nodeIdx : mSelected) {
+        const Node& node = mNodes[nodeIdx];
+        if (node.state != NodeResident || !node.positions) {
+            continue;
+        }
+        const VkBuffer buffers[3] = { node.positions->getBuffer(), node.colors->getBuffer(), node.normals ? node.normals->getBuffer() : nullptr };
+        devFuncs->vkCmdBindVertexBuffers(cmdBuf, 0, node.normals ? 3 : 2, buffers, offsets);
+        uint32_t pointCount = mReader.node(nodeIdx).pointCount;
+        devFuncs->vkCmdDraw(cmdBuf, pointCount, 1, 0, 0);
+        mStats.drawnPoints += pointCount;
+    }
+}
+
+void StreamedPointCloud::releasePipeline()
+{
+    mGo.pipelineInfo = nullptr;
+    mGo.descriptorSets.clear(); // released with PipelineManager
+}
+
+void StreamedPointCloud::releaseResource()
+{
+    mLoader.reset(); // joins threads which read mapped file
+    mReady.clear();
+    mSelected.clear();
+    mRetired.clear();
+    mLru.clear();
+    mNodes.clear();
+    mUploader.reset();
+    mReader.close();
+    mGo = {};
+    mStats.residentNodes = 0;
+    mStats.residentBytes = 0;
+}
+
+bool StreamedPointCloud::boundingSphere(glm::vec4& sphere) const
+{
+    if (!mReader.isOpen()) {
+        return false;
+    }
+    const OctreeFormat::Header& header = mReader.header();
+    glm::vec3 minPos(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+    glm::vec3 maxPos(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+    sphere = glm::vec4(0.5f * (minPos + maxPos), 0.5f * glm::length(maxPos - minPos));
+    return true;
+}
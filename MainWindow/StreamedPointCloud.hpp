@@ -0,0 +1,160 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <IRenderable.hpp>
+#include <list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include <chrono>
+#include <Graphic/GraphicObject.hpp>
+#include <Scan/OctreeNodeLoader.hpp>
+#include <Scan/OctreeReader.hpp>
+
+class BufferDescr;
+class BufferUploader;
+
+///
+/// Point cloud from native octree file (*.pco) which may be larger than device memory.
+/// Every frame visible nodes are selected by screen space error - projected spacing of their points - within point budget.
+/// Missing nodes are read by OctreeNodeLoader threads and uploaded within per frame budget. When device memory budget
+/// is exceeded least recently used nodes are evicted, their buffers are released framesInFlight frames later.
+/// Nodes are additive (child adds points to parent), so any subset of selected nodes gives a valid picture.
+///
+class StreamedPointCloud : public IRenderable
+{
+public:
+    struct Stats {
+        uint64_t hits = 0;                  // selected nodes found on device - summed over frames
+        uint64_t misses = 0;                // selected nodes not on device
+        uint64_t evictions = 0;
+        uint32_t selectedNodes = 0;         // last frame
+        uint64_t selectedPoints = 0;
+        uint64_t drawnPoints = 0;
+        uint32_t residentNodes = 0;
+        uint64_t residentBytes = 0;
+        uint64_t uploadedBytes = 0;         // total
+        double uploadMegabytesPerSecond = 0.0; // measured over last second
+        double diskMegabytesPerSecond = 0.0;   // read and decode throughput of loader threads
+    };
+
+    explicit StreamedPointCloud(const std::string& path);
+    ~StreamedPointCloud() override;
+
+    const char* id() const override;
+    const char* description() const override;
+
+    void initResource(ResourceManager* resourceMgr) override;
+    void initPipeline(PipelineManager* pipelineMgr) override;
+    void update(DrawManager* drawMgr) override;
+    void setupBarrier(DrawManager* drawMgr) override;
+    void enqueue(RenderQueue* queue, DrawManager* drawMgr) override;
+    void draw(DrawManager* drawMgr) override;
+    void releasePipeline() override;
+    void releaseResource() override;
+    bool boundingSphere(glm::vec4& sphere) const override;
+
+    ///
+    /// The same meaning as PointCloud::setPointSize
+    ///
+    void setPointSize(float size, bool attenuated);
+
+    ///
+    /// Have to be set before initResource
+    ///
+    void setFramesInFlight(uint32_t framesInFlight);
+    void setLoaderThreads(uint32_t threads);
+
+    void setGpuBudget(uint64_t bytes);             // vertex buffers of resident nodes
+    void setUploadBudget(uint64_t bytesPerFrame);  // at least one node per frame is uploaded
+    void setPointBudget(uint64_t points);          // selected points per frame
+    void setMaxScreenSpaceError(float pixels);     // node is refined when its spacing is projected to more pixels
+
+    const Stats& stats() const { return mStats; }
+
+protected:
+    enum NodeState {
+        NodeAbsent,   // on disk, may be requested
+        NodeReady,    // loaded by loader, waiting for upload
+        NodeResident, // buffers on device
+    };
+
+    struct Node {
+        NodeState state = NodeAbsent;
+        std::unique_ptr<BufferDescr> positions;
+        std::unique_ptr<BufferDescr> colors;
+        std::unique_ptr<BufferDescr> normals;
+        uint64_t bytes = 0;
+        uint64_t lastSelectedFrame = 0;
+        std::list<uint32_t>::iterator lruIt; // valid when resident
+    };
+
+    struct Retired {
+        std::unique_ptr<BufferDescr> buffers[3];
+        uint64_t frame;
+    };
+
+    void selectNodes(DrawManager* drawMgr);
+    void uploadReadyNodes();
+    bool makeRoom(uint64_t bytes); // evict LRU nodes not selected in this frame
+    void evict(uint32_t nodeIdx);
+    glm::vec4 nodeSphere(uint32_t nodeIdx) const;
+
+protected:
+    std::string mId;
+    std::string mDescr;
+    std::string mPath;
+    GraphicObject mGo; // pipeline, uniforms and descriptor sets - vertex buffers are per node
+
+    OctreeReader mReader;
+    std::unique_ptr<OctreeNodeLoader> mLoader;
+    std::unique_ptr<BufferUploader> mUploader;
+    std::vector<Node> mNodes;                     // [node index in file]
+    std::list<uint32_t> mLru;                     // resident nodes - most recently used at front
+    std::vector<OctreeNodeLoader::LoadedNode> mReady;
+    std::vector<uint32_t> mSelected;              // this frame, ordered by screen space error
+    std::vector<std::pair<float, uint32_t>> mCandidates; // max heap of (screen space error, node) - kept to reuse memory
+    std::vector<OctreeNodeLoader::Request> mRequests;
+    std::vector<Retired> mRetired;
+    uint64_t mFrame = 0;
+    Stats mStats;
+
+    std::chrono::steady_clock::time_point mBandwidthWindowStart;
+    uint64_t mBandwidthWindowBytes = 0;
+
+    float mPointSize = 2.f;
+    bool mAttenuated = false;
+    float mPointSizeRange[2] = { 1.f, 1.f };
+    uint32_t mFramesInFlight = 1;
+    uint32_t mLoaderThreads = 2;
+    uint64_t mGpuBudget = 512ull * 1024 * 1024;
+    uint64_t mUploadBudget = 32ull * 1024 * 1024;
+    uint64_t mPointBudget = 10000000;
+    float mMaxScreenSpaceError = 2.f;
+
+    ResourceManager* mResourceMgr = nullptr;
+};
@@ -23,18 +23,29 @@ SOFTWARE.
 */
 
 #include "VulkanRenderer.hpp"
-#include <QVulkanDeviceFunctions>
+#include <QVulkanInstance>
 #include <libshaderc/shaderc.hpp>
 #define GLM_ENABLE_EXPERIMENTAL
 #include <glm/ext.hpp>
 #include <array>
-#include "Cube.hpp"
+#include <chrono>
+#include "PointCloud.hpp"
+#include "SceneSetup.hpp"
+#include "StreamedPointCloud.hpp"
 #include <Graphic/ResourceManager.hpp>
 #include <Graphic/PipelineManager.hpp>
 #include <Graphic/DrawManager.hpp>
+#include <Graphic/Scene.hpp>
+#include <Graphic/ParallelRecorder.hpp>
+#include <Graphic/RenderGraph.hpp>
+#include <Graphic/GpuProfiler.hpp>
+#include <Graphic/CpuTrace.hpp>
+#include <Scan/PointCloudLoader.hpp>
+#include <QCoreApplication>
 
 VulkanRenderer::VulkanRenderer(QVulkanWindow& parent)
-    : mDrawMgr(std::unique_ptr<DrawManager>(new DrawManager()))
+    : mScene(std::unique_ptr<Scene>(new Scene()))
+    , mDrawMgr(std::unique_ptr<DrawManager>(new DrawManager()))
     , mViewMtx(std::shared_ptr<glm::mat4x4>(new glm::mat4x4))
     , mProjMtx(std::shared_ptr<glm::mat4x4>(new glm::mat4x4))
     , mParent(parent)
@@ -43,6 +54,103 @@ VulkanRenderer::VulkanRenderer(QVulkanWindow& parent)
     mDrawMgr->setViewMatrix(mViewMtx);
 }
 
+void VulkanRenderer::fillScene()
+{
+    SceneSetup::Settings settings;
+    settings.bindlessTextures = mUseBindlessTextures;
+    settings.chunksPerSide = mUseGpuDrivenChunks ? 64 : 0;
+    settings.framesInFlight = static_cast<uint32_t>(mParent.concurrentFrameCount());
+    SceneSetup::fill(*mScene, settings);
+
+    // Optional scan given as the first argument: 3DModelScaner cloud.ply, octree file (cloud.pco) is streamed
+    const QStringList arguments = QCoreApplication::arguments();
+    if (arguments.size() > 1) {
+        const std::string path = arguments[1].toStdString();
+        if (arguments[1].endsWith(".pco", Qt::CaseInsensitive)) {
+            mStreamedCloud = new StreamedPointCloud(path);
+            mStreamedCloud->setFramesInFlight(static_cast<uint32_t>(mParent.concurrentFrameCount()));
+            mScene->add(std::unique_ptr<IRenderable>(mStreamedCloud));
+            return;
+        }
+        PointCloudData data;
+        PointCloudLoader loader;
+        if (loader.load(path, data)) {
+            PointCloud* pointCloud = new PointCloud(std::move(data));
+            pointCloud->setFramesInFlight(static_cast<uint32_t>(mParent.concurrentFrameCount()));
+            mScene->add(std::unique_ptr<IRenderable>(pointCloud));
+        }
+    }
+}
+
+void VulkanRenderer::printFrameStats()
+{
+    const uint64_t printEveryFrames = 600;
+    if (mFrameCounter % printEveryFrames) {
+        return;
+    }
+
+    const RenderQueue::Stats& stats = mScene->renderQueue().stats();
+    qInfo("Frame %llu. Items: %d, draws: %d (custom: %d), state changes skipped: %d"
+          , static_cast<unsigned long long>(mFrameCounter)
+          , stats.items, stats.draws, stats.customDraws
+          , stats.stateChangesSkipped());
+    qInfo("    instanced draws: %d, instances: %d, dropped instances: %d"
+          , stats.instancedDraws, stats.instances, stats.instancesDropped);
+    const BoundsCuller::Stats& cullStats = mScene->cullStats();
+    qInfo("    frustum culling (%s): visible %d, culled %d of %d, %.3f ms, threads: %d"
+          , BoundsCuller::simdPathName(mScene->boundsCuller().simdPath())
+          , cullStats.visible, cullStats.culled, cullStats.tested, cullStats.timeMs, cullStats.threads);
+    qInfo("    recording: %.3f ms/frame, threads: %d, secondary command buffers: %d"
+          , mRecordTimeSumMs / printEveryFrames
+          , mRecorder ? mRecorder->workerCount() : 0
+          , stats.recordingChunks);
+    mRecordTimeSumMs = 0.0;
+    if (FrameArena::isHeapAllocationCountEnabled()) {
+        qInfo("    heap allocations: %.1f/frame, frame arena: %llu bytes used of %llu"
+              , static_cast<double>(mHeapAllocationsSum) / printEveryFrames
+              , static_cast<unsigned long long>(mDrawMgr->frameArena()->used())
+              , static_cast<unsigned long long>(mDrawMgr->frameArena()->capacity()));
+        mHeapAllocationsSum = 0;
+    }
+    if (mGpuProfiler) {
+        const GpuProfiler::FrameResult& gpuFrame = mGpuProfiler->lastFrame();
+        qInfo("    gpu: %.3f ms (frame %llu), dropped scopes: %d"
+              , gpuFrame.frameMs, static_cast<unsigned long long>(gpuFrame.frameNumber), gpuFrame.droppedScopes);
+        for (const GpuProfiler::Node& node : gpuFrame.nodes) {
+            if (node.depth == 1) { // render graph passes
+                qInfo("        %s: %.3f ms", node.name, node.durationMs);
+            }
+        }
+    }
+    if (mStreamedCloud) {
+        const StreamedPointCloud::Stats& streaming = mStreamedCloud->stats();
+        qInfo("    streaming: %u nodes selected, %llu points drawn, hits %llu, misses %llu, evictions %llu"
+              , streaming.selectedNodes, static_cast<unsigned long long>(streaming.drawnPoints)
+              , static_cast<unsigned long long>(streaming.hits), static_cast<unsigned long long>(streaming.misses)
+              , static_cast<unsigned long long>(streaming.evictions));
+        qInfo("        resident: %u nodes, %.1f MiB, upload: %.1f MB/s, disk: %.1f MB/s"
+              , streaming.residentNodes, static_cast<double>(streaming.residentBytes) / (1024.0 * 1024.0)
+              , streaming.uploadMegabytesPerSecond, streaming.diskMegabytesPerSecond);
+    }
+    ResourceStateTracker* tracker = mResourceMgr->stateTracker();
+    qInfo("    barriers: %d calls, image: %d, buffer: %d, not needed: %d"
+          , tracker->stats().pipelineBarriers, tracker->stats().imageBarriers
+          , tracker->stats().bufferBarriers, tracker->stats().skipped);
+    tracker->resetStats();
+    if (GeometryArena* arena = mResourceMgr->geometryArena(sizeof(glm::vec3))) {
+        GeometryArena::Stats arenaStats = arena->stats();
+        qInfo("    geometry arena (position): %d meshes, vertices: %d of %d, indices: %d of %d, failed allocations: %d"
+              , arenaStats.meshes, arenaStats.verticesUsed, arenaStats.vertexCapacity
+              , arenaStats.indicesUsed, arenaStats.indexCapacity, arenaStats.failedAllocations);
+    }
+    qInfo("    pipeline: %d/%d skipped, descriptor sets: %d/%d skipped, vertex buffers: %d/%d skipped, index buffer: %d/%d skipped, push constants: %d/%d skipped"
+          , stats.pipelineBindsSkipped, stats.pipelineBinds + stats.pipelineBindsSkipped
+          , stats.descriptorSetBindsSkipped, stats.descriptorSetBinds + stats.descriptorSetBindsSkipped
+          , stats.vertexBufferBindsSkipped, stats.vertexBufferBinds + stats.vertexBufferBindsSkipped
+          , stats.indexBufferBindsSkipped, stats.indexBufferBinds + stats.indexBufferBindsSkipped
+          , stats.pushConstantsSkipped, stats.pushConstants + stats.pushConstantsSkipped);
+}
+
 void VulkanRenderer::preInitResources()
 {
 
@@ -50,30 +158,63 @@ void VulkanRenderer::preInitResources()
 
 void VulkanRenderer::initResources()
 {
-    assert(mParent.vulkanInstance() && "Vulkan instance should to be valid here!!!");
-    mDevFuncs = mParent.vulkanInstance()->deviceFunctions(mParent.device());
-    assert(mDevFuncs && "Device functions should to be valid here!!!");
-
-    mResourceMgr = std::unique_ptr<ResourceManager>(new ResourceManager(*mParent.vulkanInstance(),
+    TRACE_SCOPE("VulkanRenderer::initResources");
+#ifdef GRAPHIC_TRACE
+    CpuTrace::setThreadName("Render");
+#endif
+    QVulkanInstance* vulkanInstance = mParent.vulkanInstance();
+    assert(vulkanInstance && "Vulkan instance should to be valid here!!!");
+    PFN_vkGetInstanceProcAddr getInstanceProcAddr = reinterpret_cast<PFN_vkGetInstanceProcAddr>(vulkanInstance->getInstanceProcAddr("vkGetInstanceProcAddr"));
+    if (!mInstanceFuncs.load(getInstanceProcAddr, vulkanInstance->vkInstance())
+     || !mDeviceFuncs.load(mInstanceFuncs, mParent.device())) {
+        qFatal("Not all Vulkan functions are resolved");
+    }
+    mDevFuncs = &mDeviceFuncs;
+
+    mResourceMgr = std::unique_ptr<ResourceManager>(new ResourceManager(mInstanceFuncs,
+                                                                        mDevFuncs,
                                                                         mParent.device(),
                                                                         mParent.physicalDevice()));
 
-    Cube* cube = new Cube(true); // TODO move this allocation somewhere else
-    mCube = std::unique_ptr<IRenderable>(cube);
-    mCube->initResource(mResourceMgr.get());
+    if (mUseBindlessTextures) {
+        const uint32_t maxBindlessTextures = 4096;
+        mUseBindlessTextures = mResourceMgr->enableBindlessTextures(maxBindlessTextures) != nullptr;
+    }
+
+    if (!mScene->size()) {
+        fillScene();
+    }
+    mScene->initResource(mResourceMgr.get(), static_cast<uint32_t>(mParent.concurrentFrameCount()));
+
+    mRecorder = std::unique_ptr<ParallelRecorder>(new ParallelRecorder(mDevFuncs,
+                                                                       mParent.device(),
+                                                                       mParent.graphicsQueueFamilyIndex(),
+                                                                       static_cast<uint32_t>(mParent.concurrentFrameCount())));
+    mRecorder->setWorkerCount(mRecordingThreads);
+
+    mGpuProfiler = std::unique_ptr<GpuProfiler>(new GpuProfiler(mResourceMgr.get()));
+    if (!mGpuProfiler->create(mParent.graphicsQueueFamilyIndex(), static_cast<uint32_t>(mParent.concurrentFrameCount()))) {
+        mGpuProfiler.reset();
+    }
+    mDrawMgr->setGpuProfiler(mGpuProfiler.get());
+
+    buildRenderGraph();
 }
 
 void VulkanRenderer::initSwapChainResources()
 {
+    TRACE_SCOPE("VulkanRenderer::initSwapChainResources");
     //here swapchain is valid eg. size of surface
     QSize frameSize = mParent.swapChainImageSize();
 
-    mPipelineMgr = std::unique_ptr<PipelineManager>(new PipelineManager(*mParent.vulkanInstance(),
+    mPipelineMgr = std::unique_ptr<PipelineManager>(new PipelineManager(mDevFuncs,
                                                                         mParent.device(),
                                                                         frameSize,
                                                                         mParent.sampleCountFlagBits(),
                                                                         mParent.defaultRenderPass()));
-    mCube->initPipeline(mPipelineMgr.get());
+    mPipelineMgr->setBindlessTextureTable(mResourceMgr->bindlessTextures());
+    mScene->initPipeline(mPipelineMgr.get());
+    mRenderGraph->compile(frameSize);
 
     //
     // Vulkan Coordinates System
@@ -86,61 +227,89 @@ void VulkanRenderer::initSwapChainResources()
     //   Z  v   v  Y
 
 
-    float fov = 60.f;
-    preparePerspective(glm::radians(fov), static_cast<float>(frameSize.width()), static_cast<float>(frameSize.height()), 0.001f, 1000.f);
+    *mProjMtx = SceneSetup::perspective(glm::radians(SceneSetup::FovDegrees), static_cast<float>(frameSize.width()),
+                                        static_cast<float>(frameSize.height()), SceneSetup::MinDepth, SceneSetup::MaxDepth);
 
-    mEyePosition = glm::vec3(0.f, 2.f, 5.f);
-    mEyeLookAtDir = glm::normalize(glm::vec3(0.f, 0.f, 0.f) - mEyePosition);
+    mEyePosition = SceneSetup::EyePosition;
+    mEyeLookAtDir = glm::normalize(SceneSetup::LookAtPosition - mEyePosition);
     *mViewMtx.get() = glm::mat4x4(1);
     lookAt(mEyePosition, mEyePosition + mEyeLookAtDir*mEyeLookAtDistance, mUpDir);
 }
 
 void VulkanRenderer::releaseSwapChainResources()
 {
-    mCube->releasePipeline();
+    mRenderGraph->release();
+    mScene->releasePipeline();
     mPipelineMgr.reset();
 }
 
 void VulkanRenderer::releaseResources()
 {
-    mCube->releaseResource();
+    mRenderGraph.reset();
+    mRecorder.reset();
+    mDrawMgr->setGpuProfiler(nullptr);
+    mGpuProfiler.reset();
+    mScene->releaseResource();
     mResourceMgr.reset();
 }
 
-void VulkanRenderer::startNextFrame()
+void VulkanRenderer::buildRenderGraph()
+{
+    mRenderGraph = std::unique_ptr<RenderGraph>(new RenderGraph(mResourceMgr.get()));
+    SceneSetup::buildRenderGraph(*mRenderGraph, *mScene, [this](DrawManager* drawMgr) {
+        recordMainPass(drawMgr);
+    });
+}
+
+void VulkanRenderer::recordMainPass(DrawManager* drawMgr)
 {
     QSize frameSize = mParent.swapChainImageSize();
+    SceneSetup::RenderTarget target;
+    target.renderPass = mParent.defaultRenderPass();
+    target.framebuffer = mParent.currentFramebuffer();
+    target.width = static_cast<uint32_t>(frameSize.width());
+    target.height = static_cast<uint32_t>(frameSize.height());
+    target.samples = mParent.sampleCountFlagBits();
+    mRecordTimeSumMs += SceneSetup::recordMainPass(*mDevFuncs, drawMgr, *mScene, mRecorder.get(), target);
+}
+
+void VulkanRenderer::startNextFrame()
+{
+    TRACE_SCOPE("Frame");
     VkCommandBuffer cmdBuf = mParent.currentCommandBuffer();
+    mDrawMgr->beginFrame();
     mDrawMgr->setCmdBuffer(cmdBuf);
-
-    mCube->update(mDrawMgr.get());
-    mCube->setupBarrier(mDrawMgr.get());
-
-    VkClearColorValue clearColor = { {  0.2f, 0.2f, 0.2f, 1.0f } };
-    VkClearDepthStencilValue clearDS = { 1.0f, 0 };
-    VkClearValue clearValues[3];
-    memset(clearValues, 0, sizeof(clearValues));
-    clearValues[0].color = clearValues[2].color = clearColor;
-    clearValues[1].depthStencil = clearDS;
-
-    VkRenderPassBeginInfo rpBeginInfo;
-    memset(&rpBeginInfo, 0, sizeof(rpBeginInfo));
-    rpBeginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    rpBeginInfo.renderPass = mParent.defaultRenderPass();
-    rpBeginInfo.framebuffer = mParent.currentFramebuffer();
-    rpBeginInfo.renderArea.extent.width = static_cast<uint32_t>(frameSize.width());
-    rpBeginInfo.renderArea.extent.height = static_cast<uint32_t>(frameSize.height());
-    rpBeginInfo.clearValueCount = mParent.sampleCountFlagBits() > VK_SAMPLE_COUNT_1_BIT ? 3 : 2;
-    rpBeginInfo.pClearValues = clearValues;
-    mDevFuncs->vkCmdBeginRenderPass(cmdBuf, &rpBeginInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    mCube->draw(mDrawMgr.get());
-
-    mDevFuncs->vkCmdEndRenderPass(cmdBuf);
+    mDrawMgr->setRenderPass(mParent.defaultRenderPass(), mParent.currentFramebuffer());
+    mDrawMgr->setCurrentFrame(static_cast<uint32_t>(mParent.currentFrame()));
+    QSize frameSize = mParent.swapChainImageSize();
+    mDrawMgr->setViewportSize(static_cast<uint32_t>(frameSize.width()), static_cast<uint32_t>(frameSize.height()));
+
+    if (mRecorder->workerCount() != mRecordingThreads) {
+        // Command pools of workers are recreated - no frame can use them
+        mDevFuncs->vkDeviceWaitIdle(mParent.device());
+        mRecorder->setWorkerCount(mRecordingThreads);
+    }
+
+    if (mGpuProfiler) {
+        mGpuProfiler->beginFrame(cmdBuf, mDrawMgr->getCurrentFrame());
+    }
+    {
+        GpuScope frameScope(mDrawMgr.get(), "Frame");
+        mRenderGraph->execute(mDrawMgr.get());
+    }
+    mHeapAllocationsSum += mDrawMgr->heapAllocationsInFrame();
 
     mParent.frameReady();
 
     mDrawMgr->setCmdBuffer(nullptr);
+
+    ++mFrameCounter;
+    printFrameStats();
+}
+
+const GpuProfiler* VulkanRenderer::gpuProfiler() const
+{
+    return mGpuProfiler.get();
 }
 
 void VulkanRenderer::physicalDeviceLost()
@@ -176,6 +345,11 @@ void VulkanRenderer::moveCamera(float right, float up, float forward)
     lookAt(mEyePosition, mEyePosition + mEyeLookAtDir*mEyeLookAtDistance, mUpDir);
 }
 
+void VulkanRenderer::setRecordingThreads(uint32_t threadCount)
+{
+    mRecordingThreads = threadCount;
+}
+
 void VulkanRenderer::lookAt(const glm::vec3& eye, const glm::vec3& center, const glm::vec3& up)
 {
     glm::vec3 const f(glm::normalize(center - eye));
@@ -197,19 +371,3 @@ void VulkanRenderer::lookAt(const glm::vec3& eye, const glm::vec3& center, const
     viewMtx[3][1] =-dot(u, eye);
     viewMtx[3][2] = dot(f, eye);
 }
-
-void VulkanRenderer::preparePerspective(float fovRadians, float width, float height, float minDepth, float maxDepth)
-{
-    float halfFov = 0.5f * fovRadians;
-    float f = glm::cos(halfFov) / glm::sin(halfFov);
-
-    glm::mat4x4& projMtx = *mProjMtx.get();
-
-    projMtx = glm::mat4x4(0);
-    projMtx[0][0] = f * height / width;
-    projMtx[1][1] = -f;
-    projMtx[2][2] = maxDepth / (minDepth - maxDepth);
-    projMtx[2][3] = -1;
-    projMtx[3][2] = (minDepth * maxDepth) / (minDepth - maxDepth);
-}
-
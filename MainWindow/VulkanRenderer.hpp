@@ -29,10 +29,16 @@ SOFTWARE.
 #include <memory>
 
 #include <IRenderable.hpp>
+#include <Graphic/VulkanFunctions.hpp>
 
 class ResourceManager;
 class PipelineManager;
 class DrawManager;
+class Scene;
+class ParallelRecorder;
+class RenderGraph;
+class GpuProfiler;
+class StreamedPointCloud;
 
 class VulkanRenderer : public QVulkanWindowRenderer
 {
@@ -52,14 +58,41 @@ public:
 
     void rotateCamera(float pitch, float yaw, float roll); //relative rotation x-pitch, y-yaw, z-roll [degree]
     void moveCamera(float right, float up, float forward); //relative move [meter]
+
+    ///
+    /// Number of threads recording render queue into secondary command buffers. 0 - record inline in primary.
+    /// Applied at the beginning of the next frame.
+    ///
+    void setRecordingThreads(uint32_t threadCount);
+    uint32_t recordingThreads() const { return mRecordingThreads; }
+
+    ///
+    /// GPU times of render graph passes and renderables, nullptr when device resources are not created
+    /// or timestamps are not supported.
+    ///
+    const GpuProfiler* gpuProfiler() const;
 protected:
 
     void updateUniformBuffer();
+    void fillScene();
+    void printFrameStats();
+    void buildRenderGraph();
+    void recordMainPass(DrawManager* drawMgr); // scene in default render pass of the window
 
     void lookAt(const glm::vec3& eye, const glm::vec3& center, const glm::vec3& up);
-    void preparePerspective(float fovRadians, float width, float height, float minDepth, float maxDepth);
 
-    std::unique_ptr<IRenderable> mCube;
+    bool mUseBindlessTextures = false; // QVulkanWindow (Qt 5) can't chain descriptor indexing features to device create info,
+                                       // bindless path runs with HeadlessContext (3DModelScanerBench --bindless)
+    bool mUseGpuDrivenChunks = true;   // chunk field culled by compute shader and drawn indirectly
+    std::unique_ptr<Scene> mScene;
+    uint64_t mFrameCounter = 0;
+    uint32_t mRecordingThreads = 0;
+    double mRecordTimeSumMs = 0.0; // since last stats print
+    uint64_t mHeapAllocationsSum = 0; // since last stats print, counted only with GRAPHIC_COUNT_HEAP_ALLOCATIONS
+    std::unique_ptr<ParallelRecorder> mRecorder;
+    std::unique_ptr<RenderGraph> mRenderGraph;
+    std::unique_ptr<GpuProfiler> mGpuProfiler;
+    StreamedPointCloud* mStreamedCloud = nullptr; // owned by scene, only when octree file is given
     std::unique_ptr<PipelineManager> mPipelineMgr;
     std::unique_ptr<DrawManager> mDrawMgr;
     std::unique_ptr<ResourceManager> mResourceMgr;
@@ -73,5 +106,7 @@ protected:
     std::shared_ptr<glm::mat4x4> mProjMtx;
 
     QVulkanWindow &mParent;
-    QVulkanDeviceFunctions *mDevFuncs;
+    VulkanInstanceFunctions mInstanceFuncs; // resolved from QVulkanInstance of the window
+    VulkanDeviceFunctions mDeviceFuncs;
+    VulkanDeviceFunctions *mDevFuncs = nullptr;
 };
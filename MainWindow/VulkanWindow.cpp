@@ -24,10 +24,22 @@ SOFTWARE.
 
 #include "VulkanWindow.hpp"
 #include "VulkanRenderer.hpp"
+#include "GpuProfilerWidget.hpp"
+#include <Graphic/CpuTrace.hpp>
 #include <QInputEvent>
 #include <set>
+#include <thread>
+#include <algorithm>
 
 VulkanWindow::VulkanWindow()
+{
+    // Optional features - unsupported extensions are ignored by QVulkanWindow
+    setDeviceExtensions(QByteArrayList() << VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME
+                                         << VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME
+                                         << VK_EXT_CALIBRATED_TIMESTAMPS_EXTENSION_NAME); // GPU scopes in CPU trace
+}
+
+VulkanWindow::~VulkanWindow()
 {
 }
 
@@ -38,6 +50,11 @@ QVulkanWindowRenderer* VulkanWindow::createRenderer()
     return mVulkanRenderer;
 }
 
+const GpuProfiler* VulkanWindow::gpuProfiler() const
+{
+    return mVulkanRenderer ? mVulkanRenderer->gpuProfiler() : nullptr;
+}
+
 void VulkanWindow::keyPressEvent(QKeyEvent *event)
 {
     static const std::set<int> movementSet = {Qt::Key_W, Qt::Key_S, Qt::Key_A, Qt::Key_D, Qt::Key_Q, Qt::Key_E};
@@ -59,6 +76,29 @@ void VulkanWindow::keyPressEvent(QKeyEvent *event)
         mVulkanRenderer->moveCamera(moveRight, moveUp, moveForward);
         requestUpdate();
     }
+    if (mVulkanRenderer
+     && event
+     && event->key() == Qt::Key_T) {
+        // Cycle 0, 1, 2, 4 ... hardware threads - compare recording time printed in frame stats
+        uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+        uint32_t threads = mVulkanRenderer->recordingThreads();
+        threads = threads == 0 ? 1 : threads * 2;
+        mVulkanRenderer->setRecordingThreads(threads > maxThreads ? 0 : threads);
+        qInfo("Recording threads: %d", mVulkanRenderer->recordingThreads());
+        requestUpdate();
+    }
+    if (event
+     && event->key() == Qt::Key_R) {
+        // Chrome/Perfetto trace of last events - empty without GRAPHIC_TRACE
+        CpuTrace::writeChromeTrace("trace.json");
+    }
+    if (event
+     && event->key() == Qt::Key_P) {
+        if (!mGpuProfilerWidget) {
+            mGpuProfilerWidget = std::unique_ptr<GpuProfilerWidget>(new GpuProfilerWidget(this));
+        }
+        mGpuProfilerWidget->setVisible(!mGpuProfilerWidget->isVisible());
+    }
     QVulkanWindow::keyPressEvent(event);
 }
 
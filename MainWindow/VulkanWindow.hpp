@@ -25,8 +25,11 @@ SOFTWARE.
 #pragma once
 
 #include <QVulkanWindow>
+#include <memory>
 
 class VulkanRenderer;
+class GpuProfiler;
+class GpuProfilerWidget;
 
 class VulkanWindow : public QVulkanWindow
 {
@@ -34,6 +37,7 @@ class VulkanWindow : public QVulkanWindow
 
 public:
     VulkanWindow();
+    ~VulkanWindow() override;
 
     ///From QT documentation:
     /// This virtual function is called once during the lifetime of the window, at some point after making it visible for the first time.
@@ -45,6 +49,8 @@ public:
     /// So there is no need to call this function by our site.
     QVulkanWindowRenderer *createRenderer() override;
 
+    const GpuProfiler* gpuProfiler() const; // nullptr if renderer is not created or profiling is not available
+
 protected:
     void keyPressEvent(QKeyEvent *) override;
     void mousePressEvent(QMouseEvent *) override;
@@ -57,4 +63,5 @@ protected:
 protected:
     VulkanRenderer* mVulkanRenderer = nullptr; // Should not be released here!!!
     QPointF mPrevCursorPosition;
+    std::unique_ptr<GpuProfilerWidget> mGpuProfilerWidget; // toggled with P key
 };
@@ -53,6 +53,9 @@ int main(int argc, char **argv) {
                        << "VK_LAYER_GOOGLE_unique_objects");
 #endif
 
+    // Needed to query optional device features e.g. descriptor indexing (core since Vulkan 1.1)
+    vkInstance.setExtensions(QByteArrayList() << VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME);
+
     qInfo("Creating Vulkan instance...");
     if (!vkInstance.create()) {
         qFatal("Failed to create Vulkan instance: %d", vkInstance.errorCode());
@@ -0,0 +1,428 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "DepthBackProjector.hpp"
+#include "Parallel.hpp"
+#include <WorkStealingPool.hpp>
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+
+#if defined(SIMD_X86)
+#include <immintrin.h>
+#elif defined(SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+const uint32_t MinPixelsPerThread = 64 * 1024; // below that waking a pool thread costs more than it saves
+const uint32_t BlocksPerThread = 4;            // row blocks to steal when rows have different point counts
+
+///
+/// One row of depth image with everything needed to emit its points
+///
+struct RowJob {
+    float depthScale;
+    float minDepth;
+    float maxDepth;
+    float rowFactor;            // (v - cy) / fy
+    const float* columnFactors; // (u - cx) / fx
+    uint32_t width;
+    const uint32_t* colorRow;     // nullptr - no colors
+    const uint32_t* colorColumns;
+};
+
+inline float depthValue(uint16_t value, float scale) { return value * scale; }
+inline float depthValue(float value, float scale) { return value * scale; }
+
+//
+// Scalar
+//
+
+template <typename Depth>
+uint32_t countRowScalar(const Depth* row, const RowJob& job, uint32_t first)
+{
+    uint32_t count = 0;
+    for (uint32_t u = first; u < job.width; ++u) {
+        float z = depthValue(row[u], job.depthScale);
+        count += (z >= job.minDepth && z <= job.maxDepth) ? 1 : 0; // NaN fails both
+    }
+    return count;
+}
+
+template <typename Depth>
+uint32_t writeRowScalar(const Depth* row, const RowJob& job, uint32_t first, glm::vec3* positions, uint32_t* colors)
+{
+    uint32_t written = 0;
+    for (uint32_t u = first; u < job.width; ++u) {
+        float z = depthValue(row[u], job.depthScale);
+        if (z >= job.minDepth && z <= job.maxDepth) {
+            positions[written] = glm::vec3(z * job.columnFactors[u], z * job.rowFactor, z);
+            if (colors) {
+                colors[written] = job.colorRow[job.colorColumns[u]];
+            }
+            ++written;
+        }
+    }
+    return written;
+}
+
+///
+/// Lanes of valid depth (bits of mask) go to output - shared by SIMD paths
+///
+template <int Lanes>
+inline uint32_t emitLanes(int mask, uint32_t u, const float* x, const float* y, const float* z, const RowJob& job,
+                          glm::vec3* positions, uint32_t* colors)
+{
+    if (mask == (1 << Lanes) - 1) { // the common case - whole surface visible
+        for (int lane = 0; lane < Lanes; ++lane) {
+            positions[lane] = glm::vec3(x[lane], y[lane], z[lane]);
+        }
+        if (colors) {
+            for (int lane = 0; lane < Lanes; ++lane) {
+                colors[lane] = job.colorRow[job.colorColumns[u + lane]];
+            }
+        }
+        return Lanes;
+    }
+    uint32_t written = 0;
+    while (mask) {
+        int lane = __builtin_ctz(static_cast<unsigned>(mask));
+        mask &= mask - 1;
+        positions[written] = glm::vec3(x[lane], y[lane], z[lane]);
+        if (colors) {
+            colors[written] = job.colorRow[job.colorColumns[u + lane]];
+        }
+        ++written;
+    }
+    return written;
+}
+
+//
+// AVX2 - 8 pixels
+//
+
+#if defined(SIMD_AVX2)
+__attribute__((target("avx2")))
+inline __m256 loadDepthAvx2(const uint16_t* depth)
+{
+    __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(depth));
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(values));
+}
+
+__attribute__((target("avx2")))
+inline __m256 loadDepthAvx2(const float* depth)
+{
+    return _mm256_loadu_ps(depth);
+}
+
+template <typename Depth>
+__attribute__((target("avx2")))
+uint32_t countRowAvx2(const Depth* row, const RowJob& job)
+{
+    const __m256 scale = _mm256_set1_ps(job.depthScale);
+    const __m256 minDepth = _mm256_set1_ps(job.minDepth);
+    const __m256 maxDepth = _mm256_set1_ps(job.maxDepth);
+    uint32_t count = 0;
+    uint32_t u = 0;
+    for (; u + 8 <= job.width; u += 8) {
+        __m256 z = _mm256_mul_ps(loadDepthAvx2(row + u), scale);
+        __m256 valid = _mm256_and_ps(_mm256_cmp_ps(z, minDepth, _CMP_GE_OQ), _mm256_cmp_ps(z, maxDepth, _CMP_LE_OQ));
+        count += static_cast<uint32_t>(__builtin_popcount(static_cast<unsigned>(_mm256_movemask_ps(valid))));
+    }
+    return count + countRowScalar(row, job, u);
+}
+
+template <typename Depth>
+__attribute__((target("avx2")))
+uint32_t writeRowAvx2(const Depth* row, const RowJob& job, glm::vec3* positions, uint32_t* colors)
+{
+    const __m256 scale = _mm256_set1_ps(job.depthScale);
+    const __m256 minDepth = _mm256_set1_ps(job.minDepth);
+    const __m256 maxDepth = _mm256_set1_ps(job.maxDepth);
+    const __m256 rowFactor = _mm256_set1_ps(job.rowFactor);
+    alignas(32) float x[8];
+    alignas(32) float y[8];
+    alignas(32) float z[8];
+    uint32_t written = 0;
+    uint32_t u = 0;
+    for (; u + 8 <= job.width; u += 8) {
+        __m256 depth = _mm256_mul_ps(loadDepthAvx2(row + u), scale);
+        __m256 valid = _mm256_and_ps(_mm256_cmp_ps(depth, minDepth, _CMP_GE_OQ), _mm256_cmp_ps(depth, maxDepth, _CMP_LE_OQ));
+        int mask = _mm256_movemask_ps(valid);
+        if (!mask) {
+            continue;
+        }
+        _mm256_store_ps(x, _mm256_mul_ps(depth, _mm256_loadu_ps(job.columnFactors + u)));
+        _mm256_store_ps(y, _mm256_mul_ps(depth, rowFactor));
+        _mm256_store_ps(z, depth);
+        written += emitLanes<8>(mask, u, x, y, z, job, positions + written, colors ? colors + written : nullptr);
+    }
+    return written + writeRowScalar(row, job, u, positions + written, colors ? colors + written : nullptr);
+}
+#endif
+
+//
+// NEON - 4 pixels
+//
+
+#if defined(SIMD_NEON)
+inline float32x4_t loadDepthNeon(const uint16_t* depth)
+{
+    return vcvtq_f32_u32(vmovl_u16(vld1_u16(depth)));
+}
+
+inline float32x4_t loadDepthNeon(const float* depth)
+{
+    return vld1q_f32(depth);
+}
+
+inline int maskNeon(uint32x4_t valid)
+{
+    return static_cast<int>((vgetq_lane_u32(valid, 0) & 1) | (vgetq_lane_u32(valid, 1) & 2) |
+                            (vgetq_lane_u32(valid, 2) & 4) | (vgetq_lane_u32(valid, 3) & 8));
+}
+
+template <typename Depth>
+uint32_t countRowNeon(const Depth* row, const RowJob& job)
+{
+    const float32x4_t scale = vdupq_n_f32(job.depthScale);
+    const float32x4_t minDepth = vdupq_n_f32(job.minDepth);
+    const float32x4_t maxDepth = vdupq_n_f32(job.maxDepth);
+    uint32x4_t count = vdupq_n_u32(0);
+    uint32_t u = 0;
+    for (; u + 4 <= job.width; u += 4) {
+        float32x4_t z = vmulq_f32(loadDepthNeon(row + u), scale);
+        uint32x4_t valid = vandq_u32(vcgeq_f32(z, minDepth), vcleq_f32(z, maxDepth));
+        count = vsubq_u32(count, valid); // valid lane is ~0 == -1
+    }
+    uint32_t total = vgetq_lane_u32(count, 0) + vgetq_lane_u32(count, 1) + vgetq_lane_u32(count, 2) + vgetq_lane_u32(count, 3);
+    return total + countRowScalar(row, job, u);
+}
+
+template <typename Depth>
+uint32_t writeRowNeon(const Depth* row, const RowJob& job, glm::vec3* positions, uint32_t* colors)
+{
+    const float32x4_t scale = vdupq_n_f32(job.depthScale);
+    const float32x4_t minDepth = vdupq_n_f32(job.minDepth);
+    const float32x4_t maxDepth = vdupq_n_f32(job.maxDepth);
+    const float32x4_t rowFactor = vdupq_n_f32(job.rowFactor);
+    float x[4];
+    float y[4];
+    float z[4];
+    uint32_t written = 0;
+    uint32_t u = 0;
+    for (; u + 4 <= job.width; u += 4) {
+        float32x4_t depth = vmulq_f32(loadDepthNeon(row + u), scale);
+        int mask = maskNeon(vandq_u32(vcgeq_f32(depth, minDepth), vcleq_f32(depth, maxDepth)));
+        if (!mask) {
+            continue;
+        }
+        vst1q_f32(x, vmulq_f32(depth, vld1q_f32(job.columnFactors + u)));
+        vst1q_f32(y, vmulq_f32(depth, rowFactor));
+        vst1q_f32(z, depth);
+        written += emitLanes<4>(mask, u, x, y, z, job, positions + written, colors ? colors + written : nullptr);
+    }
+    return written + writeRowScalar(row, job, u, positions + written, colors ? colors + written : nullptr);
+}
+#endif
+
+template <typename Depth>
+uint32_t countRow(Simd::Path path, const Depth* row, const RowJob& job)
+{
+    switch (path) {
+#if defined(SIMD_AVX2)
+    case Simd::Avx2: return countRowAvx2(row, job);
+#endif
+#if defined(SIMD_NEON)
+    case Simd::Neon: return countRowNeon(row, job);
+#endif
+    default: return countRowScalar(row, job, 0);
+    }
+}
+
+template <typename Depth>
+uint32_t writeRow(Simd::Path path, const Depth* row, const RowJob& job, glm::vec3* positions, uint32_t* colors)
+{
+    switch (path) {
+#if defined(SIMD_AVX2)
+    case Simd::Avx2: return writeRowAvx2(row, job, positions, colors);
+#endif
+#if defined(SIMD_NEON)
+    case Simd::Neon: return writeRowNeon(row, job, positions, colors);
+#endif
+    default: return writeRowScalar(row, job, 0, positions, colors);
+    }
+}
+
+}
+
+DepthBackProjector::DepthBackProjector()
+{
+}
+
+DepthBackProjector::~DepthBackProjector()
+{
+}
+
+void DepthBackProjector::setIntrinsics(const CameraIntrinsics& intrinsics)
+{
+    mIntrinsics = intrinsics;
+    mColumnFactors.resize(intrinsics.width);
+    for (uint32_t u = 0; u < intrinsics.width; ++u) {
+        mColumnFactors[u] = (static_cast<float>(u) - intrinsics.cx) / intrinsics.fx;
+    }
+    mRowFactors.resize(intrinsics.height);
+    for (uint32_t v = 0; v < intrinsics.height; ++v) {
+        mRowFactors[v] = (static_cast<float>(v) - intrinsics.cy) / intrinsics.fy;
+    }
+    mColorWidth = 0; // color columns depend on depth width
+}
+
+void DepthBackProjector::setDepthRange(float minDepth, float maxDepth)
+{
+    mMinDepth = std::max(minDepth, std::numeric_limits<float>::min()); // zero depth is always "no measurement"
+    mMaxDepth = maxDepth;
+}
+
+Simd::Path DepthBackProjector::setSimdPath(Simd::Path path)
+{
+    mPath = Simd::resolve(path);
+    return mPath;
+}
+
+uint64_t DepthBackProjector::project(const uint16_t* depth, float depthScale, PointCloudData& points, const ColorImage& color)
+{
+    return projectImage(depth, depthScale, points, color);
+}
+
+uint64_t DepthBackProjector::project(const float* depth, PointCloudData& points, const ColorImage& color)
+{
+    return projectImage(depth, 1.f, points, color);
+}
+
+template <typename Depth>
+uint64_t DepthBackProjector::projectImage(const Depth* depth, float depthScale, PointCloudData& points, const ColorImage& color)
+{
+    auto start = std::chrono::steady_clock::now();
+    mStats = Stats();
+    points.normals.clear();
+
+    const uint32_t width = mIntrinsics.width;
+    const uint32_t height = mIntrinsics.height;
+    if (!depth || width == 0 || height == 0) {
+        qWarning("Depth back projection without depth image or intrinsics");
+        points.clear();
+        return 0;
+    }
+    if (mPath == Simd::Auto) {
+        setSimdPath(Simd::Auto);
+    }
+
+    const bool withColors = color.pixels && color.width && color.height;
+    if (withColors && mColorWidth != color.width) {
+        mColorColumns.resize(width);
+        for (uint32_t u = 0; u < width; ++u) {
+            mColorColumns[u] = static_cast<uint32_t>(uint64_t(u) * color.width / width);
+        }
+        mColorWidth = color.width;
+    }
+
+    uint64_t pixels = uint64_t(width) * height;
+    uint32_t threads = static_cast<uint32_t>(std::max<uint64_t>(1, std::min<uint64_t>(Parallel::threadCount(mMaxThreads),
+                                                                                      pixels / MinPixelsPerThread)));
+    threads = std::min(threads, height);
+    if (threads > 1 && (!mPool || mPool->threadCount() != threads)) {
+        mPool.reset(new WorkStealingPool(threads));
+    }
+
+    // rows of block b: [height * b / blocks, height * (b + 1) / blocks), several blocks per thread - stolen by threads
+    // which finish early. First pass counts points of every block, second writes them from the sum of counts before it.
+    const uint32_t blocks = threads > 1 ? std::min(height, threads * BlocksPerThread) : 1;
+    auto forBlocks = [&](const std::function<void(uint32_t block, uint32_t firstRow, uint32_t lastRow)>& func) {
+        auto range = [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+            for (size_t block = first; block < last; ++block) {
+                func(static_cast<uint32_t>(block), static_cast<uint32_t>(uint64_t(height) * block / blocks),
+                     static_cast<uint32_t>(uint64_t(height) * (block + 1) / blocks));
+            }
+        };
+        if (threads > 1) {
+            mPool->parallelFor(blocks, 1, range);
+        } else {
+            range(0, blocks, 0);
+        }
+    };
+
+    RowJob rowJob;
+    rowJob.depthScale = depthScale;
+    rowJob.minDepth = mMinDepth;
+    rowJob.maxDepth = mMaxDepth;
+    rowJob.rowFactor = 0.f;
+    rowJob.columnFactors = mColumnFactors.data();
+    rowJob.width = width;
+    rowJob.colorRow = nullptr;
+    rowJob.colorColumns = withColors ? mColorColumns.data() : nullptr;
+
+    mBlockOffsets.assign(size_t(blocks) + 1, 0);
+    forBlocks([&](uint32_t block, uint32_t firstRow, uint32_t lastRow) {
+        uint64_t count = 0;
+        for (uint32_t v = firstRow; v < lastRow; ++v) {
+            count += countRow(mPath, depth + size_t(v) * width, rowJob);
+        }
+        mBlockOffsets[size_t(block) + 1] = count;
+    });
+
+    for (uint32_t block = 0; block < blocks; ++block) {
+        mBlockOffsets[size_t(block) + 1] += mBlockOffsets[block];
+    }
+    const uint64_t total = mBlockOffsets[blocks];
+    points.positions.resize(total); // previous frame size is overwritten, not zeroed
+    points.colors.resize(withColors ? total : 0);
+
+    forBlocks([&](uint32_t block, uint32_t firstRow, uint32_t lastRow) {
+        RowJob job = rowJob;
+        glm::vec3* positions = points.positions.data() + mBlockOffsets[block];
+        uint32_t* colors = withColors ? points.colors.data() + mBlockOffsets[block] : nullptr;
+        for (uint32_t v = firstRow; v < lastRow; ++v) {
+            job.rowFactor = mRowFactors[v];
+            if (withColors) {
+                job.colorRow = color.pixels + size_t(uint64_t(v) * color.height / height) * color.width;
+            }
+            uint32_t written = writeRow(mPath, depth + size_t(v) * width, job, positions, colors);
+            positions += written;
+            if (colors) {
+                colors += written;
+            }
+        }
+    });
+
+    mStats.pixels = pixels;
+    mStats.points = points.size();
+    mStats.threads = threads;
+    mStats.timeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return mStats.points;
+}
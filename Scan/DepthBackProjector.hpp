@@ -0,0 +1,125 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "PointCloudData.hpp"
+#include "SimdPath.hpp"
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class WorkStealingPool;
+
+///
+/// Pinhole camera of depth sensor - depth images are expected undistorted (rectified).
+///
+struct CameraIntrinsics {
+    float fx = 0.f;
+    float fy = 0.f;
+    float cx = 0.f;
+    float cy = 0.f;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+///
+/// Optional color image registered to depth image (the same view), any resolution - nearest pixel is used.
+/// RGBA8, red in the lowest byte.
+///
+struct ColorImage {
+    const uint32_t* pixels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+///
+/// Depth map to points in camera space (x right, y down, z forward - as depth sensors deliver it).
+/// Per column and per row factors (u - cx) / fx, (v - cy) / fy are precomputed, so a point costs three multiplications.
+/// Pixels out of depth range (0 - no measurement, NaN) are skipped - output is dense and goes straight into
+/// PointCloudData arrays, i.e. the vertex layout of PointCloud. Row blocks are processed by persistent threads
+/// (WorkStealingPool - projected every frame): first pass counts valid pixels of every block, second writes points
+/// to their final place.
+/// Depth is converted with AVX2 (runtime detected), NEON or scalar code.
+///
+class DepthBackProjector
+{
+public:
+    struct Stats {
+        uint64_t pixels = 0;
+        uint64_t points = 0;
+        uint32_t threads = 0;
+        double timeMs = 0.0;
+
+        double megapixelsPerSecond() const { return timeMs > 0.0 ? pixels / timeMs / 1000.0 : 0.0; }
+    };
+
+    DepthBackProjector();
+    ~DepthBackProjector();
+
+    void setIntrinsics(const CameraIntrinsics& intrinsics);
+    const CameraIntrinsics& intrinsics() const { return mIntrinsics; }
+
+    ///
+    /// Valid depth in meters, default 0.1 .. 10
+    ///
+    void setDepthRange(float minDepth, float maxDepth);
+
+    ///
+    /// Not supported path falls back to the best available one. Returns path which will be used.
+    ///
+    Simd::Path setSimdPath(Simd::Path path);
+    Simd::Path simdPath() const { return mPath; }
+
+    ///
+    /// 0 - hardware concurrency
+    ///
+    void setMaxThreads(uint32_t maxThreads) { mMaxThreads = maxThreads; }
+
+    ///
+    /// depth - width * height values, meters = value * depthScale (e.g. 0.001 for millimeters).
+    /// Previous content of points is replaced (memory is reused). Returns number of points.
+    ///
+    uint64_t project(const uint16_t* depth, float depthScale, PointCloudData& points, const ColorImage& color = ColorImage());
+    uint64_t project(const float* depth, PointCloudData& points, const ColorImage& color = ColorImage());
+
+    const Stats& stats() const { return mStats; }
+
+protected:
+    template <typename Depth>
+    uint64_t projectImage(const Depth* depth, float depthScale, PointCloudData& points, const ColorImage& color);
+
+    CameraIntrinsics mIntrinsics;
+    std::vector<float> mColumnFactors; // (u - cx) / fx
+    std::vector<float> mRowFactors;    // (v - cy) / fy
+    std::vector<uint32_t> mColorColumns; // color image column of depth column
+    uint32_t mColorWidth = 0;
+    float mMinDepth = 0.1f;
+    float mMaxDepth = 10.f;
+    Simd::Path mPath = Simd::Auto;
+    uint32_t mMaxThreads = 0;
+    Stats mStats;
+    std::unique_ptr<WorkStealingPool> mPool;
+    std::vector<uint64_t> mBlockOffsets; // first point of row block, [blocks] - total
+};
@@ -0,0 +1,306 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "IcpRegistration.hpp"
+#include "KdTree.hpp"
+#include "Parallel.hpp"
+#include <WorkStealingPool.hpp>
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+const size_t AlignGrain = 1024;         // source points
+const size_t NormalGrain = 64 * 1024;   // target points
+
+inline float robustWeight(IcpRegistration::Kernel kernel, float width, float residual)
+{
+    float absResidual = std::fabs(residual);
+    switch (kernel) {
+    case IcpRegistration::KernelHuber:
+        return absResidual <= width ? 1.f : width / absResidual;
+    case IcpRegistration::KernelTukey: {
+        if (absResidual >= width) {
+            return 0.f;
+        }
+        float ratio = residual / width;
+        float weight = 1.f - ratio * ratio;
+        return weight * weight;
+    }
+    default:
+        return 1.f;
+    }
+}
+
+///
+/// One row of Jacobian into normal equations
+///
+inline void addRow(double (&normal)[21], double (&rhs)[6], const float (&jacobian)[6], float residual, float weight)
+{
+    int k = 0;
+    for (int row = 0; row < 6; ++row) {
+        double weighted = double(weight) * jacobian[row];
+        for (int col = row; col < 6; ++col) {
+            normal[k++] += weighted * jacobian[col];
+        }
+        rhs[row] += weighted * residual;
+    }
+}
+
+///
+/// Solves A x = b of symmetric 6x6 (upper triangle row by row) by Cholesky decomposition,
+/// false - matrix is not positive definite (some DoF is not constrained)
+///
+bool solve6(const double (&upper)[21], const double (&b)[6], double (&x)[6])
+{
+    double l[6][6] = {};
+    double maxDiagonal = 0.0;
+    for (int row = 0, k = 0; row < 6; ++row) {
+        for (int col = row; col < 6; ++col, ++k) {
+            l[col][row] = upper[k]; // lower triangle
+        }
+        maxDiagonal = std::max(maxDiagonal, upper[k - (6 - row)]);
+    }
+    for (int j = 0; j < 6; ++j) {
+        double diagonal = l[j][j];
+        for (int k = 0; k < j; ++k) {
+            diagonal -= l[j][k] * l[j][k];
+        }
+        if (!(diagonal > 1e-12 * maxDiagonal)) {
+            return false;
+        }
+        l[j][j] = std::sqrt(diagonal);
+        for (int i = j + 1; i < 6; ++i) {
+            double value = l[i][j];
+            for (int k = 0; k < j; ++k) {
+                value -= l[i][k] * l[j][k];
+            }
+            l[i][j] = value / l[j][j];
+        }
+    }
+    double y[6];
+    for (int i = 0; i < 6; ++i) {
+        double value = b[i];
+        for (int k = 0; k < i; ++k) {
+            value -= l[i][k] * y[k];
+        }
+        y[i] = value / l[i][i];
+    }
+    for (int i = 5; i >= 0; --i) {
+        double value = y[i];
+        for (int k = i + 1; k < 6; ++k) {
+            value -= l[k][i] * x[k];
+        }
+        x[i] = value / l[i][i];
+    }
+    return true;
+}
+
+///
+/// Rigid transform of rotation vector (Rodrigues) and translation
+///
+glm::mat4 rigidTransform(const double (&x)[6])
+{
+    double theta = std::sqrt(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]);
+    double a = 1.0;
+    double b = 0.0;
+    if (theta > 1e-12) {
+        a = std::sin(theta) / theta;
+        b = (1.0 - std::cos(theta)) / (theta * theta);
+    }
+    // R = I + a * K + b * K^2, K - cross product matrix of rotation vector
+    double k[3][3] = {{0.0, -x[2], x[1]}, {x[2], 0.0, -x[0]}, {-x[1], x[0], 0.0}};
+    glm::mat4 transform(1.f);
+    for (int row = 0; row < 3; ++row) {
+        for (int col = 0; col < 3; ++col) {
+            double k2 = k[row][0] * k[0][col] + k[row][1] * k[1][col] + k[row][2] * k[2][col];
+            transform[col][row] = static_cast<float>((row == col ? 1.0 : 0.0) + a * k[row][col] + b * k2);
+        }
+    }
+    transform[3] = glm::vec4(static_cast<float>(x[3]), static_cast<float>(x[4]), static_cast<float>(x[5]), 1.f);
+    return transform;
+}
+
+}
+
+struct IcpRegistration::TargetIndex
+{
+    KdTree tree;
+    std::vector<glm::vec3> normals; // tree order, empty - target without normals
+};
+
+void IcpRegistration::Accumulator::reset()
+{
+    std::fill(normal, normal + 21, 0.0);
+    std::fill(rhs, rhs + 6, 0.0);
+    squaredError = 0.0;
+    count = 0;
+}
+
+IcpRegistration::IcpRegistration()
+{
+    setSettings(Settings());
+}
+
+IcpRegistration::~IcpRegistration()
+{
+}
+
+void IcpRegistration::setSettings(const Settings& settings)
+{
+    uint32_t threads = Parallel::threadCount(settings.threads);
+    if (!mPool || mPool->threadCount() != threads) {
+        mPool.reset(new WorkStealingPool(threads));
+    }
+    mSettings = settings;
+    mSettings.maxDistance = std::max(mSettings.maxDistance, 1e-4f);
+    mSettings.kernelWidth = std::max(mSettings.kernelWidth, 1e-6f);
+    mSettings.sampleStride = std::max(mSettings.sampleStride, 1u);
+}
+
+bool IcpRegistration::setTarget(const PointCloudData& target)
+{
+    mIndex.reset();
+    std::unique_ptr<TargetIndex> index(new TargetIndex);
+    index->tree.setMaxThreads(mSettings.threads);
+    if (!index->tree.build(target.positions)) {
+        qWarning("ICP target can't be indexed");
+        return false;
+    }
+    if (target.hasNormals()) {
+        const std::vector<uint32_t>& order = index->tree.originalIndices();
+        index->normals.resize(order.size());
+        mPool->parallelFor(order.size(), NormalGrain, [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+            for (size_t i = first; i < last; ++i) {
+                index->normals[i] = target.normals[order[i]];
+            }
+        });
+    }
+    mIndex = std::move(index);
+    mStats.indexMs = mIndex->tree.stats().buildMs;
+    return true;
+}
+
+bool IcpRegistration::align(const PointCloudData& source, glm::mat4& sourceToTarget)
+{
+    if (!mIndex) {
+        qWarning("ICP without target");
+        return false;
+    }
+    if (mSettings.metric == PointToPlane && mIndex->normals.empty()) {
+        qWarning("Point to plane ICP needs target normals");
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    double indexMs = mStats.indexMs;
+    mStats = Stats();
+    mStats.indexMs = indexMs;
+    mStats.threads = mPool->threadCount();
+    mAccumulators.resize(mStats.threads);
+
+    bool ok = true;
+    size_t samples = (source.size() + mSettings.sampleStride - 1) / mSettings.sampleStride;
+    while (mStats.iterations < mSettings.maxIterations) {
+        for (Accumulator& accumulator : mAccumulators) {
+            accumulator.reset();
+        }
+        mPool->parallelFor(samples, AlignGrain, [&](size_t first, size_t last, uint32_t threadIdx) {
+            accumulate(source, sourceToTarget, first, last, mAccumulators[threadIdx]);
+        });
+
+        Accumulator total;
+        total.reset();
+        for (const Accumulator& accumulator : mAccumulators) {
+            for (int i = 0; i < 21; ++i) {
+                total.normal[i] += accumulator.normal[i];
+            }
+            for (int i = 0; i < 6; ++i) {
+                total.rhs[i] -= accumulator.rhs[i]; // J^T W J x = -J^T W r
+            }
+            total.squaredError += accumulator.squaredError;
+            total.count += accumulator.count;
+        }
+        ++mStats.iterations;
+        mStats.correspondences = total.count;
+        mStats.rmse = total.count ? static_cast<float>(std::sqrt(total.squaredError / total.count)) : 0.f;
+
+        double update[6];
+        if (total.count < 6 || !solve6(total.normal, total.rhs, update)) {
+            qWarning("ICP correspondences do not constrain the transform (%u correspondences)", total.count);
+            ok = false;
+            break;
+        }
+        sourceToTarget = rigidTransform(update) * sourceToTarget;
+
+        double rotation = std::sqrt(update[0] * update[0] + update[1] * update[1] + update[2] * update[2]);
+        double translation = std::sqrt(update[3] * update[3] + update[4] * update[4] + update[5] * update[5]);
+        if (rotation < mSettings.minRotation && translation < mSettings.minTranslation) {
+            mStats.converged = true;
+            break;
+        }
+    }
+    mStats.totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return ok;
+}
+
+void IcpRegistration::accumulate(const PointCloudData& source, const glm::mat4& sourceToTarget, size_t first, size_t last,
+                                 Accumulator& accumulator) const
+{
+    const TargetIndex& index = *mIndex;
+    const bool pointToPlane = mSettings.metric == PointToPlane;
+    const float maxDistance = mSettings.maxDistance;
+    for (size_t i = first; i < last; ++i) {
+        glm::vec3 point(sourceToTarget * glm::vec4(source.positions[i * mSettings.sampleStride], 1.f));
+        float distanceSquared;
+        uint32_t targetIdx = index.tree.nearest(point, maxDistance, distanceSquared);
+        if (targetIdx == KdTree::NoPoint) {
+            continue;
+        }
+        glm::vec3 diff = point - index.tree.point(targetIdx);
+        if (pointToPlane) {
+            // r = dot(p + w x p + t - q, n), dr/dw = p x n, dr/dt = n
+            const glm::vec3& normal = index.normals[targetIdx];
+            float residual = glm::dot(diff, normal);
+            glm::vec3 moment = glm::cross(point, normal);
+            const float jacobian[6] = {moment.x, moment.y, moment.z, normal.x, normal.y, normal.z};
+            addRow(accumulator.normal, accumulator.rhs, jacobian, residual, robustWeight(mSettings.kernel, mSettings.kernelWidth, residual));
+            accumulator.squaredError += residual * residual;
+        }
+        else {
+            // r = p + w x p + t - q - one row per axis, weight of the whole distance
+            float weight = robustWeight(mSettings.kernel, mSettings.kernelWidth, std::sqrt(distanceSquared));
+            const float rowX[6] = {0.f, point.z, -point.y, 1.f, 0.f, 0.f};
+            const float rowY[6] = {-point.z, 0.f, point.x, 0.f, 1.f, 0.f};
+            const float rowZ[6] = {point.y, -point.x, 0.f, 0.f, 0.f, 1.f};
+            addRow(accumulator.normal, accumulator.rhs, rowX, diff.x, weight);
+            addRow(accumulator.normal, accumulator.rhs, rowY, diff.y, weight);
+            addRow(accumulator.normal, accumulator.rhs, rowZ, diff.z, weight);
+            accumulator.squaredError += distanceSquared;
+        }
+        ++accumulator.count;
+    }
+}
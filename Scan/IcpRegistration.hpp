@@ -0,0 +1,135 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include "PointCloudData.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class WorkStealingPool;
+
+///
+/// Rigid registration of point clouds by iterative closest point. Target is indexed once in KdTree (setTarget),
+/// every align() iteration finds nearest target point of each source point and solves linearized 6 DoF update
+/// (rotation vector, translation) from normal equations. Correspondences and normal equations are computed
+/// on WorkStealingPool threads, each thread sums into its own accumulator - they are added up only at the end
+/// of iteration.
+///     PointToPoint - |T * source - target|^2
+///     PointToPlane - (dot(T * source - target, targetNormal))^2, converges in a few iterations, needs target normals
+/// Residuals are weighted by robust kernel, so outliers and not overlapping parts do not pull the result.
+///
+/// Result is sourceToTarget transform - object drawing the source (GraphicObject::modelMtx) is aligned with
+/// the target when its model matrix becomes targetModelMtx * sourceToTarget.
+///
+class IcpRegistration
+{
+public:
+    enum Metric {
+        PointToPoint,
+        PointToPlane,
+    };
+
+    enum Kernel {
+        KernelNone,
+        KernelHuber,  // weight kernelWidth / |residual| above kernelWidth
+        KernelTukey,  // weight (1 - (residual / kernelWidth)^2)^2, residuals above kernelWidth are ignored
+    };
+
+    struct Settings {
+        Metric metric = PointToPlane;
+        Kernel kernel = KernelHuber;
+        float kernelWidth = 0.01f;     // meters
+        float maxDistance = 0.05f;     // meters - farther nearest neighbour is not a correspondence
+        uint32_t maxIterations = 30;
+        float minRotation = 1.0e-5f;   // radians - converged when update is smaller in rotation and translation
+        float minTranslation = 1.0e-5f; // meters
+        uint32_t sampleStride = 1;     // every n-th source point is registered
+        uint32_t threads = 0;          // 0 - hardware concurrency
+    };
+
+    struct Stats {
+        uint32_t iterations = 0;
+        uint32_t correspondences = 0;  // of the last iteration
+        float rmse = 0.f;              // meters, of the last iteration correspondences before its update
+        bool converged = false;        // false - stopped by maxIterations
+        uint32_t threads = 0;
+        double indexMs = 0.0;          // KD-tree build of setTarget
+        double totalMs = 0.0;          // align
+
+        double msPerIteration() const { return iterations ? totalMs / iterations : 0.0; }
+    };
+
+    IcpRegistration();
+    ~IcpRegistration();
+
+    ///
+    /// Target stays indexed
+    ///
+    void setSettings(const Settings& settings);
+    const Settings& settings() const { return mSettings; }
+
+    ///
+    /// Copies and indexes target points (and normals) - returns false for empty cloud
+    ///
+    bool setTarget(const PointCloudData& target);
+
+    ///
+    /// sourceToTarget - initial guess on input, result on output (also when false is returned).
+    /// Returns false without target, without target normals for PointToPlane or when correspondences
+    /// do not constrain all 6 DoF (e.g. too few of them).
+    ///
+    bool align(const PointCloudData& source, glm::mat4& sourceToTarget);
+
+    const Stats& stats() const { return mStats; }
+
+    IcpRegistration(const IcpRegistration&) = delete;
+    IcpRegistration& operator=(const IcpRegistration&) = delete;
+
+protected:
+    struct TargetIndex;
+
+    ///
+    /// Per thread sums of one iteration - x = (rotation vector, translation)
+    ///
+    struct Accumulator {
+        double normal[21];     // upper triangle of J^T W J (6x6), row by row
+        double rhs[6];         // J^T W residual
+        double squaredError;   // unweighted
+        uint32_t count;
+        char padding[64];      // accumulators of different threads never share cache line
+
+        void reset();
+    };
+
+    void accumulate(const PointCloudData& source, const glm::mat4& sourceToTarget, size_t first, size_t last,
+                    Accumulator& accumulator) const;
+
+    Settings mSettings;
+    Stats mStats;
+    std::unique_ptr<WorkStealingPool> mPool;
+    std::unique_ptr<TargetIndex> mIndex;
+    std::vector<Accumulator> mAccumulators; // [threadIdx]
+};
@@ -0,0 +1,457 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "KdTree.hpp"
+#include "Parallel.hpp"
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(SIMD_X86)
+#include <immintrin.h>
+#elif defined(SIMD_NEON)
+#include <arm_neon.h>
+#endif
+
+const uint32_t KdTree::NoPoint;
+const uint32_t KdTree::LeafSize;
+
+namespace {
+
+const uint32_t SimdPadding = 8;          // floats after the last point - leaf loads may read past its end
+const size_t QueryChunk = 256;           // queries taken by thread at once
+const size_t BuildChunk = 64 * 1024;     // points
+const uint32_t SubtreesPerThread = 4;    // below that level subtrees are built each by one thread
+const uint32_t MaxDepth = 32;
+
+struct BuildItem {
+    float p[3];
+    uint32_t idx;
+};
+
+struct BuildCell {
+    uint32_t begin;
+    uint32_t end;
+    glm::vec3 min;
+    glm::vec3 max;
+};
+
+//
+// Collectors - receive leaf points closer than `worst`, which only shrinks during search
+//
+
+struct KnnCollector {
+    uint32_t k;
+    uint32_t count;
+    uint32_t* indices;
+    float* distances;
+    float worst;
+
+    void add(float distance, uint32_t idx)
+    {
+        if (!(distance < worst)) {
+            return;
+        }
+        uint32_t slot = count < k ? count++ : k - 1;
+        while (slot > 0 && distances[slot - 1] > distance) {
+            distances[slot] = distances[slot - 1];
+            indices[slot] = indices[slot - 1];
+            --slot;
+        }
+        distances[slot] = distance;
+        indices[slot] = idx;
+        if (count == k) {
+            worst = distances[k - 1];
+        }
+    }
+};
+
+struct RadiusCollector {
+    std::vector<uint32_t>* indices;
+    float worst;
+
+    void add(float distance, uint32_t idx)
+    {
+        if (distance < worst) {
+            indices->push_back(idx);
+        }
+    }
+};
+
+//
+// Leaf scans
+//
+
+struct LeafPoints {
+    const float* x;
+    const float* y;
+    const float* z;
+};
+
+template <typename Collector>
+void scanLeafScalar(const LeafPoints& points, const glm::vec3& query, uint32_t begin, uint32_t end, Collector& collector)
+{
+    for (uint32_t i = begin; i < end; ++i) {
+        float dx = points.x[i] - query.x;
+        float dy = points.y[i] - query.y;
+        float dz = points.z[i] - query.z;
+        float distance = dx * dx + dy * dy + dz * dz;
+        if (distance < collector.worst) {
+            collector.add(distance, i);
+        }
+    }
+}
+
+#if defined(SIMD_AVX2)
+template <typename Collector>
+__attribute__((target("avx2")))
+void scanLeafAvx2(const LeafPoints& points, const glm::vec3& query, uint32_t begin, uint32_t end, Collector& collector)
+{
+    const __m256 qx = _mm256_set1_ps(query.x);
+    const __m256 qy = _mm256_set1_ps(query.y);
+    const __m256 qz = _mm256_set1_ps(query.z);
+    alignas(32) float distances[8];
+    for (uint32_t i = begin; i < end; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(points.x + i), qx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(points.y + i), qy);
+        __m256 dz = _mm256_sub_ps(_mm256_loadu_ps(points.z + i), qz);
+        __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_ps(_mm256_cmp_ps(distance, _mm256_set1_ps(collector.worst), _CMP_LT_OQ)));
+        if (end - i < 8) {
+            mask &= (1u << (end - i)) - 1; // lanes past the leaf
+        }
+        if (!mask) {
+            continue;
+        }
+        _mm256_store_ps(distances, distance);
+        for (; mask; mask &= mask - 1) {
+            uint32_t lane = static_cast<uint32_t>(__builtin_ctz(mask));
+            collector.add(distances[lane], i + lane);
+        }
+    }
+}
+#endif
+
+#if defined(SIMD_NEON)
+template <typename Collector>
+void scanLeafNeon(const LeafPoints& points, const glm::vec3& query, uint32_t begin, uint32_t end, Collector& collector)
+{
+    const float32x4_t qx = vdupq_n_f32(query.x);
+    const float32x4_t qy = vdupq_n_f32(query.y);
+    const float32x4_t qz = vdupq_n_f32(query.z);
+    float distances[4];
+    for (uint32_t i = begin; i < end; i += 4) {
+        float32x4_t dx = vsubq_f32(vld1q_f32(points.x + i), qx);
+        float32x4_t dy = vsubq_f32(vld1q_f32(points.y + i), qy);
+        float32x4_t dz = vsubq_f32(vld1q_f32(points.z + i), qz);
+        float32x4_t distance = vmlaq_f32(vmlaq_f32(vmulq_f32(dx, dx), dy, dy), dz, dz);
+        uint32x4_t closer = vcltq_f32(distance, vdupq_n_f32(collector.worst));
+        if (vgetq_lane_u64(vreinterpretq_u64_u32(closer), 0) == 0 && vgetq_lane_u64(vreinterpretq_u64_u32(closer), 1) == 0) {
+            continue;
+        }
+        vst1q_f32(distances, distance);
+        uint32_t lanes = std::min(4u, end - i);
+        for (uint32_t lane = 0; lane < lanes; ++lane) {
+            collector.add(distances[lane], i + lane);
+        }
+    }
+}
+#endif
+
+template <typename Collector>
+inline void scanLeaf(Simd::Path path, const LeafPoints& points, const glm::vec3& query, uint32_t begin, uint32_t end,
+                     Collector& collector)
+{
+    switch (path) {
+#if defined(SIMD_AVX2)
+    case Simd::Avx2: scanLeafAvx2(points, query, begin, end, collector); break;
+#endif
+#if defined(SIMD_NEON)
+    case Simd::Neon: scanLeafNeon(points, query, begin, end, collector); break;
+#endif
+    default: scanLeafScalar(points, query, begin, end, collector); break;
+    }
+}
+
+///
+/// Axis of the longest cell side
+///
+inline uint32_t splitAxis(const glm::vec3& min, const glm::vec3& max)
+{
+    glm::vec3 extent = max - min;
+    return extent.x >= extent.y ? (extent.x >= extent.z ? 0 : 2) : (extent.y >= extent.z ? 1 : 2);
+}
+
+}
+
+KdTree::KdTree()
+{
+    setSimdPath(Simd::Auto);
+}
+
+Simd::Path KdTree::setSimdPath(Simd::Path path)
+{
+    mPath = Simd::resolve(path);
+    return mPath;
+}
+
+void KdTree::clear()
+{
+    mNodes.clear();
+    mLeafBegins.clear();
+    mX.clear();
+    mY.clear();
+    mZ.clear();
+    mIndices.clear();
+    mStats = Stats();
+}
+
+bool KdTree::build(const glm::vec3* points, size_t count)
+{
+    clear();
+    if (!points || count == 0 || count >= NoPoint) {
+        qWarning("KD-tree of %zu points can't be built", count);
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    const uint32_t threads = Parallel::threadCount(mMaxThreads);
+    const uint32_t pointCount = static_cast<uint32_t>(count);
+    const size_t chunks = (count + BuildChunk - 1) / BuildChunk;
+
+    uint32_t depth = 0;
+    uint32_t leaves = 1;
+    while (depth < MaxDepth && uint64_t(leaves) * LeafSize < count) {
+        leaves *= 2;
+        ++depth;
+    }
+    mNodes.resize(leaves - 1);
+    mLeafBegins.resize(leaves + 1);
+    mLeafBegins[leaves] = pointCount;
+
+    // Items with bounds of all points
+    std::vector<BuildItem> items(count);
+    std::vector<glm::vec3> chunkMin(chunks, points[0]);
+    std::vector<glm::vec3> chunkMax(chunks, points[0]);
+    Parallel::forEach(threads, chunks, [&](size_t chunk) {
+        size_t end = std::min(count, (chunk + 1) * BuildChunk);
+        for (size_t i = chunk * BuildChunk; i < end; ++i) {
+            const glm::vec3& p = points[i];
+            items[i] = BuildItem{{p.x, p.y, p.z}, static_cast<uint32_t>(i)};
+            chunkMin[chunk] = glm::min(chunkMin[chunk], p);
+            chunkMax[chunk] = glm::max(chunkMax[chunk], p);
+        }
+    });
+    BuildCell root{0, pointCount, chunkMin[0], chunkMax[0]};
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        root.min = glm::min(root.min, chunkMin[chunk]);
+        root.max = glm::max(root.max, chunkMax[chunk]);
+    }
+
+    // Split of one node - median along the longest side, children cells are the two halves
+    auto splitNode = [&](uint32_t node, const BuildCell& cell, BuildCell& left, BuildCell& right) {
+        uint32_t axis = splitAxis(cell.min, cell.max);
+        uint32_t mid = cell.begin + (cell.end - cell.begin) / 2;
+        std::nth_element(items.begin() + cell.begin, items.begin() + mid, items.begin() + cell.end,
+                         [axis](const BuildItem& a, const BuildItem& b) { return a.p[axis] < b.p[axis]; });
+        float split = items[mid].p[axis];
+        mNodes[node] = Node{split, axis};
+        left = BuildCell{cell.begin, mid, cell.min, cell.max};
+        right = BuildCell{mid, cell.end, cell.min, cell.max};
+        left.max[axis] = split;
+        right.min[axis] = split;
+    };
+    const uint32_t firstLeaf = leaves - 1;
+    std::function<void(uint32_t, const BuildCell&)> buildSubtree = [&](uint32_t node, const BuildCell& cell) {
+        if (node >= firstLeaf) {
+            mLeafBegins[node - firstLeaf] = cell.begin;
+            return;
+        }
+        BuildCell left;
+        BuildCell right;
+        splitNode(node, cell, left, right);
+        buildSubtree(2 * node + 1, left);
+        buildSubtree(2 * node + 2, right);
+    };
+
+    // Top levels one by one with nodes of the level in parallel, then whole subtrees in parallel
+    std::vector<BuildCell> level(1, root);
+    uint32_t levelFirst = 0; // node index of level[0]
+    while (levelFirst < firstLeaf && level.size() < SubtreesPerThread * threads) {
+        std::vector<BuildCell> next(level.size() * 2);
+        Parallel::forEach(threads, level.size(), [&](size_t i) {
+            splitNode(levelFirst + static_cast<uint32_t>(i), level[i], next[2 * i], next[2 * i + 1]);
+        });
+        level.swap(next);
+        levelFirst = 2 * levelFirst + 1;
+    }
+    Parallel::forEach(threads, level.size(), [&](size_t i) {
+        buildSubtree(levelFirst + static_cast<uint32_t>(i), level[i]);
+    });
+
+    // Points in tree order
+    mX.resize(count + SimdPadding, 0.f);
+    mY.resize(count + SimdPadding, 0.f);
+    mZ.resize(count + SimdPadding, 0.f);
+    mIndices.resize(count);
+    Parallel::forEach(threads, chunks, [&](size_t chunk) {
+        size_t end = std::min(count, (chunk + 1) * BuildChunk);
+        for (size_t i = chunk * BuildChunk; i < end; ++i) {
+            mX[i] = items[i].p[0];
+            mY[i] = items[i].p[1];
+            mZ[i] = items[i].p[2];
+            mIndices[i] = items[i].idx;
+        }
+    });
+
+    mStats.points = pointCount;
+    mStats.leaves = leaves;
+    mStats.depth = depth;
+    mStats.threads = threads;
+    mStats.buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+template <typename Collector>
+void KdTree::search(const glm::vec3& query, Collector& collector) const
+{
+    if (mIndices.empty()) {
+        return;
+    }
+    struct Pending {
+        uint32_t node;
+        float bound;     // squared distance from query to the node's cell
+        float offset[3]; // per axis distance from query to the node's cell - bound is their sum of squares
+    };
+    Pending stack[MaxDepth + 1];
+    uint32_t top = 0;
+    stack[top++] = Pending{0, 0.f, {0.f, 0.f, 0.f}};
+    const float q[3] = {query.x, query.y, query.z};
+    const uint32_t firstLeaf = static_cast<uint32_t>(mNodes.size());
+    const LeafPoints points{mX.data(), mY.data(), mZ.data()};
+    while (top > 0) {
+        Pending pending = stack[--top];
+        if (!(pending.bound < collector.worst)) {
+            continue;
+        }
+        uint32_t node = pending.node;
+        while (node < firstLeaf) {
+            const Node& split = mNodes[node];
+            float diff = q[split.axis] - split.split;
+            uint32_t nearChild = 2 * node + (diff < 0.f ? 1 : 2);
+            // far cell is farther only along split axis - replace offset of this axis
+            float oldOffset = pending.offset[split.axis];
+            float farBound = pending.bound - oldOffset * oldOffset + diff * diff;
+            if (farBound < collector.worst) {
+                Pending& far = stack[top++];
+                far = pending;
+                far.node = 4 * node + 3 - nearChild; // sibling of nearChild
+                far.bound = farBound;
+                far.offset[split.axis] = std::fabs(diff);
+            }
+            node = nearChild;
+        }
+        uint32_t leaf = node - firstLeaf;
+        scanLeaf(mPath, points, query, mLeafBegins[leaf], mLeafBegins[leaf + 1], collector);
+    }
+}
+
+uint32_t KdTree::nearest(const glm::vec3& query, float maxDistance, float& distanceSquared) const
+{
+    uint32_t idx = NoPoint;
+    distanceSquared = std::numeric_limits<float>::infinity();
+    knn(query, 1, &idx, &distanceSquared, maxDistance);
+    return idx;
+}
+
+uint32_t KdTree::knn(const glm::vec3& query, uint32_t k, uint32_t* indices, float* distancesSquared, float maxDistance) const
+{
+    if (k == 0) {
+        return 0;
+    }
+    KnnCollector collector{k, 0, indices, distancesSquared, maxDistance * maxDistance};
+    search(query, collector);
+    return collector.count;
+}
+
+void KdTree::radius(const glm::vec3& query, float radius, std::vector<uint32_t>& indices) const
+{
+    indices.clear();
+    RadiusCollector collector{&indices, radius * radius};
+    search(query, collector);
+}
+
+uint32_t KdTree::queryThreads(size_t chunks) const
+{
+    return static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(Parallel::threadCount(mMaxThreads), chunks)));
+}
+
+void KdTree::knnBatch(const glm::vec3* queries, size_t count, uint32_t k, uint32_t* indices, float* distancesSquared,
+                      float maxDistance) const
+{
+    if (k == 0 || count == 0) {
+        return;
+    }
+    size_t chunks = (count + QueryChunk - 1) / QueryChunk;
+    Parallel::forEach(queryThreads(chunks), chunks, [&](size_t chunk) {
+        size_t end = std::min(count, (chunk + 1) * QueryChunk);
+        for (size_t i = chunk * QueryChunk; i < end; ++i) {
+            uint32_t* queryIndices = indices + i * k;
+            float* queryDistances = distancesSquared + i * k;
+            uint32_t found = knn(queries[i], k, queryIndices, queryDistances, maxDistance);
+            std::fill(queryIndices + found, queryIndices + k, NoPoint);
+            std::fill(queryDistances + found, queryDistances + k, std::numeric_limits<float>::infinity());
+        }
+    });
+}
+
+void KdTree::radiusBatch(const glm::vec3* queries, size_t count, float radius,
+                         std::vector<uint32_t>& offsets, std::vector<uint32_t>& indices) const
+{
+    offsets.assign(count + 1, 0);
+    indices.clear();
+    if (count == 0) {
+        return;
+    }
+    // Every chunk collects its neighbours, then they are placed one after another
+    size_t chunks = (count + QueryChunk - 1) / QueryChunk;
+    std::vector<std::vector<uint32_t>> chunkIndices(chunks);
+    Parallel::forEach(queryThreads(chunks), chunks, [&](size_t chunk) {
+        std::vector<uint32_t>& found = chunkIndices[chunk];
+        RadiusCollector collector{&found, radius * radius};
+        size_t end = std::min(count, (chunk + 1) * QueryChunk);
+        for (size_t i = chunk * QueryChunk; i < end; ++i) {
+            size_t before = found.size();
+            search(queries[i], collector);
+            offsets[i + 1] = static_cast<uint32_t>(found.size() - before);
+        }
+    });
+    for (size_t i = 0; i < count; ++i) {
+        offsets[i + 1] += offsets[i];
+    }
+    indices.resize(offsets[count]);
+    Parallel::forEach(queryThreads(chunks), chunks, [&](size_t chunk) {
+        std::copy(chunkIndices[chunk].begin(), chunkIndices[chunk].end(), indices.begin() + offsets[chunk * QueryChunk]);
+    });
+}
@@ -0,0 +1,144 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include "SimdPath.hpp"
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+///
+/// Static KD-tree of 3D points for nearest neighbour (kNN) and radius queries.
+/// Tree is complete and balanced - every split is the median of its points along the longest side of the node's
+/// cell, so nodes live in one flat array in breadth first (implicit heap) order: children of node i are 2i+1, 2i+2,
+/// no pointers, top levels visited by every query share few cache lines. Leaves hold at most LeafSize points.
+/// Points are reordered so that every leaf is a contiguous range and stored as separate x, y, z arrays - distances
+/// of leaf points are computed 8 (AVX2) or 4 (NEON) at once.
+///
+/// Indices returned by queries are in tree order - originalIndex() maps them back to the order given to build(),
+/// data attached to points (normals, colors) can be reordered once with originalIndices().
+/// Build and batched queries run in parallel; queries are const and may be called from many threads.
+///
+class KdTree
+{
+public:
+    static const uint32_t NoPoint = ~0u;
+    static const uint32_t LeafSize = 16;
+
+    struct Stats {
+        uint32_t points = 0;
+        uint32_t leaves = 0;
+        uint32_t depth = 0;     // levels of internal nodes
+        uint32_t threads = 0;
+        double buildMs = 0.0;
+    };
+
+    KdTree();
+
+    ///
+    /// Replaces content of the tree - returns false for empty input or more than 2^32 - 2 points
+    ///
+    bool build(const glm::vec3* points, size_t count);
+    bool build(const std::vector<glm::vec3>& points) { return build(points.data(), points.size()); }
+    void clear();
+
+    size_t size() const { return mIndices.size(); }
+    bool empty() const { return mIndices.empty(); }
+    glm::vec3 point(uint32_t idx) const { return glm::vec3(mX[idx], mY[idx], mZ[idx]); }
+    uint32_t originalIndex(uint32_t idx) const { return mIndices[idx]; }
+    const std::vector<uint32_t>& originalIndices() const { return mIndices; }
+
+    ///
+    /// Not supported path falls back to the best available one. Returns path which will be used.
+    ///
+    Simd::Path setSimdPath(Simd::Path path);
+    Simd::Path simdPath() const { return mPath; }
+
+    ///
+    /// Threads of build and batched queries, 0 - hardware concurrency
+    ///
+    void setMaxThreads(uint32_t maxThreads) { mMaxThreads = maxThreads; }
+
+    //
+    // Single queries - only points closer than maxDistance (radius) are returned
+    //
+
+    ///
+    /// NoPoint - nothing closer than maxDistance
+    ///
+    uint32_t nearest(const glm::vec3& query, float maxDistance, float& distanceSquared) const;
+
+    ///
+    /// Up to k nearest points sorted by distance - returns their count
+    ///
+    uint32_t knn(const glm::vec3& query, uint32_t k, uint32_t* indices, float* distancesSquared,
+                 float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    ///
+    /// All points closer than radius in no particular order, indices are replaced
+    ///
+    void radius(const glm::vec3& query, float radius, std::vector<uint32_t>& indices) const;
+
+    //
+    // Batched queries - queries are split between threads
+    //
+
+    ///
+    /// indices and distancesSquared have count * k items, k neighbours of each query - missing ones are
+    /// NoPoint with infinite distance
+    ///
+    void knnBatch(const glm::vec3* queries, size_t count, uint32_t k, uint32_t* indices, float* distancesSquared,
+                  float maxDistance = std::numeric_limits<float>::infinity()) const;
+
+    ///
+    /// Neighbours of query i are indices[offsets[i] .. offsets[i + 1]), offsets has count + 1 items
+    ///
+    void radiusBatch(const glm::vec3* queries, size_t count, float radius,
+                     std::vector<uint32_t>& offsets, std::vector<uint32_t>& indices) const;
+
+    const Stats& stats() const { return mStats; }
+
+protected:
+    struct Node {
+        float split;
+        uint32_t axis;
+    };
+
+    template <typename Collector>
+    void search(const glm::vec3& query, Collector& collector) const;
+
+    uint32_t queryThreads(size_t chunks) const;
+
+    std::vector<Node> mNodes;          // internal nodes in breadth first order
+    std::vector<uint32_t> mLeafBegins; // [leaf] first point, last item - point count
+    std::vector<float> mX;             // tree order, padded for SIMD loads
+    std::vector<float> mY;
+    std::vector<float> mZ;
+    std::vector<uint32_t> mIndices;    // tree order -> build order
+    Simd::Path mPath = Simd::Auto;
+    uint32_t mMaxThreads = 0;
+    Stats mStats;
+};
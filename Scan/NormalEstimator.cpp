@@ -0,0 +1,376 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "NormalEstimator.hpp"
+#include "Parallel.hpp"
+#include <WorkStealingPool.hpp>
+#include <QtGlobal>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+
+namespace {
+
+const size_t PcaGrain = 1024;       // points
+const size_t ScatterGrain = 16384;  // points
+
+///
+/// Eigenvector of the smallest eigenvalue of symmetric 3x3 matrix - false when it is not unique
+/// (zero or isotropic matrix, points on a line)
+///
+bool smallestEigenvector(float a00, float a01, float a02, float a11, float a12, float a22, glm::vec3& eigenvector)
+{
+    float scale = std::max(std::max(std::max(std::fabs(a00), std::fabs(a01)), std::max(std::fabs(a02), std::fabs(a11))),
+                           std::max(std::fabs(a12), std::fabs(a22)));
+    if (!(scale > 0.f)) {
+        return false;
+    }
+    a00 /= scale; a01 /= scale; a02 /= scale;
+    a11 /= scale; a12 /= scale; a22 /= scale;
+
+    // eigenvalues q + 2p cos(phi + 2pi i / 3) of A = q I + p B, det(B) = 2 cos(3 phi)
+    float offDiagonal = a01 * a01 + a02 * a02 + a12 * a12;
+    float q = (a00 + a11 + a22) / 3.f;
+    float b00 = a00 - q;
+    float b11 = a11 - q;
+    float b22 = a22 - q;
+    float p = std::sqrt((b00 * b00 + b11 * b11 + b22 * b22 + 2.f * offDiagonal) / 6.f);
+    if (!(p > 1e-6f)) {
+        return false;
+    }
+    float det = b00 * (b11 * b22 - a12 * a12) - a01 * (a01 * b22 - a12 * a02) + a02 * (a01 * a12 - b11 * a02);
+    float r = std::max(-1.f, std::min(1.f, det / (2.f * p * p * p)));
+    float phi = std::acos(r) / 3.f;
+    float smallest = q + 2.f * p * std::cos(phi + 2.0943951f);
+
+    // eigenvector is perpendicular to rows of A - smallest * I - the longest cross product of two rows
+    glm::vec3 row0(a00 - smallest, a01, a02);
+    glm::vec3 row1(a01, a11 - smallest, a12);
+    glm::vec3 row2(a02, a12, a22 - smallest);
+    glm::vec3 candidates[3] = {glm::cross(row0, row1), glm::cross(row0, row2), glm::cross(row1, row2)};
+    float best = 0.f;
+    for (const glm::vec3& candidate : candidates) {
+        float length = glm::dot(candidate, candidate);
+        if (length > best) {
+            best = length;
+            eigenvector = candidate;
+        }
+    }
+    if (!(best > 1e-10f)) {
+        return false;
+    }
+    eigenvector = eigenvector / std::sqrt(best);
+    return true;
+}
+
+///
+/// Normal of neighbourhood given by tree indices
+///
+bool pcaNormal(const KdTree& tree, const uint32_t* indices, uint32_t count, glm::vec3& normal)
+{
+    glm::vec3 mean(0.f);
+    for (uint32_t i = 0; i < count; ++i) {
+        mean += tree.point(indices[i]);
+    }
+    mean = mean / static_cast<float>(count);
+    float xx = 0.f, xy = 0.f, xz = 0.f, yy = 0.f, yz = 0.f, zz = 0.f;
+    for (uint32_t i = 0; i < count; ++i) {
+        glm::vec3 d = tree.point(indices[i]) - mean;
+        xx += d.x * d.x;
+        xy += d.x * d.y;
+        xz += d.x * d.z;
+        yy += d.y * d.y;
+        yz += d.y * d.z;
+        zz += d.z * d.z;
+    }
+    return smallestEigenvector(xx, xy, xz, yy, yz, zz, normal);
+}
+
+inline uint32_t packSnorm16(float value)
+{
+    float clamped = std::max(-1.f, std::min(1.f, value));
+    return static_cast<uint16_t>(static_cast<int16_t>(std::round(clamped * 32767.f)));
+}
+
+inline float unpackSnorm16(uint32_t bits)
+{
+    return std::max(-1.f, static_cast<int16_t>(static_cast<uint16_t>(bits)) / 32767.f);
+}
+
+inline float signNotZero(float value)
+{
+    return value >= 0.f ? 1.f : -1.f;
+}
+
+}
+
+NormalEstimator::NormalEstimator()
+{
+    setSettings(Settings());
+}
+
+NormalEstimator::~NormalEstimator()
+{
+}
+
+void NormalEstimator::setSettings(const Settings& settings)
+{
+    uint32_t threads = Parallel::threadCount(settings.threads);
+    if (!mPool || mPool->threadCount() != threads) {
+        mPool.reset(new WorkStealingPool(threads));
+    }
+    mSettings = settings;
+    mSettings.neighbours = std::max(mSettings.neighbours, 3u);
+    mSettings.maxDistance = std::max(mSettings.maxDistance, 0.f);
+    mTree.setMaxThreads(threads);
+}
+
+uint32_t NormalEstimator::packOctahedral(const glm::vec3& normal)
+{
+    float sum = std::fabs(normal.x) + std::fabs(normal.y) + std::fabs(normal.z);
+    if (!(sum > 0.f)) {
+        return 0; // +z
+    }
+    float x = normal.x / sum;
+    float y = normal.y / sum;
+    if (normal.z < 0.f) { // lower half is folded over the diagonals
+        float foldedX = (1.f - std::fabs(y)) * signNotZero(x);
+        y = (1.f - std::fabs(x)) * signNotZero(y);
+        x = foldedX;
+    }
+    return packSnorm16(x) | (packSnorm16(y) << 16);
+}
+
+glm::vec3 NormalEstimator::unpackOctahedral(uint32_t packed)
+{
+    float x = unpackSnorm16(packed);
+    float y = unpackSnorm16(packed >> 16);
+    glm::vec3 normal(x, y, 1.f - std::fabs(x) - std::fabs(y));
+    if (normal.z < 0.f) {
+        normal.x = (1.f - std::fabs(y)) * signNotZero(x);
+        normal.y = (1.f - std::fabs(x)) * signNotZero(y);
+    }
+    return glm::normalize(normal);
+}
+
+bool NormalEstimator::estimate(PointCloudData& cloud)
+{
+    if (!estimateTreeOrder(cloud.positions)) {
+        cloud.normals.clear();
+        return false;
+    }
+    const std::vector<uint32_t>& order = mTree.originalIndices();
+    cloud.normals.resize(order.size());
+    mPool->parallelFor(order.size(), ScatterGrain, [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+        for (size_t i = first; i < last; ++i) {
+            cloud.normals[order[i]] = mNormals[i];
+        }
+    });
+    return true;
+}
+
+bool NormalEstimator::estimate(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& packedNormals)
+{
+    if (!estimateTreeOrder(positions)) {
+        packedNormals.clear();
+        return false;
+    }
+    const std::vector<uint32_t>& order = mTree.originalIndices();
+    packedNormals.resize(order.size());
+    mPool->parallelFor(order.size(), ScatterGrain, [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+        for (size_t i = first; i < last; ++i) {
+            packedNormals[order[i]] = packOctahedral(mNormals[i]);
+        }
+    });
+    return true;
+}
+
+bool NormalEstimator::estimateTreeOrder(const std::vector<glm::vec3>& positions)
+{
+    auto start = std::chrono::steady_clock::now();
+    mStats = Stats();
+    mStats.threads = mPool->threadCount();
+    if (!mTree.build(positions)) {
+        qWarning("Normals of %zu points can't be estimated", positions.size());
+        return false;
+    }
+    auto indexed = std::chrono::steady_clock::now();
+
+    const size_t count = mTree.size();
+    const uint32_t k = mSettings.neighbours;
+    const float maxDistance = mSettings.maxDistance > 0.f ? mSettings.maxDistance : std::numeric_limits<float>::infinity();
+    const bool propagate = mSettings.orientation == OrientPropagate;
+    mStats.points = count;
+    mNormals.resize(count);
+    if (propagate) {
+        mNeighbours.resize(count * k);
+    }
+    else {
+        std::vector<uint32_t>().swap(mNeighbours);
+        std::vector<uint32_t>().swap(mEdgeOffsets);
+        std::vector<uint32_t>().swap(mEdges);
+    }
+
+    // Neighbourhood and its normal of every point - tree order keeps queries of a thread close to each other
+    std::vector<std::vector<uint32_t>> threadIndices(mStats.threads, std::vector<uint32_t>(k));
+    std::vector<std::vector<float>> threadDistances(mStats.threads, std::vector<float>(k));
+    std::atomic<uint64_t> fallbacks(0);
+    mPool->parallelFor(count, PcaGrain, [&](size_t first, size_t last, uint32_t threadIdx) {
+        uint32_t* indices = threadIndices[threadIdx].data();
+        float* distances = threadDistances[threadIdx].data();
+        uint64_t rangeFallbacks = 0;
+        for (size_t i = first; i < last; ++i) {
+            glm::vec3 point = mTree.point(static_cast<uint32_t>(i));
+            uint32_t found = mTree.knn(point, k, indices, distances, maxDistance);
+            glm::vec3 toSensor = mSettings.sensorPosition - point;
+            glm::vec3 normal;
+            if (found < 3 || !pcaNormal(mTree, indices, found, normal)) {
+                float length = glm::length(toSensor);
+                normal = length > 0.f ? toSensor / length : glm::vec3(0.f, 0.f, 1.f);
+                ++rangeFallbacks;
+            }
+            else if (mSettings.orientation != OrientNone && glm::dot(normal, toSensor) < 0.f) {
+                normal = -normal;
+            }
+            mNormals[i] = normal;
+            if (propagate) {
+                std::copy(indices, indices + found, mNeighbours.begin() + i * k);
+                std::fill(mNeighbours.begin() + i * k + found, mNeighbours.begin() + (i + 1) * k, KdTree::NoPoint);
+            }
+        }
+        fallbacks += rangeFallbacks;
+    });
+    mStats.fallbacks = fallbacks;
+    auto estimated = std::chrono::steady_clock::now();
+
+    if (propagate) {
+        orientPropagate();
+    }
+    auto end = std::chrono::steady_clock::now();
+    mStats.indexMs = std::chrono::duration<double, std::milli>(indexed - start).count();
+    mStats.pcaMs = std::chrono::duration<double, std::milli>(estimated - indexed).count();
+    mStats.orientMs = std::chrono::duration<double, std::milli>(end - estimated).count();
+    mStats.totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+    return true;
+}
+
+void NormalEstimator::orientPropagate()
+{
+    // Prim's algorithm over kNN edges, cost of edge grows with angle between normals. Point is queued again
+    // only when its cost drops, so queue stays small.
+    struct Edge {
+        float cost;
+        uint32_t point;
+        uint32_t parent;
+        bool operator>(const Edge& other) const { return cost > other.cost; }
+    };
+    const size_t count = mNormals.size();
+    const uint32_t k = mSettings.neighbours;
+    std::vector<uint8_t> visited(count, 0);
+    std::vector<float> bestCost(count, std::numeric_limits<float>::infinity());
+    std::vector<uint32_t> members; // of current tree
+    std::priority_queue<Edge, std::vector<Edge>, std::greater<Edge>> queue;
+
+    // kNN relation is not symmetric (point in sparse area is neighbour of points which are not its neighbours),
+    // every edge is used in both directions - graph of undirected edges in CSR, mutual neighbours twice
+    mEdgeOffsets.assign(count + 1, 0);
+    for (size_t point = 0; point < count; ++point) {
+        const uint32_t* neighbours = &mNeighbours[point * k];
+        for (uint32_t n = 0; n < k && neighbours[n] != KdTree::NoPoint; ++n) {
+            ++mEdgeOffsets[point + 1];
+            ++mEdgeOffsets[size_t(neighbours[n]) + 1];
+        }
+    }
+    for (size_t point = 0; point < count; ++point) {
+        mEdgeOffsets[point + 1] += mEdgeOffsets[point];
+    }
+    mEdges.resize(mEdgeOffsets[count]);
+    std::vector<uint32_t> filled(mEdgeOffsets.begin(), mEdgeOffsets.end() - 1);
+    for (size_t point = 0; point < count; ++point) {
+        const uint32_t* neighbours = &mNeighbours[point * k];
+        for (uint32_t n = 0; n < k && neighbours[n] != KdTree::NoPoint; ++n) {
+            mEdges[filled[point]++] = neighbours[n];
+            mEdges[filled[neighbours[n]]++] = static_cast<uint32_t>(point);
+        }
+    }
+
+    auto pushNeighbours = [&](uint32_t point) {
+        for (uint32_t e = mEdgeOffsets[point]; e < mEdgeOffsets[size_t(point) + 1]; ++e) {
+            uint32_t neighbour = mEdges[e];
+            if (visited[neighbour]) {
+                continue;
+            }
+            float cost = 1.f - std::fabs(glm::dot(mNormals[point], mNormals[neighbour]));
+            if (cost < bestCost[neighbour]) {
+                bestCost[neighbour] = cost;
+                queue.push(Edge{cost, neighbour, point});
+            }
+        }
+    };
+
+    for (uint32_t seed = 0; seed < count; ++seed) {
+        if (visited[seed]) {
+            continue;
+        }
+        ++mStats.trees;
+        members.clear();
+        visited[seed] = 1;
+        members.push_back(seed);
+        pushNeighbours(seed);
+        while (!queue.empty()) {
+            Edge edge = queue.top();
+            queue.pop();
+            if (visited[edge.point]) {
+                continue;
+            }
+            visited[edge.point] = 1;
+            members.push_back(edge.point);
+            if (glm::dot(mNormals[edge.point], mNormals[edge.parent]) < 0.f) {
+                mNormals[edge.point] = -mNormals[edge.point];
+            }
+            pushNeighbours(edge.point);
+        }
+
+        // point nearest to the sensor is seen by it for sure - whole tree is flipped to make it face the sensor
+        uint32_t nearest = seed;
+        float nearestDistance = std::numeric_limits<float>::infinity();
+        for (uint32_t point : members) {
+            glm::vec3 toSensor = mSettings.sensorPosition - mTree.point(point);
+            float distance = glm::dot(toSensor, toSensor);
+            if (distance < nearestDistance) {
+                nearestDistance = distance;
+                nearest = point;
+            }
+        }
+        if (glm::dot(mNormals[nearest], mSettings.sensorPosition - mTree.point(nearest)) < 0.f) {
+            for (uint32_t point : members) {
+                mNormals[point] = -mNormals[point];
+            }
+        }
+    }
+}
@@ -0,0 +1,123 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+#pragma once
+
+#include "KdTree.hpp"
+#include "PointCloudData.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class WorkStealingPool;
+
+///
+/// Normals of scanned points by principal component analysis of their k nearest neighbours - normal is
+/// the eigenvector of the smallest eigenvalue of neighbourhood covariance, found in closed form (trigonometric
+/// solution of 3x3 symmetric eigenproblem, no iterations). Points are processed in parallel in KdTree order,
+/// so neighbouring queries hit the same nodes.
+/// Sign of PCA normal is arbitrary, it is fixed by Orientation:
+///     OrientToSensor - every normal faces sensorPosition (single scan position)
+///     OrientPropagate - orientation is propagated along minimum spanning tree of symmetric kNN graph (edge cost
+///                       1 - |dot(ni, nj)|, i.e. over flat areas first), tree is flipped as a whole when its point
+///                       nearest to sensorPosition faces away from it.
+///                       Consistent also for merged scans and surfaces seen from both sides, but serial.
+/// Points without usable neighbourhood (fewer than 3 neighbours, all on one line) get normal facing the sensor.
+///
+/// Normals are returned as vec3 (PointCloudData::normals) or packed for vertex buffer - octahedral encoding in two
+/// snorm16 (x - low half), 4 bytes per point with error below 0.01 degree. Attribute format VK_FORMAT_R16G16_SNORM
+/// (vec2) or uint decoded in shader:
+///     vec2 e = unpackSnorm2x16(packed);
+///     vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+///     if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+///     n = normalize(n);
+///
+class NormalEstimator
+{
+public:
+    enum Orientation {
+        OrientNone,
+        OrientToSensor,
+        OrientPropagate,
+    };
+
+    struct Settings {
+        uint32_t neighbours = 16;                   // k including the point itself, at least 3
+        float maxDistance = 0.f;                    // meters - farther points are not neighbours, 0 - unlimited
+        Orientation orientation = OrientToSensor;
+        glm::vec3 sensorPosition = glm::vec3(0.f);
+        uint32_t threads = 0;                       // 0 - hardware concurrency
+    };
+
+    struct Stats {
+        uint64_t points = 0;
+        uint64_t fallbacks = 0;    // points without usable neighbourhood
+        uint32_t trees = 0;        // spanning trees of OrientPropagate
+        uint32_t threads = 0;
+        double indexMs = 0.0;      // KD-tree build
+        double pcaMs = 0.0;        // neighbours, covariance and eigenvectors
+        double orientMs = 0.0;
+        double totalMs = 0.0;
+    };
+
+    NormalEstimator();
+    ~NormalEstimator();
+
+    void setSettings(const Settings& settings);
+    const Settings& settings() const { return mSettings; }
+
+    ///
+    /// Replaces cloud.normals with unit normals of cloud.positions
+    ///
+    bool estimate(PointCloudData& cloud);
+
+    ///
+    /// Octahedral packed normals of positions, ready for upload
+    ///
+    bool estimate(const std::vector<glm::vec3>& positions, std::vector<uint32_t>& packedNormals);
+
+    static uint32_t packOctahedral(const glm::vec3& normal);
+    static glm::vec3 unpackOctahedral(uint32_t packed);
+
+    const Stats& stats() const { return mStats; }
+
+    NormalEstimator(const NormalEstimator&) = delete;
+    NormalEstimator& operator=(const NormalEstimator&) = delete;
+
+protected:
+    ///
+    /// Normals in tree order into mNormals
+    ///
+    bool estimateTreeOrder(const std::vector<glm::vec3>& positions);
+    void orientPropagate();
+
+    Settings mSettings;
+    Stats mStats;
+    std::unique_ptr<WorkStealingPool> mPool;
+    KdTree mTree;
+    std::vector<glm::vec3> mNormals;     // tree order
+    std::vector<uint32_t> mNeighbours;   // [point * k + n] tree order, only for propagation
+    std::vector<uint32_t> mEdgeOffsets;  // symmetric kNN graph of propagation - edges of point are
+    std::vector<uint32_t> mEdges;        // mEdges[mEdgeOffsets[point]..mEdgeOffsets[point + 1])
+};
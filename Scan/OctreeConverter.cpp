@@ -0,0 +1,331 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "OctreeConverter.hpp"
+#include "OctreeFormat.hpp"
+#include "Parallel.hpp"
+#include "PointCloudLoader.hpp"
+#include <QFile>
+#include <QtGlobal>
+#include <glm/gtc/packing.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const uint32_t MortonBits = 21; // per axis - 63 bit code
+const uint32_t MaxDepth = MortonBits - 1;
+
+// 21 bits spread to every third bit
+uint64_t spreadBits(uint32_t value)
+{
+    uint64_t x = value & 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffull;
+    x = (x | x << 16) & 0x1f0000ff0000ffull;
+    x = (x | x << 8) & 0x100f00f00f00f00full;
+    x = (x | x << 4) & 0x10c30c30c30c30c3ull;
+    x = (x | x << 2) & 0x1249249249249249ull;
+    return x;
+}
+
+struct SortedPoint {
+    uint64_t code;  // Morton code in root cube - x in bits 0, 3, 6...
+    uint32_t index; // in PointCloudData
+};
+
+bool operator<(const SortedPoint& a, const SortedPoint& b)
+{
+    return a.code < b.code || (a.code == b.code && a.index < b.index);
+}
+
+// Ranges are sorted in parallel, then neighbour ranges are merged
+void parallelSort(std::vector<SortedPoint>& points, uint32_t threads)
+{
+    const uint32_t ranges = static_cast<uint32_t>(std::min<size_t>(threads, std::max<size_t>(1, points.size() / 65536)));
+    std::vector<size_t> bounds(ranges + 1);
+    for (uint32_t r = 0; r <= ranges; ++r) {
+        bounds[r] = points.size() * r / ranges;
+    }
+    Parallel::run(ranges, [&](uint32_t r) {
+        std::sort(points.begin() + bounds[r], points.begin() + bounds[r + 1]);
+    });
+    for (uint32_t width = 1; width < ranges; width *= 2) {
+        std::vector<uint32_t> merges;
+        for (uint32_t r = 0; r + width < ranges; r += 2 * width) {
+            merges.push_back(r);
+        }
+        Parallel::forEach(threads, merges.size(), [&](size_t m) {
+            uint32_t r = merges[m];
+            std::inplace_merge(points.begin() + bounds[r], points.begin() + bounds[r + width],
+                               points.begin() + bounds[std::min(r + 2 * width, ranges)]);
+        });
+    }
+}
+
+struct BuildNode {
+    glm::vec3 origin;
+    float size = 0.f;
+    uint32_t depth = 0;
+    std::vector<uint32_t> candidates; // indices to sorted points not taken by parents, sorted
+    std::vector<uint32_t> points;     // kept by this node
+    std::vector<uint32_t> remaining;  // go to children - octant ranges are childBegin[octant]..childBegin[octant + 1]
+    size_t childBegin[9] = {};
+    uint32_t firstChild = OctreeFormat::InvalidNode;
+    uint8_t childMask = 0;
+};
+
+// One point (middle of the run) of every sample cell stays, the rest is split between octants
+void processNode(BuildNode& node, const std::vector<SortedPoint>& sorted, const OctreeConverter::Settings& settings)
+{
+    std::vector<uint32_t>& candidates = node.candidates;
+    if (candidates.size() <= settings.maxPointsPerNode || node.depth >= std::min(settings.maxDepth, MaxDepth)) {
+        node.points.swap(candidates);
+        return;
+    }
+
+    const uint32_t cellShift = 3 * (MortonBits - std::min(node.depth + settings.sampleGridBits, MortonBits));
+    node.remaining.reserve(candidates.size());
+    for (size_t runBegin = 0; runBegin < candidates.size();) {
+        const uint64_t cell = sorted[candidates[runBegin]].code >> cellShift;
+        size_t runEnd = runBegin + 1;
+        while (runEnd < candidates.size() && (sorted[candidates[runEnd]].code >> cellShift) == cell) {
+            ++runEnd;
+        }
+        const size_t keep = runBegin + (runEnd - runBegin) / 2;
+        for (size_t i = runBegin; i < runEnd; ++i) {
+            (i == keep ? node.points : node.remaining).push_back(candidates[i]);
+        }
+        runBegin = runEnd;
+    }
+    std::vector<uint32_t>().swap(candidates);
+
+    const uint32_t octantShift = 3 * (MortonBits - 1 - node.depth);
+    size_t counts[8] = {};
+    for (uint32_t candidate : node.remaining) {
+        ++counts[(sorted[candidate].code >> octantShift) & 7];
+    }
+    for (uint32_t octant = 0; octant < 8; ++octant) {
+        node.childBegin[octant + 1] = node.childBegin[octant] + counts[octant];
+    }
+}
+
+}
+
+bool OctreeConverter::convert(const std::string& inputPath, const std::string& outputPath)
+{
+    PointCloudData data;
+    PointCloudLoader loader;
+    loader.setThreadCount(mSettings.threads);
+    return loader.load(inputPath, data) && convert(data, outputPath);
+}
+
+bool OctreeConverter::convert(const PointCloudData& data, const std::string& outputPath)
+{
+    using namespace OctreeFormat;
+
+    auto start = std::chrono::steady_clock::now();
+    mStats = Stats();
+    if (Q_BYTE_ORDER != Q_LITTLE_ENDIAN) {
+        qWarning("Octree files are written only on little endian machines");
+        return false;
+    }
+    if (data.size() == 0 || data.size() >= InvalidNode) {
+        qWarning("Octree needs 1 .. 2^32-1 points, got %llu", static_cast<unsigned long long>(data.size()));
+        return false;
+    }
+    const uint32_t threads = Parallel::threadCount(mSettings.threads);
+    const uint32_t pointCount = static_cast<uint32_t>(data.size());
+    const uint32_t attributes = (data.hasColors() ? uint32_t(AttributeColors) : 0u) | (data.hasNormals() ? uint32_t(AttributeNormals) : 0u);
+
+    //
+    // Root cube and Morton order
+    //
+    std::vector<glm::vec3> threadMin(threads, data.positions[0]);
+    std::vector<glm::vec3> threadMax(threads, data.positions[0]);
+    Parallel::run(threads, [&](uint32_t t) {
+        for (size_t i = pointCount * size_t(t) / threads; i < pointCount * size_t(t + 1) / threads; ++i) {
+            threadMin[t] = glm::min(threadMin[t], data.positions[i]);
+            threadMax[t] = glm::max(threadMax[t], data.positions[i]);
+        }
+    });
+    glm::vec3 boundsMin = threadMin[0];
+    glm::vec3 boundsMax = threadMax[0];
+    for (uint32_t t = 1; t < threads; ++t) {
+        boundsMin = glm::min(boundsMin, threadMin[t]);
+        boundsMax = glm::max(boundsMax, threadMax[t]);
+    }
+    const glm::vec3 extent = boundsMax - boundsMin;
+    const float rootSize = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f)) * 1.0001f;
+
+    std::vector<SortedPoint> sorted(pointCount);
+    const float toGrid = static_cast<float>(1u << MortonBits) / rootSize;
+    Parallel::run(threads, [&](uint32_t t) {
+        for (size_t i = pointCount * size_t(t) / threads; i < pointCount * size_t(t + 1) / threads; ++i) {
+            glm::vec3 cell = glm::min((data.positions[i] - boundsMin) * toGrid, glm::vec3((1u << MortonBits) - 1));
+            sorted[i].code = spreadBits(static_cast<uint32_t>(cell.x))
+                           | spreadBits(static_cast<uint32_t>(cell.y)) << 1
+                           | spreadBits(static_cast<uint32_t>(cell.z)) << 2;
+            sorted[i].index = static_cast<uint32_t>(i);
+        }
+    });
+    parallelSort(sorted, threads);
+
+    //
+    // Octree level by level - nodes of one level in parallel
+    //
+    std::vector<BuildNode> nodes(1);
+    nodes[0].origin = boundsMin;
+    nodes[0].size = rootSize;
+    nodes[0].candidates.resize(pointCount);
+    for (uint32_t i = 0; i < pointCount; ++i) {
+        nodes[0].candidates[i] = i;
+    }
+    for (size_t levelBegin = 0, levelEnd = 1; levelBegin < levelEnd; levelBegin = levelEnd, levelEnd = nodes.size()) {
+        Parallel::forEach(threads, levelEnd - levelBegin, [&](size_t i) {
+            processNode(nodes[levelBegin + i], sorted, mSettings);
+        });
+        for (size_t nodeIdx = levelBegin; nodeIdx < levelEnd; ++nodeIdx) {
+            for (uint32_t octant = 0; octant < 8; ++octant) {
+                BuildNode& parent = nodes[nodeIdx];
+                if (parent.childBegin[octant] == parent.childBegin[octant + 1]) {
+                    continue;
+                }
+                if (!parent.childMask) {
+                    parent.firstChild = static_cast<uint32_t>(nodes.size());
+                }
+                parent.childMask |= 1u << octant;
+                BuildNode child;
+                child.size = parent.size * 0.5f;
+                child.origin = parent.origin + child.size * glm::vec3(octant & 1, (octant >> 1) & 1, (octant >> 2) & 1);
+                child.depth = parent.depth + 1;
+                child.candidates.assign(parent.remaining.begin() + parent.childBegin[octant],
+                                        parent.remaining.begin() + parent.childBegin[octant + 1]);
+                nodes.push_back(std::move(child)); // parent reference is not valid anymore
+            }
+            std::vector<uint32_t>().swap(nodes[nodeIdx].remaining);
+        }
+    }
+    if (nodes.size() >= InvalidNode) {
+        qWarning("Too many octree nodes: %llu", static_cast<unsigned long long>(nodes.size()));
+        return false;
+    }
+
+    //
+    // File layout and parallel encoding of node blocks into mapped file
+    //
+    std::vector<Node> records(nodes.size());
+    const uint64_t nodesOffset = sizeof(Header);
+    const uint64_t dataOffset = alignUp(nodesOffset + records.size() * sizeof(Node), DataAlignment);
+    uint64_t fileSize = dataOffset;
+    for (size_t nodeIdx = 0; nodeIdx < nodes.size(); ++nodeIdx) {
+        records[nodeIdx].dataOffset = alignUp(fileSize, BlockAlignment);
+        fileSize = records[nodeIdx].dataOffset + blockSize(static_cast<uint32_t>(nodes[nodeIdx].points.size()), attributes);
+    }
+
+    QFile file(QString::fromStdString(outputPath));
+    if (!file.open(QIODevice::ReadWrite | QIODevice::Truncate) || !file.resize(static_cast<qint64>(fileSize))) {
+        qWarning("Can't create octree file: %s", outputPath.c_str());
+        return false;
+    }
+    uchar* mapped = file.map(0, static_cast<qint64>(fileSize));
+    if (!mapped) {
+        qWarning("Can't map octree file: %s", outputPath.c_str());
+        return false;
+    }
+
+    Parallel::forEach(threads, nodes.size(), [&](size_t nodeIdx) {
+        const BuildNode& node = nodes[nodeIdx];
+        Node& record = records[nodeIdx];
+        const uint32_t count = static_cast<uint32_t>(node.points.size());
+        uchar* block = mapped + record.dataOffset;
+        uint16_t* positions = reinterpret_cast<uint16_t*>(block);
+        uint32_t* colors = reinterpret_cast<uint32_t*>(block + colorsOffset(count));
+        uint32_t* normals = reinterpret_cast<uint32_t*>(block + normalsOffset(count, attributes));
+        const float toSteps = QuantizationSteps / node.size;
+        glm::vec3 pointsMin(node.origin + node.size);
+        glm::vec3 pointsMax(node.origin);
+        for (uint32_t i = 0; i < count; ++i) {
+            const uint32_t pointIdx = sorted[node.points[i]].index;
+            const glm::vec3& position = data.positions[pointIdx];
+            glm::vec3 q = glm::clamp((position - node.origin) * toSteps + 0.5f, glm::vec3(0.f), glm::vec3(QuantizationSteps));
+            positions[3 * i + 0] = static_cast<uint16_t>(q.x);
+            positions[3 * i + 1] = static_cast<uint16_t>(q.y);
+            positions[3 * i + 2] = static_cast<uint16_t>(q.z);
+            pointsMin = glm::min(pointsMin, position);
+            pointsMax = glm::max(pointsMax, position);
+            if (attributes & AttributeColors) {
+                colors[i] = data.colors[pointIdx];
+            }
+            if (attributes & AttributeNormals) {
+                normals[i] = glm::packSnorm4x8(glm::vec4(data.normals[pointIdx], 0.f));
+            }
+        }
+        for (int axis = 0; axis < 3; ++axis) {
+            record.origin[axis] = node.origin[axis];
+            record.boundsMin[axis] = count ? pointsMin[axis] : node.origin[axis];
+            record.boundsMax[axis] = count ? pointsMax[axis] : node.origin[axis];
+        }
+        record.size = node.size;
+        record.spacing = node.size / static_cast<float>(1u << std::min(mSettings.sampleGridBits, MortonBits));
+        record.pointCount = count;
+        record.firstChild = node.firstChild;
+        record.childMask = node.childMask;
+        record.depth = static_cast<uint8_t>(node.depth);
+        record.reserved = 0;
+    });
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, Magic, sizeof(header.magic));
+    header.version = Version;
+    header.endianMarker = EndianMarker;
+    header.headerSize = sizeof(Header);
+    header.nodeSize = sizeof(Node);
+    header.nodeCount = static_cast<uint32_t>(records.size());
+    header.attributes = attributes;
+    header.pointCount = pointCount;
+    header.nodesOffset = nodesOffset;
+    header.dataOffset = dataOffset;
+    header.fileSize = fileSize;
+    for (int axis = 0; axis < 3; ++axis) {
+        header.boundsMin[axis] = boundsMin[axis];
+        header.boundsMax[axis] = boundsMax[axis];
+    }
+    header.depth = nodes.back().depth + 1;
+    memcpy(mapped, &header, sizeof(header));
+    memcpy(mapped + nodesOffset, records.data(), records.size() * sizeof(Node));
+    file.unmap(mapped);
+    file.close();
+
+    mStats.points = pointCount;
+    mStats.nodes = header.nodeCount;
+    mStats.depth = header.depth;
+    mStats.bytes = fileSize;
+    mStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    qInfo("Octree %s: %llu points, %u nodes, depth %u, %.1f MB in %.3f s", outputPath.c_str(),
+          static_cast<unsigned long long>(mStats.points), mStats.nodes, mStats.depth,
+          mStats.bytes / (1024.0 * 1024.0), mStats.seconds);
+    return true;
+}
@@ -0,0 +1,69 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "PointCloudData.hpp"
+#include <string>
+
+///
+/// Builds LOD octree of points and writes it as native scan file (see OctreeFormat.hpp).
+/// Points are sorted along 63 bit Morton curve, so every node is a range of sorted points and a sample cell
+/// is a prefix of Morton code - subsampling is a single linear pass. Nodes of one level are processed
+/// in parallel, node blocks are encoded in parallel straight into the mapped output file.
+///
+class OctreeConverter
+{
+public:
+    struct Settings {
+        uint32_t maxPointsPerNode = 65536; // node with more points is subsampled and split
+        uint32_t sampleGridBits = 7;       // inner node keeps one point per cell of (2^bits)^3 grid of its cube
+        uint32_t maxDepth = 14;            // nodes at this depth keep all their points (at most 20)
+        uint32_t threads = 0;              // 0 - std::thread::hardware_concurrency()
+    };
+
+    struct Stats {
+        uint64_t points = 0;
+        uint32_t nodes = 0;
+        uint32_t depth = 0;
+        uint64_t bytes = 0;
+        double seconds = 0.0;
+    };
+
+    void setSettings(const Settings& settings) { mSettings = settings; }
+    const Settings& settings() const { return mSettings; }
+
+    bool convert(const PointCloudData& data, const std::string& outputPath);
+
+    ///
+    /// Loads input with PointCloudLoader (PLY, XYZ, PTS) first
+    ///
+    bool convert(const std::string& inputPath, const std::string& outputPath);
+
+    const Stats& stats() const { return mStats; }
+
+protected:
+    Settings mSettings;
+    Stats mStats;
+};
@@ -0,0 +1,130 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <cstdint>
+
+///
+/// Native scan file (*.pco) - LOD octree of point chunks, laid out to be used straight from mmap:
+///     Header | Node[nodeCount] | node data blocks (first one page aligned)
+/// Nodes are in breadth first order, children of one node are next to each other (firstChild + childMask).
+/// Every node keeps a subsample of points of its cube - at most one point per cell of spacing size,
+/// points which are not taken go to children. Nodes down to some depth give the whole cloud in density of that depth.
+///
+/// Node data block is columnar, every column starts at ColumnAlignment:
+///     uint16_t positions[pointCount][3] - quantised in node cube: origin + q * size / QuantizationSteps
+///     uint32_t colors[pointCount]       - RGBA8 (red in the lowest byte), only with AttributeColors
+///     uint32_t normals[pointCount]      - snorm8 xyz (w = 0), only with AttributeNormals
+/// All values are little endian.
+///
+namespace OctreeFormat
+{
+
+const char Magic[8] = { 'P', 'C', 'O', 'C', 'T', 'R', 'E', 'E' };
+const uint32_t Version = 1;
+const uint32_t EndianMarker = 0x01020304u;
+const uint64_t DataAlignment = 4096;  // page - first node block
+const uint64_t BlockAlignment = 64;   // cache line - every node block
+const uint64_t ColumnAlignment = 16;
+const uint32_t InvalidNode = ~0u;
+const float QuantizationSteps = 65535.f;
+
+enum Attributes : uint32_t {
+    AttributeColors = 1,
+    AttributeNormals = 2,
+};
+
+struct Header {
+    char     magic[8];
+    uint32_t version;
+    uint32_t endianMarker;
+    uint32_t headerSize;   // sizeof(Header)
+    uint32_t nodeSize;     // sizeof(Node)
+    uint32_t nodeCount;
+    uint32_t attributes;   // Attributes bits
+    uint64_t pointCount;
+    uint64_t nodesOffset;
+    uint64_t dataOffset;
+    uint64_t fileSize;
+    float    boundsMin[3]; // tight bounds of all points
+    float    boundsMax[3];
+    uint32_t depth;        // levels of the octree
+    uint32_t reserved[9];
+};
+
+struct Node {
+    float    origin[3];    // cube corner with minimal coordinates
+    float    size;         // cube edge
+    float    boundsMin[3]; // tight bounds of node points
+    float    boundsMax[3];
+    float    spacing;      // max distance of sampled points - world space error when children are not drawn
+    uint32_t pointCount;
+    uint32_t firstChild;   // InvalidNode - leaf
+    uint8_t  childMask;    // bit i - child in octant i = x | y << 1 | z << 2
+    uint8_t  depth;
+    uint16_t reserved;
+    uint64_t dataOffset;   // block from file start
+};
+
+static_assert(sizeof(Header) == 128, "Header is part of file format");
+static_assert(sizeof(Node) == 64, "Node is part of file format");
+
+inline uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+inline uint64_t colorsOffset(uint32_t pointCount)
+{
+    return alignUp(pointCount * 3ull * sizeof(uint16_t), ColumnAlignment);
+}
+
+inline uint64_t normalsOffset(uint32_t pointCount, uint32_t attributes)
+{
+    return colorsOffset(pointCount) + (attributes & AttributeColors ? alignUp(pointCount * 4ull, ColumnAlignment) : 0);
+}
+
+inline uint64_t blockSize(uint32_t pointCount, uint32_t attributes)
+{
+    return normalsOffset(pointCount, attributes) + (attributes & AttributeNormals ? alignUp(pointCount * 4ull, ColumnAlignment) : 0);
+}
+
+///
+/// Index of child node in octant, InvalidNode if there is no such child
+///
+inline uint32_t childIndex(const Node& node, uint32_t octant)
+{
+    if (!(node.childMask & (1u << octant))) {
+        return InvalidNode;
+    }
+    uint32_t before = node.childMask & ((1u << octant) - 1);
+    uint32_t index = node.firstChild;
+    for (; before; before &= before - 1) {
+        ++index;
+    }
+    return index;
+}
+
+}
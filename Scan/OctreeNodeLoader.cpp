@@ -0,0 +1,129 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "OctreeNodeLoader.hpp"
+#include "OctreeReader.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+OctreeNodeLoader::OctreeNodeLoader(const OctreeReader* reader, uint32_t threads)
+    : mReader(reader)
+{
+    for (uint32_t t = 0; t < std::max(1u, threads); ++t) {
+        mWorkers.emplace_back(&OctreeNodeLoader::workerLoop, this);
+    }
+}
+
+OctreeNodeLoader::~OctreeNodeLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQuit = true;
+    }
+    mRequestCv.notify_all();
+    for (std::thread& worker : mWorkers) {
+        worker.join();
+    }
+}
+
+void OctreeNodeLoader::setRequests(const std::vector<Request>& requests)
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mRequests.clear();
+        for (const Request& request : requests) {
+            if (!mBusy.count(request.nodeIdx)) {
+                mRequests.push_back(request);
+            }
+        }
+        std::sort(mRequests.begin(), mRequests.end(), [](const Request& a, const Request& b) { return a.priority < b.priority; });
+    }
+    mRequestCv.notify_all();
+}
+
+void OctreeNodeLoader::takeLoaded(std::vector<LoadedNode>& nodes)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    for (LoadedNode& node : mLoaded) {
+        mBusy.erase(node.nodeIdx);
+        nodes.push_back(std::move(node));
+    }
+    mLoaded.clear();
+}
+
+size_t OctreeNodeLoader::pendingCount() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mRequests.size();
+}
+
+OctreeNodeLoader::Stats OctreeNodeLoader::stats() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mStats;
+}
+
+void OctreeNodeLoader::workerLoop()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mRequestCv.wait(lock, [this]() { return mQuit || !mRequests.empty(); });
+        if (mQuit) {
+            return;
+        }
+        const uint32_t nodeIdx = mRequests.back().nodeIdx;
+        mRequests.pop_back();
+        mBusy.insert(nodeIdx);
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        LoadedNode node;
+        loadNode(nodeIdx, node);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        ++mStats.nodes;
+        mStats.bytes += OctreeFormat::blockSize(mReader->node(nodeIdx).pointCount, mReader->header().attributes);
+        mStats.seconds += seconds;
+        mLoaded.push_back(std::move(node));
+    }
+}
+
+void OctreeNodeLoader::loadNode(uint32_t nodeIdx, LoadedNode& node) const
+{
+    const uint32_t count = mReader->node(nodeIdx).pointCount;
+    node.nodeIdx = nodeIdx;
+    node.positions.resize(count);
+    mReader->decodePositions(nodeIdx, node.positions.data());
+    if (const uint32_t* colors = mReader->colors(nodeIdx)) {
+        node.colors.assign(colors, colors + count);
+    }
+    else {
+        node.colors.assign(count, 0xffffffffu);
+    }
+    if (const uint32_t* normals = mReader->normals(nodeIdx)) {
+        node.normals.assign(normals, normals + count);
+    }
+}
@@ -0,0 +1,102 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+class OctreeReader;
+
+///
+/// Background threads reading octree nodes from mapped file - page faults and decoding of quantised
+/// positions happen outside of render thread. Result has the vertex layout of PointCloud buffers.
+/// Requests are replaced every frame (latest priorities), requests already being loaded are not repeated.
+///
+class OctreeNodeLoader
+{
+public:
+    struct Request {
+        uint32_t nodeIdx;
+        float priority; // higher first
+    };
+
+    struct LoadedNode {
+        uint32_t nodeIdx = 0;
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t> colors;  // RGBA8, white if file has no colors
+        std::vector<uint32_t> normals; // snorm8 xyz, empty if file has no normals
+    };
+
+    struct Stats {
+        uint64_t nodes = 0;
+        uint64_t bytes = 0;    // read from file
+        double seconds = 0.0;  // busy time summed over threads
+
+        double megabytesPerSecond() const { return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0; }
+    };
+
+    ///
+    /// Reader has to stay open while loader exists
+    ///
+    OctreeNodeLoader(const OctreeReader* reader, uint32_t threads = 1);
+    ~OctreeNodeLoader();
+
+    ///
+    /// Replaces requests which are not started yet
+    ///
+    void setRequests(const std::vector<Request>& requests);
+
+    ///
+    /// Appends nodes loaded since last call
+    ///
+    void takeLoaded(std::vector<LoadedNode>& nodes);
+
+    size_t pendingCount() const;
+    Stats stats() const;
+
+    OctreeNodeLoader(const OctreeNodeLoader&) = delete;
+    OctreeNodeLoader& operator=(const OctreeNodeLoader&) = delete;
+
+protected:
+    void workerLoop();
+    void loadNode(uint32_t nodeIdx, LoadedNode& node) const;
+
+    std::vector<std::thread> mWorkers;
+
+    mutable std::mutex mMutex;
+    std::condition_variable mRequestCv;
+    std::vector<Request> mRequests;   // waiting, sorted by priority - highest at the end
+    std::set<uint32_t> mBusy;         // being loaded or loaded and not taken
+    std::vector<LoadedNode> mLoaded;
+    Stats mStats;
+    bool mQuit = false;
+
+    const OctreeReader* mReader;
+};
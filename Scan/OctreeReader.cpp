@@ -0,0 +1,188 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "OctreeReader.hpp"
+#include "Parallel.hpp"
+#include <QFile>
+#include <QtGlobal>
+#include <glm/gtc/packing.hpp>
+#include <chrono>
+#include <cstring>
+
+using namespace OctreeFormat;
+
+OctreeReader::OctreeReader()
+{
+}
+
+OctreeReader::~OctreeReader()
+{
+    close();
+}
+
+bool OctreeReader::open(const std::string& path)
+{
+    auto start = std::chrono::steady_clock::now();
+    close();
+
+    std::unique_ptr<QFile> file(new QFile(QString::fromStdString(path)));
+    if (!file->open(QIODevice::ReadOnly)) {
+        qWarning("Can't open octree file: %s", path.c_str());
+        return false;
+    }
+    const uint64_t size = static_cast<uint64_t>(file->size());
+    if (size < sizeof(Header)) {
+        qWarning("Not an octree file: %s", path.c_str());
+        return false;
+    }
+    const uint8_t* data = file->map(0, static_cast<qint64>(size));
+    if (!data) {
+        qWarning("Can't map octree file: %s", path.c_str());
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(data);
+    if (memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->endianMarker != EndianMarker) {
+        qWarning("Not an octree file or different endianness: %s", path.c_str());
+        return false;
+    }
+    if (header->version != Version || header->headerSize != sizeof(Header) || header->nodeSize != sizeof(Node)) {
+        qWarning("Unsupported octree file version %u: %s", header->version, path.c_str());
+        return false;
+    }
+    if (header->fileSize != size || !header->nodeCount
+        || header->nodesOffset % alignof(Node) || header->nodesOffset + header->nodeCount * uint64_t(sizeof(Node)) > size) {
+        qWarning("Octree file is truncated or damaged: %s", path.c_str());
+        return false;
+    }
+    const Node* nodes = reinterpret_cast<const Node*>(data + header->nodesOffset);
+    for (uint32_t nodeIdx = 0; nodeIdx < header->nodeCount; ++nodeIdx) {
+        const Node& node = nodes[nodeIdx];
+        uint32_t childCount = 0;
+        for (uint32_t mask = node.childMask; mask; mask &= mask - 1) {
+            ++childCount;
+        }
+        bool childrenValid = !childCount || (node.firstChild > nodeIdx && node.firstChild + uint64_t(childCount) <= header->nodeCount);
+        if (node.dataOffset % BlockAlignment || node.dataOffset + blockSize(node.pointCount, header->attributes) > size || !childrenValid) {
+            qWarning("Octree file has damaged node %u: %s", nodeIdx, path.c_str());
+            return false;
+        }
+    }
+
+    mFile = std::move(file);
+    mData = data;
+    mHeader = header;
+    mNodes = nodes;
+    mOpenMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void OctreeReader::close()
+{
+    if (mFile) {
+        mFile->unmap(const_cast<uchar*>(mData));
+        mFile.reset();
+    }
+    mData = nullptr;
+    mHeader = nullptr;
+    mNodes = nullptr;
+}
+
+const uint16_t* OctreeReader::quantizedPositions(uint32_t nodeIdx) const
+{
+    return reinterpret_cast<const uint16_t*>(mData + mNodes[nodeIdx].dataOffset);
+}
+
+const uint32_t* OctreeReader::colors(uint32_t nodeIdx) const
+{
+    const Node& node = mNodes[nodeIdx];
+    if (!(mHeader->attributes & AttributeColors)) {
+        return nullptr;
+    }
+    return reinterpret_cast<const uint32_t*>(mData + node.dataOffset + colorsOffset(node.pointCount));
+}
+
+const uint32_t* OctreeReader::normals(uint32_t nodeIdx) const
+{
+    const Node& node = mNodes[nodeIdx];
+    if (!(mHeader->attributes & AttributeNormals)) {
+        return nullptr;
+    }
+    return reinterpret_cast<const uint32_t*>(mData + node.dataOffset + normalsOffset(node.pointCount, mHeader->attributes));
+}
+
+void OctreeReader::decodePositions(uint32_t nodeIdx, glm::vec3* positions) const
+{
+    const Node& node = mNodes[nodeIdx];
+    const glm::vec3 origin(node.origin[0], node.origin[1], node.origin[2]);
+    const float step = node.size / QuantizationSteps;
+    const uint16_t* quantized = quantizedPositions(nodeIdx);
+    for (uint32_t i = 0; i < node.pointCount; ++i) {
+        positions[i] = origin + step * glm::vec3(quantized[3 * i], quantized[3 * i + 1], quantized[3 * i + 2]);
+    }
+}
+
+void OctreeReader::decodeNode(uint32_t nodeIdx, PointCloudData& data, size_t firstPoint) const
+{
+    const uint32_t count = mNodes[nodeIdx].pointCount;
+    decodePositions(nodeIdx, data.positions.data() + firstPoint);
+    if (const uint32_t* nodeColors = colors(nodeIdx)) {
+        memcpy(data.colors.data() + firstPoint, nodeColors, count * sizeof(uint32_t));
+    }
+    if (const uint32_t* nodeNormals = normals(nodeIdx)) {
+        for (uint32_t i = 0; i < count; ++i) {
+            data.normals[firstPoint + i] = glm::vec3(glm::unpackSnorm4x8(nodeNormals[i]));
+        }
+    }
+}
+
+void OctreeReader::readNode(uint32_t nodeIdx, PointCloudData& data) const
+{
+    const size_t firstPoint = data.size();
+    const size_t size = firstPoint + mNodes[nodeIdx].pointCount;
+    data.positions.resize(size);
+    data.colors.resize(mHeader->attributes & AttributeColors ? size : 0);
+    data.normals.resize(mHeader->attributes & AttributeNormals ? size : 0);
+    decodeNode(nodeIdx, data, firstPoint);
+}
+
+void OctreeReader::readLevels(uint32_t maxDepth, PointCloudData& data, uint32_t threads) const
+{
+    data.clear();
+    if (!mHeader) {
+        return;
+    }
+    // Breadth first order - nodes up to maxDepth are at the beginning
+    std::vector<size_t> firstPoints(1, 0);
+    for (uint32_t nodeIdx = 0; nodeIdx < mHeader->nodeCount && mNodes[nodeIdx].depth <= maxDepth; ++nodeIdx) {
+        firstPoints.push_back(firstPoints.back() + mNodes[nodeIdx].pointCount);
+    }
+    const size_t size = firstPoints.back();
+    data.positions.resize(size);
+    data.colors.resize(mHeader->attributes & AttributeColors ? size : 0);
+    data.normals.resize(mHeader->attributes & AttributeNormals ? size : 0);
+    Parallel::forEach(Parallel::threadCount(threads), firstPoints.size() - 1, [&](size_t nodeIdx) {
+        decodeNode(static_cast<uint32_t>(nodeIdx), data, firstPoints[nodeIdx]);
+    });
+}
@@ -0,0 +1,86 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "OctreeFormat.hpp"
+#include "PointCloudData.hpp"
+#include <memory>
+#include <string>
+
+class QFile;
+
+///
+/// Native scan file opened by mmap - only header and node table are validated, point data is touched
+/// when a node is read, so opening does not depend on file size. Node columns can be used in place.
+///
+class OctreeReader
+{
+public:
+    OctreeReader();
+    ~OctreeReader();
+
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return mHeader != nullptr; }
+
+    const OctreeFormat::Header& header() const { return *mHeader; }
+    uint32_t nodeCount() const { return mHeader ? mHeader->nodeCount : 0; }
+    const OctreeFormat::Node& node(uint32_t nodeIdx) const { return mNodes[nodeIdx]; }
+    uint32_t childIndex(uint32_t nodeIdx, uint32_t octant) const { return OctreeFormat::childIndex(mNodes[nodeIdx], octant); }
+
+    ///
+    /// Columns of node in mapped file, valid until close. nullptr if file has no such attribute.
+    ///
+    const uint16_t* quantizedPositions(uint32_t nodeIdx) const;
+    const uint32_t* colors(uint32_t nodeIdx) const;
+    const uint32_t* normals(uint32_t nodeIdx) const; // snorm8 xyz
+
+    void decodePositions(uint32_t nodeIdx, glm::vec3* positions) const;
+
+    ///
+    /// Points of node appended to data, colors and normals only if file has them
+    ///
+    void readNode(uint32_t nodeIdx, PointCloudData& data) const;
+
+    ///
+    /// Points of all nodes with depth <= maxDepth (whole cloud in density of that level), nodes are decoded in parallel.
+    /// Previous content of data is replaced.
+    ///
+    void readLevels(uint32_t maxDepth, PointCloudData& data, uint32_t threads = 0) const;
+
+    double openMs() const { return mOpenMs; }
+
+    OctreeReader(const OctreeReader&) = delete;
+    OctreeReader& operator=(const OctreeReader&) = delete;
+
+protected:
+    void decodeNode(uint32_t nodeIdx, PointCloudData& data, size_t firstPoint) const;
+
+    std::unique_ptr<QFile> mFile;
+    const uint8_t* mData = nullptr;
+    const OctreeFormat::Header* mHeader = nullptr;
+    const OctreeFormat::Node* mNodes = nullptr;
+    double mOpenMs = 0.0;
+};
@@ -0,0 +1,78 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include <vector>
+
+///
+/// Small helpers for data parallel loops of Scan library - threads are created per call,
+/// so use them for work of milliseconds and more.
+///
+namespace Parallel
+{
+
+///
+/// requested threads, 0 - std::thread::hardware_concurrency()
+///
+inline uint32_t threadCount(uint32_t requested)
+{
+    return requested ? requested : std::max(1u, std::thread::hardware_concurrency());
+}
+
+///
+/// func(threadIdx) on all threads - calling thread takes index 0
+///
+inline void run(uint32_t threads, const std::function<void(uint32_t)>& func)
+{
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (uint32_t t = 1; t < threads; ++t) {
+        workers.emplace_back(func, t);
+    }
+    func(0);
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+///
+/// func(itemIdx) for items 0..count-1 taken one by one by threads - for items of different cost (e.g. octree nodes)
+///
+inline void forEach(uint32_t threads, size_t count, const std::function<void(size_t)>& func)
+{
+    std::atomic<size_t> next(0);
+    run(static_cast<uint32_t>(std::min<size_t>(threads, std::max<size_t>(1, count))), [&](uint32_t /*threadIdx*/) {
+        for (size_t itemIdx = next++; itemIdx < count; itemIdx = next++) {
+            func(itemIdx);
+        }
+    });
+}
+
+}
@@ -0,0 +1,52 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+///
+/// Scanned points as separate arrays (SoA) - the same layout as vertex buffers of PointCloud renderable,
+/// so loaded data is moved into the renderable without conversion.
+///
+struct PointCloudData
+{
+    std::vector<glm::vec3> positions;
+    std::vector<uint32_t>  colors;  // RGBA8 - red in the lowest byte, empty - no colors
+    std::vector<glm::vec3> normals; // empty - no normals
+
+    size_t size() const { return positions.size(); }
+    bool hasColors() const { return !colors.empty(); }
+    bool hasNormals() const { return !normals.empty(); }
+
+    void clear()
+    {
+        positions.clear();
+        colors.clear();
+        normals.clear();
+    }
+};
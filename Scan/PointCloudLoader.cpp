@@ -0,0 +1,732 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "PointCloudLoader.hpp"
+#include "Parallel.hpp"
+#include <QFile>
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+namespace {
+
+const uint64_t MinBytesPerThread = 1024 * 1024; // smaller files are not worth threads
+
+const char* nextLine(const char* p, const char* end)
+{
+    const char* newline = p < end ? static_cast<const char*>(memchr(p, '\n', end - p)) : nullptr;
+    return newline ? newline + 1 : end;
+}
+
+// count ranges covering [begin, end), every range starts at line start
+std::vector<const char*> splitAtLines(const char* begin, const char* end, uint32_t count)
+{
+    std::vector<const char*> bounds(count + 1, end);
+    bounds[0] = begin;
+    size_t size = end - begin;
+    for (uint32_t i = 1; i < count; ++i) {
+        bounds[i] = nextLine(std::max(bounds[i - 1], begin + size * i / count), end);
+    }
+    return bounds;
+}
+
+//
+// Fast float parser - decimal numbers as written by scanners: [sign] digits [. digits] [e [sign] digits].
+// No locale, no null termination needed (mapped file). Returns position after the number, nullptr if there is no number.
+//
+const char* parseFloat(const char* p, const char* end, float& value)
+{
+    static const double powersOf10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const int maxExactPower = 22;
+    const int maxDigits = 19; // fits uint64_t
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    uint64_t mantissa = 0;
+    int digits = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    for (; p < end && static_cast<unsigned>(*p - '0') < 10; ++p) {
+        anyDigit = true;
+        if (digits < maxDigits) {
+            mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+            digits += mantissa ? 1 : 0;
+        }
+        else {
+            ++exponent; // digits beyond precision
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && static_cast<unsigned>(*p - '0') < 10; ++p) {
+            anyDigit = true;
+            if (digits < maxDigits) {
+                mantissa = mantissa * 10 + static_cast<unsigned>(*p - '0');
+                digits += mantissa ? 1 : 0;
+                --exponent;
+            }
+        }
+    }
+    if (!anyDigit) {
+        return nullptr;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* expStart = p++;
+        bool expNegative = false;
+        if (p < end && (*p == '-' || *p == '+')) {
+            expNegative = *p == '-';
+            ++p;
+        }
+        if (p < end && static_cast<unsigned>(*p - '0') < 10) {
+            int expValue = 0;
+            for (; p < end && static_cast<unsigned>(*p - '0') < 10; ++p) {
+                expValue = std::min(expValue * 10 + (*p - '0'), 10000);
+            }
+            exponent += expNegative ? -expValue : expValue;
+        }
+        else {
+            p = expStart; // 'e' is not part of the number
+        }
+    }
+
+    double result = static_cast<double>(mantissa);
+    if (mantissa && exponent) {
+        if (exponent < 0 && exponent >= -maxExactPower) {
+            result /= powersOf10[-exponent];
+        }
+        else if (exponent > 0 && exponent <= maxExactPower) {
+            result *= powersOf10[exponent];
+        }
+        else {
+            result *= std::pow(10.0, exponent);
+        }
+    }
+    value = static_cast<float>(negative ? -result : result);
+    return p;
+}
+
+inline bool isSeparator(char c)
+{
+    return c == ' ' || c == '\t' || c == ',' || c == ';';
+}
+
+// First non separator character starts a number - skips empty, comment and header lines
+bool isDataLine(const char* p, const char* end)
+{
+    while (p < end && isSeparator(*p)) {
+        ++p;
+    }
+    return p < end && (static_cast<unsigned>(*p - '0') < 10 || *p == '-' || *p == '+' || *p == '.');
+}
+
+// Up to maxValues numbers of line starting at p, p is moved to the next line. Returns count of parsed numbers.
+uint32_t parseLine(const char*& p, const char* end, float* values, uint32_t maxValues)
+{
+    uint32_t count = 0;
+    while (count < maxValues) {
+        while (p < end && isSeparator(*p)) {
+            ++p;
+        }
+        if (p >= end || *p == '\n' || *p == '\r') {
+            break;
+        }
+        const char* next = parseFloat(p, end, values[count]);
+        if (!next) {
+            break; // not a number - rest of line is ignored
+        }
+        p = next;
+        ++count;
+    }
+    p = nextLine(p, end);
+    return count;
+}
+
+uint32_t packColor(float r, float g, float b, float a)
+{
+    auto channel = [](float value) { return static_cast<uint32_t>(std::min(std::max(value, 0.f), 255.f) + 0.5f); };
+    return channel(r) | (channel(g) << 8) | (channel(b) << 16) | (channel(a) << 24);
+}
+
+//
+// Which columns (ASCII) or properties (binary PLY) hold which attribute
+//
+struct Layout {
+    static const uint32_t MaxColumns = 32;
+
+    uint32_t columns = 0;
+    int position[3] = { -1, -1, -1 };
+    int normal[3] = { -1, -1, -1 };
+    int color[4] = { -1, -1, -1, -1 }; // rgba, alpha is optional
+    float colorScale[4] = { 1.f, 1.f, 1.f, 1.f }; // value * scale is in 0..255
+    int intensity = -1;                // PTS intensity -2048..2047 shown as gray when there is no color
+
+    bool hasNormals() const { return normal[0] >= 0 && normal[1] >= 0 && normal[2] >= 0; }
+    bool hasColors() const { return (color[0] >= 0 && color[1] >= 0 && color[2] >= 0) || intensity >= 0; }
+    bool isValid() const { return position[0] >= 0 && position[1] >= 0 && position[2] >= 0; }
+
+    void store(const float* values, size_t pointIdx, PointCloudData& data) const
+    {
+        data.positions[pointIdx] = glm::vec3(values[position[0]], values[position[1]], values[position[2]]);
+        if (hasNormals()) {
+            data.normals[pointIdx] = glm::vec3(values[normal[0]], values[normal[1]], values[normal[2]]);
+        }
+        if (color[0] >= 0) {
+            float alpha = color[3] >= 0 ? values[color[3]] * colorScale[3] : 255.f;
+            data.colors[pointIdx] = packColor(values[color[0]] * colorScale[0], values[color[1]] * colorScale[1],
+                                              values[color[2]] * colorScale[2], alpha);
+        }
+        else if (intensity >= 0) {
+            float gray = (values[intensity] + 2048.f) * (255.f / 4095.f);
+            data.colors[pointIdx] = packColor(gray, gray, gray, 255.f);
+        }
+    }
+};
+
+void resizeData(PointCloudData& data, size_t count, const Layout& layout)
+{
+    data.positions.resize(count);
+    data.colors.resize(layout.hasColors() ? count : 0);
+    data.normals.resize(layout.hasNormals() ? count : 0);
+}
+
+//
+// ASCII - every thread counts data lines of its range, then parses them straight into their final index
+//
+uint64_t parseColumnLines(const char* begin, const char* end, uint32_t threads, uint64_t maxLines,
+                          const Layout& layout, PointCloudData& data)
+{
+    std::vector<const char*> bounds = splitAtLines(begin, end, threads);
+    std::vector<uint64_t> firstLine(threads + 1, 0);
+    Parallel::run(threads, [&](uint32_t t) {
+        uint64_t lines = 0;
+        for (const char* p = bounds[t]; p < bounds[t + 1]; p = nextLine(p, bounds[t + 1])) {
+            lines += isDataLine(p, bounds[t + 1]) ? 1 : 0;
+        }
+        firstLine[t + 1] = lines;
+    });
+    for (uint32_t t = 0; t < threads; ++t) {
+        firstLine[t + 1] += firstLine[t];
+    }
+    uint64_t total = std::min(firstLine[threads], maxLines);
+    resizeData(data, static_cast<size_t>(total), layout);
+
+    std::vector<uint64_t> invalidLines(threads, 0);
+    Parallel::run(threads, [&](uint32_t t) {
+        float values[Layout::MaxColumns];
+        uint64_t lineIdx = firstLine[t];
+        const char* rangeEnd = bounds[t + 1];
+        for (const char* p = bounds[t]; p < rangeEnd && lineIdx < total;) {
+            if (!isDataLine(p, rangeEnd)) {
+                p = nextLine(p, rangeEnd);
+                continue;
+            }
+            uint32_t count = parseLine(p, rangeEnd, values, layout.columns);
+            if (count < layout.columns) {
+                std::fill(values + count, values + layout.columns, 0.f);
+                ++invalidLines[t];
+            }
+            layout.store(values, static_cast<size_t>(lineIdx), data);
+            ++lineIdx;
+        }
+    });
+
+    uint64_t invalidSum = 0;
+    for (uint64_t invalid : invalidLines) {
+        invalidSum += invalid;
+    }
+    return invalidSum;
+}
+
+//
+// PLY header
+//
+enum PlyType {
+    PlyInvalid,
+    PlyInt8,
+    PlyUint8,
+    PlyInt16,
+    PlyUint16,
+    PlyInt32,
+    PlyUint32,
+    PlyFloat32,
+    PlyFloat64,
+};
+
+PlyType plyType(const std::string& name)
+{
+    if (name == "char" || name == "int8") return PlyInt8;
+    if (name == "uchar" || name == "uint8") return PlyUint8;
+    if (name == "short" || name == "int16") return PlyInt16;
+    if (name == "ushort" || name == "uint16") return PlyUint16;
+    if (name == "int" || name == "int32") return PlyInt32;
+    if (name == "uint" || name == "uint32") return PlyUint32;
+    if (name == "float" || name == "float32") return PlyFloat32;
+    if (name == "double" || name == "float64") return PlyFloat64;
+    return PlyInvalid;
+}
+
+uint32_t plyTypeSize(PlyType type)
+{
+    switch (type) {
+    case PlyInt8: case PlyUint8: return 1;
+    case PlyInt16: case PlyUint16: return 2;
+    case PlyInt32: case PlyUint32: case PlyFloat32: return 4;
+    case PlyFloat64: return 8;
+    case PlyInvalid: break;
+    }
+    return 0;
+}
+
+// Color properties are stored as 0..255
+float plyColorScale(PlyType type)
+{
+    switch (type) {
+    case PlyFloat32: case PlyFloat64: return 255.f;
+    case PlyInt16: case PlyUint16: return 255.f / 65535.f;
+    default: return 1.f;
+    }
+}
+
+struct PlyProperty {
+    std::string name;
+    PlyType type = PlyInvalid;
+    bool isList = false;
+    uint32_t offset = 0; // in binary vertex
+};
+
+struct PlyElement {
+    std::string name;
+    uint64_t count = 0;
+    std::vector<PlyProperty> properties;
+    uint32_t stride = 0; // binary size, 0 - element has list property
+};
+
+std::vector<std::string> splitWords(const char* begin, const char* end)
+{
+    std::vector<std::string> words;
+    const char* p = begin;
+    while (p < end) {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) {
+            ++p;
+        }
+        const char* wordStart = p;
+        while (p < end && *p != ' ' && *p != '\t' && *p != '\r') {
+            ++p;
+        }
+        if (p > wordStart) {
+            words.emplace_back(wordStart, p);
+        }
+    }
+    return words;
+}
+
+template <typename T>
+T loadValue(const char* p, bool swapBytes)
+{
+    char bytes[sizeof(T)];
+    memcpy(bytes, p, sizeof(T));
+    if (swapBytes) {
+        std::reverse(bytes, bytes + sizeof(T));
+    }
+    T value;
+    memcpy(&value, bytes, sizeof(T));
+    return value;
+}
+
+float readPlyValue(const char* p, PlyType type, bool swapBytes)
+{
+    switch (type) {
+    case PlyInt8: return static_cast<float>(static_cast<int8_t>(*p));
+    case PlyUint8: return static_cast<float>(static_cast<uint8_t>(*p));
+    case PlyInt16: return static_cast<float>(loadValue<int16_t>(p, swapBytes));
+    case PlyUint16: return static_cast<float>(loadValue<uint16_t>(p, swapBytes));
+    case PlyInt32: return static_cast<float>(loadValue<int32_t>(p, swapBytes));
+    case PlyUint32: return static_cast<float>(loadValue<uint32_t>(p, swapBytes));
+    case PlyFloat32: return loadValue<float>(p, swapBytes);
+    case PlyFloat64: return static_cast<float>(loadValue<double>(p, swapBytes));
+    case PlyInvalid: break;
+    }
+    return 0.f;
+}
+
+int findProperty(const PlyElement& element, const char* name, const char* alternativeName = nullptr)
+{
+    for (size_t i = 0; i < element.properties.size(); ++i) {
+        const std::string& propertyName = element.properties[i].name;
+        if (propertyName == name || (alternativeName && propertyName == alternativeName)) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+Layout plyLayout(const PlyElement& vertex)
+{
+    Layout layout;
+    layout.columns = static_cast<uint32_t>(vertex.properties.size());
+    layout.position[0] = findProperty(vertex, "x");
+    layout.position[1] = findProperty(vertex, "y");
+    layout.position[2] = findProperty(vertex, "z");
+    layout.normal[0] = findProperty(vertex, "nx", "normal_x");
+    layout.normal[1] = findProperty(vertex, "ny", "normal_y");
+    layout.normal[2] = findProperty(vertex, "nz", "normal_z");
+    layout.color[0] = findProperty(vertex, "red", "diffuse_red");
+    layout.color[1] = findProperty(vertex, "green", "diffuse_green");
+    layout.color[2] = findProperty(vertex, "blue", "diffuse_blue");
+    layout.color[3] = findProperty(vertex, "alpha", "diffuse_alpha");
+    if (!(layout.color[0] >= 0 && layout.color[1] >= 0 && layout.color[2] >= 0)) {
+        layout.color[0] = layout.color[1] = layout.color[2] = layout.color[3] = -1;
+    }
+    for (int c = 0; c < 4; ++c) {
+        if (layout.color[c] >= 0) {
+            layout.colorScale[c] = plyColorScale(vertex.properties[layout.color[c]].type);
+        }
+    }
+    return layout;
+}
+
+}
+
+PointCloudLoader::Format PointCloudLoader::formatFromPath(const std::string& path)
+{
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) {
+        return FormatUnknown;
+    }
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](char c) { return static_cast<char>(tolower(c)); });
+    if (extension == "ply") {
+        return FormatPly;
+    }
+    if (extension == "xyz" || extension == "txt") {
+        return FormatXyz;
+    }
+    if (extension == "pts") {
+        return FormatPts;
+    }
+    return FormatUnknown;
+}
+
+bool PointCloudLoader::load(const std::string& path, PointCloudData& data, Format format)
+{
+    auto start = std::chrono::steady_clock::now();
+    mStats = Stats();
+    data.clear();
+
+    if (format == FormatUnknown) {
+        format = formatFromPath(path);
+    }
+    if (format == FormatUnknown) {
+        qWarning("Unknown point cloud format: %s", path.c_str());
+        return false;
+    }
+
+    QFile file(QString::fromStdString(path));
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning("Can't open point cloud: %s", path.c_str());
+        return false;
+    }
+    qint64 size = file.size();
+    uchar* mapped = size > 0 ? file.map(0, size) : nullptr;
+    if (!mapped) {
+        qWarning("Can't map point cloud: %s", path.c_str());
+        return false;
+    }
+
+    mUsedThreads = Parallel::threadCount(mThreadCount);
+    mUsedThreads = static_cast<uint32_t>(std::min<uint64_t>(mUsedThreads, std::max<uint64_t>(1, size / MinBytesPerThread)));
+
+    const char* begin = reinterpret_cast<const char*>(mapped);
+    const char* end = begin + size;
+    bool loaded = format == FormatPly ? loadPly(begin, end, data) : loadColumns(begin, end, format == FormatPts, data);
+    file.unmap(mapped);
+    if (!loaded) {
+        data.clear();
+        return false;
+    }
+
+    mStats.bytes = static_cast<uint64_t>(size);
+    mStats.points = data.size();
+    mStats.threads = mUsedThreads;
+    mStats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    qInfo("Loaded %s: %llu points, %.1f MB in %.3f s - %.1f MB/s, %.2f Mpoints/s, threads: %u", path.c_str(),
+          static_cast<unsigned long long>(mStats.points), mStats.bytes / (1024.0 * 1024.0), mStats.seconds,
+          mStats.megabytesPerSecond(), mStats.pointsPerSecond() / 1e6, mStats.threads);
+    if (mStats.invalidLines) {
+        qWarning("%s: %llu lines with missing values", path.c_str(), static_cast<unsigned long long>(mStats.invalidLines));
+    }
+    return true;
+}
+
+bool PointCloudLoader::loadPly(const char* begin, const char* end, PointCloudData& data)
+{
+    //
+    // Header
+    //
+    enum Encoding { Ascii, BinaryLittleEndian, BinaryBigEndian } encoding = Ascii;
+    bool formatFound = false;
+    std::vector<PlyElement> elements;
+    const char* p = begin;
+    const char* dataStart = nullptr;
+    for (bool firstLine = true; p < end && !dataStart; firstLine = false) {
+        const char* lineEnd = nextLine(p, end);
+        std::vector<std::string> words = splitWords(p, lineEnd > p && lineEnd[-1] == '\n' ? lineEnd - 1 : lineEnd);
+        p = lineEnd;
+        if (firstLine) {
+            if (words.size() != 1 || words[0] != "ply") {
+                qWarning("Not a PLY file");
+                return false;
+            }
+            continue;
+        }
+        if (words.empty() || words[0] == "comment" || words[0] == "obj_info") {
+            continue;
+        }
+        if (words[0] == "end_header") {
+            dataStart = p;
+        }
+        else if (words[0] == "format" && words.size() >= 2) {
+            formatFound = true;
+            if (words[1] == "ascii") {
+                encoding = Ascii;
+            }
+            else if (words[1] == "binary_little_endian") {
+                encoding = BinaryLittleEndian;
+            }
+            else if (words[1] == "binary_big_endian") {
+                encoding = BinaryBigEndian;
+            }
+            else {
+                qWarning("Unsupported PLY format: %s", words[1].c_str());
+                return false;
+            }
+        }
+        else if (words[0] == "element" && words.size() >= 3) {
+            PlyElement element;
+            element.name = words[1];
+            element.count = std::strtoull(words[2].c_str(), nullptr, 10);
+            elements.push_back(element);
+        }
+        else if (words[0] == "property" && !elements.empty()) {
+            PlyElement& element = elements.back();
+            PlyProperty property;
+            if (words.size() >= 5 && words[1] == "list") {
+                property.isList = true;
+                property.type = plyType(words[3]);
+                property.name = words[4];
+            }
+            else if (words.size() >= 3) {
+                property.type = plyType(words[1]);
+                property.name = words[2];
+            }
+            if (property.type == PlyInvalid) {
+                qWarning("Unsupported PLY property type in element %s", element.name.c_str());
+                return false;
+            }
+            element.properties.push_back(property);
+        }
+    }
+    if (!dataStart || !formatFound) {
+        qWarning("Incomplete PLY header");
+        return false;
+    }
+
+    // Binary layout - elements with lists have no fixed size
+    for (PlyElement& element : elements) {
+        element.stride = 0;
+        for (PlyProperty& property : element.properties) {
+            if (property.isList) {
+                element.stride = 0;
+                break;
+            }
+            property.offset = element.stride;
+            element.stride += plyTypeSize(property.type);
+        }
+    }
+
+    auto vertexIt = std::find_if(elements.begin(), elements.end(), [](const PlyElement& element) { return element.name == "vertex"; });
+    if (vertexIt == elements.end()) {
+        qWarning("PLY file without vertex element");
+        return false;
+    }
+    const PlyElement& vertex = *vertexIt;
+    Layout layout = plyLayout(vertex);
+    if (!layout.isValid() || !vertex.stride || layout.columns > Layout::MaxColumns) {
+        qWarning("PLY vertex element without x, y, z or with list property");
+        return false;
+    }
+
+    //
+    // ASCII - vertex lines follow lines of preceding elements
+    //
+    if (encoding == Ascii) {
+        const char* vertexStart = dataStart;
+        for (auto it = elements.begin(); it != vertexIt; ++it) {
+            for (uint64_t line = 0; line < it->count && vertexStart < end; ++line) {
+                vertexStart = nextLine(vertexStart, end);
+            }
+        }
+        mStats.invalidLines = parseColumnLines(vertexStart, end, mUsedThreads, vertex.count, layout, data);
+        if (data.size() < vertex.count) {
+            qWarning("PLY file has %llu of %llu vertices", static_cast<unsigned long long>(data.size()),
+                     static_cast<unsigned long long>(vertex.count));
+        }
+        return true;
+    }
+
+    //
+    // Binary - fixed stride, every thread gathers its range of vertices
+    //
+    const char* vertexData = dataStart;
+    for (auto it = elements.begin(); it != vertexIt; ++it) {
+        if (!it->stride) {
+            qWarning("PLY element %s with list property before vertices", it->name.c_str());
+            return false;
+        }
+        vertexData += it->stride * it->count;
+    }
+    if (vertexData > end || static_cast<uint64_t>(end - vertexData) / vertex.stride < vertex.count) {
+        qWarning("PLY file is truncated");
+        return false;
+    }
+
+    const bool swapBytes = (encoding == BinaryBigEndian) == (Q_BYTE_ORDER == Q_LITTLE_ENDIAN);
+    const PlyProperty& x = vertex.properties[layout.position[0]];
+    const PlyProperty& y = vertex.properties[layout.position[1]];
+    const PlyProperty& z = vertex.properties[layout.position[2]];
+    // Common case - positions are copied as they are
+    const bool rawPositions = !swapBytes && x.type == PlyFloat32 && y.type == PlyFloat32 && z.type == PlyFloat32
+                           && y.offset == x.offset + 4 && z.offset == x.offset + 8;
+
+    const size_t count = static_cast<size_t>(vertex.count);
+    resizeData(data, count, layout);
+    const uint32_t threads = static_cast<uint32_t>(std::min<uint64_t>(mUsedThreads, std::max<uint64_t>(1, count / 4096)));
+    Parallel::run(threads, [&](uint32_t t) {
+        float values[Layout::MaxColumns];
+        const size_t first = count * t / threads;
+        const size_t last = count * (t + 1) / threads;
+        for (size_t i = first; i < last; ++i) {
+            const char* v = vertexData + i * vertex.stride;
+            if (rawPositions && layout.columns == 3) {
+                memcpy(&data.positions[i], v + x.offset, sizeof(glm::vec3));
+                continue;
+            }
+            for (uint32_t c = 0; c < layout.columns; ++c) {
+                const PlyProperty& property = vertex.properties[c];
+                values[c] = readPlyValue(v + property.offset, property.type, swapBytes);
+            }
+            layout.store(values, i, data);
+        }
+    });
+    return true;
+}
+
+bool PointCloudLoader::loadColumns(const char* begin, const char* end, bool ptsHeader, PointCloudData& data)
+{
+    float values[Layout::MaxColumns];
+    const char* p = begin;
+    while (p < end && !isDataLine(p, end)) {
+        p = nextLine(p, end);
+    }
+    if (ptsHeader && p < end) {
+        const char* line = p;
+        if (parseLine(line, end, values, Layout::MaxColumns) == 1) {
+            p = line; // point count
+        }
+    }
+    while (p < end && !isDataLine(p, end)) {
+        p = nextLine(p, end);
+    }
+    if (p >= end) {
+        qWarning("Point cloud without points");
+        return false;
+    }
+
+    //
+    // Columns of the first lines decide layout
+    //
+    const char* line = p;
+    uint32_t columns = parseLine(line, end, values, Layout::MaxColumns);
+    Layout layout;
+    layout.columns = columns;
+    layout.position[0] = 0;
+    layout.position[1] = 1;
+    layout.position[2] = 2;
+    switch (columns) {
+    case 3:
+        break;
+    case 4:
+        layout.intensity = ptsHeader ? 3 : -1;
+        break;
+    case 6: {
+        // Colors are integers 0..255, anything else are normals
+        bool integerColors = true;
+        const char* sample = p;
+        for (int sampleLine = 0; sampleLine < 16 && sample < end && integerColors; ++sampleLine) {
+            if (!isDataLine(sample, end)) {
+                sample = nextLine(sample, end);
+                continue;
+            }
+            if (parseLine(sample, end, values, Layout::MaxColumns) != 6) {
+                continue;
+            }
+            for (int c = 3; c < 6; ++c) {
+                integerColors = integerColors && values[c] >= 0.f && values[c] <= 255.f && values[c] == std::floor(values[c]);
+            }
+        }
+        for (int c = 0; c < 3; ++c) {
+            (integerColors ? layout.color : layout.normal)[c] = 3 + c;
+        }
+        break;
+    }
+    case 7:
+        layout.color[0] = 4;
+        layout.color[1] = 5;
+        layout.color[2] = 6;
+        break;
+    case 9:
+        for (int c = 0; c < 3; ++c) {
+            layout.color[c] = 3 + c;
+            layout.normal[c] = 6 + c;
+        }
+        break;
+    default:
+        if (columns < 3) {
+            qWarning("Point cloud line with %u columns", columns);
+            return false;
+        }
+        layout.columns = 3; // unknown meaning of other columns
+        break;
+    }
+
+    mStats.invalidLines = parseColumnLines(p, end, mUsedThreads, ~0ull, layout, data);
+    return true;
+}
@@ -0,0 +1,86 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "PointCloudData.hpp"
+#include <string>
+
+///
+/// Loader of PLY (ascii, binary little/big endian), XYZ and PTS point clouds.
+/// File is memory mapped. Binary PLY vertices are gathered straight into PointCloudData arrays by all threads.
+/// ASCII files are split at line boundaries and parsed in parallel - first pass counts lines, second pass
+/// parses them into their final place, so there is no merge of partial results.
+///
+/// XYZ/PTS columns (separated by spaces, tabs, commas or semicolons):
+///     3 - x y z
+///     4 - x y z intensity (PTS: -2048..2047 as gray, XYZ: ignored)
+///     6 - x y z r g b (0..255 integers) or x y z nx ny nz
+///     7 - x y z intensity r g b
+///     9 - x y z r g b nx ny nz
+/// PTS file starts with point count line, it is skipped.
+///
+class PointCloudLoader
+{
+public:
+    enum Format {
+        FormatUnknown, // decided by file extension
+        FormatPly,
+        FormatXyz,
+        FormatPts,
+    };
+
+    struct Stats {
+        uint64_t bytes = 0;
+        uint64_t points = 0;
+        uint64_t invalidLines = 0; // ASCII lines with less columns than expected - missing values are 0
+        uint32_t threads = 0;
+        double seconds = 0.0;      // map + parse
+
+        double megabytesPerSecond() const { return seconds > 0.0 ? bytes / (1024.0 * 1024.0) / seconds : 0.0; }
+        double pointsPerSecond() const { return seconds > 0.0 ? points / seconds : 0.0; }
+    };
+
+    static Format formatFromPath(const std::string& path);
+
+    ///
+    /// 0 - std::thread::hardware_concurrency()
+    ///
+    void setThreadCount(uint32_t threads) { mThreadCount = threads; }
+
+    ///
+    /// Previous content of data is replaced. Returns false if file can't be read or format is not supported.
+    ///
+    bool load(const std::string& path, PointCloudData& data, Format format = FormatUnknown);
+
+    const Stats& stats() const { return mStats; }
+
+protected:
+    bool loadPly(const char* begin, const char* end, PointCloudData& data);
+    bool loadColumns(const char* begin, const char* end, bool ptsHeader, PointCloudData& data);
+
+    uint32_t mThreadCount = 0;
+    uint32_t mUsedThreads = 1;
+    Stats mStats;
+};
@@ -0,0 +1,64 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "OctreeConverter.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+///
+/// Converts PLY/XYZ/PTS point cloud into native octree file (*.pco).
+/// Usage: scan_convert INPUT OUTPUT.pco [--max-points N] [--grid-bits N] [--max-depth N] [--threads N]
+///
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        printf("Usage: scan_convert INPUT OUTPUT.pco [--max-points N] [--grid-bits N] [--max-depth N] [--threads N]\n");
+        return 1;
+    }
+    OctreeConverter::Settings settings;
+    for (int i = 3; i + 1 < argc; i += 2) {
+        uint32_t value = static_cast<uint32_t>(std::strtoul(argv[i + 1], nullptr, 10));
+        if (strcmp(argv[i], "--max-points") == 0) {
+            settings.maxPointsPerNode = std::max(1u, value);
+        }
+        else if (strcmp(argv[i], "--grid-bits") == 0) {
+            settings.sampleGridBits = value;
+        }
+        else if (strcmp(argv[i], "--max-depth") == 0) {
+            settings.maxDepth = value;
+        }
+        else if (strcmp(argv[i], "--threads") == 0) {
+            settings.threads = value;
+        }
+        else {
+            printf("Unknown option: %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    OctreeConverter converter;
+    converter.setSettings(settings);
+    return converter.convert(argv[1], argv[2]) ? 0 : 1;
+}
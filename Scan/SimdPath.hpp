@@ -0,0 +1,94 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__)
+#define SIMD_X86 1
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__)) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_NEON 1
+#endif
+
+#if defined(SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define SIMD_AVX2 1 // compiled with target attribute, used only when CPU supports it
+#endif
+
+///
+/// Instruction set of vectorized code paths of Scan library - AVX2 is detected at runtime,
+/// NEON is always present on targets compiled with it.
+///
+namespace Simd
+{
+
+enum Path {
+    Auto,
+    Scalar,
+    Avx2,
+    Neon,
+};
+
+inline bool isSupported(Path path)
+{
+    switch (path) {
+    case Auto:
+    case Scalar: return true;
+#if defined(SIMD_AVX2)
+    case Avx2: return __builtin_cpu_supports("avx2");
+#endif
+#if defined(SIMD_NEON)
+    case Neon: return true;
+#endif
+    default: break;
+    }
+    return false;
+}
+
+///
+/// Auto or not supported path - the best available one
+///
+inline Path resolve(Path path)
+{
+    if (path == Auto || !isSupported(path)) {
+        static const Path bestFirst[] = {Avx2, Neon, Scalar};
+        for (Path candidate : bestFirst) {
+            if (isSupported(candidate)) {
+                return candidate;
+            }
+        }
+    }
+    return path;
+}
+
+inline const char* name(Path path)
+{
+    switch (path) {
+    case Auto:   return "auto";
+    case Scalar: return "scalar";
+    case Avx2:   return "AVX2";
+    case Neon:   return "NEON";
+    }
+    return "unknown";
+}
+
+}
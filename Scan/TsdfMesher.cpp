@@ -0,0 +1,535 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "TsdfMesher.hpp"
+#include "TsdfVolume.hpp"
+#include <WorkStealingPool.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+const uint32_t TsdfMesher::PageVertices;
+const uint32_t TsdfMesher::PageTriangles;
+
+namespace {
+
+const int BlockSize = TsdfVolume::BlockSize;
+const int Padded = BlockSize + 1;            // block voxels and the first layer of upper neighbours
+const int PaddedVoxels = Padded * Padded * Padded;
+const int PaddedStride[3] = {1, Padded, Padded * Padded};
+const int BlockEdges = TsdfVolume::BlockVoxels * 3;
+const uint16_t NoVertex = 0xffff;
+const size_t MeshGrain = 2;                  // blocks
+
+//
+// Marching cubes tables
+// Corner c of cube is at (c & 1, (c >> 1) & 1, (c >> 2) & 1), edge e goes along axis e / 4 from corner edgeCorner[e].
+// Instead of classic hand written table triangles are generated: on every cube face the inside corners are cut off
+// by segments (inside corners are always separated on ambiguous faces), segments of all faces chain into closed
+// polygons which are fanned into triangles. Both cubes sharing a face cut it the same way, so the surface is watertight.
+//
+const int MaxCaseTriangles = 12;
+
+struct CubeTables {
+    uint8_t edgeAxis[12];
+    uint8_t edgeCorner[12];
+    uint8_t triangleCount[256];
+    uint8_t triangleEdges[256][MaxCaseTriangles * 3];
+
+    CubeTables();
+    int edgeBetween(int corner0, int corner1) const;
+};
+
+CubeTables::CubeTables()
+{
+    for (int e = 0; e < 12; ++e) {
+        int axis = e / 4;
+        int u = (axis + 1) % 3;
+        int v = (axis + 2) % 3;
+        edgeAxis[e] = static_cast<uint8_t>(axis);
+        edgeCorner[e] = static_cast<uint8_t>(((e & 1) << u) | (((e >> 1) & 1) << v));
+    }
+
+    for (int cube = 0; cube < 256; ++cube) {
+        auto inside = [cube](int corner) { return ((cube >> corner) & 1) != 0; };
+
+        // segment of face polygon: from edge where face walk enters inside corners to edge where it leaves them
+        int next[12];
+        std::fill(next, next + 12, -1);
+        for (int axis = 0; axis < 3; ++axis) {
+            int u = (axis + 1) % 3;
+            int v = (axis + 2) % 3;
+            for (int side = 0; side < 2; ++side) {
+                // face corners counter clockwise seen from outside of the cube
+                static const int Ccw[2][4][2] = {{{0, 0}, {0, 1}, {1, 1}, {1, 0}}, {{0, 0}, {1, 0}, {1, 1}, {0, 1}}};
+                int corners[4];
+                for (int i = 0; i < 4; ++i) {
+                    corners[i] = (side << axis) | (Ccw[side][i][0] << u) | (Ccw[side][i][1] << v);
+                }
+                for (int k = 0; k < 4; ++k) {
+                    if (inside(corners[k]) || !inside(corners[(k + 1) % 4])) {
+                        continue;
+                    }
+                    int last = (k + 1) % 4; // the last inside corner of the run - corners[k] is outside, so the run ends
+                    while (inside(corners[(last + 1) % 4])) {
+                        last = (last + 1) % 4;
+                    }
+                    next[edgeBetween(corners[k], corners[(k + 1) % 4])] = edgeBetween(corners[last], corners[(last + 1) % 4]);
+                }
+            }
+        }
+
+        int triangles = 0;
+        bool used[12] = {};
+        for (int first = 0; first < 12; ++first) {
+            if (next[first] < 0 || used[first]) {
+                continue;
+            }
+            int polygon[12];
+            int size = 0;
+            for (int e = first; !used[e]; e = next[e]) {
+                used[e] = true;
+                polygon[size++] = e;
+            }
+            for (int i = 1; i + 1 < size; ++i) {
+                triangleEdges[cube][triangles * 3 + 0] = static_cast<uint8_t>(polygon[0]);
+                triangleEdges[cube][triangles * 3 + 1] = static_cast<uint8_t>(polygon[i]);
+                triangleEdges[cube][triangles * 3 + 2] = static_cast<uint8_t>(polygon[i + 1]);
+                ++triangles;
+            }
+        }
+        triangleCount[cube] = static_cast<uint8_t>(triangles);
+    }
+}
+
+int CubeTables::edgeBetween(int corner0, int corner1) const
+{
+    int axis = (corner0 ^ corner1) == 1 ? 0 : ((corner0 ^ corner1) == 2 ? 1 : 2);
+    int lower = std::min(corner0, corner1);
+    for (int e = axis * 4; e < axis * 4 + 4; ++e) {
+        if (edgeCorner[e] == lower) {
+            return e;
+        }
+    }
+    return -1;
+}
+
+const CubeTables& cubeTables()
+{
+    static const CubeTables tables;
+    return tables;
+}
+
+inline uint16_t edgeId(int x, int y, int z, int axis)
+{
+    return static_cast<uint16_t>(((z * BlockSize + y) * BlockSize + x) * 3 + axis);
+}
+
+///
+/// Voxels of block and first layer of its upper neighbours - [x + y * Padded + z * Padded^2], x, y, z in 0..BlockSize
+///
+struct Neighborhood {
+    int16_t sdf[PaddedVoxels];
+    uint8_t weight[PaddedVoxels];
+    uint32_t color[PaddedVoxels];
+    uint32_t blocks[8]; // bit 0 - +x neighbour, bit 1 - +y, bit 2 - +z, TsdfVolume::InvalidBlock - not allocated
+    bool hasColors;
+};
+
+void gather(const TsdfVolume& volume, uint32_t blockIdx, Neighborhood& n)
+{
+    const glm::ivec3 coord = volume.blockCoord(blockIdx);
+    n.hasColors = volume.blockColors(blockIdx) != nullptr;
+    for (int neighbor = 0; neighbor < 8; ++neighbor) {
+        int nx = neighbor & 1;
+        int ny = (neighbor >> 1) & 1;
+        int nz = (neighbor >> 2) & 1;
+        uint32_t block = neighbor ? volume.findBlock(coord + glm::ivec3(nx, ny, nz)) : blockIdx;
+        n.blocks[neighbor] = block;
+        const int16_t* sdf = block != TsdfVolume::InvalidBlock ? volume.blockSdf(block) : nullptr;
+        const uint8_t* weights = sdf ? volume.blockWeights(block) : nullptr;
+        const uint8_t* colors = sdf ? volume.blockColors(block) : nullptr;
+        for (int z = nz * BlockSize; z < (nz ? Padded : BlockSize); ++z) {
+            for (int y = ny * BlockSize; y < (ny ? Padded : BlockSize); ++y) {
+                for (int x = nx * BlockSize; x < (nx ? Padded : BlockSize); ++x) {
+                    int idx = x + y * Padded + z * Padded * Padded;
+                    int local = (x - nx * BlockSize) + (y - ny * BlockSize) * BlockSize + (z - nz * BlockSize) * BlockSize * BlockSize;
+                    if (!sdf) {
+                        n.sdf[idx] = TsdfVolume::SdfMax;
+                        n.weight[idx] = 0;
+                        n.color[idx] = 0;
+                        continue;
+                    }
+                    n.sdf[idx] = sdf[local];
+                    n.weight[idx] = weights[local];
+                    n.color[idx] = colors ? (0xff000000u | colors[local * 3] | (colors[local * 3 + 1] << 8) | (colors[local * 3 + 2] << 16)) : 0;
+                }
+            }
+        }
+    }
+}
+
+///
+/// Gradient of trilinear interpolation inside cube with lower corner idx at point of its edge from that corner
+/// (t along axis) - vertex normal computed only from the cube owning the vertex, the same for all blocks using it
+///
+glm::vec3 edgeGradient(const Neighborhood& n, int idx, int axis, float t)
+{
+    float corners[8];
+    for (int c = 0; c < 8; ++c) {
+        int cornerIdx = idx + (c & 1) * PaddedStride[0] + ((c >> 1) & 1) * PaddedStride[1] + ((c >> 2) & 1) * PaddedStride[2];
+        if (n.weight[cornerIdx] == 0) {
+            // cube not observed - only direction along the edge is known
+            glm::vec3 gradient(0.f);
+            gradient[axis] = static_cast<float>(n.sdf[idx + PaddedStride[axis]] - n.sdf[idx]);
+            return gradient;
+        }
+        corners[c] = n.sdf[cornerIdx];
+    }
+    float point[3] = {0.f, 0.f, 0.f};
+    point[axis] = t;
+    glm::vec3 gradient(0.f);
+    for (int d = 0; d < 3; ++d) {
+        for (int c = 0; c < 8; ++c) {
+            if (c & (1 << d)) {
+                continue;
+            }
+            float w = 1.f;
+            for (int e = 0; e < 3; ++e) {
+                if (e != d) {
+                    w *= (c & (1 << e)) ? point[e] : 1.f - point[e];
+                }
+            }
+            gradient[d] += (corners[c | (1 << d)] - corners[c]) * w;
+        }
+    }
+    return gradient;
+}
+
+inline uint32_t lerpColor(uint32_t a, uint32_t b, float t)
+{
+    uint32_t result = 0;
+    for (int c = 0; c < 4; ++c) {
+        float ca = static_cast<float>((a >> (8 * c)) & 0xff);
+        float cb = static_cast<float>((b >> (8 * c)) & 0xff);
+        result |= static_cast<uint32_t>(ca + (cb - ca) * t + 0.5f) << (8 * c);
+    }
+    return result;
+}
+
+}
+
+struct TsdfMesher::Scratch {
+    std::vector<uint16_t> vertexEdges;
+    std::vector<glm::vec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> colors;
+    std::vector<uint32_t> indices;
+};
+
+TsdfMesher::TsdfMesher(uint32_t threads)
+    : mPool(new WorkStealingPool(threads))
+{
+    cubeTables(); // built once, before threads use them
+}
+
+TsdfMesher::~TsdfMesher()
+{
+}
+
+void TsdfMesher::reset()
+{
+    mMesh = Mesh();
+    mStats = Stats();
+    mBlocks.clear();
+    mBlockStamps.clear();
+    mMeshedBlocks.clear();
+    mLastFrame = 0;
+    mFreeVertexPages.clear();
+    mFreeIndexPages.clear();
+    mVertexPageCount = 0;
+    mIndexPageCount = 0;
+    mChangedVertexPages.clear();
+    mChangedIndexPages.clear();
+}
+
+void TsdfMesher::collectBlocks(const TsdfVolume& volume)
+{
+    // Block voxels are used by its cubes and cubes of its 7 lower neighbours. Vertices of those neighbours may change,
+    // so their lower neighbours refer to new vertex indices too - re-mesh offsets 0, -1, -2 in every axis.
+    mMeshedBlocks.clear();
+    ++mStamp;
+    uint32_t blocks = volume.blockCount();
+    for (uint32_t blockIdx = 0; blockIdx < blocks; ++blockIdx) {
+        if (volume.blockUpdateFrame(blockIdx) <= mLastFrame) {
+            continue;
+        }
+        ++mStats.updatedBlocks;
+        const glm::ivec3 coord = volume.blockCoord(blockIdx);
+        for (int dz = 0; dz > -3; --dz) {
+            for (int dy = 0; dy > -3; --dy) {
+                for (int dx = 0; dx > -3; --dx) {
+                    uint32_t neighbor = (dx || dy || dz) ? volume.findBlock(coord + glm::ivec3(dx, dy, dz)) : blockIdx;
+                    if (neighbor != TsdfVolume::InvalidBlock && mBlockStamps[neighbor] != mStamp) {
+                        mBlockStamps[neighbor] = mStamp;
+                        mMeshedBlocks.push_back(neighbor);
+                    }
+                }
+            }
+        }
+    }
+    std::sort(mMeshedBlocks.begin(), mMeshedBlocks.end());
+}
+
+bool TsdfMesher::extract(const TsdfVolume& volume)
+{
+    auto start = std::chrono::steady_clock::now();
+    uint32_t frame = volume.stats().frame;
+    if (volume.clearCount() != mVolumeClearCount) {
+        reset(); // block indices of cleared volume refer to other blocks
+        mVolumeClearCount = volume.clearCount();
+    }
+    Stats previous = mStats;
+    mStats = Stats();
+    mStats.threads = mPool->threadCount();
+    mChangedVertexPages.clear();
+    mChangedIndexPages.clear();
+    mBlocks.resize(volume.blockCount());
+    mBlockStamps.resize(volume.blockCount(), 0);
+
+    collectBlocks(volume);
+    mLastFrame = frame;
+    mStats.meshedBlocks = static_cast<uint32_t>(mMeshedBlocks.size());
+    mStats.vertices = previous.vertices;
+    mStats.triangles = previous.triangles;
+    if (mMeshedBlocks.empty()) {
+        mStats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return false;
+    }
+    while (mScratch.size() < mMeshedBlocks.size()) {
+        mScratch.emplace_back(new Scratch());
+    }
+
+    // 1. Vertices of owned edges
+    mPool->parallelFor(mMeshedBlocks.size(), MeshGrain, [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+        for (size_t i = first; i < last; ++i) {
+            buildVertices(volume, mMeshedBlocks[i], *mScratch[i]);
+        }
+    });
+
+    // 2. Vertex pages - blocks which were not re-meshed keep theirs, so their triangles stay valid
+    const bool hasColors = volume.settings().colors;
+    for (size_t i = 0; i < mMeshedBlocks.size(); ++i) {
+        BlockMesh& block = mBlocks[mMeshedBlocks[i]];
+        Scratch& scratch = *mScratch[i];
+        mStats.vertices += static_cast<uint32_t>(scratch.vertexEdges.size()) - static_cast<uint32_t>(block.vertexEdges.size());
+        block.vertexEdges.swap(scratch.vertexEdges);
+        uint32_t pages = static_cast<uint32_t>((block.vertexEdges.size() + PageVertices - 1) / PageVertices);
+        resizePages(block.vertexPages, pages, mFreeVertexPages, mVertexPageCount);
+        mChangedVertexPages.insert(mChangedVertexPages.end(), block.vertexPages.begin(), block.vertexPages.end());
+    }
+    size_t vertexCapacity = size_t(mVertexPageCount) * PageVertices;
+    mMesh.positions.resize(vertexCapacity);
+    mMesh.normals.resize(vertexCapacity);
+    mMesh.colors.resize(hasColors ? vertexCapacity : 0);
+
+    // 3. Copy vertices into pages and build triangles - they refer to vertices of neighbours, which are final now
+    mPool->parallelFor(mMeshedBlocks.size(), MeshGrain, [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+        for (size_t i = first; i < last; ++i) {
+            const BlockMesh& block = mBlocks[mMeshedBlocks[i]];
+            const Scratch& scratch = *mScratch[i];
+            for (size_t v = 0; v < scratch.positions.size(); v += PageVertices) {
+                size_t count = std::min<size_t>(PageVertices, scratch.positions.size() - v);
+                size_t target = size_t(block.vertexPages[v / PageVertices]) * PageVertices;
+                std::copy(scratch.positions.begin() + v, scratch.positions.begin() + v + count, mMesh.positions.begin() + target);
+                std::copy(scratch.normals.begin() + v, scratch.normals.begin() + v + count, mMesh.normals.begin() + target);
+                if (hasColors) {
+                    std::copy(scratch.colors.begin() + v, scratch.colors.begin() + v + count, mMesh.colors.begin() + target);
+                }
+            }
+            buildTriangles(volume, mMeshedBlocks[i], *mScratch[i]);
+        }
+    });
+
+    // 4. Index pages - released pages become degenerate triangles
+    for (size_t i = 0; i < mMeshedBlocks.size(); ++i) {
+        BlockMesh& block = mBlocks[mMeshedBlocks[i]];
+        uint32_t triangles = static_cast<uint32_t>(mScratch[i]->indices.size() / 3);
+        mStats.triangles += triangles - block.triangles;
+        block.triangles = triangles;
+        size_t freeBefore = mFreeIndexPages.size();
+        uint32_t pages = (triangles + PageTriangles - 1) / PageTriangles;
+        resizePages(block.indexPages, pages, mFreeIndexPages, mIndexPageCount);
+        mMesh.indices.resize(size_t(mIndexPageCount) * PageTriangles * 3, 0);
+        for (size_t p = freeBefore; p < mFreeIndexPages.size(); ++p) {
+            auto page = mMesh.indices.begin() + size_t(mFreeIndexPages[p]) * PageTriangles * 3;
+            std::fill(page, page + PageTriangles * 3, 0);
+            mChangedIndexPages.push_back(mFreeIndexPages[p]);
+        }
+        mChangedIndexPages.insert(mChangedIndexPages.end(), block.indexPages.begin(), block.indexPages.end());
+    }
+
+    mPool->parallelFor(mMeshedBlocks.size(), MeshGrain, [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+        for (size_t i = first; i < last; ++i) {
+            const BlockMesh& block = mBlocks[mMeshedBlocks[i]];
+            const std::vector<uint32_t>& indices = mScratch[i]->indices;
+            for (size_t p = 0; p < block.indexPages.size(); ++p) {
+                size_t begin = p * PageTriangles * 3;
+                size_t count = std::min<size_t>(PageTriangles * 3, indices.size() - begin);
+                auto target = mMesh.indices.begin() + size_t(block.indexPages[p]) * PageTriangles * 3;
+                std::copy(indices.begin() + begin, indices.begin() + begin + count, target);
+                std::fill(target + count, target + PageTriangles * 3, 0);
+            }
+        }
+    });
+
+    mStats.changedVertexPages = static_cast<uint32_t>(mChangedVertexPages.size());
+    mStats.changedIndexPages = static_cast<uint32_t>(mChangedIndexPages.size());
+    mStats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void TsdfMesher::resizePages(std::vector<uint32_t>& pages, uint32_t count, std::vector<uint32_t>& freePages, uint32_t& pageCount)
+{
+    while (pages.size() > count) {
+        freePages.push_back(pages.back());
+        pages.pop_back();
+    }
+    while (pages.size() < count) {
+        if (!freePages.empty()) {
+            pages.push_back(freePages.back());
+            freePages.pop_back();
+        }
+        else {
+            pages.push_back(pageCount++);
+        }
+    }
+}
+
+uint32_t TsdfMesher::globalVertex(uint32_t blockIdx, uint16_t edge) const
+{
+    const BlockMesh& block = mBlocks[blockIdx];
+    auto found = std::lower_bound(block.vertexEdges.begin(), block.vertexEdges.end(), edge);
+    if (found == block.vertexEdges.end() || *found != edge) {
+        return ~0u;
+    }
+    uint32_t local = static_cast<uint32_t>(found - block.vertexEdges.begin());
+    return block.vertexPages[local / PageVertices] * PageVertices + local % PageVertices;
+}
+
+void TsdfMesher::buildVertices(const TsdfVolume& volume, uint32_t blockIdx, Scratch& scratch) const
+{
+    Neighborhood n;
+    gather(volume, blockIdx, n);
+
+    scratch.vertexEdges.clear();
+    scratch.positions.clear();
+    scratch.normals.clear();
+    scratch.colors.clear();
+
+    const float voxelSize = volume.settings().voxelSize;
+    const glm::vec3 origin = volume.blockOrigin(blockIdx) + glm::vec3(0.5f * voxelSize);
+    for (int z = 0; z < BlockSize; ++z) {
+        for (int y = 0; y < BlockSize; ++y) {
+            for (int x = 0; x < BlockSize; ++x) {
+                int idx = x + y * Padded + z * Padded * Padded;
+                if (n.weight[idx] == 0) {
+                    continue;
+                }
+                float sdf0 = n.sdf[idx];
+                for (int axis = 0; axis < 3; ++axis) {
+                    int idx1 = idx + PaddedStride[axis];
+                    float sdf1 = n.sdf[idx1];
+                    if (n.weight[idx1] == 0 || (sdf0 < 0.f) == (sdf1 < 0.f)) {
+                        continue;
+                    }
+                    float t = sdf0 / (sdf0 - sdf1);
+                    glm::vec3 position = origin + glm::vec3(x, y, z) * voxelSize;
+                    position[axis] += t * voxelSize;
+                    glm::vec3 gradient = edgeGradient(n, idx, axis, t);
+                    float length = glm::length(gradient);
+                    glm::vec3 normal(0.f);
+                    normal[axis] = sdf1 > sdf0 ? 1.f : -1.f;
+
+                    scratch.vertexEdges.push_back(edgeId(x, y, z, axis));
+                    scratch.positions.push_back(position);
+                    scratch.normals.push_back(length > 0.f ? gradient / length : normal);
+                    if (n.hasColors) {
+                        scratch.colors.push_back(lerpColor(n.color[idx], n.color[idx1], t));
+                    }
+                }
+            }
+        }
+    }
+}
+
+void TsdfMesher::buildTriangles(const TsdfVolume& volume, uint32_t blockIdx, Scratch& scratch) const
+{
+    Neighborhood n;
+    gather(volume, blockIdx, n);
+    const CubeTables& tables = cubeTables();
+
+    // own vertices by edge, neighbours' through their sorted edge lists
+    const BlockMesh& block = mBlocks[blockIdx];
+    uint32_t ownVertices[BlockEdges];
+    std::fill(ownVertices, ownVertices + BlockEdges, ~0u);
+    for (uint32_t i = 0; i < block.vertexEdges.size(); ++i) {
+        ownVertices[block.vertexEdges[i]] = block.vertexPages[i / PageVertices] * PageVertices + i % PageVertices;
+    }
+
+    scratch.indices.clear();
+    for (int z = 0; z < BlockSize; ++z) {
+        for (int y = 0; y < BlockSize; ++y) {
+            for (int x = 0; x < BlockSize; ++x) {
+                int idx = x + y * Padded + z * Padded * Padded;
+                int cube = 0;
+                bool observed = true;
+                for (int c = 0; c < 8; ++c) {
+                    int cornerIdx = idx + (c & 1) * PaddedStride[0] + ((c >> 1) & 1) * PaddedStride[1] + ((c >> 2) & 1) * PaddedStride[2];
+                    observed = observed && n.weight[cornerIdx] != 0;
+                    cube |= (n.sdf[cornerIdx] < 0 ? 1 : 0) << c;
+                }
+                if (!observed || tables.triangleCount[cube] == 0) {
+                    continue;
+                }
+                for (int tri = 0; tri < tables.triangleCount[cube]; ++tri) {
+                    uint32_t vertices[3];
+                    for (int k = 0; k < 3; ++k) {
+                        int e = tables.triangleEdges[cube][tri * 3 + k];
+                        int corner = tables.edgeCorner[e];
+                        int vx = x + (corner & 1);
+                        int vy = y + ((corner >> 1) & 1);
+                        int vz = z + ((corner >> 2) & 1);
+                        int neighbor = (vx / BlockSize) | ((vy / BlockSize) << 1) | ((vz / BlockSize) << 2);
+                        uint16_t edge = edgeId(vx % BlockSize, vy % BlockSize, vz % BlockSize, tables.edgeAxis[e]);
+                        vertices[k] = neighbor ? globalVertex(n.blocks[neighbor], edge) : ownVertices[edge];
+                    }
+                    if (vertices[0] != ~0u && vertices[1] != ~0u && vertices[2] != ~0u) {
+                        scratch.indices.insert(scratch.indices.end(), vertices, vertices + 3);
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,135 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class TsdfVolume;
+class WorkStealingPool;
+
+///
+/// Incremental marching cubes over blocks of TsdfVolume. Only blocks updated since the previous extract() are re-meshed,
+/// together with their lower neighbours whose cubes reach into them - cost follows the change, not the volume size.
+/// Every vertex belongs to the block owning lower end of its voxel edge, cubes on block border refer to vertices
+/// of neighbour blocks, so the mesh has no duplicated vertices and no cracks between blocks.
+///
+/// Result is one mesh in arrays ready for shared vertex/index buffers (SoA like PointCloudData, indices are 32 bit
+/// and global - vertexOffset 0). Arrays are divided into pages of PageVertices vertices and PageTriangles triangles,
+/// block owns whole pages, so changed part of the mesh is uploaded per page (see changedVertexPages()).
+/// Unused triangles are degenerate (0, 0, 0), whole index array can be drawn with one call.
+///
+class TsdfMesher
+{
+public:
+    static const uint32_t PageVertices = 64;
+    static const uint32_t PageTriangles = 64;
+
+    struct Mesh {
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> normals;  // unit, pointing out of surface (to positive distance)
+        std::vector<uint32_t> colors;    // RGBA8 - red in the lowest byte, empty when volume has no colors
+        std::vector<uint32_t> indices;   // counter clockwise triangles seen from outside
+    };
+
+    struct Stats {
+        uint32_t updatedBlocks = 0;   // blocks changed since previous extract
+        uint32_t meshedBlocks = 0;    // including neighbours which refer to changed blocks
+        uint32_t vertices = 0;        // whole mesh
+        uint32_t triangles = 0;
+        uint32_t changedVertexPages = 0;
+        uint32_t changedIndexPages = 0;
+        uint32_t threads = 0;
+        double ms = 0.0;
+    };
+
+    ///
+    /// threads - 0 hardware concurrency
+    ///
+    explicit TsdfMesher(uint32_t threads = 0);
+    ~TsdfMesher();
+
+    ///
+    /// Re-mesh blocks updated since previous call - first call (or after volume was cleared) meshes everything.
+    /// Returns true if mesh changed.
+    ///
+    bool extract(const TsdfVolume& volume);
+
+    ///
+    /// Forget mesh - next extract() meshes whole volume
+    ///
+    void reset();
+
+    const Mesh& mesh() const { return mMesh; }
+
+    ///
+    /// Pages written by last extract() - vertices [page * PageVertices, (page + 1) * PageVertices),
+    /// indices [page * PageTriangles * 3, (page + 1) * PageTriangles * 3)
+    ///
+    const std::vector<uint32_t>& changedVertexPages() const { return mChangedVertexPages; }
+    const std::vector<uint32_t>& changedIndexPages() const { return mChangedIndexPages; }
+
+    const Stats& stats() const { return mStats; }
+
+    TsdfMesher(const TsdfMesher&) = delete;
+    TsdfMesher& operator=(const TsdfMesher&) = delete;
+
+protected:
+    struct BlockMesh {
+        std::vector<uint16_t> vertexEdges; // sorted local edge ids ((z * 8 + y) * 8 + x) * 3 + axis of block vertices
+        std::vector<uint32_t> vertexPages;
+        std::vector<uint32_t> indexPages;
+        uint32_t triangles = 0;
+    };
+
+    struct Scratch; // per meshed block results between phases
+
+    void collectBlocks(const TsdfVolume& volume);
+    void buildVertices(const TsdfVolume& volume, uint32_t blockIdx, Scratch& scratch) const;
+    void buildTriangles(const TsdfVolume& volume, uint32_t blockIdx, Scratch& scratch) const;
+    uint32_t globalVertex(uint32_t blockIdx, uint16_t edge) const;
+    void resizePages(std::vector<uint32_t>& pages, uint32_t count, std::vector<uint32_t>& freePages, uint32_t& pageCount);
+
+    std::unique_ptr<WorkStealingPool> mPool;
+    Mesh mMesh;
+    Stats mStats;
+
+    std::vector<BlockMesh> mBlocks;          // [volume blockIdx]
+    std::vector<uint32_t> mMeshedBlocks;     // blocks re-meshed by current extract
+    std::vector<uint32_t> mBlockStamps;      // [volume blockIdx] - extract which added block to mMeshedBlocks
+    std::vector<std::unique_ptr<Scratch>> mScratch; // [mMeshedBlocks idx]
+    uint32_t mStamp = 0;
+    uint32_t mLastFrame = 0;                 // volume frame meshed by previous extract
+    uint32_t mVolumeClearCount = 0;          // TsdfVolume::clearCount() meshed by previous extract
+
+    std::vector<uint32_t> mFreeVertexPages;
+    std::vector<uint32_t> mFreeIndexPages;
+    uint32_t mVertexPageCount = 0;
+    uint32_t mIndexPageCount = 0;
+    std::vector<uint32_t> mChangedVertexPages;
+    std::vector<uint32_t> mChangedIndexPages;
+};
@@ -0,0 +1,427 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#include "TsdfVolume.hpp"
+#include "Parallel.hpp"
+#include <WorkStealingPool.hpp>
+#include <QtGlobal>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+const int TsdfVolume::BlockSize;
+const int TsdfVolume::BlockVoxels;
+const uint32_t TsdfVolume::InvalidBlock;
+const int16_t TsdfVolume::SdfMax;
+
+namespace {
+
+const uint64_t EmptyKey = ~0ull;
+const int32_t KeyBits = 21;                 // per axis - +-1M blocks
+const int32_t KeyOffset = 1 << (KeyBits - 1);
+const uint64_t KeyMask = (1ull << KeyBits) - 1;
+const uint32_t RayStride = 2;               // blocks are tens of pixels big, every second ray in both directions finds them
+const size_t IntegrateGrain = 4;            // blocks
+const size_t CollectGrain = 4;              // rows
+
+inline uint64_t packKey(int32_t x, int32_t y, int32_t z)
+{
+    return (uint64_t(x + KeyOffset) & KeyMask) | ((uint64_t(y + KeyOffset) & KeyMask) << KeyBits)
+         | ((uint64_t(z + KeyOffset) & KeyMask) << (2 * KeyBits));
+}
+
+inline glm::ivec3 unpackKey(uint64_t key)
+{
+    return glm::ivec3(static_cast<int32_t>(key & KeyMask) - KeyOffset,
+                      static_cast<int32_t>((key >> KeyBits) & KeyMask) - KeyOffset,
+                      static_cast<int32_t>((key >> (2 * KeyBits)) & KeyMask) - KeyOffset);
+}
+
+inline size_t hashKey(uint64_t key)
+{
+    key ^= key >> 31;
+    key *= 0x7fb5d329728ea185ull;
+    key ^= key >> 27;
+    return static_cast<size_t>(key);
+}
+
+///
+/// Adds key to open addressing set (power of two capacity), grows it at half load
+///
+void insertKey(std::vector<uint64_t>& set, uint32_t& count, uint64_t key)
+{
+    size_t mask = set.size() - 1;
+    for (size_t slot = hashKey(key) & mask;; slot = (slot + 1) & mask) {
+        if (set[slot] == key) {
+            return;
+        }
+        if (set[slot] == EmptyKey) {
+            set[slot] = key;
+            break;
+        }
+    }
+    if (++count * 2 > set.size()) {
+        std::vector<uint64_t> old(set.size() * 2, EmptyKey);
+        old.swap(set);
+        count = 0;
+        for (uint64_t oldKey : old) {
+            if (oldKey != EmptyKey) {
+                insertKey(set, count, oldKey);
+            }
+        }
+    }
+}
+
+inline float depthValue(uint16_t value, float scale) { return value * scale; }
+inline float depthValue(float value, float scale) { return value * scale; }
+
+}
+
+TsdfVolume::TsdfVolume()
+{
+    setSettings(Settings());
+}
+
+TsdfVolume::~TsdfVolume()
+{
+}
+
+void TsdfVolume::setSettings(const Settings& settings)
+{
+    uint32_t threads = Parallel::threadCount(settings.threads);
+    if (!mPool || mPool->threadCount() != threads) {
+        mPool.reset(new WorkStealingPool(threads));
+    }
+    mSettings = settings;
+    mSettings.voxelSize = std::max(mSettings.voxelSize, 1e-4f);
+    mSettings.truncation = std::max(mSettings.truncation, mSettings.voxelSize);
+    mSettings.maxWeight = std::max<uint8_t>(mSettings.maxWeight, 1);
+    clear();
+}
+
+void TsdfVolume::clear()
+{
+    ++mClearCount;
+    mStats = Stats();
+    mHashKeys.assign(1024, EmptyKey);
+    mHashBlocks.assign(1024, InvalidBlock);
+    mBlockCoords.clear();
+    mBlockUpdateFrames.clear();
+    mSdf.clear();
+    mWeights.clear();
+    mColors.clear();
+    mFrameBlocks.clear();
+}
+
+uint32_t TsdfVolume::findBlock(const glm::ivec3& blockCoord) const
+{
+    uint64_t key = packKey(blockCoord.x, blockCoord.y, blockCoord.z);
+    size_t mask = mHashKeys.size() - 1;
+    for (size_t slot = hashKey(key) & mask; mHashKeys[slot] != EmptyKey; slot = (slot + 1) & mask) {
+        if (mHashKeys[slot] == key) {
+            return mHashBlocks[slot];
+        }
+    }
+    return InvalidBlock;
+}
+
+const uint8_t* TsdfVolume::blockColors(uint32_t blockIdx) const
+{
+    return mSettings.colors ? mColors.data() + size_t(blockIdx) * BlockVoxels * 3 : nullptr;
+}
+
+uint64_t TsdfVolume::memoryBytes() const
+{
+    return mSdf.capacity() * sizeof(int16_t) + mWeights.capacity() + mColors.capacity()
+         + mBlockCoords.capacity() * sizeof(glm::ivec3) + mBlockUpdateFrames.capacity() * sizeof(uint32_t)
+         + mHashKeys.capacity() * sizeof(uint64_t) + mHashBlocks.capacity() * sizeof(uint32_t);
+}
+
+uint32_t TsdfVolume::insertBlock(const glm::ivec3& blockCoord)
+{
+    uint64_t key = packKey(blockCoord.x, blockCoord.y, blockCoord.z);
+    size_t mask = mHashKeys.size() - 1;
+    size_t slot = hashKey(key) & mask;
+    for (; mHashKeys[slot] != EmptyKey; slot = (slot + 1) & mask) {
+        if (mHashKeys[slot] == key) {
+            return mHashBlocks[slot];
+        }
+    }
+
+    uint32_t blockIdx = blockCount();
+    mHashKeys[slot] = key;
+    mHashBlocks[slot] = blockIdx;
+    mBlockCoords.push_back(blockCoord);
+    mBlockUpdateFrames.push_back(0);
+    mSdf.resize(mSdf.size() + BlockVoxels, SdfMax);
+    mWeights.resize(mWeights.size() + BlockVoxels, 0);
+    if (mSettings.colors) {
+        mColors.resize(mColors.size() + BlockVoxels * 3, 0);
+    }
+    if (mBlockCoords.size() * 2 > mHashKeys.size()) {
+        rehash(mHashKeys.size() * 2);
+    }
+    return blockIdx;
+}
+
+void TsdfVolume::rehash(size_t capacity)
+{
+    std::vector<uint64_t> keys(capacity, EmptyKey);
+    std::vector<uint32_t> blocks(capacity, InvalidBlock);
+    size_t mask = capacity - 1;
+    for (size_t i = 0; i < mHashKeys.size(); ++i) {
+        if (mHashKeys[i] == EmptyKey) {
+            continue;
+        }
+        size_t slot = hashKey(mHashKeys[i]) & mask;
+        while (keys[slot] != EmptyKey) {
+            slot = (slot + 1) & mask;
+        }
+        keys[slot] = mHashKeys[i];
+        blocks[slot] = mHashBlocks[i];
+    }
+    mHashKeys.swap(keys);
+    mHashBlocks.swap(blocks);
+}
+
+bool TsdfVolume::integrate(const uint16_t* depth, float depthScale, const CameraIntrinsics& intrinsics,
+                           const glm::mat4& cameraToWorld, const ColorImage& color)
+{
+    return integrateImage(depth, depthScale, intrinsics, cameraToWorld, color);
+}
+
+bool TsdfVolume::integrate(const float* depth, const CameraIntrinsics& intrinsics,
+                           const glm::mat4& cameraToWorld, const ColorImage& color)
+{
+    return integrateImage(depth, 1.f, intrinsics, cameraToWorld, color);
+}
+
+template <typename Depth>
+bool TsdfVolume::integrateImage(const Depth* depth, float depthScale, const CameraIntrinsics& intrinsics,
+                                const glm::mat4& cameraToWorld, const ColorImage& color)
+{
+    if (!depth || intrinsics.width == 0 || intrinsics.height == 0 || intrinsics.fx == 0.f || intrinsics.fy == 0.f) {
+        qWarning("TSDF integration without depth image or intrinsics");
+        return false;
+    }
+    auto start = std::chrono::steady_clock::now();
+    ++mStats.frame;
+    mStats.threads = mPool->threadCount();
+
+    // 1. Blocks along rays inside truncation band - every thread collects its own set of keys, then they are merged
+    collectBlocks(depth, depthScale, intrinsics, cameraToWorld);
+    uint32_t blocksBefore = blockCount();
+    allocateBlocks();
+    mStats.allocatedBlocks = blockCount() - blocksBefore;
+    mStats.touchedBlocks = static_cast<uint32_t>(mFrameBlocks.size());
+    auto allocated = std::chrono::steady_clock::now();
+
+    // 2. Voxels of touched blocks - blocks behind surface or out of image are cheap, stealing balances them
+    glm::mat4 worldToCamera = glm::inverse(cameraToWorld);
+    ColorImage frameColor = mSettings.colors && color.pixels && color.width && color.height ? color : ColorImage();
+    mPool->parallelFor(mFrameBlocks.size(), IntegrateGrain, [&](size_t first, size_t last, uint32_t /*threadIdx*/) {
+        for (size_t i = first; i < last; ++i) {
+            integrateBlock(mFrameBlocks[i], depth, depthScale, intrinsics, worldToCamera, frameColor);
+        }
+    });
+    auto end = std::chrono::steady_clock::now();
+
+    mStats.blocks = blockCount();
+    mStats.bytes = memoryBytes();
+    mStats.allocateMs = std::chrono::duration<double, std::milli>(allocated - start).count();
+    mStats.integrateMs = std::chrono::duration<double, std::milli>(end - allocated).count();
+    mStats.totalMs = std::chrono::duration<double, std::milli>(end - start).count();
+    return true;
+}
+
+template <typename Depth>
+void TsdfVolume::collectBlocks(const Depth* depth, float depthScale, const CameraIntrinsics& intrinsics, const glm::mat4& cameraToWorld)
+{
+    uint32_t threads = mPool->threadCount();
+    mThreadKeys.resize(threads);
+    mThreadKeyCounts.assign(threads, 0);
+    for (std::vector<uint64_t>& keys : mThreadKeys) {
+        keys.assign(std::max<size_t>(keys.size(), 1024), EmptyKey);
+    }
+
+    const float blockScale = 1.f / (mSettings.voxelSize * BlockSize); // world -> block coordinates
+    const glm::vec3 origin = glm::vec3(cameraToWorld[3]) * blockScale;
+    const glm::vec3 axisX = glm::vec3(cameraToWorld[0]) * blockScale;
+    const glm::vec3 axisY = glm::vec3(cameraToWorld[1]) * blockScale;
+    const glm::vec3 axisZ = glm::vec3(cameraToWorld[2]) * blockScale;
+    const uint32_t rows = (intrinsics.height + RayStride - 1) / RayStride;
+
+    mPool->parallelFor(rows, CollectGrain, [&](size_t firstRow, size_t lastRow, uint32_t threadIdx) {
+        std::vector<uint64_t>& keys = mThreadKeys[threadIdx];
+        uint32_t& keyCount = mThreadKeyCounts[threadIdx];
+        uint64_t lastKey = EmptyKey; // neighbour rays mostly hit the same block
+        for (size_t row = firstRow; row < lastRow; ++row) {
+            uint32_t v = static_cast<uint32_t>(row * RayStride);
+            const Depth* depthRow = depth + size_t(v) * intrinsics.width;
+            glm::vec3 rowDir = axisZ + axisY * ((v - intrinsics.cy) / intrinsics.fy);
+            for (uint32_t u = 0; u < intrinsics.width; u += RayStride) {
+                float d = depthValue(depthRow[u], depthScale);
+                if (!(d >= mSettings.minDepth && d <= mSettings.maxDepth)) {
+                    continue;
+                }
+                // ray point at camera depth t is origin + dir * t, band is [d - truncation, d + truncation]
+                glm::vec3 dir = rowDir + axisX * ((u - intrinsics.cx) / intrinsics.fx);
+                glm::vec3 a = origin + dir * std::max(d - mSettings.truncation, 0.f);
+                glm::vec3 b = origin + dir * (d + mSettings.truncation);
+
+                // 3D DDA over blocks from a to b
+                const float from[3] = {a.x, a.y, a.z};
+                const float delta[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+                int32_t cell[3], endCell[3], step[3];
+                float tMax[3], tDelta[3];
+                for (int i = 0; i < 3; ++i) {
+                    cell[i] = static_cast<int32_t>(std::floor(from[i]));
+                    endCell[i] = static_cast<int32_t>(std::floor(from[i] + delta[i]));
+                    step[i] = delta[i] >= 0.f ? 1 : -1;
+                    if (delta[i] != 0.f) {
+                        float boundary = static_cast<float>(step[i] > 0 ? cell[i] + 1 : cell[i]);
+                        tMax[i] = (boundary - from[i]) / delta[i];
+                        tDelta[i] = std::fabs(1.f / delta[i]);
+                    }
+                    else {
+                        tMax[i] = tDelta[i] = std::numeric_limits<float>::infinity();
+                    }
+                }
+                for (int s = 0; s < 3 * 64; ++s) { // band is a few blocks long, limit guards against rounding
+                    uint64_t key = packKey(cell[0], cell[1], cell[2]);
+                    if (key != lastKey) {
+                        insertKey(keys, keyCount, key);
+                        lastKey = key;
+                    }
+                    if (cell[0] == endCell[0] && cell[1] == endCell[1] && cell[2] == endCell[2]) {
+                        break;
+                    }
+                    int axis = tMax[0] < tMax[1] ? (tMax[0] < tMax[2] ? 0 : 2) : (tMax[1] < tMax[2] ? 1 : 2);
+                    if (tMax[axis] > 1.f) {
+                        break;
+                    }
+                    cell[axis] += step[axis];
+                    tMax[axis] += tDelta[axis];
+                }
+            }
+        }
+    });
+}
+
+void TsdfVolume::allocateBlocks()
+{
+    mFrameBlocks.clear();
+    for (const std::vector<uint64_t>& keys : mThreadKeys) {
+        for (uint64_t key : keys) {
+            if (key == EmptyKey) {
+                continue;
+            }
+            uint32_t blockIdx = insertBlock(unpackKey(key));
+            if (mBlockUpdateFrames[blockIdx] != mStats.frame) { // the same block can be seen by several threads
+                mBlockUpdateFrames[blockIdx] = mStats.frame;
+                mFrameBlocks.push_back(blockIdx);
+            }
+        }
+    }
+    // neighbour blocks next to each other in memory
+    std::sort(mFrameBlocks.begin(), mFrameBlocks.end());
+}
+
+template <typename Depth>
+void TsdfVolume::integrateBlock(uint32_t blockIdx, const Depth* depth, float depthScale, const CameraIntrinsics& intrinsics,
+                                const glm::mat4& worldToCamera, const ColorImage& color)
+{
+    // locals - writes through uint8_t pointers below could alias members, compiler would reload them per voxel
+    const float voxelSize = mSettings.voxelSize;
+    const float truncation = mSettings.truncation;
+    const float minDepth = mSettings.minDepth;
+    const float maxDepth = mSettings.maxDepth;
+    const float toSdf = SdfMax / truncation;
+    const uint32_t maxWeight = mSettings.maxWeight;
+    const float fx = intrinsics.fx;
+    const float fy = intrinsics.fy;
+    const float cx = intrinsics.cx;
+    const float cy = intrinsics.cy;
+    const uint32_t width = intrinsics.width;
+    const uint32_t height = intrinsics.height;
+    const float maxU = static_cast<float>(width) - 0.5f;
+    const float maxV = static_cast<float>(height) - 0.5f;
+
+    // camera space of voxel centers: first + stepX * x + stepY * y + stepZ * z
+    glm::vec3 firstCenter = blockOrigin(blockIdx) + glm::vec3(0.5f * voxelSize);
+    glm::vec3 first = glm::vec3(worldToCamera * glm::vec4(firstCenter, 1.f));
+    glm::vec3 stepX = glm::vec3(worldToCamera[0]) * voxelSize;
+    glm::vec3 stepY = glm::vec3(worldToCamera[1]) * voxelSize;
+    glm::vec3 stepZ = glm::vec3(worldToCamera[2]) * voxelSize;
+
+    int16_t* sdf = mSdf.data() + size_t(blockIdx) * BlockVoxels;
+    uint8_t* weights = mWeights.data() + size_t(blockIdx) * BlockVoxels;
+    uint8_t* colors = color.pixels ? mColors.data() + size_t(blockIdx) * BlockVoxels * 3 : nullptr;
+
+    int voxelIdx = 0;
+    for (int z = 0; z < BlockSize; ++z) {
+        for (int y = 0; y < BlockSize; ++y) {
+            glm::vec3 p = first + stepY * static_cast<float>(y) + stepZ * static_cast<float>(z);
+            for (int x = 0; x < BlockSize; ++x, ++voxelIdx, p += stepX) {
+                if (p.z < minDepth) {
+                    continue;
+                }
+                float invZ = 1.f / p.z;
+                float u = fx * p.x * invZ + cx;
+                float v = fy * p.y * invZ + cy;
+                if (!(u >= -0.5f && u < maxU && v >= -0.5f && v < maxV)) {
+                    continue;
+                }
+                uint32_t pixelU = static_cast<uint32_t>(u + 0.5f);
+                uint32_t pixelV = static_cast<uint32_t>(v + 0.5f);
+                float d = depthValue(depth[size_t(pixelV) * width + pixelU], depthScale);
+                if (!(d >= minDepth && d <= maxDepth)) {
+                    continue;
+                }
+                float distance = d - p.z; // projective distance - along camera axis
+                if (distance < -truncation) {
+                    continue; // occluded
+                }
+                float observed = std::min(distance, truncation) * toSdf;
+
+                uint32_t weight = weights[voxelIdx];
+                float fused = (sdf[voxelIdx] * static_cast<float>(weight) + observed) / static_cast<float>(weight + 1);
+                sdf[voxelIdx] = static_cast<int16_t>(fused + (fused >= 0.f ? 0.5f : -0.5f));
+                weights[voxelIdx] = static_cast<uint8_t>(std::min(weight + 1, maxWeight));
+
+                if (colors) {
+                    uint32_t colorU = static_cast<uint32_t>(uint64_t(pixelU) * color.width / width);
+                    uint32_t colorV = static_cast<uint32_t>(uint64_t(pixelV) * color.height / height);
+                    uint32_t rgba = color.pixels[size_t(colorV) * color.width + colorU];
+                    uint8_t* rgb = colors + voxelIdx * 3;
+                    for (int c = 0; c < 3; ++c) {
+                        uint32_t channel = (rgba >> (8 * c)) & 0xff;
+                        rgb[c] = static_cast<uint8_t>((rgb[c] * weight + channel) / (weight + 1));
+                    }
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,152 @@
+/*
+MIT License
+
+Copyright (c) 2019 Karolpg
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in all
+copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+SOFTWARE.
+*/
+
+#pragma once
+
+#include "DepthBackProjector.hpp"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+class WorkStealingPool;
+
+///
+/// Sparse truncated signed distance volume (voxel hashing). Space is divided into blocks of 8^3 voxels,
+/// blocks are allocated only where depth frames see a surface - along every camera ray inside the truncation band.
+/// Block coordinates are found through open addressing hash table, voxels of all blocks live in pooled arrays:
+///     signed distance - int16 of [-truncation, truncation], weight - uint8 observation count (clamped),
+///     color (optional) - RGB8,
+/// i.e. 1.5 KiB per block, 3 KiB with colors.
+/// integrate() updates all blocks touched by the frame in parallel (WorkStealingPool), each block remembers
+/// frame of its last update, so mesh extraction can process only changed blocks.
+///
+class TsdfVolume
+{
+public:
+    static const int BlockSize = 8;  // voxels along block edge
+    static const int BlockVoxels = BlockSize * BlockSize * BlockSize;
+    static const uint32_t InvalidBlock = ~0u;
+    static const int16_t SdfMax = 32767; // truncation distance - also value of not observed voxel
+
+    struct Settings {
+        float voxelSize = 0.01f;   // meters
+        float truncation = 0.04f;  // meters, at least one voxel
+        float minDepth = 0.1f;     // meters, depth out of range is not integrated
+        float maxDepth = 5.f;
+        uint8_t maxWeight = 64;    // older observations are forgotten slower with higher value
+        bool colors = true;
+        uint32_t threads = 0;      // 0 - hardware concurrency
+    };
+
+    struct Stats {
+        uint32_t frame = 0;            // frames integrated so far
+        uint32_t touchedBlocks = 0;    // blocks updated by the last frame
+        uint32_t allocatedBlocks = 0;  // blocks created by the last frame
+        uint32_t blocks = 0;
+        uint64_t bytes = 0;            // voxels and hash table
+        uint32_t threads = 0;
+        double allocateMs = 0.0;
+        double integrateMs = 0.0;
+        double totalMs = 0.0;
+    };
+
+    TsdfVolume();
+    ~TsdfVolume();
+
+    ///
+    /// Clears the volume
+    ///
+    void setSettings(const Settings& settings);
+    const Settings& settings() const { return mSettings; }
+    void clear();
+
+    ///
+    /// Fuses depth frame (meters = value * depthScale) seen from cameraToWorld pose. Camera space is the same as
+    /// of DepthBackProjector - x right, y down, z forward. Color image is used when Settings::colors is set.
+    ///
+    bool integrate(const uint16_t* depth, float depthScale, const CameraIntrinsics& intrinsics,
+                   const glm::mat4& cameraToWorld, const ColorImage& color = ColorImage());
+    bool integrate(const float* depth, const CameraIntrinsics& intrinsics,
+                   const glm::mat4& cameraToWorld, const ColorImage& color = ColorImage());
+
+    const Stats& stats() const { return mStats; }
+
+    //
+    // Block access - block index is stable until clear()
+    //
+    uint32_t blockCount() const { return static_cast<uint32_t>(mBlockCoords.size()); }
+    uint32_t clearCount() const { return mClearCount; } // changes with every clear() - block indices are reused after it
+    uint32_t findBlock(const glm::ivec3& blockCoord) const;
+    const glm::ivec3& blockCoord(uint32_t blockIdx) const { return mBlockCoords[blockIdx]; }
+    glm::vec3 blockOrigin(uint32_t blockIdx) const { return glm::vec3(mBlockCoords[blockIdx]) * (mSettings.voxelSize * BlockSize); }
+    uint32_t blockUpdateFrame(uint32_t blockIdx) const { return mBlockUpdateFrames[blockIdx]; }
+
+    ///
+    /// Voxels of block, index x + y * BlockSize + z * BlockSize^2. Distance in meters = sdf * truncation / SdfMax.
+    ///
+    const int16_t* blockSdf(uint32_t blockIdx) const { return mSdf.data() + size_t(blockIdx) * BlockVoxels; }
+    const uint8_t* blockWeights(uint32_t blockIdx) const { return mWeights.data() + size_t(blockIdx) * BlockVoxels; }
+    const uint8_t* blockColors(uint32_t blockIdx) const; // RGB, nullptr without colors
+
+    uint64_t memoryBytes() const;
+
+    TsdfVolume(const TsdfVolume&) = delete;
+    TsdfVolume& operator=(const TsdfVolume&) = delete;
+
+protected:
+    template <typename Depth>
+    bool integrateImage(const Depth* depth, float depthScale, const CameraIntrinsics& intrinsics,
+                        const glm::mat4& cameraToWorld, const ColorImage& color);
+
+    template <typename Depth>
+    void collectBlocks(const Depth* depth, float depthScale, const CameraIntrinsics& intrinsics, const glm::mat4& cameraToWorld);
+    void allocateBlocks();
+
+    template <typename Depth>
+    void integrateBlock(uint32_t blockIdx, const Depth* depth, float depthScale, const CameraIntrinsics& intrinsics,
+                        const glm::mat4& worldToCamera, const ColorImage& color);
+
+    uint32_t insertBlock(const glm::ivec3& blockCoord);
+    void rehash(size_t capacity);
+
+    Settings mSettings;
+    Stats mStats;
+    uint32_t mClearCount = 0;
+    std::unique_ptr<WorkStealingPool> mPool;
+
+    // open addressing, linear probing - capacity is power of two, load at most 1/2
+    std::vector<uint64_t> mHashKeys;   // packed block coordinates, EmptyKey - free slot
+    std::vector<uint32_t> mHashBlocks; // block index
+
+    std::vector<glm::ivec3> mBlockCoords;      // [blockIdx]
+    std::vector<uint32_t> mBlockUpdateFrames;  // [blockIdx]
+    std::vector<int16_t> mSdf;                 // [blockIdx * BlockVoxels + voxelIdx]
+    std::vector<uint8_t> mWeights;
+    std::vector<uint8_t> mColors;              // RGB
+
+    std::vector<std::vector<uint64_t>> mThreadKeys; // [threadIdx] - open addressing sets of block keys seen by ray casting
+    std::vector<uint32_t> mThreadKeyCounts;
+    std::vector<uint32_t> mFrameBlocks;             // blocks touched by current frame
+};
@@ -0,0 +1,18 @@
+#version 450
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in mat4 instanceModel; // locations 1-4, per instance
+layout(location = 5) in vec4 instanceColor; // per instance
+
+layout(location = 0) out vec3 posOut;
+layout(location = 1) out vec4 colorOut;
+
+layout(binding = 0) uniform buf {
+                                    mat4 viewProj;
+                                } uniformBuf;
+
+void main() {
+    posOut = pos;
+    colorOut = instanceColor;
+    gl_Position = uniformBuf.viewProj * instanceModel * vec4(pos, 1.0);
+}
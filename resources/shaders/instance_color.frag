@@ -0,0 +1,11 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 pixelPos;
+layout(location = 1) in vec4 instanceColor;
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    vec3 gradient = (pixelPos + 1.0)/2.0;
+    outColor = vec4(mix(gradient, instanceColor.rgb, instanceColor.a), 1.0);
+}
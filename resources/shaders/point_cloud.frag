@@ -0,0 +1,10 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec4 color;
+layout(location = 0) out vec4 outColor;
+
+// Square points - no discard, so early depth test is kept for tens of millions of points
+void main() {
+    outColor = vec4(color.rgb, 1.0);
+}
@@ -0,0 +1,20 @@
+#version 450
+
+layout(location = 0) in vec3 pos;   // world space
+layout(location = 1) in uint color; // RGBA8 - red in the lowest byte
+
+layout(location = 0) out vec4 colorOut;
+
+layout(binding = 0) uniform buf {
+                                    mat4 viewProj;
+                                    vec4 cameraPos; // xyz - world space
+                                    vec4 pointSize; // x - size, y - pixels per world unit at distance 1 (0 - x is in pixels), zw - min/max in pixels
+                                } uniformBuf;
+
+void main() {
+    colorOut = unpackUnorm4x8(color);
+    gl_Position = uniformBuf.viewProj * vec4(pos, 1.0);
+    float size = uniformBuf.pointSize.y > 0.0 ? uniformBuf.pointSize.x * uniformBuf.pointSize.y / max(gl_Position.w, 0.0001)
+                                              : uniformBuf.pointSize.x;
+    gl_PointSize = clamp(size, uniformBuf.pointSize.z, uniformBuf.pointSize.w);
+}
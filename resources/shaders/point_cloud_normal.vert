@@ -0,0 +1,26 @@
+#version 450
+
+layout(location = 0) in vec3 pos;    // world space
+layout(location = 1) in uint color;  // RGBA8 - red in the lowest byte
+layout(location = 2) in uint normal; // xyz - snorm8
+
+layout(location = 0) out vec4 colorOut;
+
+layout(binding = 0) uniform buf {
+                                    mat4 viewProj;
+                                    vec4 cameraPos; // xyz - world space
+                                    vec4 pointSize; // x - size, y - pixels per world unit at distance 1 (0 - x is in pixels), zw - min/max in pixels
+                                } uniformBuf;
+
+void main() {
+    // Head light - scanned surfaces are not oriented consistently, both sides are lit
+    vec3 n = normalize(unpackSnorm4x8(normal).xyz);
+    vec3 l = normalize(uniformBuf.cameraPos.xyz - pos);
+    vec4 baseColor = unpackUnorm4x8(color);
+    colorOut = vec4(baseColor.rgb * (0.3 + 0.7 * abs(dot(n, l))), baseColor.a);
+
+    gl_Position = uniformBuf.viewProj * vec4(pos, 1.0);
+    float size = uniformBuf.pointSize.y > 0.0 ? uniformBuf.pointSize.x * uniformBuf.pointSize.y / max(gl_Position.w, 0.0001)
+                                              : uniformBuf.pointSize.x;
+    gl_PointSize = clamp(size, uniformBuf.pointSize.z, uniformBuf.pointSize.w);
+}
@@ -0,0 +1,16 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+layout(location = 1) in vec2 texCoord;
+layout(location = 0) out vec4 outColor;
+
+layout (set = 1, binding = 0) uniform sampler2D bindlessTextures[];
+
+layout (push_constant) uniform material {
+    uint textureIdx;
+} materialInfo;
+
+void main() {
+    outColor = texture(bindlessTextures[materialInfo.textureIdx], texCoord);
+}
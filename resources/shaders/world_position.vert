@@ -0,0 +1,14 @@
+#version 450
+
+layout(location = 0) in vec3 pos; // already in world space
+
+layout(location = 0) out vec3 posOut;
+
+layout(binding = 0) uniform buf {
+                                    mat4 viewProj;
+                                } uniformBuf;
+
+void main() {
+    posOut = fract(pos * 0.25) * 2.0 - 1.0; // repeated gradient
+    gl_Position = uniformBuf.viewProj * vec4(pos, 1.0);
+}